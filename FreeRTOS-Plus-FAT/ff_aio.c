@@ -0,0 +1,408 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/*
+	ff_aio.c
+
+	Asynchronous file I/O: requests are kept in a single queue, ordered by
+	priority, and executed by ffconfigAIO_WORKER_COUNT worker tasks which are
+	started when the first request is submitted.  A worker will not take a
+	request for a file that another worker is busy with, and a new request is
+	never queued in front of an earlier request for the same file, so the
+	requests for one file are executed in the order of submission.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+#include "portable.h"
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_aio.h"
+
+#if( ffconfigAIO_SUPPORT != 0 )
+
+#define FF_AIO_READ		1
+#define FF_AIO_WRITE	2
+#define FF_AIO_FSYNC	3
+
+/* Values of xAIOState. */
+#define FF_AIO_STOPPED	0
+#define FF_AIO_STARTING	1	/* A task is creating the workers. */
+#define FF_AIO_RUNNING	2
+
+/* The requests that have not been taken by a worker yet. */
+static FF_AIORequest_t *pxAIOQueue = NULL;
+
+/* The file that each worker is currently busy with. */
+static FF_FILE *pxAIOBusyFiles[ ffconfigAIO_WORKER_COUNT ];
+
+static TaskHandle_t xAIOWorkers[ ffconfigAIO_WORKER_COUNT ];
+static BaseType_t xAIOState = FF_AIO_STOPPED;
+
+static BaseType_t FF_AIOStart( void );
+static int FF_AIOSubmit( FF_AIORequest_t *pxRequest, uint8_t ucOperation );
+static FF_AIORequest_t *FF_AIOTake( FF_FILE **ppxBusyFile );
+static void FF_AIOExecute( FF_AIORequest_t *pxRequest );
+static void FF_AIOComplete( FF_AIORequest_t *pxRequest );
+static void FF_AIOWakeWorkers( void );
+static void FF_AIOWorker( void *pvParameters );
+
+/*-----------------------------------------------------------*/
+
+int ff_aio_read( FF_AIORequest_t *pxRequest )
+{
+	return FF_AIOSubmit( pxRequest, FF_AIO_READ );
+}
+/*-----------------------------------------------------------*/
+
+int ff_aio_write( FF_AIORequest_t *pxRequest )
+{
+	return FF_AIOSubmit( pxRequest, FF_AIO_WRITE );
+}
+/*-----------------------------------------------------------*/
+
+int ff_aio_fsync( FF_AIORequest_t *pxRequest )
+{
+	return FF_AIOSubmit( pxRequest, FF_AIO_FSYNC );
+}
+/*-----------------------------------------------------------*/
+
+int ff_aio_cancel( FF_AIORequest_t *pxRequest )
+{
+FF_AIORequest_t **ppxLink;
+int iReturn = FF_AIO_ALLDONE;
+
+	taskENTER_CRITICAL();
+	{
+		if( pxRequest->xStatus == eAIOQueued )
+		{
+			for( ppxLink = &pxAIOQueue; *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+			{
+				if( *ppxLink == pxRequest )
+				{
+					*ppxLink = pxRequest->pxNext;
+					break;
+				}
+			}
+			pxRequest->pxNext = NULL;
+			pxRequest->lResult = -1;
+			pxRequest->iErrno = pdFREERTOS_ERRNO_ECANCELED;
+			pxRequest->xStatus = eAIOCancelled;
+			iReturn = FF_AIO_CANCELED;
+		}
+		else if( pxRequest->xStatus == eAIOBusy )
+		{
+			iReturn = FF_AIO_NOTCANCELED;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return iReturn;
+}	/* ff_aio_cancel() */
+/*-----------------------------------------------------------*/
+
+BaseType_t ff_aio_done( const FF_AIORequest_t *pxRequest )
+{
+BaseType_t xReturn;
+
+	xReturn = ( pxRequest->xStatus != eAIOQueued ) && ( pxRequest->xStatus != eAIOBusy );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t FF_AIOStart( void )
+{
+BaseType_t xIndex;
+BaseType_t xState;
+BaseType_t xCreated = 0;
+
+	for( ;; )
+	{
+		taskENTER_CRITICAL();
+		{
+			xState = xAIOState;
+			if( xState == FF_AIO_STOPPED )
+			{
+				xAIOState = FF_AIO_STARTING;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		if( xState != FF_AIO_STARTING )
+		{
+			break;
+		}
+
+		/* Another task is creating the workers.  A request may only be
+		queued once it is sure that there are workers to execute it. */
+		vTaskDelay( 1 );
+	}
+
+	if( xState == FF_AIO_RUNNING )
+	{
+		return pdPASS;
+	}
+
+	for( xIndex = 0; xIndex < ffconfigAIO_WORKER_COUNT; xIndex++ )
+	{
+		if( xTaskCreate( FF_AIOWorker, "FF_AIO", ffconfigAIO_WORKER_STACK_SIZE, &( pxAIOBusyFiles[ xIndex ] ),
+			ffconfigAIO_WORKER_PRIORITY, &( xAIOWorkers[ xIndex ] ) ) == pdPASS )
+		{
+			xCreated++;
+		}
+		else
+		{
+			xAIOWorkers[ xIndex ] = NULL;
+		}
+	}
+
+	taskENTER_CRITICAL();
+	{
+		/* When no worker could be created, a later call will try again. */
+		xAIOState = ( xCreated != 0 ) ? FF_AIO_RUNNING : FF_AIO_STOPPED;
+	}
+	taskEXIT_CRITICAL();
+
+	return ( xCreated != 0 ) ? pdPASS : pdFAIL;
+}	/* FF_AIOStart() */
+/*-----------------------------------------------------------*/
+
+static int FF_AIOSubmit( FF_AIORequest_t *pxRequest, uint8_t ucOperation )
+{
+FF_AIORequest_t **ppxLink;
+FF_AIORequest_t **ppxInsert;
+int iErrno = 0;
+
+	if( ( pxRequest == NULL ) || ( pxRequest->pxFile == NULL ) ||
+		( ( ucOperation != FF_AIO_FSYNC ) && ( pxRequest->pvBuffer == NULL ) && ( pxRequest->ulLength != 0ul ) ) )
+	{
+		iErrno = pdFREERTOS_ERRNO_EINVAL;
+	}
+	else if( FF_AIOStart() == pdFAIL )
+	{
+		iErrno = pdFREERTOS_ERRNO_ENOMEM;
+	}
+	else
+	{
+		taskENTER_CRITICAL();
+		{
+			if( ( pxRequest->xStatus == eAIOQueued ) || ( pxRequest->xStatus == eAIOBusy ) )
+			{
+				iErrno = pdFREERTOS_ERRNO_EBUSY;
+			}
+			else
+			{
+				pxRequest->ucOperation = ucOperation;
+				pxRequest->lResult = 0;
+				pxRequest->iErrno = 0;
+				pxRequest->xStatus = eAIOQueued;
+
+				/* Find the place behind all requests with the same or a higher
+				priority, and behind any earlier request for the same file. */
+				ppxInsert = &pxAIOQueue;
+				for( ppxLink = &pxAIOQueue; *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+				{
+					if( ( ( *ppxLink )->uxPriority >= pxRequest->uxPriority ) ||
+						( ( *ppxLink )->pxFile == pxRequest->pxFile ) )
+					{
+						ppxInsert = &( ( *ppxLink )->pxNext );
+					}
+				}
+				pxRequest->pxNext = *ppxInsert;
+				*ppxInsert = pxRequest;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		if( iErrno == 0 )
+		{
+			FF_AIOWakeWorkers();
+		}
+	}
+
+	stdioSET_ERRNO( iErrno );
+
+	return ( iErrno == 0 ) ? 0 : -1;
+}	/* FF_AIOSubmit() */
+/*-----------------------------------------------------------*/
+
+static FF_AIORequest_t *FF_AIOTake( FF_FILE **ppxBusyFile )
+{
+FF_AIORequest_t **ppxLink;
+FF_AIORequest_t *pxRequest = NULL;
+BaseType_t xIndex;
+
+	taskENTER_CRITICAL();
+	{
+		for( ppxLink = &pxAIOQueue; *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+		{
+			for( xIndex = 0; xIndex < ffconfigAIO_WORKER_COUNT; xIndex++ )
+			{
+				if( pxAIOBusyFiles[ xIndex ] == ( *ppxLink )->pxFile )
+				{
+					break;
+				}
+			}
+
+			if( xIndex == ffconfigAIO_WORKER_COUNT )
+			{
+				/* No other worker is using this file.  The queue order
+				guarantees that there is no earlier request for it. */
+				pxRequest = *ppxLink;
+				*ppxLink = pxRequest->pxNext;
+				pxRequest->pxNext = NULL;
+				pxRequest->xStatus = eAIOBusy;
+				*ppxBusyFile = pxRequest->pxFile;
+				break;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return pxRequest;
+}	/* FF_AIOTake() */
+/*-----------------------------------------------------------*/
+
+static void FF_AIOExecute( FF_AIORequest_t *pxRequest )
+{
+FF_FILE *pxFile = pxRequest->pxFile;
+int32_t lResult = 0;
+
+	if( ( pxRequest->ucOperation != FF_AIO_FSYNC ) && ( pxRequest->lOffset >= 0 ) &&
+		( ff_fseek( pxFile, pxRequest->lOffset, FF_SEEK_SET ) != 0 ) )
+	{
+		lResult = -1;
+	}
+	else switch( pxRequest->ucOperation )
+	{
+	case FF_AIO_READ:
+		lResult = ( int32_t ) ff_fread( pxRequest->pvBuffer, 1, pxRequest->ulLength, pxFile );
+		break;
+
+	case FF_AIO_WRITE:
+		lResult = ( int32_t ) ff_fwrite( pxRequest->pvBuffer, 1, pxRequest->ulLength, pxFile );
+		break;
+
+	default:
+		lResult = ( int32_t ) ff_fflush( pxFile );
+		break;
+	}
+
+	/* The stdio functions set errno of the calling task, which is this
+	worker. */
+	pxRequest->iErrno = stdioGET_ERRNO();
+	pxRequest->lResult = lResult;
+}	/* FF_AIOExecute() */
+/*-----------------------------------------------------------*/
+
+static void FF_AIOComplete( FF_AIORequest_t *pxRequest )
+{
+TaskHandle_t xNotifyTask = pxRequest->xNotifyTask;
+EventGroupHandle_t xEventGroup = pxRequest->xEventGroup;
+EventBits_t uxEventBits = pxRequest->uxEventBits;
+
+	/* The callback is called while the request is still 'busy', so it may
+	look at the request, but it may not submit it again. */
+	if( pxRequest->fnCallback != NULL )
+	{
+		pxRequest->fnCallback( pxRequest );
+	}
+
+	/* From here on the owner may reuse or free the request, so only the
+	local copies are used. */
+	pxRequest->xStatus = eAIODone;
+
+	if( xNotifyTask != NULL )
+	{
+		xTaskNotifyGive( xNotifyTask );
+	}
+
+	if( xEventGroup != NULL )
+	{
+		xEventGroupSetBits( xEventGroup, uxEventBits );
+	}
+}	/* FF_AIOComplete() */
+/*-----------------------------------------------------------*/
+
+static void FF_AIOWakeWorkers( void )
+{
+BaseType_t xIndex;
+TaskHandle_t xCurrent = xTaskGetCurrentTaskHandle();
+
+	for( xIndex = 0; xIndex < ffconfigAIO_WORKER_COUNT; xIndex++ )
+	{
+		if( ( xAIOWorkers[ xIndex ] != NULL ) && ( xAIOWorkers[ xIndex ] != xCurrent ) )
+		{
+			xTaskNotifyGive( xAIOWorkers[ xIndex ] );
+		}
+	}
+}	/* FF_AIOWakeWorkers() */
+/*-----------------------------------------------------------*/
+
+static void FF_AIOWorker( void *pvParameters )
+{
+/* The worker's entry in pxAIOBusyFiles[]. */
+FF_FILE **ppxBusyFile = ( FF_FILE ** ) pvParameters;
+FF_AIORequest_t *pxRequest;
+
+	for( ;; )
+	{
+		pxRequest = FF_AIOTake( ppxBusyFile );
+
+		if( pxRequest == NULL )
+		{
+			/* Wait until a request is submitted, or until another worker
+			has released a file. */
+			ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+			continue;
+		}
+
+		FF_AIOExecute( pxRequest );
+		FF_AIOComplete( pxRequest );
+
+		/* Only now release the file, so that completions are signalled in
+		the same order as the requests were submitted. */
+		taskENTER_CRITICAL();
+		{
+			*ppxBusyFile = NULL;
+		}
+		taskEXIT_CRITICAL();
+
+		/* The next request for this file may have been skipped by the other
+		workers. */
+		FF_AIOWakeWorkers();
+	}
+}	/* FF_AIOWorker() */
+/*-----------------------------------------------------------*/
+
+#endif /* ffconfigAIO_SUPPORT */
@@ -0,0 +1,664 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/*
+	ff_blkqueue.c
+
+	The block queue of an I/O manager holds at most ffconfigBLOCK_QUEUE_DEPTH
+	requests.  There is no separate task: the first task that finds the queue
+	idle becomes the dispatcher.  It selects a request, merges adjacent
+	requests of the same direction into it, calls the driver and wakes up the
+	owners of the requests that were served.  It keeps doing so until its own
+	request is done, and then hands over to the task of the most important
+	pending request.  While the driver is busy, other tasks add requests to
+	the queue, which is what makes merging across tasks possible.
+
+	A request is never served before an older request for overlapping sectors
+	when either of them is a write, so the order of reads and writes of the
+	same sector is kept.
+*/
+
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "ff_headers.h"
+#include "ff_blkqueue.h"
+
+#if( ffconfigBLOCK_QUEUE != 0 )
+
+#if( ffconfigBLOCK_QUEUE_MERGE_SECTORS < 1 )
+	#error ffconfigBLOCK_QUEUE_MERGE_SECTORS must be at least 1
+#endif
+
+/* Values of 'FF_BlockRequest_t::xState'. */
+#define blkqFREE		0
+#define blkqQUEUED		1
+#define blkqBUSY		2
+#define blkqDONE		3
+
+typedef struct xFF_BLOCK_REQUEST
+{
+	struct xFF_BLOCK_REQUEST *pxNext;	/* In the pending list, or in the batch that is executed. */
+	uint8_t *pucBuffer;
+	uint32_t ulSector;
+	uint32_t ulCount;
+	uint32_t ulSequence;				/* Order of arrival. */
+	TickType_t xArrival;
+	UBaseType_t uxPriority;				/* The priority of the task that made the request. */
+	BaseType_t xIsWrite;
+	volatile int32_t lResult;
+	volatile BaseType_t xState;
+	SemaphoreHandle_t xWake;			/* Given when the request is done, or to hand over dispatching. */
+} FF_BlockRequest_t;
+
+struct xFF_BLOCK_QUEUE
+{
+	FF_BlockRequest_t xRequests[ ffconfigBLOCK_QUEUE_DEPTH ];
+	FF_BlockRequest_t *pxPending;		/* The requests that wait to be selected, in no particular order. */
+	SemaphoreHandle_t xFreeSlots;		/* Counts the free entries in 'xRequests'. */
+	SemaphoreHandle_t xDriverMutex;		/* Taken around every call to the driver. */
+	SemaphoreHandle_t xCompletion;		/* Given by FF_BlockQueueComplete(). */
+	uint8_t *pucMergeBuffer;			/* ffconfigBLOCK_QUEUE_MERGE_SECTORS sectors. */
+	volatile int32_t lAsyncResult;
+	uint32_t ulHeadSector;				/* The sector that follows the last transfer. */
+	uint32_t ulSequence;
+	BaseType_t xDispatching;			/* A task is dispatching. */
+	FF_BlockQueueStats_t xStats;
+};
+
+typedef struct xFF_BLOCK_QUEUE FF_BlockQueue_t;
+
+static FF_BlockRequest_t *prvSelectBatch( FF_BlockQueue_t *pxQueue );
+static BaseType_t prvIsBlocked( FF_BlockQueue_t *pxQueue, FF_BlockRequest_t *pxRequest );
+static BaseType_t prvIsBetter( FF_BlockQueue_t *pxQueue, FF_BlockRequest_t *pxRequest, FF_BlockRequest_t *pxBest, TickType_t xNow );
+static void prvUnlink( FF_BlockQueue_t *pxQueue, FF_BlockRequest_t *pxRequest );
+static void prvDispatch( FF_IOManager_t *pxIOManager );
+static int32_t prvCallDriver( FF_IOManager_t *pxIOManager, uint8_t *pucBuffer, uint32_t ulSector, uint32_t ulCount,
+	BaseType_t xIsWrite );
+
+/*-----------------------------------------------------------*/
+
+FF_Error_t FF_BlockQueueCreate( FF_IOManager_t *pxIOManager )
+{
+FF_BlockQueue_t *pxQueue;
+FF_Error_t xError = FF_ERR_NONE;
+BaseType_t xIndex;
+
+	pxQueue = ( FF_BlockQueue_t * ) ffconfigMALLOC( sizeof( *pxQueue ) );
+	if( pxQueue == NULL )
+	{
+		xError = FF_ERR_NOT_ENOUGH_MEMORY | FF_CREATEIOMAN;
+	}
+	else
+	{
+		memset( pxQueue, '\0', sizeof( *pxQueue ) );
+		pxIOManager->pxBlockQueue = pxQueue;
+
+		pxQueue->pucMergeBuffer = ( uint8_t * ) ffconfigMALLOC( ( size_t ) ffconfigBLOCK_QUEUE_MERGE_SECTORS * pxIOManager->usSectorSize );
+		pxQueue->xFreeSlots = xSemaphoreCreateCounting( ffconfigBLOCK_QUEUE_DEPTH, ffconfigBLOCK_QUEUE_DEPTH );
+		pxQueue->xDriverMutex = xSemaphoreCreateMutex();
+		pxQueue->xCompletion = xSemaphoreCreateBinary();
+
+		if( ( pxQueue->pucMergeBuffer == NULL ) || ( pxQueue->xFreeSlots == NULL ) ||
+			( pxQueue->xDriverMutex == NULL ) || ( pxQueue->xCompletion == NULL ) )
+		{
+			xError = FF_ERR_NOT_ENOUGH_MEMORY | FF_CREATEIOMAN;
+		}
+
+		for( xIndex = 0; ( xIndex < ffconfigBLOCK_QUEUE_DEPTH ) && ( FF_isERR( xError ) == pdFALSE ); xIndex++ )
+		{
+			pxQueue->xRequests[ xIndex ].xWake = xSemaphoreCreateBinary();
+			if( pxQueue->xRequests[ xIndex ].xWake == NULL )
+			{
+				xError = FF_ERR_NOT_ENOUGH_MEMORY | FF_CREATEIOMAN;
+			}
+		}
+
+		if( FF_isERR( xError ) )
+		{
+			FF_BlockQueueDelete( pxIOManager );
+		}
+	}
+
+	return xError;
+}	/* FF_BlockQueueCreate() */
+/*-----------------------------------------------------------*/
+
+void FF_BlockQueueDelete( FF_IOManager_t *pxIOManager )
+{
+FF_BlockQueue_t *pxQueue = pxIOManager->pxBlockQueue;
+BaseType_t xIndex;
+
+	if( pxQueue != NULL )
+	{
+		for( xIndex = 0; xIndex < ffconfigBLOCK_QUEUE_DEPTH; xIndex++ )
+		{
+			if( pxQueue->xRequests[ xIndex ].xWake != NULL )
+			{
+				vSemaphoreDelete( pxQueue->xRequests[ xIndex ].xWake );
+			}
+		}
+		if( pxQueue->xCompletion != NULL )
+		{
+			vSemaphoreDelete( pxQueue->xCompletion );
+		}
+		if( pxQueue->xDriverMutex != NULL )
+		{
+			vSemaphoreDelete( pxQueue->xDriverMutex );
+		}
+		if( pxQueue->xFreeSlots != NULL )
+		{
+			vSemaphoreDelete( pxQueue->xFreeSlots );
+		}
+		if( pxQueue->pucMergeBuffer != NULL )
+		{
+			ffconfigFREE( pxQueue->pucMergeBuffer );
+		}
+		ffconfigFREE( pxQueue );
+		pxIOManager->pxBlockQueue = NULL;
+	}
+}	/* FF_BlockQueueDelete() */
+/*-----------------------------------------------------------*/
+
+int32_t FF_BlockQueueTransfer( FF_IOManager_t *pxIOManager, uint32_t ulSectorLBA, uint32_t ulNumSectors,
+	uint8_t *pucBuffer, BaseType_t xIsWrite )
+{
+FF_BlockQueue_t *pxQueue = pxIOManager->pxBlockQueue;
+FF_BlockRequest_t *pxRequest = NULL;
+FF_BlockRequest_t *pxHandOver;
+FF_BlockRequest_t *pxPending;
+BaseType_t xIndex;
+BaseType_t xLead = pdFALSE;
+BaseType_t xDone = pdFALSE;
+int32_t lResult;
+
+	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+	{
+		/* Nobody can wait yet, call the driver directly. */
+		return prvCallDriver( pxIOManager, pucBuffer, ulSectorLBA, ulNumSectors, xIsWrite );
+	}
+
+	xSemaphoreTake( pxQueue->xFreeSlots, portMAX_DELAY );
+
+	taskENTER_CRITICAL();
+	{
+		for( xIndex = 0; xIndex < ffconfigBLOCK_QUEUE_DEPTH; xIndex++ )
+		{
+			if( pxQueue->xRequests[ xIndex ].xState == blkqFREE )
+			{
+				pxRequest = &( pxQueue->xRequests[ xIndex ] );
+				break;
+			}
+		}
+		/* The counting semaphore guarantees a free entry. */
+		configASSERT( pxRequest != NULL );
+
+		pxRequest->pucBuffer = pucBuffer;
+		pxRequest->ulSector = ulSectorLBA;
+		pxRequest->ulCount = ulNumSectors;
+		pxRequest->ulSequence = pxQueue->ulSequence++;
+		pxRequest->xArrival = xTaskGetTickCount();
+		pxRequest->uxPriority = uxTaskPriorityGet( NULL );
+		pxRequest->xIsWrite = xIsWrite;
+		pxRequest->lResult = 0;
+		pxRequest->xState = blkqQUEUED;
+		/* A hand-over that came too late may have left the semaphore given. */
+		( void ) xSemaphoreTake( pxRequest->xWake, 0 );
+		pxRequest->pxNext = pxQueue->pxPending;
+		pxQueue->pxPending = pxRequest;
+		pxQueue->xStats.ulRequests++;
+
+		if( pxQueue->xDispatching == pdFALSE )
+		{
+			pxQueue->xDispatching = pdTRUE;
+			xLead = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	while( xDone == pdFALSE )
+	{
+		if( xLead != pdFALSE )
+		{
+			prvDispatch( pxIOManager );
+
+			pxHandOver = NULL;
+			taskENTER_CRITICAL();
+			{
+				xDone = ( pxRequest->xState == blkqDONE );
+				if( xDone != pdFALSE )
+				{
+					/* Let the task with the most important request continue
+					dispatching, rather than lending it this task's time. */
+					pxQueue->xDispatching = pdFALSE;
+					for( pxPending = pxQueue->pxPending; pxPending != NULL; pxPending = pxPending->pxNext )
+					{
+						if( ( pxHandOver == NULL ) || ( pxPending->uxPriority > pxHandOver->uxPriority ) )
+						{
+							pxHandOver = pxPending;
+						}
+					}
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( pxHandOver != NULL )
+			{
+				xSemaphoreGive( pxHandOver->xWake );
+			}
+		}
+		else
+		{
+			xSemaphoreTake( pxRequest->xWake, portMAX_DELAY );
+
+			taskENTER_CRITICAL();
+			{
+				xDone = ( pxRequest->xState == blkqDONE );
+				if( ( xDone == pdFALSE ) && ( pxQueue->xDispatching == pdFALSE ) )
+				{
+					pxQueue->xDispatching = pdTRUE;
+					xLead = pdTRUE;
+				}
+			}
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	lResult = pxRequest->lResult;
+
+	taskENTER_CRITICAL();
+	{
+		pxRequest->xState = blkqFREE;
+	}
+	taskEXIT_CRITICAL();
+
+	xSemaphoreGive( pxQueue->xFreeSlots );
+
+	if( xLead != pdFALSE )
+	{
+		/* The dispatcher has just woken the tasks of the other requests in
+		its batches.  Let those of equal priority queue their next requests
+		before this task adds its own, so they can be merged. */
+		taskYIELD();
+	}
+
+	return lResult;
+}	/* FF_BlockQueueTransfer() */
+/*-----------------------------------------------------------*/
+
+/* Select the next request, and merge the pending requests that continue it
+on either side.  Returns the batch in sector order, or NULL. */
+static FF_BlockRequest_t *prvSelectBatch( FF_BlockQueue_t *pxQueue )
+{
+FF_BlockRequest_t *pxBest = NULL;
+FF_BlockRequest_t *pxLast;
+FF_BlockRequest_t *pxRequest;
+TickType_t xNow = xTaskGetTickCount();
+uint32_t ulFirst;
+uint32_t ulEnd;
+BaseType_t xFound;
+
+	taskENTER_CRITICAL();
+	{
+		for( pxRequest = pxQueue->pxPending; pxRequest != NULL; pxRequest = pxRequest->pxNext )
+		{
+			if( ( prvIsBlocked( pxQueue, pxRequest ) == pdFALSE ) &&
+				( ( pxBest == NULL ) || ( prvIsBetter( pxQueue, pxRequest, pxBest, xNow ) != pdFALSE ) ) )
+			{
+				pxBest = pxRequest;
+			}
+		}
+
+		if( pxBest != NULL )
+		{
+			if( ( xNow - pxBest->xArrival ) >= pdMS_TO_TICKS( ffconfigBLOCK_QUEUE_DEADLINE_MS ) )
+			{
+				pxQueue->xStats.ulExpired++;
+			}
+
+			prvUnlink( pxQueue, pxBest );
+			pxBest->pxNext = NULL;
+			pxLast = pxBest;
+			ulFirst = pxBest->ulSector;
+			ulEnd = pxBest->ulSector + pxBest->ulCount;
+
+			do
+			{
+				xFound = pdFALSE;
+				for( pxRequest = pxQueue->pxPending; pxRequest != NULL; pxRequest = pxRequest->pxNext )
+				{
+					if( ( pxRequest->xIsWrite != pxBest->xIsWrite ) ||
+						( ( ulEnd - ulFirst ) + pxRequest->ulCount > ffconfigBLOCK_QUEUE_MERGE_SECTORS ) ||
+						( prvIsBlocked( pxQueue, pxRequest ) != pdFALSE ) )
+					{
+						continue;
+					}
+
+					if( pxRequest->ulSector == ulEnd )
+					{
+						prvUnlink( pxQueue, pxRequest );
+						pxRequest->pxNext = NULL;
+						pxLast->pxNext = pxRequest;
+						pxLast = pxRequest;
+						ulEnd += pxRequest->ulCount;
+						xFound = pdTRUE;
+					}
+					else if( pxRequest->ulSector + pxRequest->ulCount == ulFirst )
+					{
+						prvUnlink( pxQueue, pxRequest );
+						pxRequest->pxNext = pxBest;
+						pxBest = pxRequest;
+						ulFirst = pxRequest->ulSector;
+						xFound = pdTRUE;
+					}
+
+					if( xFound != pdFALSE )
+					{
+						pxQueue->xStats.ulMerged++;
+						/* The pending list has changed, start again. */
+						break;
+					}
+				}
+			} while( xFound != pdFALSE );
+
+			for( pxRequest = pxBest; pxRequest != NULL; pxRequest = pxRequest->pxNext )
+			{
+				pxRequest->xState = blkqBUSY;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return pxBest;
+}	/* prvSelectBatch() */
+/*-----------------------------------------------------------*/
+
+/* A request must wait for an older pending request of overlapping sectors,
+if either of the two writes. */
+static BaseType_t prvIsBlocked( FF_BlockQueue_t *pxQueue, FF_BlockRequest_t *pxRequest )
+{
+FF_BlockRequest_t *pxOther;
+BaseType_t xBlocked = pdFALSE;
+
+	for( pxOther = pxQueue->pxPending; pxOther != NULL; pxOther = pxOther->pxNext )
+	{
+		if( ( ( int32_t ) ( pxOther->ulSequence - pxRequest->ulSequence ) < 0 ) &&
+			( ( pxOther->xIsWrite != pdFALSE ) || ( pxRequest->xIsWrite != pdFALSE ) ) &&
+			( pxOther->ulSector < pxRequest->ulSector + pxRequest->ulCount ) &&
+			( pxRequest->ulSector < pxOther->ulSector + pxOther->ulCount ) )
+		{
+			xBlocked = pdTRUE;
+			break;
+		}
+	}
+
+	return xBlocked;
+}	/* prvIsBlocked() */
+/*-----------------------------------------------------------*/
+
+/* Returns pdTRUE if 'pxRequest' should be served before 'pxBest': expired
+requests go first, oldest first.  Then the task priority counts, and finally
+the position on the disk: the elevator serves the sectors from the current
+position upwards, and then starts again at the lowest sector. */
+static BaseType_t prvIsBetter( FF_BlockQueue_t *pxQueue, FF_BlockRequest_t *pxRequest, FF_BlockRequest_t *pxBest, TickType_t xNow )
+{
+const TickType_t xDeadline = pdMS_TO_TICKS( ffconfigBLOCK_QUEUE_DEADLINE_MS );
+BaseType_t xExpired = ( ( xNow - pxRequest->xArrival ) >= xDeadline );
+BaseType_t xBestExpired = ( ( xNow - pxBest->xArrival ) >= xDeadline );
+BaseType_t xAhead = ( pxRequest->ulSector >= pxQueue->ulHeadSector );
+BaseType_t xBestAhead = ( pxBest->ulSector >= pxQueue->ulHeadSector );
+BaseType_t xReturn;
+
+	if( xExpired != xBestExpired )
+	{
+		xReturn = xExpired;
+	}
+	else if( xExpired != pdFALSE )
+	{
+		xReturn = ( ( int32_t ) ( pxRequest->ulSequence - pxBest->ulSequence ) < 0 );
+	}
+	else if( pxRequest->uxPriority != pxBest->uxPriority )
+	{
+		xReturn = ( pxRequest->uxPriority > pxBest->uxPriority );
+	}
+	else if( xAhead != xBestAhead )
+	{
+		xReturn = xAhead;
+	}
+	else
+	{
+		xReturn = ( pxRequest->ulSector < pxBest->ulSector );
+	}
+
+	return xReturn;
+}	/* prvIsBetter() */
+/*-----------------------------------------------------------*/
+
+static void prvUnlink( FF_BlockQueue_t *pxQueue, FF_BlockRequest_t *pxRequest )
+{
+FF_BlockRequest_t **ppxLink;
+
+	for( ppxLink = &( pxQueue->pxPending ); *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+	{
+		if( *ppxLink == pxRequest )
+		{
+			*ppxLink = pxRequest->pxNext;
+			break;
+		}
+	}
+}	/* prvUnlink() */
+/*-----------------------------------------------------------*/
+
+/* Serve one batch, called by the dispatching task. */
+static void prvDispatch( FF_IOManager_t *pxIOManager )
+{
+FF_BlockQueue_t *pxQueue = pxIOManager->pxBlockQueue;
+FF_BlockRequest_t *pxBatch;
+FF_BlockRequest_t *pxRequest;
+FF_BlockRequest_t *pxNext;
+uint8_t *pucBuffer;
+uint32_t ulFirst;
+uint32_t ulCount = 0;
+size_t uxOffset;
+BaseType_t xContiguous = pdTRUE;
+BaseType_t xIsWrite;
+int32_t lResult;
+
+	pxBatch = prvSelectBatch( pxQueue );
+	if( pxBatch == NULL )
+	{
+		return;
+	}
+
+	ulFirst = pxBatch->ulSector;
+	xIsWrite = pxBatch->xIsWrite;
+	for( pxRequest = pxBatch; pxRequest != NULL; pxRequest = pxRequest->pxNext )
+	{
+		/* The buffers may happen to follow each other, as the buffers of
+		the cache often do. */
+		if( pxRequest->pucBuffer != pxBatch->pucBuffer + ( ( size_t ) ulCount * pxIOManager->usSectorSize ) )
+		{
+			xContiguous = pdFALSE;
+		}
+		ulCount += pxRequest->ulCount;
+	}
+
+	xSemaphoreTake( pxQueue->xDriverMutex, portMAX_DELAY );
+	{
+		if( xContiguous != pdFALSE )
+		{
+			pucBuffer = pxBatch->pucBuffer;
+		}
+		else
+		{
+			pucBuffer = pxQueue->pucMergeBuffer;
+			pxQueue->xStats.ulCopied++;
+			if( xIsWrite != pdFALSE )
+			{
+				for( pxRequest = pxBatch, uxOffset = 0; pxRequest != NULL; pxRequest = pxRequest->pxNext )
+				{
+					memcpy( pucBuffer + uxOffset, pxRequest->pucBuffer, ( size_t ) pxRequest->ulCount * pxIOManager->usSectorSize );
+					uxOffset += ( size_t ) pxRequest->ulCount * pxIOManager->usSectorSize;
+				}
+			}
+		}
+
+		lResult = prvCallDriver( pxIOManager, pucBuffer, ulFirst, ulCount, xIsWrite );
+		pxQueue->xStats.ulDriverCalls++;
+
+		for( pxRequest = pxBatch, uxOffset = 0; pxRequest != NULL; pxRequest = pxRequest->pxNext )
+		{
+			if( ( lResult < 0 ) && ( pxBatch->pxNext != NULL ) )
+			{
+				/* Do not let one bad sector fail the other requests. */
+				pxRequest->lResult = prvCallDriver( pxIOManager, pxRequest->pucBuffer, pxRequest->ulSector, pxRequest->ulCount, xIsWrite );
+				pxQueue->xStats.ulDriverCalls++;
+			}
+			else
+			{
+				if( ( xContiguous == pdFALSE ) && ( xIsWrite == pdFALSE ) )
+				{
+					memcpy( pxRequest->pucBuffer, pucBuffer + uxOffset, ( size_t ) pxRequest->ulCount * pxIOManager->usSectorSize );
+				}
+				pxRequest->lResult = lResult;
+			}
+			uxOffset += ( size_t ) pxRequest->ulCount * pxIOManager->usSectorSize;
+		}
+	}
+	xSemaphoreGive( pxQueue->xDriverMutex );
+
+	pxQueue->ulHeadSector = ulFirst + ulCount;
+
+	for( pxRequest = pxBatch; pxRequest != NULL; pxRequest = pxNext )
+	{
+		/* Once the state is set, the owner may free the request. */
+		pxNext = pxRequest->pxNext;
+		taskENTER_CRITICAL();
+		{
+			pxRequest->xState = blkqDONE;
+		}
+		taskEXIT_CRITICAL();
+		xSemaphoreGive( pxRequest->xWake );
+	}
+}	/* prvDispatch() */
+/*-----------------------------------------------------------*/
+
+static int32_t prvCallDriver( FF_IOManager_t *pxIOManager, uint8_t *pucBuffer, uint32_t ulSector, uint32_t ulCount,
+	BaseType_t xIsWrite )
+{
+FF_Disk_t *pxDisk = pxIOManager->xBlkDevice.pxDisk;
+FF_BlockQueue_t *pxQueue = pxIOManager->pxBlockQueue;
+int32_t lResult;
+
+	do
+	{
+		if( ( pxDisk != NULL ) && ( pxDisk->fnStartBlocks != NULL ) &&
+			( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ) )
+		{
+			lResult = pxDisk->fnStartBlocks( pxDisk, pucBuffer, ulSector, ulCount, xIsWrite );
+			if( lResult == 0 )
+			{
+				/* The driver will call FF_BlockQueueComplete(). */
+				xSemaphoreTake( pxQueue->xCompletion, portMAX_DELAY );
+				lResult = pxQueue->lAsyncResult;
+			}
+		}
+		else if( xIsWrite != pdFALSE )
+		{
+			lResult = pxIOManager->xBlkDevice.fnpWriteBlocks( pucBuffer, ulSector, ulCount, pxDisk );
+		}
+		else
+		{
+			lResult = pxIOManager->xBlkDevice.fnpReadBlocks( pucBuffer, ulSector, ulCount, pxDisk );
+		}
+
+		if( FF_GETERROR( lResult ) != FF_ERR_DRIVER_BUSY )
+		{
+			break;
+		}
+
+		FF_Sleep( ffconfigDRIVER_BUSY_SLEEP_MS );
+	} while( pdTRUE );
+
+	return lResult;
+}	/* prvCallDriver() */
+/*-----------------------------------------------------------*/
+
+void FF_BlockQueueComplete( FF_Disk_t *pxDisk, int32_t lResult )
+{
+FF_BlockQueue_t *pxQueue = pxDisk->pxIOManager->pxBlockQueue;
+
+	pxQueue->lAsyncResult = lResult;
+	xSemaphoreGive( pxQueue->xCompletion );
+}
+/*-----------------------------------------------------------*/
+
+void FF_BlockQueueCompleteFromISR( FF_Disk_t *pxDisk, int32_t lResult, BaseType_t *pxHigherPriorityTaskWoken )
+{
+FF_BlockQueue_t *pxQueue = pxDisk->pxIOManager->pxBlockQueue;
+
+	pxQueue->lAsyncResult = lResult;
+	xSemaphoreGiveFromISR( pxQueue->xCompletion, pxHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+void FF_BlockQueueLockDriver( FF_IOManager_t *pxIOManager )
+{
+	if( ( pxIOManager->pxBlockQueue != NULL ) && ( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ) )
+	{
+		xSemaphoreTake( pxIOManager->pxBlockQueue->xDriverMutex, portMAX_DELAY );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void FF_BlockQueueUnlockDriver( FF_IOManager_t *pxIOManager )
+{
+	if( ( pxIOManager->pxBlockQueue != NULL ) && ( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ) )
+	{
+		xSemaphoreGive( pxIOManager->pxBlockQueue->xDriverMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void FF_BlockQueueGetStats( FF_IOManager_t *pxIOManager, FF_BlockQueueStats_t *pxStats )
+{
+	memset( pxStats, '\0', sizeof( *pxStats ) );
+	if( pxIOManager->pxBlockQueue != NULL )
+	{
+		taskENTER_CRITICAL();
+		{
+			*pxStats = pxIOManager->pxBlockQueue->xStats;
+		}
+		taskEXIT_CRITICAL();
+	}
+}
+/*-----------------------------------------------------------*/
+
+#endif /* ffconfigBLOCK_QUEUE */
@@ -90,6 +90,33 @@ static void FF_ProcessShortName( char *pcName );
 static FF_Error_t FF_Traverse( FF_IOManager_t *pxIOManager, uint32_t ulEntry, FF_FetchContext_t *pxContext );
 static int32_t FF_FindFreeDirent( FF_IOManager_t *pxIOManager, FF_FindParams_t *pxFindParams, uint16_t usSequential );
 
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	/*
+	 * Free-entry hints per directory, see FF_DirentHint_t.  The hints must only
+	 * be used or changed while the directory lock is held.
+	 */
+	static FF_DirentHint_t *FF_GetDirentHint( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, BaseType_t xCreate );
+	static void FF_DirentHintAllocated( FF_DirentHint_t *pxHint, uint16_t usEntry, uint16_t usSequential );
+	static void FF_DirentHintReleased( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, uint16_t usEntry );
+#endif /* ffconfigDIRENT_HINT_CACHE */
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+		static BaseType_t FF_WildCardSegment( const FF_T_WCHAR *pcPattern, const FF_T_WCHAR *pcName, BaseType_t xLength );
+	#else
+		static BaseType_t FF_WildCardSegment( const char *pcPattern, const char *pcName, BaseType_t xLength );
+	#endif
+	static BaseType_t FF_WildCardCheckShort( const FF_DirEnt_t *pxDirEntry, const uint8_t *pucEntryBuffer );
+	#if( ffconfigLFN_SUPPORT != 0 )
+		static uint16_t FF_GetLFNChar( const uint8_t *pucEntryBuffer, BaseType_t xIndex );
+		static BaseType_t FF_WildCardCheckLFN( FF_IOManager_t *pxIOManager, FF_DirEnt_t *pxDirEntry, const uint8_t *pucEntryBuffer, BaseType_t xLFNCount );
+	#endif
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+
+#if( ffconfigHASH_CACHE != 0 )
+	static void FF_AddShortNameHash( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, const uint8_t *pucEntryBuffer );
+#endif
+
 #if( ffconfigLFN_SUPPORT != 0 )
 	static int8_t FF_CreateLFNEntry( uint8_t *pucEntryBuffer, uint8_t *pcName, UBaseType_t uxNameLength, UBaseType_t uxLFN, uint8_t ucCheckSum );
 #endif /* ffconfigLFN_SUPPORT */
@@ -207,9 +234,9 @@ BaseType_t xResult = -1;
 		{
 			for( xIndex = 0; xIndex < FF_MAX_ENTRIES_PER_DIRECTORY; xIndex++ )
 			{
-				/* Call FF_FetchEntryWithContext only once for every 512-byte block */
+				/* Call FF_FetchEntryWithContext only once for every sector */
 				if( ( xIndex == 0 ) ||
-					( pucEntryBuffer >= xFetchContext.pxBuffer->pucBuffer + ( FF_SIZEOF_SECTOR - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
+					( pucEntryBuffer >= xFetchContext.pxBuffer->pucBuffer + ( pxIOManager->usSectorSize - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
 				{
 					*pxError = FF_FetchEntryWithContext( pxIOManager, ( uint32_t ) xIndex, &xFetchContext, NULL );
 					if( FF_isERR( *pxError ) )
@@ -341,7 +368,7 @@ uint32_t xResult = 0ul;
 		for( pxDirEntry->usCurrentItem = 0; pxDirEntry->usCurrentItem < FF_MAX_ENTRIES_PER_DIRECTORY; pxDirEntry->usCurrentItem++ )
 		{
 			if( ( src == NULL ) ||
-				( src >= xFetchContext.pxBuffer->pucBuffer + ( FF_SIZEOF_SECTOR - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
+				( src >= xFetchContext.pxBuffer->pucBuffer + ( pxIOManager->usSectorSize - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
 			{
 				xError = FF_FetchEntryWithContext( pxIOManager, pxDirEntry->usCurrentItem, &xFetchContext, NULL );
 
@@ -1520,6 +1547,8 @@ FF_Error_t xError;
 
 #if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
 	BaseType_t xIndex = 0;
+	BaseType_t xPosition;
+	BaseType_t xIsPattern = pdFALSE;
 	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
 		const FF_T_WCHAR *pcWildCard;	/* Check for a Wild-card. */
 	#else
@@ -1559,24 +1588,47 @@ FF_Error_t xError;
 						break;
 					}
 				}
+
+				/* The last token is only used as a pattern when it has a wild-card
+				character or ends with the ':' that inverts the match.  Otherwise
+				the complete path is the directory to be listed. */
+				pcWildCard = &pcPath[ PathLen - xIndex ];
+				for( xPosition = 0; xPosition < xIndex; xPosition++ )
+				{
+					if( ( pcWildCard[ xPosition ] == '*' ) || ( pcWildCard[ xPosition ] == '?' ) ||
+						( ( pcWildCard[ xPosition ] == ':' ) && ( xPosition == xIndex - 1 ) ) )
+					{
+						xIsPattern = pdTRUE;
+					}
+				}
+
+				if( xIsPattern != pdFALSE )
+				{
+					PathLen -= ( uint16_t ) xIndex;
+				}
 			}
 
-			pxDirEntry->ulDirCluster = FF_FindDir( pxIOManager, pcPath, PathLen - xIndex, &xError );
+			pxDirEntry->ulDirCluster = FF_FindDir( pxIOManager, pcPath, PathLen, &xError );
 			if( FF_isERR( xError ) == pdFALSE )
 			{
-				if( pxDirEntry->ulDirCluster != 0 )
+				if( ( pxDirEntry->ulDirCluster != 0 ) && ( xIsPattern != pdFALSE ) )
 				{
 					/* Valid Dir found, copy the wildCard to filename! */
 			#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
-					wcsncpy( pxDirEntry->pcWildCard, ++pcWildCard, ffconfigMAX_FILENAME );
+					wcsncpy( pxDirEntry->pcWildCard, pcWildCard, ffconfigMAX_FILENAME );
 			#else
-					strncpy( pxDirEntry->pcWildCard, ++pcWildCard, ffconfigMAX_FILENAME );
+					strncpy( pxDirEntry->pcWildCard, pcWildCard, ffconfigMAX_FILENAME );
 			#endif
-					if( pxDirEntry->pcWildCard[ xIndex - 1 ] == ':' )
+					pxDirEntry->pcWildCard[ ffconfigMAX_FILENAME - 1 ] = '\0';
+					if( ( xIndex <= ffconfigMAX_FILENAME ) && ( pxDirEntry->pcWildCard[ xIndex - 1 ] == ':' ) )
 					{
 						pxDirEntry->xInvertWildCard = pdTRUE;
 						pxDirEntry->pcWildCard[ xIndex - 1 ] = '\0';
 					}
+
+					/* Prepare the pattern once, it will be matched against
+					every entry of the directory. */
+					FF_WildCardCompile( &( pxDirEntry->xWildCard ), pxDirEntry->pcWildCard );
 				}
 			}
 		}
@@ -1648,7 +1700,7 @@ const uint8_t *pucEntryBuffer = NULL;
 		for( ; pxDirEntry->usCurrentItem < FF_MAX_ENTRIES_PER_DIRECTORY; pxDirEntry->usCurrentItem++ )
 		{
 			if( ( pucEntryBuffer == NULL ) ||
-				( pucEntryBuffer >= ( pxDirEntry->xFetchContext.pxBuffer->pucBuffer + ( FF_SIZEOF_SECTOR - FF_SIZEOF_DIRECTORY_ENTRY ) ) ) )
+				( pucEntryBuffer >= ( pxDirEntry->xFetchContext.pxBuffer->pucBuffer + ( pxIOManager->usSectorSize - FF_SIZEOF_DIRECTORY_ENTRY ) ) ) )
 			{
 				xError = FF_FetchEntryWithContext( pxIOManager, pxDirEntry->usCurrentItem, &( pxDirEntry->xFetchContext ), NULL );
 
@@ -1660,7 +1712,7 @@ const uint8_t *pucEntryBuffer = NULL;
 				if( pucEntryBuffer == NULL )
 				{
 					pucEntryBuffer = pxDirEntry->xFetchContext.pxBuffer->pucBuffer +
-						( FF_SIZEOF_DIRECTORY_ENTRY * ( pxDirEntry->usCurrentItem % ( FF_SIZEOF_SECTOR/FF_SIZEOF_DIRECTORY_ENTRY ) ) );
+						( FF_SIZEOF_DIRECTORY_ENTRY * ( pxDirEntry->usCurrentItem % ( pxIOManager->usSectorSize / FF_SIZEOF_DIRECTORY_ENTRY ) ) );
 				}
 				else
 				{
@@ -1697,6 +1749,21 @@ const uint8_t *pucEntryBuffer = NULL;
 				/* Reserve 32 bytes to hold one directory entry. */
 				uint8_t	Buffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 
+					#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+					{
+						if( ( pxDirEntry->pcWildCard[ 0 ] != 0 ) && ( pxDirEntry->xInvertWildCard == pdFALSE ) &&
+							( FF_WildCardCheckLFN( pxIOManager, pxDirEntry, pucEntryBuffer, xLFNCount ) == pdFALSE ) )
+						{
+							/* The name can not match, skip the LFN entries and the
+							short entry without decoding them.  The loop will do an
+							extra increment. */
+							pxDirEntry->usCurrentItem += ( uint16_t ) xLFNCount;
+							pucEntryBuffer = NULL;
+							continue;
+						}
+					}
+					#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+
 					/* Fetch the shortname, and get it's checksum, or for a deleted item with
 					orphaned LFN entries. */
 					xError = FF_FetchEntryWithContext( pxIOManager, ( uint32_t ) ( pxDirEntry->usCurrentItem + xLFNCount ), &pxDirEntry->xFetchContext, Buffer );
@@ -1726,7 +1793,7 @@ const uint8_t *pucEntryBuffer = NULL;
 							if( pxDirEntry->pcWildCard[0] )
 						#endif
 							{
-								b = FF_wildcompare( pxDirEntry->pcWildCard, pxDirEntry->pcFileName );
+								b = FF_WildCardMatch( &( pxDirEntry->xWildCard ), pxDirEntry->pcWildCard, pxDirEntry->pcFileName );
 								if( pxDirEntry->xInvertWildCard != pdFALSE )
 								{
 									b = !b;
@@ -1743,7 +1810,7 @@ const uint8_t *pucEntryBuffer = NULL;
 								/* xFetchContext/usCurrentItem have changed.  Update
 								'pucEntryBuffer' to point to the current buffer position. */
 								pucEntryBuffer = pxDirEntry->xFetchContext.pxBuffer->pucBuffer +
-									( FF_SIZEOF_DIRECTORY_ENTRY * ( pxDirEntry->usCurrentItem % ( FF_SIZEOF_SECTOR/FF_SIZEOF_DIRECTORY_ENTRY ) ) );
+									( FF_SIZEOF_DIRECTORY_ENTRY * ( pxDirEntry->usCurrentItem % ( pxIOManager->usSectorSize / FF_SIZEOF_DIRECTORY_ENTRY ) ) );
 							}
 							else
 							{
@@ -1769,6 +1836,16 @@ const uint8_t *pucEntryBuffer = NULL;
 			} /* ( ( pxDirEntry->ucAttrib & FF_FAT_ATTR_LFN ) == FF_FAT_ATTR_LFN ) */
 			else if( ( pxDirEntry->ucAttrib & FF_FAT_ATTR_VOLID ) != FF_FAT_ATTR_VOLID )
 			{
+				#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+				{
+					if( FF_WildCardCheckShort( pxDirEntry, pucEntryBuffer ) == pdFALSE )
+					{
+						/* The first character does not match. */
+						continue;
+					}
+				}
+				#endif
+
 				/* If it's not a LFN entry, neither a Volume ID, it is a normal short name entry. */
 				FF_PopulateShortDirent( pxIOManager, pxDirEntry, pucEntryBuffer );
 				#if( ffconfigSHORTNAME_CASE != 0 )
@@ -1782,7 +1859,7 @@ const uint8_t *pucEntryBuffer = NULL;
 				{
 					if( pxDirEntry->pcWildCard[ 0 ] )
 					{
-						b = FF_wildcompare( pxDirEntry->pcWildCard, pxDirEntry->pcFileName );
+						b = FF_WildCardMatch( &( pxDirEntry->xWildCard ), pxDirEntry->pcWildCard, pxDirEntry->pcFileName );
 						if( pxDirEntry->xInvertWildCard != pdFALSE )
 						{
 							b = !b;
@@ -1828,6 +1905,306 @@ const uint8_t *pucEntryBuffer = NULL;
 }	/* FF_FindNext() */
 /*-----------------------------------------------------------*/
 
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	#if( ffconfigWILDCARD_CASE_INSENSITIVE != 0 )
+		#define FF_WILDCARD_FOLD( xChar )	( ( ( ( xChar ) >= 'A' ) && ( ( xChar ) <= 'Z' ) ) ? ( ( xChar ) - 'A' + 'a' ) : ( xChar ) )
+	#else
+		#define FF_WILDCARD_FOLD( xChar )	( xChar )
+	#endif
+
+	/* Only ASCII characters are compared by the pre-filters, they have the
+	same length in UTF-8, UTF-16 and in the LFN entries. */
+	#define FF_WILDCARD_IS_ASCII( xChar )	( ( ( uint32_t ) ( xChar ) & ~0x7Ful ) == 0ul )
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	/**
+	 *	@public
+	 *	@brief	Prepares a wild-card pattern for FF_WildCardMatch(), so that the
+	 *			work is done once per FF_FindFirst() and not for every entry.
+	 *
+	 *	@param	pxWildCard	Receives the properties of the pattern.
+	 *	@param	pcPattern	The pattern, it will be changed in place.
+	 **/
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	void FF_WildCardCompile( FF_WildCard_t *pxWildCard, FF_T_WCHAR *pcPattern )
+	#else
+	void FF_WildCardCompile( FF_WildCard_t *pxWildCard, char *pcPattern )
+	#endif
+	{
+	BaseType_t xSource, xTarget = 0;
+	BaseType_t xLastStar = -1;
+
+		memset( pxWildCard, '\0', sizeof( *pxWildCard ) );
+
+		for( xSource = 0; pcPattern[ xSource ] != '\0'; xSource++ )
+		{
+			if( pcPattern[ xSource ] == '*' )
+			{
+				if( ( xTarget > 0 ) && ( pcPattern[ xTarget - 1 ] == '*' ) )
+				{
+					/* "**" is the same as "*". */
+					continue;
+				}
+
+				if( pxWildCard->xHasStar == pdFALSE )
+				{
+					pxWildCard->xHasStar = pdTRUE;
+					pxWildCard->usPrefixLength = ( uint16_t ) xTarget;
+				}
+				xLastStar = xTarget;
+			}
+			else
+			{
+				pxWildCard->usMinLength++;
+			}
+
+			pcPattern[ xTarget ] = FF_WILDCARD_FOLD( pcPattern[ xSource ] );
+			xTarget++;
+		}
+
+		pcPattern[ xTarget ] = '\0';
+		pxWildCard->usLength = ( uint16_t ) xTarget;
+
+		if( pxWildCard->xHasStar == pdFALSE )
+		{
+			/* The whole pattern must match the whole name. */
+			pxWildCard->usPrefixLength = ( uint16_t ) xTarget;
+			pxWildCard->usSuffixLength = ( uint16_t ) xTarget;
+		}
+		else
+		{
+			pxWildCard->usSuffixLength = ( uint16_t ) ( xTarget - xLastStar - 1 );
+		}
+	}	/* FF_WildCardCompile() */
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	/**
+	 *	@public
+	 *	@brief	Matches a name against a pattern prepared by FF_WildCardCompile().
+	 *			The fixed prefix and suffix are checked first, then every segment
+	 *			between two stars is looked up at its first possible position.
+	 *
+	 *	@return	pdTRUE if the name matches the pattern.
+	 **/
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	BaseType_t FF_WildCardMatch( const FF_WildCard_t *pxWildCard, const FF_T_WCHAR *pcPattern, const FF_T_WCHAR *pcName )
+	#else
+	BaseType_t FF_WildCardMatch( const FF_WildCard_t *pxWildCard, const char *pcPattern, const char *pcName )
+	#endif
+	{
+	BaseType_t xReturn = pdFALSE;
+	BaseType_t xNameLength = ( BaseType_t ) STRLEN( pcName );
+	BaseType_t xPosition, xEnd, xSegment, xSegmentLength;
+
+		if( pxWildCard->xHasStar == pdFALSE )
+		{
+			if( xNameLength == ( BaseType_t ) pxWildCard->usLength )
+			{
+				xReturn = FF_WildCardSegment( pcPattern, pcName, xNameLength );
+			}
+		}
+		else if( ( xNameLength >= ( BaseType_t ) pxWildCard->usMinLength ) &&
+				 ( FF_WildCardSegment( pcPattern, pcName, ( BaseType_t ) pxWildCard->usPrefixLength ) != pdFALSE ) &&
+				 ( FF_WildCardSegment( pcPattern + pxWildCard->usLength - pxWildCard->usSuffixLength,
+									   pcName + xNameLength - pxWildCard->usSuffixLength,
+									   ( BaseType_t ) pxWildCard->usSuffixLength ) != pdFALSE ) )
+		{
+			/* Now find the segments between the first and the last star, each
+			one as early as possible in what is left of the name. */
+			xReturn = pdTRUE;
+			xPosition = ( BaseType_t ) pxWildCard->usPrefixLength;
+			xEnd = xNameLength - ( BaseType_t ) pxWildCard->usSuffixLength;
+			xSegment = ( BaseType_t ) pxWildCard->usPrefixLength + 1;
+
+			while( xSegment < ( BaseType_t ) ( pxWildCard->usLength - pxWildCard->usSuffixLength ) )
+			{
+				for( xSegmentLength = 0; pcPattern[ xSegment + xSegmentLength ] != '*'; xSegmentLength++ )
+				{
+				}
+
+				while( ( xPosition + xSegmentLength <= xEnd ) &&
+					   ( FF_WildCardSegment( pcPattern + xSegment, pcName + xPosition, xSegmentLength ) == pdFALSE ) )
+				{
+					xPosition++;
+				}
+
+				if( xPosition + xSegmentLength > xEnd )
+				{
+					xReturn = pdFALSE;
+					break;
+				}
+
+				xPosition += xSegmentLength;
+				xSegment += xSegmentLength + 1;
+			}
+		}
+
+		return xReturn;
+	}	/* FF_WildCardMatch() */
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	static BaseType_t FF_WildCardSegment( const FF_T_WCHAR *pcPattern, const FF_T_WCHAR *pcName, BaseType_t xLength )
+	#else
+	static BaseType_t FF_WildCardSegment( const char *pcPattern, const char *pcName, BaseType_t xLength )
+	#endif
+	{
+	BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < xLength; xIndex++ )
+		{
+			if( ( pcPattern[ xIndex ] != '?' ) && ( pcPattern[ xIndex ] != FF_WILDCARD_FOLD( pcName[ xIndex ] ) ) )
+			{
+				break;
+			}
+		}
+
+		return ( xIndex == xLength ) ? pdTRUE : pdFALSE;
+	}	/* FF_WildCardSegment() */
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	/* Returns pdFALSE if a short entry can not match the pattern because of its
+	first character.  Short names are stored in upper-case, the NT case bits may
+	show them in lower-case. */
+	static BaseType_t FF_WildCardCheckShort( const FF_DirEnt_t *pxDirEntry, const uint8_t *pucEntryBuffer )
+	{
+	BaseType_t xReturn = pdTRUE;
+	uint8_t ucFirst = pucEntryBuffer[ 0 ];
+	uint8_t ucLower;
+
+		if( ( pxDirEntry->pcWildCard[ 0 ] != 0 ) &&
+			( pxDirEntry->xInvertWildCard == pdFALSE ) &&
+			( pxDirEntry->xWildCard.usPrefixLength != 0u ) &&
+			( pxDirEntry->pcWildCard[ 0 ] != '?' ) &&
+			( FF_WILDCARD_IS_ASCII( pxDirEntry->pcWildCard[ 0 ] ) != pdFALSE ) &&
+			( ucFirst != 0x05u ) )	/* 0x05 stands for 0xE5. */
+		{
+			ucLower = ( ( ucFirst >= 'A' ) && ( ucFirst <= 'Z' ) ) ? ( uint8_t ) ( ucFirst - 'A' + 'a' ) : ucFirst;
+			if( ( pxDirEntry->pcWildCard[ 0 ] != ucFirst ) && ( pxDirEntry->pcWildCard[ 0 ] != ucLower ) )
+			{
+				xReturn = pdFALSE;
+			}
+		}
+
+		return xReturn;
+	}	/* FF_WildCardCheckShort() */
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 ) && ( ffconfigLFN_SUPPORT != 0 )
+	/* Get UTF-16 unit 'xIndex' (0..12) from an LFN entry. */
+	static uint16_t FF_GetLFNChar( const uint8_t *pucEntryBuffer, BaseType_t xIndex )
+	{
+	uint32_t ulOffset;
+
+		if( xIndex < 5 )
+		{
+			ulOffset = FF_FAT_LFN_NAME_1 + 2 * xIndex;
+		}
+		else if( xIndex < 11 )
+		{
+			ulOffset = FF_FAT_LFN_NAME_2 + 2 * ( xIndex - 5 );
+		}
+		else
+		{
+			ulOffset = FF_FAT_LFN_NAME_3 + 2 * ( xIndex - 11 );
+		}
+
+		return FF_getShort( pucEntryBuffer, ulOffset );
+	}	/* FF_GetLFNChar() */
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS && ffconfigLFN_SUPPORT */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 ) && ( ffconfigLFN_SUPPORT != 0 )
+	/* Returns pdFALSE if the long name that starts at entry 'pucEntryBuffer'
+	can not match the pattern, before it is decoded.  This entry holds the last
+	characters of the name, they are compared with the pattern's suffix.  The
+	entry that holds the first characters is compared with the prefix. */
+	static BaseType_t FF_WildCardCheckLFN( FF_IOManager_t *pxIOManager, FF_DirEnt_t *pxDirEntry, const uint8_t *pucEntryBuffer, BaseType_t xLFNCount )
+	{
+	const FF_WildCard_t *pxWildCard = &( pxDirEntry->xWildCard );
+	uint8_t pucFirstEntry[ FF_SIZEOF_DIRECTORY_ENTRY ];
+	BaseType_t xReturn = pdTRUE;
+	BaseType_t xTailLength, xCount, xIndex;
+	uint16_t usChar;
+
+		for( xTailLength = 0; xTailLength < 13; xTailLength++ )
+		{
+			if( FF_GetLFNChar( pucEntryBuffer, xTailLength ) == 0u )
+			{
+				break;
+			}
+		}
+
+		/* Compare from the end of the name, as long as the characters are ASCII. */
+		xCount = ( xTailLength < ( BaseType_t ) pxWildCard->usSuffixLength ) ? xTailLength : ( BaseType_t ) pxWildCard->usSuffixLength;
+		for( xIndex = 1; xIndex <= xCount; xIndex++ )
+		{
+			usChar = FF_GetLFNChar( pucEntryBuffer, xTailLength - xIndex );
+			if( ( FF_WILDCARD_IS_ASCII( usChar ) == pdFALSE ) ||
+				( FF_WILDCARD_IS_ASCII( pxDirEntry->pcWildCard[ pxWildCard->usLength - xIndex ] ) == pdFALSE ) )
+			{
+				break;
+			}
+
+			if( ( pxDirEntry->pcWildCard[ pxWildCard->usLength - xIndex ] != '?' ) &&
+				( pxDirEntry->pcWildCard[ pxWildCard->usLength - xIndex ] != FF_WILDCARD_FOLD( usChar ) ) )
+			{
+				xReturn = pdFALSE;
+				break;
+			}
+		}
+
+		if( ( xReturn != pdFALSE ) && ( pxWildCard->usPrefixLength != 0u ) && ( pxDirEntry->pcWildCard[ 0 ] != '?' ) )
+		{
+			if( xLFNCount > 1 )
+			{
+				/* The first characters are in the entry just before the short
+				entry, which will be read anyway. */
+				if( FF_isERR( FF_FetchEntryWithContext( pxIOManager, ( uint32_t ) ( pxDirEntry->usCurrentItem + xLFNCount - 1 ),
+					&( pxDirEntry->xFetchContext ), pucFirstEntry ) ) == pdFALSE )
+				{
+					pucEntryBuffer = pucFirstEntry;
+					xTailLength = 13;
+				}
+				else
+				{
+					/* Let FF_PopulateLongDirent() report the error. */
+					xTailLength = 0;
+				}
+			}
+
+			xCount = ( xTailLength < ( BaseType_t ) pxWildCard->usPrefixLength ) ? xTailLength : ( BaseType_t ) pxWildCard->usPrefixLength;
+			for( xIndex = 0; xIndex < xCount; xIndex++ )
+			{
+				usChar = FF_GetLFNChar( pucEntryBuffer, xIndex );
+				if( ( FF_WILDCARD_IS_ASCII( usChar ) == pdFALSE ) ||
+					( FF_WILDCARD_IS_ASCII( pxDirEntry->pcWildCard[ xIndex ] ) == pdFALSE ) )
+				{
+					break;
+				}
+
+				if( ( pxDirEntry->pcWildCard[ xIndex ] != '?' ) &&
+					( pxDirEntry->pcWildCard[ xIndex ] != FF_WILDCARD_FOLD( usChar ) ) )
+				{
+					xReturn = pdFALSE;
+					break;
+				}
+			}
+		}
+
+		return xReturn;
+	}	/* FF_WildCardCheckLFN() */
+#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS && ffconfigLFN_SUPPORT */
+/*-----------------------------------------------------------*/
+
 
 /*
 	Returns >= 0 for a free dirent entry.
@@ -1839,28 +2216,66 @@ const uint8_t *pucEntryBuffer = NULL;
 uint16_t freeCount = 0;
 UBaseType_t uxEntry = 0;
 BaseType_t xEntryFound = pdFALSE;
+BaseType_t xEndOfDir = pdFALSE;
 FF_Error_t xError;
 uint32_t DirLength;
+uint32_t ulEntriesPerCluster;
 FF_FetchContext_t xFetchContext;
 uint32_t ulDirCluster = pxFindParams->ulDirCluster;
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	FF_DirentHint_t *pxHint;
+	BaseType_t xClass;
+	BaseType_t xScanIsComplete = pdFALSE;
+#endif
 
 	xError = FF_InitEntryFetch( pxIOManager, ulDirCluster, &xFetchContext );
 
 	if( FF_isERR( xError ) == pdFALSE )
 	{
 		uxEntry = pxFindParams->lFreeEntry >= 0 ? pxFindParams->lFreeEntry : 0;
-		for ( ; uxEntry < FF_MAX_ENTRIES_PER_DIRECTORY; uxEntry++ )
+
+		#if( ffconfigDIRENT_HINT_CACHE != 0 )
+		{
+			/* The hint table is shared with tasks that change other
+			directories, a slot may be recycled during the scan.  So it is only
+			accessed while holding the semaphore. */
+			FF_PendSemaphore( pxIOManager->pvSemaphore );
+			{
+				pxHint = FF_GetDirentHint( pxIOManager, ulDirCluster, pdTRUE );
+				xClass = ( usSequential < FF_DIRENT_HINT_CLASSES ) ? ( BaseType_t ) usSequential - 1 : FF_DIRENT_HINT_CLASSES - 1;
+
+				if( uxEntry <= pxHint->usFreeRun[ xClass ] )
+				{
+					/* No run that is long enough starts before the hint, so a
+					scan from the hint will find the first one. */
+					uxEntry = pxHint->usFreeRun[ xClass ];
+					xScanIsComplete = pdTRUE;
+				}
+
+				if( ( pxHint->usEndOfDir != FF_DIRENT_HINT_UNKNOWN ) && ( uxEntry >= pxHint->usEndOfDir ) )
+				{
+					/* All entries from the end-of-dir marker onward are free,
+					no need to read the directory at all. */
+					uxEntry = pxHint->usEndOfDir;
+					xEndOfDir = pdTRUE;
+				}
+			}
+			FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+		}
+		#endif /* ffconfigDIRENT_HINT_CACHE */
+
+		for ( ; ( xEndOfDir == pdFALSE ) && ( uxEntry < FF_MAX_ENTRIES_PER_DIRECTORY ); uxEntry++ )
 		{
 			if( ( pucEntryBuffer == NULL ) ||
-				( pucEntryBuffer >= xFetchContext.pxBuffer->pucBuffer + ( FF_SIZEOF_SECTOR - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
+				( pucEntryBuffer >= xFetchContext.pxBuffer->pucBuffer + ( pxIOManager->usSectorSize - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
 			{
 				xError = FF_FetchEntryWithContext( pxIOManager, uxEntry, &xFetchContext, NULL );
 				if( FF_GETERROR( xError ) == FF_ERR_DIR_END_OF_DIR )
 				{
-
-					xError = FF_ExtendDirectory( pxIOManager, ulDirCluster );
-					/* The value of xEntryFound will be ignored in case there was an error. */
-					xEntryFound = pdTRUE;
+					/* The last cluster is full and has no end-of-dir marker:
+					the directory will be extended here below. */
+					xError = FF_ERR_NONE;
+					xEndOfDir = pdTRUE;
 					break;
 				}
 				else if( FF_isERR( xError ) )
@@ -1870,7 +2285,7 @@ uint32_t ulDirCluster = pxFindParams->ulDirCluster;
 				if( pucEntryBuffer == NULL )
 				{
 					pucEntryBuffer = xFetchContext.pxBuffer->pucBuffer +
-						( FF_SIZEOF_DIRECTORY_ENTRY * ( uxEntry % ( FF_SIZEOF_SECTOR / FF_SIZEOF_DIRECTORY_ENTRY ) ) );
+						( FF_SIZEOF_DIRECTORY_ENTRY * ( uxEntry % ( pxIOManager->usSectorSize / FF_SIZEOF_DIRECTORY_ENTRY ) ) );
 				}
 				else
 				{
@@ -1884,21 +2299,13 @@ uint32_t ulDirCluster = pxFindParams->ulDirCluster;
 			}
 			if( FF_isEndOfDir( pucEntryBuffer ) )	/* If its the end of the Dir, then FreeDirents from here. */
 			{
-				/* Check if the directory has enough space */
-				DirLength = xFetchContext.ulChainLength;
-				if( ( uxEntry + usSequential ) >
-					( ( DirLength * ( ( UBaseType_t )pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->xPartition.usBlkSize ) ) / FF_SIZEOF_DIRECTORY_ENTRY ) )
-				{
-					xError = FF_ExtendDirectory( pxIOManager, ulDirCluster );
-				}
-				xEntryFound = pdTRUE;
+				xEndOfDir = pdTRUE;
 				break;
 			}
 			if( FF_isDeleted( pucEntryBuffer ) )
 			{
 				if( ++freeCount == usSequential )
 				{
-					xError = FF_CleanupEntryFetch( pxIOManager, &xFetchContext );
 					xEntryFound = pdTRUE;
 					uxEntry = ( uxEntry - ( usSequential - 1 ) );/* Return the beginning entry in the sequential sequence. */
 					break;
@@ -1920,12 +2327,77 @@ uint32_t ulDirCluster = pxFindParams->ulDirCluster;
 			}
 		}
 
+		if( ( xEndOfDir != pdFALSE ) && ( FF_isERR( xError ) == pdFALSE ) )
+		{
+			/* Check if the directory has enough space.  A long name may need
+			more than one extra cluster. */
+			DirLength = xFetchContext.ulChainLength;
+			ulEntriesPerCluster = ( ( uint32_t ) pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->xPartition.usBlkSize ) / FF_SIZEOF_DIRECTORY_ENTRY;
+			while( ( uxEntry + usSequential ) > ( DirLength * ulEntriesPerCluster ) )
+			{
+				xError = FF_ExtendDirectory( pxIOManager, ulDirCluster );
+				if( FF_isERR( xError ) )
+				{
+					break;
+				}
+				DirLength++;
+			}
+
+			#if( ffconfigDIRENT_HINT_CACHE != 0 )
+			{
+				if( ( FF_isERR( xError ) == pdFALSE ) &&
+					( ( uxEntry + usSequential ) == ( DirLength * ulEntriesPerCluster ) ) &&
+					( ( ulDirCluster != pxIOManager->xPartition.ulRootDirCluster ) || ( pxIOManager->xPartition.ucType == FF_T_FAT32 ) ) )
+				{
+					/* The new entries will fill the directory up to its last slot.
+					Extend it now, so the next creation finds an end-of-dir marker. */
+					xError = FF_ExtendDirectory( pxIOManager, ulDirCluster );
+					if( FF_GETERROR( xError ) == FF_ERR_FAT_NO_FREE_CLUSTERS )
+					{
+						/* Not fatal, the new entries still fit. */
+						xError = FF_ERR_NONE;
+					}
+				}
+			}
+			#endif /* ffconfigDIRENT_HINT_CACHE */
+
+			xEntryFound = pdTRUE;
+		}
 	}
 
 	if( FF_isERR( xError ) == pdFALSE )
 	{
 		if( xEntryFound != pdFALSE )
 		{
+			#if( ffconfigDIRENT_HINT_CACHE != 0 )
+			{
+				FF_PendSemaphore( pxIOManager->pvSemaphore );
+				{
+					/* Look it up again, in case the slot was recycled.  The
+					results are valid because the directory is still locked. */
+					pxHint = FF_GetDirentHint( pxIOManager, ulDirCluster, pdTRUE );
+					if( xEndOfDir != pdFALSE )
+					{
+						pxHint->usEndOfDir = ( uint16_t ) uxEntry;
+					}
+
+					if( xScanIsComplete != pdFALSE )
+					{
+						/* The scan has proven that no run of 'usSequential'
+						free entries, or longer, starts before 'uxEntry'. */
+						for( xClass = ( BaseType_t ) usSequential - 1; xClass < FF_DIRENT_HINT_CLASSES; xClass++ )
+						{
+							if( pxHint->usFreeRun[ xClass ] < uxEntry )
+							{
+								pxHint->usFreeRun[ xClass ] = ( uint16_t ) uxEntry;
+							}
+						}
+					}
+				}
+				FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+			}
+			#endif /* ffconfigDIRENT_HINT_CACHE */
+
 			/* No error has occurred and a free directory entry has been found. */
 			xError = uxEntry;
 		}
@@ -2681,9 +3153,6 @@ FF_FetchContext_t xFetchContext;
 uint32_t	ulDirCluster = pxFindParams->ulDirCluster;
 int32_t lFitShort;
 
-#if( ffconfigHASH_CACHE != 0 )
-	char pcShortName[ 13 ];
-#endif
 #if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
 	uint16_t NameLen = ( uint16_t ) wcslen( pxDirEntry->pcFileName );
 #else
@@ -2721,7 +3190,7 @@ int32_t lFitShort;
 	#endif
 
 	/* Create the ShortName. */
-	FF_LockDirectory( pxIOManager );
+	FF_LockDirectory( pxIOManager, ulDirCluster );
 	do
 	{
 		/* Open a do {} while( pdFALSE ) loop to allow the use of break statements. */
@@ -2809,31 +3278,24 @@ int32_t lFitShort;
 				break;
 			}
 
+			#if( ffconfigDIRENT_HINT_CACHE != 0 )
+			{
+				FF_PendSemaphore( pxIOManager->pvSemaphore );
+				FF_DirentHintAllocated( FF_GetDirentHint( pxIOManager, ulDirCluster, pdFALSE ), ( uint16_t ) lFreeEntry, ( uint16_t ) ( xLFNCount + 1 ) );
+				FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+			}
+			#endif /* ffconfigDIRENT_HINT_CACHE */
+
 			#if( ffconfigHASH_CACHE != 0 )
 			{
-				if( FF_DirHashed( pxIOManager, ulDirCluster ) == pdFALSE )
-				{
-					/* Hash the directory. */
-					FF_HashDir( pxIOManager, ulDirCluster );
-				}
-				memcpy( pcShortName, pucEntryBuffer, 11 );
-				FF_ProcessShortName( pcShortName );		/* Format the shortname to 8.3. */
-				#if( ffconfigHASH_FUNCTION == CRC16 )
-				{
-					FF_AddDirentHash( pxIOManager, ulDirCluster, ( uint32_t )FF_GetCRC16( ( uint8_t * ) pcShortName, strlen( pcShortName ) ) );
-				}
-				#elif( ffconfigHASH_FUNCTION == CRC8 )
-				{
-					FF_AddDirentHash( pxIOManager, ulDirCluster, ( uint32_t )FF_GetCRC8( ( uint8_t * ) pcShortName, strlen( pcShortName ) ) );
-				}
-				#endif /* ffconfigHASH_FUNCTION */
+				FF_AddShortNameHash( pxIOManager, ulDirCluster, pucEntryBuffer );
 			}
 			#endif /* ffconfigHASH_CACHE*/
 		}
 	}
 	while( pdFALSE );
 
-	FF_UnlockDirectory( pxIOManager );
+	FF_UnlockDirectory( pxIOManager, ulDirCluster );
 
 	if( FF_isERR( xReturn ) == pdFALSE )
 	{
@@ -2847,6 +3309,300 @@ int32_t lFitShort;
 }	/* FF_CreateDirent() */
 /*-----------------------------------------------------------*/
 
+/* FF_RenameDirent() : give the object at 'usEntry' in directory 'ulDirCluster'
+a new name.  The short entry keeps its attributes, times, cluster and size.
+When the new name needs no more LFN entries than the old one, the entries are
+rewritten in place.  Otherwise a new run is taken, using the free-entry hints,
+and the old run is deleted.  Either way the directory is locked only once and
+normally no more than two sectors are written.  When another object has the
+new name, FF_ERR_DIR_OBJECT_EXISTS is returned. */
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+FF_Error_t FF_RenameDirent( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, uint16_t usEntry, FF_T_WCHAR *pcName, uint16_t *pusNewEntry )
+#else
+FF_Error_t FF_RenameDirent( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, uint16_t usEntry, char *pcName, uint16_t *pusNewEntry )
+#endif
+{
+uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
+uint8_t	pucShortEntry[ FF_SIZEOF_DIRECTORY_ENTRY ];
+FF_FindParams_t xFindParams;
+FF_FetchContext_t xFetchContext;
+FF_Error_t xError;
+BaseType_t xLFNCount;
+BaseType_t xOldLFNCount = 0;
+int32_t lFitShort, lFreeEntry;
+uint16_t usNewEntry = usEntry;	/* The first entry of the new run. */
+uint16_t usOldFirst, usOldLast;	/* The entries that must be deleted. */
+uint16_t usIndex;
+BaseType_t xInPlace = pdFALSE;
+
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	uint16_t NameLen = ( uint16_t ) wcslen( pcName );
+#else
+	uint16_t NameLen = ( uint16_t ) strlen( pcName );
+#endif
+
+	memset( &xFindParams, '\0', sizeof( xFindParams ) );
+	memset( &xFetchContext, '\0', sizeof( xFetchContext ) );
+	xFindParams.ulDirCluster = ulDirCluster;
+
+	/* Round-up the number of LFN's needed: */
+	xLFNCount = ( BaseType_t ) ( ( NameLen + 12 ) / 13 );
+
+	FF_MakeNameCompliant( pcName );	/* Ensure we don't break the Dir tables. */
+
+	FF_LockDirectory( pxIOManager, ulDirCluster );
+	do
+	{
+		/* Open a do {} while( pdFALSE ) loop to allow the use of break statements. */
+
+		/* The caller looked for the new name before the directory was
+		locked.  Look again now that nobody can create it any more. */
+		{
+		FF_FindParams_t xNameParams;
+		FF_DirEnt_t xExisting;
+		uint32_t ulCluster;
+
+			memset( &xNameParams, '\0', sizeof( xNameParams ) );
+			xNameParams.ulDirCluster = ulDirCluster;
+			ulCluster = FF_FindEntryInDir( pxIOManager, &xNameParams, pcName, 0x00, &xExisting, &xError );
+
+			/* An empty file has no cluster, compare its name. */
+			if( ( ulCluster != 0ul ) ||
+			#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+				( ( FF_isERR( xError ) == pdFALSE ) && ( wcsicmp( ( const char * ) pcName, ( const char * ) xExisting.pcFileName ) == 0 ) ) )
+			#else
+				( ( FF_isERR( xError ) == pdFALSE ) && ( FF_stricmp( ( const char * ) pcName, ( const char * ) xExisting.pcFileName ) == 0 ) ) )
+			#endif
+			{
+				if( ( uint16_t ) ( xExisting.usCurrentItem - 1u ) != usEntry )
+				{
+					xError = ( FF_Error_t ) ( FF_ERR_DIR_OBJECT_EXISTS | FF_MOVE );
+					break;
+				}
+			}
+			else if( ( FF_isERR( xError ) != pdFALSE ) && ( FF_GETERROR( xError ) != FF_ERR_DIR_END_OF_DIR ) )
+			{
+				break;
+			}
+		}
+
+		xError = FF_InitEntryFetch( pxIOManager, ulDirCluster, &xFetchContext );
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+
+		xError = FF_FetchEntryWithContext( pxIOManager, usEntry, &xFetchContext, pucShortEntry );
+
+		#if( ffconfigLFN_SUPPORT != 0 )
+		{
+		uint8_t ucCheckSum = FF_CreateChkSum( pucShortEntry );
+
+			/* Count the LFN entries that belong to the short entry. */
+			for( usIndex = usEntry; ( FF_isERR( xError ) == pdFALSE ) && ( usIndex > 0u ); )
+			{
+				usIndex--;
+				xError = FF_FetchEntryWithContext( pxIOManager, usIndex, &xFetchContext, pucEntryBuffer );
+				if( ( FF_isERR( xError ) != pdFALSE ) ||
+					( FF_getChar( pucEntryBuffer, ( uint16_t ) ( FF_FAT_DIRENT_ATTRIB ) ) != FF_FAT_ATTR_LFN ) ||
+					( FF_isDeleted( pucEntryBuffer ) != pdFALSE ) ||
+					( FF_getChar( pucEntryBuffer, ( uint16_t ) ( FF_FAT_LFN_CHECKSUM ) ) != ucCheckSum ) )
+				{
+					break;
+				}
+
+				xOldLFNCount++;
+				if( ( pucEntryBuffer[ 0 ] & 0x40 ) != 0 )
+				{
+					/* This is the first entry of the run. */
+					break;
+				}
+			}
+		}
+		#endif /* ffconfigLFN_SUPPORT */
+
+		{
+		FF_Error_t xTempError;
+
+			/* Release the buffer, the sector will be written below. */
+			xTempError = FF_CleanupEntryFetch( pxIOManager, &xFetchContext );
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				xError = xTempError;
+			}
+		}
+
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+
+		/* The new short name must be unique, its basis may be taken by the
+		old name: in that case another tail will be chosen. */
+		FF_CreateShortName( &xFindParams, pcName );
+		lFitShort = FF_FindShortName( pxIOManager, &xFindParams );
+		if( FF_isERR( lFitShort ) )
+		{
+			xError = lFitShort;
+			break;
+		}
+
+		#if( ffconfigLFN_SUPPORT != 0 )
+		{
+			if( lFitShort != 0 )
+			{
+				/* The name fits into a normal 32-byte entry. */
+				xLFNCount = 0;
+			}
+		}
+		#else
+		{
+			xLFNCount = 0;
+		}
+		#endif /* ffconfigLFN_SUPPORT */
+
+		memcpy( pucShortEntry, xFindParams.pcEntryBuffer, 11 );
+		#if( ffconfigSHORTNAME_CASE != 0 )
+		{
+			FF_putChar( pucShortEntry, FF_FAT_CASE_OFFS, ( uint32_t ) lFitShort & ( FF_FAT_CASE_ATTR_BASE | FF_FAT_CASE_ATTR_EXT ) );
+		}
+		#endif
+
+		usOldFirst = ( uint16_t ) ( usEntry - xOldLFNCount );
+		if( xLFNCount <= xOldLFNCount )
+		{
+			/* Rename in place: the short entry stays where it is and the new
+			LFN entries are put just before it.  Only the leading entries of
+			the old run will be deleted. */
+			xInPlace = pdTRUE;
+			usNewEntry = ( uint16_t ) ( usEntry - xLFNCount );
+			usOldLast = usNewEntry;
+		}
+		else
+		{
+			lFreeEntry = FF_FindFreeDirent( pxIOManager, &xFindParams, ( uint16_t ) ( xLFNCount + 1 ) );
+			if( FF_isERR( lFreeEntry ) )
+			{
+				xError = lFreeEntry;
+				break;
+			}
+			usNewEntry = ( uint16_t ) lFreeEntry;
+			usOldLast = ( uint16_t ) ( usEntry + 1 );
+		}
+
+		#if( ffconfigLFN_SUPPORT != 0 )
+		{
+			if( xLFNCount > 0 )
+			{
+				xError = FF_CreateLFNs( pxIOManager, ulDirCluster, pcName, FF_CreateChkSum( pucShortEntry ), usNewEntry );
+				if( FF_isERR( xError ) )
+				{
+					break;
+				}
+			}
+		}
+		#endif /* ffconfigLFN_SUPPORT */
+
+		xError = FF_InitEntryFetch( pxIOManager, ulDirCluster, &xFetchContext );
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+
+		/* Write the new entries first and delete the old ones after that. */
+		xError = FF_PushEntryWithContext( pxIOManager, ( uint32_t ) ( usNewEntry + xLFNCount ), &xFetchContext, pucShortEntry );
+
+		for( usIndex = usOldFirst; ( FF_isERR( xError ) == pdFALSE ) && ( usIndex < usOldLast ); usIndex++ )
+		{
+			xError = FF_FetchEntryWithContext( pxIOManager, usIndex, &xFetchContext, pucEntryBuffer );
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pucEntryBuffer[ 0 ] = FF_FAT_DELETED;
+				if( usIndex == usEntry )
+				{
+					FF_putShort( pucEntryBuffer, FF_FAT_DIRENT_CLUS_HIGH, ( uint32_t ) 0ul );
+					FF_putShort( pucEntryBuffer, FF_FAT_DIRENT_CLUS_LOW,  ( uint32_t ) 0ul );
+				}
+				xError = FF_PushEntryWithContext( pxIOManager, usIndex, &xFetchContext, pucEntryBuffer );
+			}
+		}
+
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+
+		#if( ffconfigDIRENT_HINT_CACHE != 0 )
+		{
+			if( usOldLast != usOldFirst )
+			{
+				FF_DirentHintReleased( pxIOManager, ulDirCluster, ( uint16_t ) ( usOldLast - 1 ) );
+			}
+
+			if( xInPlace == pdFALSE )
+			{
+				FF_PendSemaphore( pxIOManager->pvSemaphore );
+				FF_DirentHintAllocated( FF_GetDirentHint( pxIOManager, ulDirCluster, pdFALSE ), usNewEntry, ( uint16_t ) ( xLFNCount + 1 ) );
+				FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+			}
+		}
+		#endif /* ffconfigDIRENT_HINT_CACHE */
+
+		#if( ffconfigHASH_CACHE != 0 )
+		{
+			FF_AddShortNameHash( pxIOManager, ulDirCluster, pucShortEntry );
+		}
+		#endif /* ffconfigHASH_CACHE*/
+	}
+	while( pdFALSE );
+
+	{
+	FF_Error_t xTempError;
+
+		xTempError = FF_CleanupEntryFetch( pxIOManager, &xFetchContext );
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			xError = xTempError;
+		}
+	}
+
+	FF_UnlockDirectory( pxIOManager, ulDirCluster );
+
+	if( ( FF_isERR( xError ) == pdFALSE ) && ( pusNewEntry != NULL ) )
+	{
+		*pusNewEntry = ( uint16_t ) ( usNewEntry + xLFNCount );
+	}
+
+	return xError;
+}	/* FF_RenameDirent() */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigHASH_CACHE != 0 )
+	/* Add the short name of a new directory entry to the hash of its directory. */
+	static void FF_AddShortNameHash( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, const uint8_t *pucEntryBuffer )
+	{
+	char pcShortName[ 13 ];
+
+		if( FF_DirHashed( pxIOManager, ulDirCluster ) == pdFALSE )
+		{
+			/* Hash the directory. */
+			FF_HashDir( pxIOManager, ulDirCluster );
+		}
+		memcpy( pcShortName, pucEntryBuffer, 11 );
+		FF_ProcessShortName( pcShortName );		/* Format the shortname to 8.3. */
+		#if( ffconfigHASH_FUNCTION == CRC16 )
+		{
+			FF_AddDirentHash( pxIOManager, ulDirCluster, ( uint32_t )FF_GetCRC16( ( uint8_t * ) pcShortName, strlen( pcShortName ) ) );
+		}
+		#elif( ffconfigHASH_FUNCTION == CRC8 )
+		{
+			FF_AddDirentHash( pxIOManager, ulDirCluster, ( uint32_t )FF_GetCRC8( ( uint8_t * ) pcShortName, strlen( pcShortName ) ) );
+		}
+		#endif /* ffconfigHASH_FUNCTION */
+	}	/* FF_AddShortNameHash() */
+#endif /* ffconfigHASH_CACHE */
+/*-----------------------------------------------------------*/
+
 
 #if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
 uint32_t FF_CreateFile( FF_IOManager_t *pxIOManager, FF_FindParams_t *pxFindParams, FF_T_WCHAR *pcFileName, FF_DirEnt_t *pxDirEntry, FF_Error_t *pxError )
@@ -3133,6 +3889,15 @@ FF_Error_t FF_RmLFNs( FF_IOManager_t *pxIOManager, uint16_t usDirEntry, FF_Fetch
 FF_Error_t xError = FF_ERR_NONE;
 uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 
+	#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	{
+		/* The caller is about to remove the short-name entry at 'usDirEntry',
+		the LFN entries precede it.  The hints are lower bounds, so they may be
+		lowered before the entries are actually removed. */
+		FF_DirentHintReleased( pxIOManager, pxContext->ulDirCluster, usDirEntry );
+	}
+	#endif /* ffconfigDIRENT_HINT_CACHE */
+
 	if( usDirEntry != 0 )
 	{
 		usDirEntry--;
@@ -3167,6 +3932,135 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 }	/* FF_RmLFNs() */
 /*-----------------------------------------------------------*/
 
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	static FF_DirentHint_t *FF_GetDirentHint( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, BaseType_t xCreate )
+	{
+	FF_DirentHint_t *pxHint = pxIOManager->xDirentHints;
+	FF_DirentHint_t *pxLast = pxIOManager->xDirentHints + ffconfigDIRENT_HINT_DEPTH;
+	FF_DirentHint_t *pxOldest = pxHint;
+	BaseType_t xIndex;
+
+		pxIOManager->ulDirentHintAge++;
+
+		for( ; pxHint < pxLast; pxHint++ )
+		{
+			if( pxHint->ulDirCluster == ulDirCluster )
+			{
+				break;
+			}
+			/* Unused slots have an age stamp of zero and will be taken first. */
+			if( pxHint->ulLastUsed < pxOldest->ulLastUsed )
+			{
+				pxOldest = pxHint;
+			}
+		}
+
+		if( pxHint == pxLast )
+		{
+			if( xCreate == pdFALSE )
+			{
+				pxHint = NULL;
+			}
+			else
+			{
+				/* Nothing is known yet about this directory: search from the
+				start and find the end-of-dir marker by scanning. */
+				pxHint = pxOldest;
+				pxHint->ulDirCluster = ulDirCluster;
+				pxHint->usEndOfDir = FF_DIRENT_HINT_UNKNOWN;
+				for( xIndex = 0; xIndex < FF_DIRENT_HINT_CLASSES; xIndex++ )
+				{
+					pxHint->usFreeRun[ xIndex ] = 0;
+				}
+			}
+		}
+
+		if( pxHint != NULL )
+		{
+			pxHint->ulLastUsed = pxIOManager->ulDirentHintAge;
+		}
+
+		return pxHint;
+	}	/* FF_GetDirentHint() */
+#endif /* ffconfigDIRENT_HINT_CACHE */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	/* 'usSequential' entries starting at 'usEntry' are now in use. */
+	static void FF_DirentHintAllocated( FF_DirentHint_t *pxHint, uint16_t usEntry, uint16_t usSequential )
+	{
+	BaseType_t xIndex;
+	uint32_t ulNext = ( uint32_t ) usEntry + usSequential;
+
+		if( pxHint != NULL )
+		{
+			for( xIndex = 0; xIndex < FF_DIRENT_HINT_CLASSES; xIndex++ )
+			{
+				/* A run starting within the allocated entries can not start
+				before the first entry following them. */
+				if( ( pxHint->usFreeRun[ xIndex ] >= usEntry ) && ( pxHint->usFreeRun[ xIndex ] < ulNext ) )
+				{
+					pxHint->usFreeRun[ xIndex ] = ( uint16_t ) ulNext;
+				}
+			}
+
+			if( ( pxHint->usEndOfDir != FF_DIRENT_HINT_UNKNOWN ) && ( ulNext > pxHint->usEndOfDir ) )
+			{
+				/* The entries were placed at the end of the directory. */
+				pxHint->usEndOfDir = ( ulNext < FF_DIRENT_HINT_UNKNOWN ) ? ( uint16_t ) ulNext : FF_DIRENT_HINT_UNKNOWN;
+			}
+		}
+	}	/* FF_DirentHintAllocated() */
+#endif /* ffconfigDIRENT_HINT_CACHE */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	/* Entries ending at 'usEntry' have been removed. */
+	static void FF_DirentHintReleased( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, uint16_t usEntry )
+	{
+	FF_DirentHint_t *pxHint;
+	BaseType_t xIndex;
+	uint16_t usFirst;
+
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
+		pxHint = FF_GetDirentHint( pxIOManager, ulDirCluster, pdFALSE );
+		if( pxHint != NULL )
+		{
+			for( xIndex = 0; xIndex < FF_DIRENT_HINT_CLASSES; xIndex++ )
+			{
+				/* A new run of ( xIndex + 1 ) entries includes 'usEntry' and may
+				merge with free entries that precede it. */
+				usFirst = ( usEntry > xIndex ) ? ( uint16_t ) ( usEntry - xIndex ) : 0u;
+				if( pxHint->usFreeRun[ xIndex ] > usFirst )
+				{
+					pxHint->usFreeRun[ xIndex ] = usFirst;
+				}
+			}
+		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+	}	/* FF_DirentHintReleased() */
+#endif /* ffconfigDIRENT_HINT_CACHE */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	/* FF_UnHintDir() : forget the hints of a directory that is removed, its
+	cluster may later be used by a new directory. */
+	void FF_UnHintDir( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster )
+	{
+	FF_DirentHint_t *pxHint;
+
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
+		pxHint = FF_GetDirentHint( pxIOManager, ulDirCluster, pdFALSE );
+		if( pxHint != NULL )
+		{
+			pxHint->ulDirCluster = 0;
+			pxHint->ulLastUsed = 0;
+		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+	}	/* FF_UnHintDir() */
+#endif /* ffconfigDIRENT_HINT_CACHE */
+/*-----------------------------------------------------------*/
+
 #if( ffconfigHASH_CACHE != 0 )
 	FF_Error_t FF_HashDir( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster )
 	{
@@ -3179,6 +4073,10 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 	uint32_t ulHash;
 	FF_Error_t xError;
 
+		/* Tasks that change different directories may hash at the same time.
+		A table that is being filled has a non-zero 'ulNumHandles' so it won't
+		be chosen twice, and it gets its 'ulDirCluster' when it is complete. */
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
 		for( xIndex = 0; xIndex < ffconfigHASH_CACHE_DEPTH; xIndex++ )
 		{
 			if( pxIOManager->xHashCache[ xIndex ].ulNumHandles == 0 )
@@ -3197,6 +4095,14 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 			}
 		}
 
+		if( pxHashCache != NULL )
+		{
+			/* Clear the hash table! */
+			memset( pxHashCache, '\0', sizeof( *pxHashCache ) );
+			pxHashCache->ulNumHandles = 1;
+		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+
 		if( pxHashCache != NULL )
 		{
 		#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
@@ -3204,10 +4110,6 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 		#else
 			char pcMyShortName[ 13 ];
 		#endif
-			/* Clear the hash table! */
-			memset( pxHashCache, '\0', sizeof( *pxHashCache ) );
-			pxHashCache->ulDirCluster = ulDirCluster;
-			pxHashCache->ulMisses = 0;
 
 			/* Hash the directory! */
 
@@ -3218,7 +4120,7 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 				for( xIndex = 0; xIndex < FF_MAX_ENTRIES_PER_DIRECTORY; xIndex++ )
 				{
 					if( ( pucEntryBuffer == NULL ) ||
-						( pucEntryBuffer >= xFetchContext.pxBuffer->pucBuffer + ( FF_SIZEOF_SECTOR - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
+						( pucEntryBuffer >= xFetchContext.pxBuffer->pucBuffer + ( pxIOManager->usSectorSize - FF_SIZEOF_DIRECTORY_ENTRY ) ) )
 					{
 						xError = FF_FetchEntryWithContext( pxIOManager, ( uint32_t ) xIndex, &xFetchContext, NULL );
 						if( FF_isERR( xError ) )
@@ -3268,6 +4170,15 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 					}
 				}
 			}
+
+			FF_PendSemaphore( pxIOManager->pvSemaphore );
+			if( ( FF_isERR( xError ) == pdFALSE ) || ( FF_GETERROR( xError ) == FF_ERR_DIR_END_OF_DIR ) )
+			{
+				/* Publish the complete table. */
+				pxHashCache->ulDirCluster = ulDirCluster;
+			}
+			pxHashCache->ulNumHandles = 0;
+			FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
 		} /* if( pxHashCache != NULL ) */
 		else
 		{
@@ -3288,6 +4199,7 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 	FF_HashTable_t *pxHash = pxIOManager->xHashCache;
 	FF_HashTable_t *pxLast = pxIOManager->xHashCache + ffconfigHASH_CACHE_DEPTH;
 
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
 		for( ; pxHash < pxLast; pxHash++ )
 		{
 			if( pxHash->ulDirCluster == ulDirCluster )
@@ -3296,6 +4208,7 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 				break;
 			}
 		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
 	}	/* FF_UnHashDir() */
 #endif /* ffconfigHASH_CACHE */
 /*-----------------------------------------------------------*/
@@ -3358,6 +4271,8 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 	FF_HashTable_t *pxHash = pxIOManager->xHashCache;
 	FF_HashTable_t *pxLast = pxIOManager->xHashCache + ffconfigHASH_CACHE_DEPTH;
 
+		/* The table may be recycled by a task that hashes another directory. */
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
 		for( ; pxHash < pxLast; pxHash++ )
 		{
 			if( pxHash->ulDirCluster == ulDirCluster )
@@ -3366,6 +4281,7 @@ uint8_t	pucEntryBuffer[ FF_SIZEOF_DIRECTORY_ENTRY ];
 				break;
 			}
 		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
 	}	/* FF_AddDirentHash() */
 #endif /* ffconfigHASH_CACHE*/
 /*-----------------------------------------------------------*/
@@ -136,6 +136,13 @@ const struct _FFFUNCTIONTAB
 	{ "FF_BytesLeft",             FF_GETMOD_FUNC( FF_BYTESLEFT ) },
 	{ "FF_SetFileTime",           FF_GETMOD_FUNC( FF_SETFILETIME ) },
 	{ "FF_InitBuf",               FF_GETMOD_FUNC( FF_INITBUF ) },
+	{ "FF_SyncFile",              FF_GETMOD_FUNC( FF_SYNCFILE ) },
+	{ "FF_ReadBorrow",            FF_GETMOD_FUNC( FF_READBORROW ) },
+	{ "FF_ReadRelease",           FF_GETMOD_FUNC( FF_READRELEASE ) },
+	{ "FF_MapFile",               FF_GETMOD_FUNC( FF_MAPFILE ) },
+	{ "FF_ReadV",                 FF_GETMOD_FUNC( FF_READV ) },
+	{ "FF_WriteV",                FF_GETMOD_FUNC( FF_WRITEV ) },
+	{ "FF_CopyFile",              FF_GETMOD_FUNC( FF_COPYFILE ) },
 
 /*----- FF_FAT - The FreeRTOS+FAT FAT handling routines */
 	{ "FF_getFATEntry",           FF_GETMOD_FUNC( FF_GETFATENTRY ) },
@@ -214,6 +221,8 @@ const struct _FFERRTAB
 #if( ffconfigREMOVABLE_MEDIA != 0 )
 	ERR_ENTRY( "File handle got invalid because media was removed",							FILE_MEDIA_REMOVED ),
 #endif	/* ffconfigREMOVABLE_MEDIA */
+	ERR_ENTRY( "The medium can not be accessed in place",									FILE_NOT_MAPPABLE ),
+	ERR_ENTRY( "No more cache buffers can be lent out",										FILE_BORROW_LIMIT ),
     ERR_ENTRY( "A file or folder of the same name already exists",							DIR_OBJECT_EXISTS ),
     ERR_ENTRY( "DIR_DIRECTORY_FULL",														DIR_DIRECTORY_FULL ),
     ERR_ENTRY( "DIR_END_OF_DIR",															DIR_END_OF_DIR ),
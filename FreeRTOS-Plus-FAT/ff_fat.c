@@ -596,7 +596,8 @@ BaseType_t xTakeLock = FF_Has_Lock( pxIOManager, FF_FAT_LOCK ) == pdFALSE;
 
 	if( xTakeLock )
 	{
-		FF_LockFAT( pxIOManager );
+		/* Only reading, other tasks may walk a chain at the same time. */
+		FF_LockFATRead( pxIOManager );
 	}
 	for( ulIndex = 0; ulIndex < ulCount; ulIndex++ )
 	{
@@ -617,7 +618,7 @@ BaseType_t xTakeLock = FF_Has_Lock( pxIOManager, FF_FAT_LOCK ) == pdFALSE;
 	}
 	if( xTakeLock )
 	{
-		FF_UnlockFAT( pxIOManager );
+		FF_UnlockFATRead( pxIOManager );
 	}
 
 	{
@@ -645,7 +646,7 @@ FF_Error_t xError;
 	{
 		/* Traverse FAT for (2^32-1) items/clusters,
 		or until end-of-chain is encountered. */
-		ulFatEntry = FF_TraverseFAT( pxIOManager, ulStart, ~0UL, &xError );
+		ulFatEntry = FF_TraverseFAT( pxIOManager, ulStart, 0xFFFFFFFFUL, &xError );
 	}
 	else
 	{
@@ -1133,6 +1134,96 @@ BaseType_t xTakeLock = FF_Has_Lock( pxIOManager, FF_FAT_LOCK ) == pdFALSE;
 }	/* FF_FindFreeCluster */
 /*-----------------------------------------------------------*/
 
+/**
+ * @private
+ * @brief	Looks for 'ulCount' free clusters in a row, starting at the last
+ *			known free cluster and wrapping around once.  The FAT must be
+ *			locked by the caller.
+ *
+ * @return	The first cluster of the run, or 0 when there is no such run.
+ **/
+uint32_t FF_FindFreeRun( FF_IOManager_t *pxIOManager, uint32_t ulCount, FF_Error_t *pxError )
+{
+FF_Error_t xError = FF_ERR_NONE, xTempError;
+FF_FATBuffers_t xFATBuffers;
+const uint32_t ulNumClusters = pxIOManager->xPartition.ulNumClusters;
+uint32_t ulStart = pxIOManager->xPartition.ulLastFreeCluster;
+uint32_t ulCluster, ulEnd, ulFATEntry;
+uint32_t ulRunStart = 0ul, ulRunLength = 0ul;
+uint32_t ulReturn = 0ul;
+BaseType_t xPass;
+
+	if( ( ulStart < 2ul ) || ( ulStart >= ulNumClusters ) )
+	{
+		ulStart = 2ul;
+	}
+
+	FF_InitFATBuffers( &xFATBuffers, FF_MODE_READ );
+
+	/* The first pass looks from 'ulStart' to the end, the second pass from the
+	beginning, for runs that start before 'ulStart'. */
+	for( xPass = 0; ( xPass < 2 ) && ( ulReturn == 0ul ) && ( FF_isERR( xError ) == pdFALSE ); xPass++ )
+	{
+		if( xPass == 0 )
+		{
+			ulCluster = ulStart;
+			ulEnd = ulNumClusters;
+		}
+		else
+		{
+			ulCluster = 2ul;
+			ulEnd = ( ulStart > 2ul ) ? ( ulStart + ulCount - 1ul ) : 2ul;
+			if( ulEnd > ulNumClusters )
+			{
+				ulEnd = ulNumClusters;
+			}
+		}
+
+		ulRunLength = 0ul;
+		for( ; ulCluster < ulEnd; ulCluster++ )
+		{
+			ulFATEntry = FF_getFATEntry( pxIOManager, ulCluster, &xError, &xFATBuffers );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+
+			if( ulFATEntry != 0ul )
+			{
+				ulRunLength = 0ul;
+			}
+			else
+			{
+				if( ulRunLength == 0ul )
+				{
+					ulRunStart = ulCluster;
+				}
+				ulRunLength++;
+				if( ulRunLength == ulCount )
+				{
+					ulReturn = ulRunStart;
+					break;
+				}
+			}
+		}
+	}
+
+	xTempError = FF_ReleaseFATBuffers( pxIOManager, &xFATBuffers );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		xError = xTempError;
+	}
+
+	if( FF_isERR( xError ) )
+	{
+		ulReturn = 0ul;
+	}
+	*pxError = xError;
+
+	return ulReturn;
+}	/* FF_FindFreeRun() */
+/*-----------------------------------------------------------*/
+
 /**
  * @private
  * @brief	Creates a Cluster Chain
@@ -1168,7 +1259,7 @@ FF_Error_t xError = FF_ERR_NONE;
 
 	FF_InitFATBuffers( &xFATBuffers, FF_MODE_READ );
 
-	FF_LockFAT( pxIOManager );
+	FF_LockFATRead( pxIOManager );
 	{
 		while( FF_isEndOfChain( pxIOManager, ulStartCluster ) == pdFALSE )
 		{
@@ -1189,7 +1280,7 @@ FF_Error_t xError = FF_ERR_NONE;
 		}
 		xError = FF_ReleaseFATBuffers( pxIOManager, &xFATBuffers );
 	}
-	FF_UnlockFAT( pxIOManager );
+	FF_UnlockFATRead( pxIOManager );
 
 	*pxError = xError;
 
@@ -51,6 +51,39 @@ static int32_t FF_WritePartial( FF_FILE *pxFile, uint32_t ulItemLBA, uint32_t ul
 static uint32_t FF_SetCluster( FF_FILE *pxFile, FF_Error_t *pxError );
 static uint32_t FF_FileLBA( FF_FILE *pxFile );
 
+static FF_Error_t FF_FlushDirent( FF_FILE *pxFile );
+
+static void prvFreeFileHandle( FF_IOManager_t *pxIOManager, FF_FILE *pxFile );
+
+static BaseType_t prvOpenFileBucket( uint32_t ulDirCluster, uint16_t usDirEntry );
+static void prvRemoveOpenFile( FF_FILE *pxFile );
+
+static BaseType_t prvHandleBucket( const FF_FILE *pxFile );
+static void prvIndexHandle( FF_FILE *pxFile );
+static void prvUnindexHandle( FF_FILE *pxFile );
+
+/* The addresses of all open handles, of all I/O managers, hashed on the
+address.  FF_CheckValid() finds a handle here before it reads any of its
+fields, so that a handle that was closed, and possibly freed, is never
+dereferenced.  Protected by a critical section, as there is no I/O manager
+to take a semaphore from before the handle is known to be valid. */
+static FF_FILE *pxOpenHandles[ ffconfigHANDLE_INDEX_BUCKETS ];
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	/* See ff_file.h.  Set and cleared in the same critical sections as
+	'pxOpenHandles'. */
+	FF_FILE * volatile pxFFLastValidFile = NULL;
+#endif
+
+#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+	static void FF_SetDirentDirty( FF_FILE *pxFile, uint8_t ucBits );
+#endif
+
+#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	static FF_Error_t FF_LogFlush( FF_FILE *pxFile );
+	static void FF_LogFree( FF_FILE *pxFile );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -93,6 +126,14 @@ uint8_t ucModeBits = 0x00;
 				ucModeBits |= FF_MODE_WRITE;	/* RW Mode. */
 				break;
 
+			case 'l':						/* Append-only log file, see FF_MODE_LOG. */
+			case 'L':
+				ucModeBits |= FF_MODE_WRITE;
+				ucModeBits |= FF_MODE_APPEND;
+				ucModeBits |= FF_MODE_CREATE; /* Create if not exist. */
+				ucModeBits |= FF_MODE_LOG;
+				break;
+
 			case 'D':
 				/* Internal use only! */
 				ucModeBits |= FF_MODE_DIR;
@@ -114,44 +155,258 @@ uint8_t ucModeBits = 0x00;
 }	/* FF_GetModeBits() */
 /*-----------------------------------------------------------*/
 
-static FF_FILE *prvAllocFileHandle( FF_IOManager_t *pxIOManager, FF_Error_t *pxError )
+static FF_FILE *prvAllocFileHandle( FF_IOManager_t *pxIOManager, uint8_t ucMode, FF_Error_t *pxError )
 {
-FF_FILE *pxFile;
+FF_FILE *pxFile = NULL;
+
+	#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+	{
+	FF_FILE *pxPool = ( FF_FILE * ) pxIOManager->pvFileHandlePool;
+
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
+		{
+			pxFile = ( FF_FILE * ) pxIOManager->pvFreeFileHandles;
+			if( pxFile != NULL )
+			{
+				pxIOManager->pvFreeFileHandles = pxFile->pxNext;
+			}
+		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+
+		if( pxFile != NULL )
+		{
+			memset( pxFile, 0, sizeof( *pxFile ) );
+			#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+			{
+				/* The sector buffers follow the array of handles, in the same order. */
+				pxFile->pucBuffer = ( ( uint8_t * ) &( pxPool[ ffconfigFILE_HANDLE_POOL_SIZE ] ) ) +
+					( ( size_t ) ( pxFile - pxPool ) * pxIOManager->usSectorSize );
+				memset( pxFile->pucBuffer, 0, pxIOManager->usSectorSize );
+			}
+			#else
+			{
+				( void ) pxPool;
+			}
+			#endif
+		}
+	}
+	#endif /* ffconfigFILE_HANDLE_POOL_SIZE */
 
-	pxFile = ffconfigMALLOC( sizeof( FF_FILE ) );
 	if( pxFile == NULL )
 	{
-		*pxError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_OPEN );
+		/* No pool, or all handles of the pool are in use. */
+		pxFile = ffconfigMALLOC( sizeof( FF_FILE ) );
+		if( pxFile == NULL )
+		{
+			*pxError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_OPEN );
+		}
+		else
+		{
+			memset( pxFile, 0, sizeof( *pxFile ) );
+
+			#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+			{
+				pxFile->pucBuffer = ( uint8_t * ) ffconfigMALLOC( pxIOManager->usSectorSize );
+				if( pxFile->pucBuffer != NULL )
+				{
+					memset( pxFile->pucBuffer, 0, pxIOManager->usSectorSize );
+				}
+				else
+				{
+					*pxError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_OPEN );
+					ffconfigFREE( pxFile );
+					/* Make sure that NULL will be returned. */
+					pxFile = NULL;
+				}
+			}
+			#endif
+		}
 	}
-	else
+
+	#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	{
+		if( ( pxFile != NULL ) && ( ( ucMode & FF_MODE_LOG ) != 0 ) )
+		{
+			pxFile->pucLogSector = ( uint8_t * ) ffconfigMALLOC( pxIOManager->usSectorSize );
+			pxFile->pvLogMutex = FF_CreateSemaphore();
+			pxFile->xLogSyncTime = xTaskGetTickCount();
+			if( ( pxFile->pucLogSector == NULL ) || ( pxFile->pvLogMutex == NULL ) )
+			{
+				*pxError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_OPEN );
+				FF_LogFree( pxFile );
+				prvFreeFileHandle( pxIOManager, pxFile );
+				pxFile = NULL;
+			}
+		}
+	}
+	#else
 	{
-		memset( pxFile, 0, sizeof( *pxFile ) );
+		( void ) ucMode;
+	}
+	#endif
+
+	return pxFile;
+}	/* prvAllocFileHandle() */
+/*-----------------------------------------------------------*/
 
+/* Give a handle obtained from prvAllocFileHandle() back to the pool, or to the
+heap.  The resources that the handle refers to must have been released. */
+static void prvFreeFileHandle( FF_IOManager_t *pxIOManager, FF_FILE *pxFile )
+{
+	#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+	FF_FILE *pxPool = ( FF_FILE * ) pxIOManager->pvFileHandlePool;
+
+	if( ( pxFile >= pxPool ) && ( pxFile < &( pxPool[ ffconfigFILE_HANDLE_POOL_SIZE ] ) ) )
+	{
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
+		{
+			pxFile->pxNext = ( FF_FILE * ) pxIOManager->pvFreeFileHandles;
+			pxIOManager->pvFreeFileHandles = pxFile;
+		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+	}
+	else
+	#else
+	( void ) pxIOManager;
+	#endif /* ffconfigFILE_HANDLE_POOL_SIZE */
+	{
 		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
 		{
-			pxFile->pucBuffer = ( uint8_t * ) ffconfigMALLOC( pxIOManager->usSectorSize );
-			if( pxFile->pucBuffer != NULL )
+			ffconfigFREE( pxFile->pucBuffer );
+		}
+		#endif
+		ffconfigFREE( pxFile );
+	}
+}	/* prvFreeFileHandle() */
+/*-----------------------------------------------------------*/
+
+/* Return the index of the list in 'pvOpenFiles' that holds the handles of a
+directory entry.  Entries of the same directory are spread over the lists. */
+static BaseType_t prvOpenFileBucket( uint32_t ulDirCluster, uint16_t usDirEntry )
+{
+uint32_t ulHash = ( ( ulDirCluster ^ ( ulDirCluster >> 16 ) ) * 31ul ) + usDirEntry;
+
+	return ( BaseType_t ) ( ulHash % ( uint32_t ) ffconfigOPEN_FILE_BUCKETS );
+}	/* prvOpenFileBucket() */
+/*-----------------------------------------------------------*/
+
+/* Take a handle out of the table of open files, after which FF_CheckValid()
+will not accept it anymore. */
+static void prvRemoveOpenFile( FF_FILE *pxFile )
+{
+FF_IOManager_t *pxIOManager = pxFile->pxIOManager;
+FF_FILE **ppxLink;
+
+	FF_PendSemaphore( pxIOManager->pvSemaphore );
+	{	/* Semaphore is required, or linked list could become corrupted. */
+		ppxLink = ( FF_FILE ** ) &( pxIOManager->pvOpenFiles[ prvOpenFileBucket( pxFile->ulDirCluster, pxFile->usDirEntry ) ] );
+		while( *ppxLink != NULL )
+		{
+			if( *ppxLink == pxFile )
 			{
-				memset( pxFile->pucBuffer, 0, pxIOManager->usSectorSize );
+				/* Found it, remove it from the list. */
+				*ppxLink = pxFile->pxNext;
+				pxIOManager->uxOpenFiles--;
+				break;
 			}
-			else
+			ppxLink = &( ( *ppxLink )->pxNext );
+		}
+		pxFile->ulHandleTag = 0ul;
+		prvUnindexHandle( pxFile );
+	}
+	FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+}	/* prvRemoveOpenFile() */
+/*-----------------------------------------------------------*/
+
+/* Return the index of the list in 'pxOpenHandles' that may hold pxFile.  The
+address is only hashed, never dereferenced.  The handles of a pool lie next to
+each other, so they go to consecutive lists. */
+static BaseType_t prvHandleBucket( const FF_FILE *pxFile )
+{
+	return ( BaseType_t ) ( ( ( size_t ) pxFile / sizeof( FF_FILE ) ) & ( size_t ) ( ffconfigHANDLE_INDEX_BUCKETS - 1 ) );
+}	/* prvHandleBucket() */
+/*-----------------------------------------------------------*/
+
+static void prvIndexHandle( FF_FILE *pxFile )
+{
+BaseType_t xBucket = prvHandleBucket( pxFile );
+
+	taskENTER_CRITICAL();
+	{
+		pxFile->pxNextHandle = pxOpenHandles[ xBucket ];
+		pxOpenHandles[ xBucket ] = pxFile;
+	}
+	taskEXIT_CRITICAL();
+}	/* prvIndexHandle() */
+/*-----------------------------------------------------------*/
+
+static void prvUnindexHandle( FF_FILE *pxFile )
+{
+FF_FILE **ppxLink;
+
+	taskENTER_CRITICAL();
+	{
+		for( ppxLink = &( pxOpenHandles[ prvHandleBucket( pxFile ) ] ); *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNextHandle ) )
+		{
+			if( *ppxLink == pxFile )
 			{
-				*pxError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_OPEN );
-				ffconfigFREE( pxFile );
-				/* Make sure that NULL will be returned. */
-				pxFile = NULL;
+				*ppxLink = pxFile->pxNextHandle;
+				break;
 			}
 		}
-		#else
+
+		#if( ffconfigSTDIO_BUFFERS != 0 )
 		{
-			/* Remove compiler warnings. */
-			( void ) pxIOManager;
+			if( pxFFLastValidFile == pxFile )
+			{
+				pxFFLastValidFile = NULL;
+			}
 		}
 		#endif
 	}
+	taskEXIT_CRITICAL();
+}	/* prvUnindexHandle() */
+/*-----------------------------------------------------------*/
 
-	return pxFile;
-}	/* prvAllocFileHandle() */
+void FF_ResetOpenFiles( FF_IOManager_t *pxIOManager )
+{
+FF_FILE *pxFile;
+BaseType_t xBucket;
+
+	/* Handles of a previous mount stay allocated until they are closed, but
+	FF_CheckValid() must not accept them anymore. */
+	for( xBucket = 0; xBucket < ( BaseType_t ) ffconfigOPEN_FILE_BUCKETS; xBucket++ )
+	{
+		for( pxFile = ( FF_FILE * ) pxIOManager->pvOpenFiles[ xBucket ]; pxFile != NULL; pxFile = pxFile->pxNext )
+		{
+			prvUnindexHandle( pxFile );
+		}
+	}
+
+	memset( pxIOManager->pvOpenFiles, '\0', sizeof( pxIOManager->pvOpenFiles ) );
+	pxIOManager->uxOpenFiles = 0;
+}	/* FF_ResetOpenFiles() */
+/*-----------------------------------------------------------*/
+
+FF_FILE *FF_NextOpenFile( FF_IOManager_t *pxIOManager, FF_FILE *pxFile )
+{
+FF_FILE *pxNext = NULL;
+BaseType_t xBucket = 0;
+
+	if( pxFile != NULL )
+	{
+		pxNext = pxFile->pxNext;
+		xBucket = prvOpenFileBucket( pxFile->ulDirCluster, pxFile->usDirEntry ) + 1;
+	}
+
+	while( ( pxNext == NULL ) && ( xBucket < ( BaseType_t ) ffconfigOPEN_FILE_BUCKETS ) )
+	{
+		pxNext = ( FF_FILE * ) pxIOManager->pvOpenFiles[ xBucket ];
+		xBucket++;
+	}
+
+	return pxNext;
+}	/* FF_NextOpenFile() */
 /*-----------------------------------------------------------*/
 
 /**
@@ -171,6 +426,11 @@ FF_FILE *pxFile;
  * - FF_MODE_APPEND
  *   - Causes all writes to occur at the end of the file. (Its impossible to overwrite other data in a file with this flag set).
  *   .
+ * - FF_MODE_LOG
+ *   - Write-only append mode for log files, implies FF_MODE_WRITE and FF_MODE_APPEND.  The last sector is kept
+ *     in the handle, clusters are reserved ahead and the size is published periodically, see ffconfigLOG_FILE_SUPPORT.
+ *     The handle may be shared by tasks that append to the same log.
+ *   .
  * .
  *
  * Some sample modes:
@@ -225,6 +485,19 @@ FF_FindParams_t xFindParams;
 
 	memset( &xFindParams, '\0', sizeof( xFindParams ) );
 
+	if( ( ucMode & FF_MODE_LOG ) != 0 )
+	{
+		/* The end of a log file lives in its handle, so the handle can not be
+		used for reading. */
+		ucMode = ( uint8_t ) ( ( ucMode | FF_MODE_WRITE | FF_MODE_APPEND ) & ~FF_MODE_READ );
+		#if( ffconfigLOG_FILE_SUPPORT == 0 )
+		{
+			/* Without support, a log file is an ordinary append-only file. */
+			ucMode = ( uint8_t ) ( ucMode & ~FF_MODE_LOG );
+		}
+		#endif
+	}
+
 	/* Inform the functions that the entry will be created if not found. */
 	if( ( ucMode & FF_MODE_CREATE ) != 0 )
 	{
@@ -285,7 +558,7 @@ FF_FindParams_t xFindParams;
 		else if( FF_isERR( xError ) == pdFALSE )
 		{
 			/* Allocate an empty file handle and buffer space for 'unaligned access'. */
-			pxFile = prvAllocFileHandle( pxIOManager, &xError );
+			pxFile = prvAllocFileHandle( pxIOManager, ucMode, &xError );
 		}
 	}
 
@@ -367,43 +640,38 @@ FF_FindParams_t xFindParams;
 		pxFile->ulEndOfChain = 0;
 		pxFile->ulValidFlags &= ~( FF_VALID_FLAG_DELETED );
 
-		/* Add pxFile onto the end of our linked list of FF_FILE objects.
-		But first make sure that there are not 2 handles with write access
-		to the same object. */
+		/* Add pxFile to the list of its directory entry in the table of open
+		files.  But first make sure that there are not 2 handles with write
+		access to the same object.  Such handles are always in the same list. */
 		FF_PendSemaphore( pxIOManager->pvSemaphore );
 		{
-			pxFileChain = ( FF_FILE * ) pxIOManager->FirstFile;
-			if( pxFileChain == NULL )
-			{
-				pxIOManager->FirstFile = pxFile;
-			}
-			else
+			xIndex = prvOpenFileBucket( pxFile->ulDirCluster, pxFile->usDirEntry );
+			for( pxFileChain = ( FF_FILE * ) pxIOManager->pvOpenFiles[ xIndex ]; pxFileChain != NULL; pxFileChain = pxFileChain->pxNext )
 			{
-				for( ; ; )
+				/* See if two file handles point to the same object.  The
+				first cluster is not compared: a handle with deferred
+				dirent updates may know a cluster that is not on disk yet. */
+				if( ( pxFileChain->ulDirCluster == pxFile->ulDirCluster ) &&
+					( pxFileChain->usDirEntry == pxFile->usDirEntry ) )
 				{
-					/* See if two file handles point to the same object. */
-					if( ( pxFileChain->ulObjectCluster == pxFile->ulObjectCluster ) &&
-						( pxFileChain->ulDirCluster == pxFile->ulDirCluster ) &&
-						( pxFileChain->usDirEntry == pxFile->usDirEntry ) )
-					{
-						/* Fail if any of the two has write access to the object. */
-						if( ( ( pxFileChain->ucMode | pxFile->ucMode ) & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) != 0 )
-						{
-							/* File is already open! DON'T ALLOW IT! */
-							xError = ( FF_Error_t ) ( FF_ERR_FILE_ALREADY_OPEN | FF_OPEN );
-							break;
-						}
-					}
-
-					if( pxFileChain->pxNext == NULL )
+					/* Fail if any of the two has write access to the object. */
+					if( ( ( pxFileChain->ucMode | pxFile->ucMode ) & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) != 0 )
 					{
-						pxFileChain->pxNext = pxFile;
+						/* File is already open! DON'T ALLOW IT! */
+						xError = ( FF_Error_t ) ( FF_ERR_FILE_ALREADY_OPEN | FF_OPEN );
 						break;
 					}
-
-					pxFileChain = ( FF_FILE * ) pxFileChain->pxNext;
 				}
 			}
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pxFile->pxNext = ( FF_FILE * ) pxIOManager->pvOpenFiles[ xIndex ];
+				pxIOManager->pvOpenFiles[ xIndex ] = pxFile;
+				pxIOManager->uxOpenFiles++;
+				pxFile->ulHandleTag = FF_FILE_HANDLE_TAG( pxIOManager );
+				prvIndexHandle( pxFile );
+			}
 		}
 
 		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
@@ -417,6 +685,11 @@ FF_FindParams_t xFindParams;
 			/* Set the current size and position to zero. */
 			pxFile->ulFileSize = 0;
 			pxFile->ulFilePointer = 0;
+			#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+			{
+				FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_SIZE );
+			}
+			#endif
 		}
 	}
 
@@ -424,12 +697,12 @@ FF_FindParams_t xFindParams;
 	{
 		if( pxFile != NULL )
 		{
-			#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+			#if( ffconfigLOG_FILE_SUPPORT != 0 )
 			{
-				ffconfigFREE( pxFile->pucBuffer );
+				FF_LogFree( pxFile );
 			}
 			#endif
-			ffconfigFREE( pxFile );
+			prvFreeFileHandle( pxIOManager, pxFile );
 		}
 		pxFile = NULL;
 	}
@@ -562,8 +835,10 @@ FF_Error_t			xError = FF_ERR_NONE;
 			state. */
 			memset( &xFetchContext, '\0', sizeof( xFetchContext ) );
 
-			/* This task will get the unique right to change directories. */
-			FF_LockDirectory( pxIOManager );
+			/* This task will get the unique right to change the directory
+			itself, so no entries can be added while it is being removed, and
+			to change its parent. */
+			FF_LockDirectoryPair( pxIOManager, pxFile->ulDirCluster, pxFile->ulObjectCluster );
 			do /* while( pdFALSE ) */
 			{
 				/* This while loop is only introduced to be able to use break
@@ -573,26 +848,9 @@ FF_Error_t			xError = FF_ERR_NONE;
 					xError = ( FF_ERR_DIR_NOT_EMPTY | FF_RMDIR );
 					break;
 				}
-				FF_LockFAT( pxIOManager );
-				#if( ffconfigHASH_CACHE != 0 )
-				{
-					/* A directory is removed so invalidate any hash table
-					referring to this directory. */
-					FF_UnHashDir( pxIOManager, pxFile->ulObjectCluster );
-				}
-				#endif	/* ffconfigHASH_CACHE */
-				{
-					/* Add parameter 0 to delete the entire chain!
-					The actual directory entries on disk will be freed. */
-					xError = FF_UnlinkClusterChain( pxIOManager, pxFile->ulObjectCluster, 0 );
-				}
-				FF_UnlockFAT( pxIOManager );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
 
-				/* Now remove this directory from its parent directory.
+				/* First remove this directory from its parent directory, so no
+				task can find it any more once its clusters are freed.
 				Initialise the dirent Fetch Context object for faster removal of
 				dirents. */
 				xError = FF_InitEntryFetch( pxIOManager, pxFile->ulDirCluster, &xFetchContext );
@@ -632,6 +890,12 @@ FF_Error_t			xError = FF_ERR_NONE;
 					break;
 				}
 
+				xError = FF_CleanupEntryFetch( pxIOManager, &xFetchContext );
+				if( FF_isERR( xError ) )
+				{
+					break;
+				}
+
 				#if( ffconfigPATH_CACHE != 0 )
 				{
 					/* We're removing a directory which might contain
@@ -640,6 +904,28 @@ FF_Error_t			xError = FF_ERR_NONE;
 					FF_RmPathCache( pxIOManager, pcPath );
 				}
 				#endif
+
+				/* Now the clusters of the directory can be freed. */
+				FF_LockFAT( pxIOManager );
+				#if( ffconfigHASH_CACHE != 0 )
+				{
+					/* A directory is removed so invalidate any hash table
+					referring to this directory. */
+					FF_UnHashDir( pxIOManager, pxFile->ulObjectCluster );
+				}
+				#endif	/* ffconfigHASH_CACHE */
+				#if( ffconfigDIRENT_HINT_CACHE != 0 )
+				{
+					/* The cluster may be re-used for a new directory. */
+					FF_UnHintDir( pxIOManager, pxFile->ulObjectCluster );
+				}
+				#endif	/* ffconfigDIRENT_HINT_CACHE */
+				{
+					/* Add parameter 0 to delete the entire chain!
+					The actual directory entries on disk will be freed. */
+					xError = FF_UnlinkClusterChain( pxIOManager, pxFile->ulObjectCluster, 0 );
+				}
+				FF_UnlockFAT( pxIOManager );
 			} while( pdFALSE );
 			{
 			FF_Error_t xTempError;
@@ -648,7 +934,7 @@ FF_Error_t			xError = FF_ERR_NONE;
 				{
 					xError = xTempError;
 				}
-				FF_UnlockDirectory( pxIOManager );
+				FF_UnlockDirectoryPair( pxIOManager, pxFile->ulDirCluster, pxFile->ulObjectCluster );
 
 				/* Free the file pointer resources. */
 				xTempError = FF_Close( pxFile );
@@ -711,7 +997,7 @@ FF_FetchContext_t xFetchContext;
 			memset( &xFetchContext, '\0', sizeof( xFetchContext ) );
 
 			/* Get sole access to "directory changes" */
-			FF_LockDirectory( pxIOManager );
+			FF_LockDirectory( pxIOManager, pxFile->ulDirCluster );
 
 			/* Edit the Directory Entry! (So it appears as deleted); */
 			do {
@@ -751,7 +1037,7 @@ FF_FetchContext_t xFetchContext;
 				{
 					xError = xTempError;
 				}
-				FF_UnlockDirectory( pxIOManager );
+				FF_UnlockDirectory( pxIOManager, pxFile->ulDirCluster );
 
 				/* Free the file pointer resources. */
 				xTempError = FF_Close( pxFile );
@@ -913,15 +1199,25 @@ FF_FetchContext_t xFetchContext;
 
 				if( FF_isERR( xError ) == pdFALSE )
 				{
-					/* Destination directory was found, we can now create the new entry. */
-					xFindParams.ulDirCluster = ulDirCluster;
-					xError = FF_CreateDirent( pxIOManager, &xFindParams, &xMyFile );
+					if( ulDirCluster == pSrcFile->ulDirCluster )
+					{
+						/* A rename within the same directory: the existing
+						entries are reused where possible and there is no
+						need to create a new entry and remove the old one. */
+						xError = FF_RenameDirent( pxIOManager, ulDirCluster, pSrcFile->usDirEntry, xMyFile.pcFileName, NULL );
+					}
+					else
+					{
+						/* Destination directory was found, we can now create the new entry. */
+						xFindParams.ulDirCluster = ulDirCluster;
+						xError = FF_CreateDirent( pxIOManager, &xFindParams, &xMyFile );
+					}
 				}
 
-				if( FF_isERR( xError ) == pdFALSE )
+				if( ( FF_isERR( xError ) == pdFALSE ) && ( ulDirCluster != pSrcFile->ulDirCluster ) )
 				{
 					/* Edit the Directory Entry! (So it appears as deleted); */
-					FF_LockDirectory( pxIOManager );
+					FF_LockDirectory( pxIOManager, pSrcFile->ulDirCluster );
 					{
 						xError = FF_RmLFNs( pxIOManager, pSrcFile->usDirEntry, &xFetchContext );
 
@@ -946,7 +1242,7 @@ FF_FetchContext_t xFetchContext;
 							}
 						}
 					}
-					FF_UnlockDirectory( pxIOManager );
+					FF_UnlockDirectory( pxIOManager, pSrcFile->ulDirCluster );
 				}
 
 				#if( ffconfigPATH_CACHE != 0 )
@@ -1116,7 +1412,7 @@ uint32_t ulIndex = 0;
 
 	*pxError = FF_ERR_NONE;
 
-	FF_LockFAT( pxIOManager );
+	FF_LockFATRead( pxIOManager );
 	do
 	{
 		ulCurrentCluster = ulNextCluster;
@@ -1143,7 +1439,7 @@ uint32_t ulIndex = 0;
 	}
 	while( ulNextCluster == ( ulCurrentCluster + 1 ) );
 
-	FF_UnlockFAT( pxIOManager );
+	FF_UnlockFATRead( pxIOManager );
 
 	*pxError = FF_ReleaseFATBuffers( pxIOManager, &xFATBuffers );
 
@@ -1182,12 +1478,9 @@ FF_Error_t xError = FF_ERR_NONE;
 
 		ulCount -= ( ulSequentialClusters + 1 );
 
-		FF_LockFAT( pxFile->pxIOManager );
-		{
-			pxFile->ulAddrCurrentCluster =
-				FF_TraverseFAT( pxFile->pxIOManager, pxFile->ulAddrCurrentCluster, ulSequentialClusters + 1, &xError );
-		}
-		FF_UnlockFAT( pxFile->pxIOManager );
+		/* FF_TraverseFAT() takes a read lock on the FAT by itself. */
+		pxFile->ulAddrCurrentCluster =
+			FF_TraverseFAT( pxFile->pxIOManager, pxFile->ulAddrCurrentCluster, ulSequentialClusters + 1, &xError );
 		if( FF_isERR( xError ) )
 		{
 			break;
@@ -1210,7 +1503,9 @@ uint32_t ulTotalClustersNeeded = ( ulSize + ulBytesPerCluster - 1 ) / ulBytesPer
 uint32_t ulClusterToExtend;
 /* Initialise xIndex just for the compiler. */
 BaseType_t xIndex = 0;
-FF_DirEnt_t xOriginalEntry;
+#if( ffconfigDEFERRED_DIRENT_UPDATE == 0 )
+	FF_DirEnt_t xOriginalEntry;
+#endif
 FF_Error_t xError = FF_ERR_NONE;
 FF_FATBuffers_t xFATBuffers;
 
@@ -1227,23 +1522,33 @@ FF_FATBuffers_t xFATBuffers;
 
 			if( FF_isERR( xError ) == pdFALSE )
 			{
-				/* The directory denotes the address of the first data cluster of every file.
-				Now change it to 'ulAddrCurrentCluster': */
-				xError = FF_GetEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
-
-				if( FF_isERR( xError ) == pdFALSE )
+				#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+				{
+					/* The directory entry will get the new cluster when it is
+					written at close or sync. */
+					FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_CLUSTER );
+				}
+				#else
 				{
-					xOriginalEntry.ulObjectCluster = pxFile->ulAddrCurrentCluster;
-					xError = FF_PutEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
+					/* The directory denotes the address of the first data cluster of every file.
+					Now change it to 'ulAddrCurrentCluster': */
+					xError = FF_GetEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
 
 					if( FF_isERR( xError ) == pdFALSE )
 					{
-						pxFile->ulObjectCluster = pxFile->ulAddrCurrentCluster;
-						pxFile->ulChainLength = 1;
-						pxFile->ulCurrentCluster = 0;
-						pxFile->ulEndOfChain = pxFile->ulAddrCurrentCluster;
+						xOriginalEntry.ulObjectCluster = pxFile->ulAddrCurrentCluster;
+						xError = FF_PutEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
 					}
 				}
+				#endif /* ffconfigDEFERRED_DIRENT_UPDATE */
+
+				if( FF_isERR( xError ) == pdFALSE )
+				{
+					pxFile->ulObjectCluster = pxFile->ulAddrCurrentCluster;
+					pxFile->ulChainLength = 1;
+					pxFile->ulCurrentCluster = 0;
+					pxFile->ulEndOfChain = pxFile->ulAddrCurrentCluster;
+				}
 			}
 		}
 		else
@@ -1385,12 +1690,9 @@ FF_Error_t xError = FF_ERR_NONE;
 
 		ulCount -= ulSequentialClusters + 1;
 
-		FF_LockFAT( pxFile->pxIOManager );
-		{
-			pxFile->ulAddrCurrentCluster =
-				FF_TraverseFAT( pxFile->pxIOManager, pxFile->ulAddrCurrentCluster, ulSequentialClusters + 1, &xError );
-		}
-		FF_UnlockFAT( pxFile->pxIOManager );
+		/* FF_TraverseFAT() takes a read lock on the FAT by itself. */
+		pxFile->ulAddrCurrentCluster =
+			FF_TraverseFAT( pxFile->pxIOManager, pxFile->ulAddrCurrentCluster, ulSequentialClusters + 1, &xError );
 		if( FF_isERR( xError ) )
 		{
 			break;
@@ -1452,20 +1754,12 @@ uint32_t ulReturn;
 
 	if( ulNewCluster > pxFile->ulCurrentCluster )
 	{
-		FF_LockFAT( pxIOManager );
-		{
-			pxFile->ulAddrCurrentCluster = FF_TraverseFAT( pxIOManager, pxFile->ulAddrCurrentCluster,
-				ulNewCluster - pxFile->ulCurrentCluster, &xResult );
-		}
-		FF_UnlockFAT( pxIOManager );
+		pxFile->ulAddrCurrentCluster = FF_TraverseFAT( pxIOManager, pxFile->ulAddrCurrentCluster,
+			ulNewCluster - pxFile->ulCurrentCluster, &xResult );
 	}
 	else if( ulNewCluster < pxFile->ulCurrentCluster )
 	{
-		FF_LockFAT( pxIOManager );
-		{
-			pxFile->ulAddrCurrentCluster = FF_TraverseFAT( pxIOManager, pxFile->ulObjectCluster, ulNewCluster, &xResult );
-		}
-		FF_UnlockFAT( pxIOManager );
+		pxFile->ulAddrCurrentCluster = FF_TraverseFAT( pxIOManager, pxFile->ulObjectCluster, ulNewCluster, &xResult );
 	}
 	else
 	{
@@ -1571,35 +1865,186 @@ uint32_t ulBytesRead;
 /*-----------------------------------------------------------*/
 
 /**
- *	@public
- *	@brief	Equivalent to fread()
- *
- *	@param	pxFile			FF_FILE object that was created by FF_Open().
- *	@param	ulElementSize	The size of an element to read.
- *	@param	ulCount			The number of elements to read.
- *	@param	buffer			A pointer to a buffer of adequate size to be filled with the requested data.
- *
- *	@return Number of bytes read.
+ *	@private
+ *	@brief	Reads from the current position of a file that was checked by the
+ *			caller, the number of bytes must not pass the end of the file.
  *
- * FF_Read() and FF_Write() work very similar. They both complete their task in 5 steps:
- *	1. Read bytes up to a sector border:  FF_ReadPartial()
- *	2. Read sectors up to cluster border: FF_BlockRead()
- *	3. Read complete clusters:            FF_ReadClusters()
- *	4. Read remaining sectors:            FF_BlockRead()
- *	5. Read remaining bytes:              FF_ReadPartial()
+ *	@return	The number of bytes read.
  **/
-int32_t FF_Read( FF_FILE *pxFile, uint32_t ulElementSize, uint32_t ulCount, uint8_t *pucBuffer )
+static uint32_t FF_ReadBytes( FF_FILE *pxFile, uint32_t ulBytesLeft, uint8_t *pucBuffer, FF_Error_t *pxError )
 {
-uint32_t ulBytesLeft = ulElementSize * ulCount;
 uint32_t ulBytesRead = 0;
 uint32_t ulBytesToRead;
 FF_IOManager_t *pxIOManager;
 uint32_t ulRelBlockPos;
 uint32_t ulItemLBA;
-int32_t lResult;
 uint32_t ulSectors;
 uint32_t ulRelClusterPos;
 uint32_t ulBytesPerCluster;
+FF_Error_t xError;
+
+	pxIOManager = pxFile->pxIOManager;
+
+	/* And calculate the Logical Block Address. */
+	ulItemLBA = FF_SetCluster( pxFile, &xError );
+
+	/* Get the position within a block. */
+	ulRelBlockPos = FF_getMinorBlockEntry( pxIOManager, pxFile->ulFilePointer, 1 );
+	/* Open a do {} while( 0 ) loop to allow easy breaks: */
+	do
+	{
+		if( ( ulRelBlockPos + ulBytesLeft ) <= ( uint32_t ) pxIOManager->usSectorSize )
+		{
+			/*---------- A small read within the current block only. */
+			ulBytesRead = FF_ReadPartial( pxFile, ulItemLBA, ulRelBlockPos, ulBytesLeft, pucBuffer, &xError );
+			break;
+		}
+		/*---------- Read (memcpy) to a Sector Boundary. */
+		if( ulRelBlockPos != 0 )
+		{
+			/* Not on a sector boundary, at this point the LBA is known. */
+			ulBytesToRead = pxIOManager->usSectorSize - ulRelBlockPos;
+			ulBytesRead = FF_ReadPartial( pxFile, ulItemLBA, ulRelBlockPos, ulBytesToRead, pucBuffer, &xError );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+			ulBytesLeft -= ulBytesRead;
+			pucBuffer += ulBytesRead;
+		}
+
+		/*---------- Read sectors, up to a Cluster Boundary. */
+		ulBytesPerCluster = ( pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize );
+		ulRelClusterPos = pxFile->ulFilePointer % ( ulBytesPerCluster * pxIOManager->xPartition.ucBlkFactor );
+
+		if( ( ulRelClusterPos != 0 ) && ( ( ulRelClusterPos + ulBytesLeft ) >= ulBytesPerCluster ) )
+		{
+			/* Need to get to cluster boundary. */
+			ulItemLBA = FF_SetCluster( pxFile, &xError );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+			ulSectors = pxIOManager->xPartition.ulSectorsPerCluster - ( ulRelClusterPos / pxIOManager->usSectorSize );
+			xError = FF_BlockRead( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+			ulBytesToRead = ulSectors * pxIOManager->usSectorSize;
+			ulBytesLeft -= ulBytesToRead;
+			pucBuffer += ulBytesToRead;
+			ulBytesRead += ulBytesToRead;
+			pxFile->ulFilePointer += ulBytesToRead;
+		}
+
+		/*---------- Read entire clusters. */
+		if( ulBytesLeft >= ulBytesPerCluster )
+		{
+		uint32_t ulClusters;
+
+		FF_SetCluster( pxFile, &xError );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+
+			ulClusters = ulBytesLeft / ulBytesPerCluster;
+
+			xError = FF_ReadClusters( pxFile, ulClusters, pucBuffer );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+			ulBytesToRead = ulBytesPerCluster * ulClusters;
+			pxFile->ulFilePointer += ulBytesToRead;
+			ulBytesLeft -= ulBytesToRead;
+			pucBuffer += ulBytesToRead;
+			ulBytesRead += ulBytesToRead;
+		}
+
+		/*---------- Read Remaining Blocks. */
+		while( ulBytesLeft >= ( uint32_t ) pxIOManager->usSectorSize )
+		{
+			ulSectors = ulBytesLeft / pxIOManager->usSectorSize;
+			{
+				/* HT: I'd leave these pPart/ulOffset for readability */
+				/* and shorter code lines */
+				FF_Partition_t *pPart = &( pxIOManager->xPartition );
+				uint32_t ulOffset = ( pxFile->ulFilePointer / pxIOManager->usSectorSize ) % pPart->ulSectorsPerCluster;
+				uint32_t ulRemain = pPart->ulSectorsPerCluster - ulOffset;
+				if( ulSectors > ulRemain )
+				{
+					ulSectors = ulRemain;
+				}
+			}
+
+			ulItemLBA = FF_SetCluster( pxFile, &xError );
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+			xError = FF_BlockRead( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
+
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
+			ulBytesToRead = ulSectors * pxIOManager->usSectorSize;
+			pxFile->ulFilePointer += ulBytesToRead;
+			ulBytesLeft -= ulBytesToRead;
+			pucBuffer += ulBytesToRead;
+			ulBytesRead += ulBytesToRead;
+		}
+
+		/*---------- Read (memcpy) Remaining Bytes */
+		if( ulBytesLeft == 0 )
+		{
+			break;
+		}
+		ulItemLBA = FF_SetCluster( pxFile, &xError );
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+		/* Bytes to read are within a block and less than a block size. */
+		FF_ReadPartial( pxFile, ulItemLBA, 0, ulBytesLeft, pucBuffer, &xError );
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			ulBytesRead += ulBytesLeft;
+		}
+	}
+	while( pdFALSE );
+
+	*pxError = xError;
+
+	return ulBytesRead;
+}	/* FF_ReadBytes() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@public
+ *	@brief	Equivalent to fread()
+ *
+ *	@param	pxFile			FF_FILE object that was created by FF_Open().
+ *	@param	ulElementSize	The size of an element to read.
+ *	@param	ulCount			The number of elements to read.
+ *	@param	buffer			A pointer to a buffer of adequate size to be filled with the requested data.
+ *
+ *	@return Number of bytes read.
+ *
+ * FF_Read() and FF_Write() work very similar. They both complete their task in 5 steps:
+ *	1. Read bytes up to a sector border:  FF_ReadPartial()
+ *	2. Read sectors up to cluster border: FF_BlockRead()
+ *	3. Read complete clusters:            FF_ReadClusters()
+ *	4. Read remaining sectors:            FF_BlockRead()
+ *	5. Read remaining bytes:              FF_ReadPartial()
+ **/
+int32_t FF_Read( FF_FILE *pxFile, uint32_t ulElementSize, uint32_t ulCount, uint8_t *pucBuffer )
+{
+uint32_t ulBytesLeft = ulElementSize * ulCount;
+uint32_t ulBytesRead = 0;
+int32_t lResult;
 FF_Error_t xError;
 
 	if( pxFile == NULL )
@@ -1637,139 +2082,193 @@ FF_Error_t xError;
 
 	if( FF_isERR( xError ) == pdFALSE )
 	{
-		pxIOManager = pxFile->pxIOManager;
+		ulBytesRead = FF_ReadBytes( pxFile, ulBytesLeft, pucBuffer, &xError );
+	}
 
-		/* And calculate the Logical Block Address. */
-		ulItemLBA = FF_SetCluster( pxFile, &xError );
+	if( FF_GETERROR( xError ) == FF_ERR_FILE_READ_ZERO )
+	{
+		lResult = 0;
+	}
+	else if( FF_isERR( xError ) )
+	{
+		lResult = xError;
+	}
+	else
+	{
+		lResult = ( int32_t )( ulBytesRead / ulElementSize );
+	}
 
-		/* Get the position within a block. */
-		ulRelBlockPos = FF_getMinorBlockEntry( pxIOManager, pxFile->ulFilePointer, 1 );
-		/* Open a do {} while( 0 ) loop to allow easy breaks: */
-		do
+	return lResult;
+}	/* FF_Read() */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigZERO_COPY_READ != 0 )
+/* The cache buffers that are kept back from FF_ReadBorrow(): one FAT
+operation holds ffconfigBUF_STORE_COUNT sectors of the FAT, while a directory
+operation holds a sector of the directory and may read one more, e.g. when
+it extends the directory.  Loans can last very long, without this reserve
+they could take all buffers and every other access would wait for ever. */
+#define FF_BORROW_RESERVED_BUFFERS		( ffconfigBUF_STORE_COUNT + 2 )
+
+/**
+ *	@public
+ *	@brief	Reads from a file without copying the data.  The sector that holds
+ *			the current position is pinned in the cache, and the caller gets
+ *			a pointer into it.
+ *
+ *	@param	pxFile			FF_FILE object that was created by FF_Open().
+ *	@param	ulMaxLength		The maximum number of bytes to lend out.
+ *	@param	ppucData		Will point to the data, or NULL.
+ *
+ *	@return The number of bytes lent out, which never passes the end of a sector.
+ *	@return 0 at the end of the file.
+ *	@return A negative FF_Error_t code.
+ *
+ *	A read that crosses a sector boundary is served in parts by successive
+ *	calls.  Each call releases the previous loan of the same handle.  The data
+ *	will not see later FF_Write()'s to the same sector.
+ *
+ *	All handles together can borrow the size of the cache minus
+ *	FF_BORROW_RESERVED_BUFFERS sectors.  When that many are lent out, the call
+ *	fails with FF_ERR_FILE_BORROW_LIMIT and nothing is lent out.
+ **/
+int32_t FF_ReadBorrow( FF_FILE *pxFile, uint32_t ulMaxLength, const uint8_t **ppucData )
+{
+FF_IOManager_t *pxIOManager = NULL;
+FF_Buffer_t *pxBuffer;
+uint32_t ulItemLBA = 0ul;
+uint32_t ulRelBlockPos = 0ul;
+uint32_t ulBytesToRead = 0ul;
+int32_t lResult;
+FF_Error_t xError;
+BaseType_t xHandleValid = pdFALSE;
+
+	if( ( pxFile == NULL ) || ( ppucData == NULL ) )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_READBORROW );
+	}
+	else
+	{
+		*ppucData = NULL;
+		xError = FF_CheckValid( pxFile );
+		if( FF_isERR( xError ) == pdFALSE )
 		{
-			if( ( ulRelBlockPos + ulBytesLeft ) <= ( uint32_t ) pxIOManager->usSectorSize )
+			xHandleValid = pdTRUE;
+			if( ( pxFile->ucMode & FF_MODE_READ ) == 0 )
 			{
-				/*---------- A small read within the current block only. */
-				ulBytesRead = FF_ReadPartial( pxFile, ulItemLBA, ulRelBlockPos, ulBytesLeft, pucBuffer, &xError );
-				break;
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_READ_MODE | FF_READBORROW );
 			}
-			/*---------- Read (memcpy) to a Sector Boundary. */
-			if( ulRelBlockPos != 0 )
+			else if( pxFile->ulFilePointer >= pxFile->ulFileSize )
 			{
-				/* Not on a sector boundary, at this point the LBA is known. */
-				ulBytesToRead = pxIOManager->usSectorSize - ulRelBlockPos;
-				ulBytesRead = FF_ReadPartial( pxFile, ulItemLBA, ulRelBlockPos, ulBytesToRead, pucBuffer, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-				ulBytesLeft -= ulBytesRead;
-				pucBuffer += ulBytesRead;
+				/* Not returned, see FF_Read(). */
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_READ_ZERO | FF_READBORROW );
 			}
+		}
+	}
 
-			/*---------- Read sectors, up to a Cluster Boundary. */
-			ulBytesPerCluster = ( pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize );
-			ulRelClusterPos = pxFile->ulFilePointer % ( ulBytesPerCluster * pxIOManager->xPartition.ucBlkFactor );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		pxIOManager = pxFile->pxIOManager;
 
-			if( ( ulRelClusterPos != 0 ) && ( ( ulRelClusterPos + ulBytesLeft ) >= ulBytesPerCluster ) )
+		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+		{
+			/* The sector will be read through the cache, so changes that are
+			still in the private buffer of this handle must reach the disk first. */
+			if( ( pxFile->ucState & FF_BUFSTATE_WRITTEN ) != 0 )
 			{
-				/* Need to get to cluster boundary. */
-				ulItemLBA = FF_SetCluster( pxFile, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-				ulSectors = pxIOManager->xPartition.ulSectorsPerCluster - ( ulRelClusterPos / pxIOManager->usSectorSize );
-				xError = FF_BlockRead( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-				ulBytesToRead = ulSectors * pxIOManager->usSectorSize;
-				ulBytesLeft -= ulBytesToRead;
-				pucBuffer += ulBytesToRead;
-				ulBytesRead += ulBytesToRead;
-				pxFile->ulFilePointer += ulBytesToRead;
+				xError = FF_BlockWrite( pxIOManager, FF_FileLBA( pxFile ), 1, pxFile->pucBuffer, pdFALSE );
 			}
-
-			/*---------- Read entire clusters. */
-			if( ulBytesLeft >= ulBytesPerCluster )
+			if( FF_isERR( xError ) == pdFALSE )
 			{
-			uint32_t ulClusters;
+				pxFile->ucState = FF_BUFSTATE_INVALID;
+			}
+		}
+		#endif
 
-			FF_SetCluster( pxFile, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			ulItemLBA = FF_SetCluster( pxFile, &xError );
+		}
+	}
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		ulRelBlockPos = FF_getMinorBlockEntry( pxIOManager, pxFile->ulFilePointer, 1 );
+		ulBytesToRead = ( uint32_t ) pxIOManager->usSectorSize - ulRelBlockPos;
+		if( ulBytesToRead > pxFile->ulFileSize - pxFile->ulFilePointer )
+		{
+			ulBytesToRead = pxFile->ulFileSize - pxFile->ulFilePointer;
+		}
+		if( ulBytesToRead > ulMaxLength )
+		{
+			ulBytesToRead = ulMaxLength;
+		}
+	}
 
-				ulClusters = ulBytesLeft / ulBytesPerCluster;
+	if( ( xHandleValid != pdFALSE ) && ( pxFile->pxBorrowed != NULL ) &&
+		( ( FF_isERR( xError ) != pdFALSE ) || ( pxFile->pxBorrowed->ulSector != ulItemLBA ) ) )
+	{
+		/* The previous loan of this handle ends here.  A loan of the same
+		sector is passed on, which saves a lot when reading in small parts. */
+		FF_ReadRelease( pxFile );
+	}
 
-				xError = FF_ReadClusters( pxFile, ulClusters, pucBuffer );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-				ulBytesToRead = ulBytesPerCluster * ulClusters;
-				pxFile->ulFilePointer += ulBytesToRead;
-				ulBytesLeft -= ulBytesToRead;
-				pucBuffer += ulBytesToRead;
-				ulBytesRead += ulBytesToRead;
-			}
+	if( ( FF_isERR( xError ) == pdFALSE ) && ( pxFile->pxBorrowed != NULL ) )
+	{
+		*ppucData = pxFile->pxBorrowed->pucBuffer + ulRelBlockPos;
+		pxFile->ulFilePointer += ulBytesToRead;
+	}
+	else if( FF_isERR( xError ) == pdFALSE )
+	{
+		FF_PendSemaphore( pxIOManager->pvSemaphore );
+		{
+		BaseType_t xIndex;
 
-			/*---------- Read Remaining Blocks. */
-			while( ulBytesLeft >= ( uint32_t ) pxIOManager->usSectorSize )
+			if( ( uint32_t ) pxIOManager->usBorrowedBuffers + FF_BORROW_RESERVED_BUFFERS >= ( uint32_t ) pxIOManager->usCacheSize )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_BORROW_LIMIT | FF_READBORROW );
+			}
+			else
 			{
-				ulSectors = ulBytesLeft / pxIOManager->usSectorSize;
+				pxIOManager->usBorrowedBuffers++;
+
+				/* File data is written with FF_BlockWrite(), bypassing the cache.
+				An unused copy of this sector, e.g. of a directory that was
+				removed, may be outdated: drop it so that FF_GetBuffer() reads
+				the sector again. */
+				for( xIndex = 0; xIndex < pxIOManager->usCacheSize; xIndex++ )
 				{
-					/* HT: I'd leave these pPart/ulOffset for readability */
-					/* and shorter code lines */
-					FF_Partition_t *pPart = &( pxIOManager->xPartition );
-					uint32_t ulOffset = ( pxFile->ulFilePointer / pxIOManager->usSectorSize ) % pPart->ulSectorsPerCluster;
-					uint32_t ulRemain = pPart->ulSectorsPerCluster - ulOffset;
-					if( ulSectors > ulRemain )
+					pxBuffer = &( pxIOManager->pxBuffers[ xIndex ] );
+					if( ( pxBuffer->ulSector == ulItemLBA ) && ( pxBuffer->usNumHandles == 0 ) && ( pxBuffer->bModified == pdFALSE ) )
 					{
-						ulSectors = ulRemain;
+						pxBuffer->bValid = pdFALSE;
 					}
 				}
+			}
+		}
+		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
 
-				ulItemLBA = FF_SetCluster( pxFile, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-				xError = FF_BlockRead( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			pxBuffer = FF_GetBuffer( pxIOManager, ulItemLBA, FF_MODE_READ );
+			if( pxBuffer == NULL )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_DEVICE_DRIVER_FAILED | FF_READBORROW );
 
-				if( FF_isERR( xError ) )
+				FF_PendSemaphore( pxIOManager->pvSemaphore );
 				{
-					break;
+					pxIOManager->usBorrowedBuffers--;
 				}
-				ulBytesToRead = ulSectors * pxIOManager->usSectorSize;
-				pxFile->ulFilePointer += ulBytesToRead;
-				ulBytesLeft -= ulBytesToRead;
-				pucBuffer += ulBytesToRead;
-				ulBytesRead += ulBytesToRead;
-			}
-
-			/*---------- Read (memcpy) Remaining Bytes */
-			if( ulBytesLeft == 0 )
-			{
-				break;
+				FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
 			}
-			ulItemLBA = FF_SetCluster( pxFile, &xError );
-			if( FF_isERR( xError ) )
-			{
-				break;
-			}
-			/* Bytes to read are within a block and less than a block size. */
-			FF_ReadPartial( pxFile, ulItemLBA, 0, ulBytesLeft, pucBuffer, &xError );
-			if( FF_isERR( xError ) == pdFALSE )
+			else
 			{
-				ulBytesRead += ulBytesLeft;
+				pxFile->pxBorrowed = pxBuffer;
+				*ppucData = pxBuffer->pucBuffer + ulRelBlockPos;
+				pxFile->ulFilePointer += ulBytesToRead;
 			}
 		}
-		while( pdFALSE );
-	} /* if( FF_isERR( xError ) == pdFALSE ) */
+	}
 
 	if( FF_GETERROR( xError ) == FF_ERR_FILE_READ_ZERO )
 	{
@@ -1781,35 +2280,82 @@ FF_Error_t xError;
 	}
 	else
 	{
-		lResult = ( int32_t )( ulBytesRead / ulElementSize );
+		lResult = ( int32_t ) ulBytesToRead;
 	}
 
 	return lResult;
-}	/* FF_Read() */
+}	/* FF_ReadBorrow() */
 /*-----------------------------------------------------------*/
 
 /**
-*	@public
-*	@brief	Equivalent to fgetc()
-*
-*	@param	pxFile		FF_FILE object that was created by FF_Open().
-*
-*	@return The character that was read (cast as a 32-bit interger). -1 on EOF.
-*	@return FF_Error_t code. (Check with if(FF_isERR(xRetVal)) {}).
-*	@return -1 EOF (end of file).
-*
-**/
-int32_t FF_GetC( FF_FILE *pxFile )
-{
-uint32_t ulItemLBA;
+ *	@public
+ *	@brief	Gives back the sector that was lent out by FF_ReadBorrow().
+ *
+ *	@param	pxFile		FF_FILE object that was created by FF_Open().
+ *
+ *	@return	FF_ERR_NONE on success, also when nothing was borrowed.
+ **/
+FF_Error_t FF_ReadRelease( FF_FILE *pxFile )
+{
+FF_Error_t xError;
+
+	if( pxFile == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_READRELEASE );
+	}
+	else if( pxFile->pxBorrowed == NULL )
+	{
+		xError = FF_ERR_NONE;
+	}
+	else
+	{
+		/* The buffer was obtained in FF_MODE_READ, releasing it will not
+		lead to disk access. */
+		xError = FF_ReleaseBuffer( pxFile->pxIOManager, pxFile->pxBorrowed );
+		pxFile->pxBorrowed = NULL;
+
+		FF_PendSemaphore( pxFile->pxIOManager->pvSemaphore );
+		{
+			pxFile->pxIOManager->usBorrowedBuffers--;
+		}
+		FF_ReleaseSemaphore( pxFile->pxIOManager->pvSemaphore );
+	}
+
+	return xError;
+}	/* FF_ReadRelease() */
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigZERO_COPY_READ */
+
+/**
+*	@public
+*	@brief	Equivalent to fgetc()
+*
+*	@param	pxFile		FF_FILE object that was created by FF_Open().
+*
+*	@return The character that was read (cast as a 32-bit interger). -1 on EOF.
+*	@return FF_Error_t code. (Check with if(FF_isERR(xRetVal)) {}).
+*	@return -1 EOF (end of file).
+*
+**/
+int32_t FF_GetC( FF_FILE *pxFile )
+{
+uint32_t ulItemLBA;
 uint8_t ucReturnedChar;
 uint32_t ulRelBlockPos;
 FF_Error_t xResult;
 
+	/* A handle that was closed may have been freed, it is not read before it
+	has been checked. */
+	xResult = FF_CheckValid( pxFile );
+
 	if( pxFile == NULL )
 	{
 		xResult = FF_ERR_NULL_POINTER | FF_GETC;	/* Ensure this is a signed error. */
 	}
+	else if( FF_isERR( xResult ) != pdFALSE )
+	{
+		/* FF_ERR_FILE_BAD_HANDLE or FF_ERR_FILE_MEDIA_REMOVED. */
+	}
 	else if( ( pxFile->ucMode & FF_MODE_READ ) == 0 )
 	{
 		xResult = FF_ERR_FILE_NOT_OPENED_IN_READ_MODE | FF_GETC;
@@ -2020,933 +2566,2037 @@ uint32_t ulBytesWritten;
 /*-----------------------------------------------------------*/
 
 /**
- *	@public
- *	@brief	Writes data to a File.
+ *	@private
+ *	@brief	Checks a handle before writing to it, and moves to the end of the
+ *			file when it was opened for appending.
+ **/
+static FF_Error_t FF_PrepareWrite( FF_FILE *pxFile, FF_Error_t xFunction )
+{
+FF_Error_t xError;
+
+	/* Check validity of the handle and the current position within the file. */
+	xError = FF_CheckValid( pxFile );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		if( ( pxFile->ucMode & FF_MODE_WRITE ) == 0 )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | xFunction );
+		}
+		/* Make sure a write is after the append point.  FF_WriteLog() positions
+		the writes to a log file itself. */
+		else if( ( pxFile->ucMode & ( FF_MODE_APPEND | FF_MODE_LOG ) ) == FF_MODE_APPEND )
+		{
+			if( pxFile->ulFilePointer < pxFile->ulFileSize )
+			{
+				xError = FF_Seek( pxFile, 0, FF_SEEK_END );
+			}
+		}
+	}
+
+	#if( ffconfigZERO_COPY_READ != 0 )
+	{
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			/* A sector that is lent out would not show the new data. */
+			FF_ReadRelease( pxFile );
+		}
+	}
+	#endif
+
+	return xError;
+}	/* FF_PrepareWrite() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@private
+ *	@brief	Administration after writing 'ulBytesWritten' bytes to a file.
  *
- *	@param	pxFile			FILE Pointer.
- *	@param	ulElementSize		Size of an Element of Data to be copied. (in bytes).
- *	@param	ulCount			Number of Elements of Data to be copied. (ulElementSize * ulCount must not exceed ((2^31)-1) bytes. (2GB). For best performance, multiples of 512 bytes or Cluster sizes are best.
- *	@param	pucBuffer			Byte-wise pucBuffer containing the data to be written.
+ *	@return	'xError', or the result of syncing the directory entry.
+ **/
+static FF_Error_t FF_FinishWrite( FF_FILE *pxFile, uint32_t ulBytesWritten, FF_Error_t xError )
+{
+	#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+	{
+		if( ulBytesWritten != 0u )
+		{
+			FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_SIZE | FF_DIRENT_DIRTY_MODIFIED );
+		}
+		#if( ffconfigDIRENT_SYNC_INTERVAL_MS != 0 )
+		{
+			if( ( FF_isERR( xError ) == pdFALSE ) && ( pxFile->ucDirentDirty != 0u ) &&
+				( ( xTaskGetTickCount() - pxFile->xDirentDirtyTime ) >= pdMS_TO_TICKS( ffconfigDIRENT_SYNC_INTERVAL_MS ) ) )
+			{
+				/* Don't let the directory entry lag behind for too long. */
+				xError = FF_SyncFile( pxFile );
+			}
+		}
+		#endif /* ffconfigDIRENT_SYNC_INTERVAL_MS */
+	}
+	#else
+	{
+		( void ) pxFile;
+		( void ) ulBytesWritten;
+	}
+	#endif /* ffconfigDEFERRED_DIRENT_UPDATE */
+
+	return xError;
+}	/* FF_FinishWrite() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@private
+ *	@brief	Writes at the current position of a file that was checked by the
+ *			caller, and that was already extended to hold the data.
  *
- * FF_Read() and FF_Write() work very similar. They both complete their task in 5 steps:
- *	1. Write bytes up to a sector border:  FF_WritePartial()
- *	2. Write sectors up to cluster border: FF_BlockWrite()
- *	3. Write complete clusters:            FF_WriteClusters()
- *	4. Write remaining sectors:            FF_BlockWrite()
- *	5. Write remaining bytes:              FF_WritePartial()
- *	@return
-**/
-int32_t FF_Write( FF_FILE *pxFile, uint32_t ulElementSize, uint32_t ulCount, uint8_t *pucBuffer )
+ *	@return	The number of bytes written.
+ **/
+static uint32_t FF_WriteBytes( FF_FILE *pxFile, uint32_t ulBytesLeft, uint8_t *pucBuffer, FF_Error_t *pxError )
 {
-uint32_t ulBytesLeft = ulElementSize * ulCount;
 uint32_t nBytesWritten = 0;
 uint32_t nBytesToWrite;
-FF_IOManager_t *pxIOManager;
+FF_IOManager_t *pxIOManager = pxFile->pxIOManager;
 uint32_t ulRelBlockPos;
 uint32_t ulItemLBA;
-int32_t lResult;
 uint32_t ulSectors;
 uint32_t ulRelClusterPos;
 uint32_t ulBytesPerCluster;
-FF_Error_t xError;
+FF_Error_t xError = FF_ERR_NONE;
 
-	if( pxFile == NULL )
-	{
-		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_READ );
-	}
-	else
+	/* Open a do{} while( 0 ) loop to allow the use of breaks */
+	do
 	{
-		/* Check validity of the handle and the current position within the file. */
-		xError = FF_CheckValid( pxFile );
-		if( FF_isERR( xError ) == pdFALSE )
+		ulRelBlockPos = FF_getMinorBlockEntry( pxIOManager, pxFile->ulFilePointer, 1 );	/* Get the position within a block. */
+		ulItemLBA = FF_SetCluster( pxFile, &xError );
+		if( FF_isERR( xError ) )
 		{
-			if( ( pxFile->ucMode & FF_MODE_WRITE ) == 0 )
-			{
-				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_WRITE );
-			}
-			/* Make sure a write is after the append point. */
-			else if( ( pxFile->ucMode & FF_MODE_APPEND ) != 0 )
-			{
-				if( pxFile->ulFilePointer < pxFile->ulFileSize )
-				{
-					xError = FF_Seek( pxFile, 0, FF_SEEK_END );
-				}
-			}
+			break;
 		}
-	}
 
-	if( FF_isERR( xError ) == pdFALSE )
-	{
-		pxIOManager = pxFile->pxIOManager;
+		if( ( ulRelBlockPos + ulBytesLeft ) <= ( uint32_t ) pxIOManager->usSectorSize )
+		{
+			/* Bytes to write are within a block and and do not go passed the current block. */
+			nBytesWritten = FF_WritePartial( pxFile, ulItemLBA, ulRelBlockPos, ulBytesLeft, pucBuffer, &xError );
+			break;
+		}
 
-		/* Open a do{} while( 0 ) loop to allow the use of breaks */
-		do
+		/*---------- Write (memcpy) to a Sector Boundary. */
+		if( ulRelBlockPos != 0 )
 		{
-			/* Extend File for at least ulBytesLeft!
-			Handle file-space allocation
-			+ 1 byte because the code assumes there is always a next cluster */
-			xError = FF_ExtendFile( pxFile, pxFile->ulFilePointer + ulBytesLeft + 1 );
+			/* Not writing on a sector boundary, at this point the LBA is known. */
+			nBytesToWrite = pxIOManager->usSectorSize - ulRelBlockPos;
+			nBytesWritten = FF_WritePartial( pxFile, ulItemLBA, ulRelBlockPos, nBytesToWrite, pucBuffer, &xError );
 			if( FF_isERR( xError ) )
 			{
-				/* On every error, break from the while( 0 ) loop. */
 				break;
 			}
 
-			ulRelBlockPos = FF_getMinorBlockEntry( pxIOManager, pxFile->ulFilePointer, 1 );	/* Get the position within a block. */
+			ulBytesLeft -= nBytesWritten;
+			pucBuffer += nBytesWritten;
+		}
+
+		/*---------- Write sectors, up to a Cluster Boundary. */
+		ulBytesPerCluster = ( pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize );
+		ulRelClusterPos = FF_getClusterPosition( pxIOManager, pxFile->ulFilePointer, 1 );
+
+		if( ( ulRelClusterPos != 0 ) && ( ( ulRelClusterPos + ulBytesLeft ) >= ulBytesPerCluster ) )
+		{
+			/* Need to get to cluster boundary */
 			ulItemLBA = FF_SetCluster( pxFile, &xError );
 			if( FF_isERR( xError ) )
 			{
 				break;
 			}
 
-			if( ( ulRelBlockPos + ulBytesLeft ) <= ( uint32_t ) pxIOManager->usSectorSize )
+			ulSectors = pxIOManager->xPartition.ulSectorsPerCluster - ( ulRelClusterPos / pxIOManager->usSectorSize );
+			xError = FF_BlockWrite( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
+			if( FF_isERR( xError ) )
 			{
-				/* Bytes to write are within a block and and do not go passed the current block. */
-				nBytesWritten = FF_WritePartial( pxFile, ulItemLBA, ulRelBlockPos, ulBytesLeft, pucBuffer, &xError );
 				break;
 			}
 
-			/*---------- Write (memcpy) to a Sector Boundary. */
-			if( ulRelBlockPos != 0 )
+			nBytesToWrite = ulSectors * pxIOManager->usSectorSize;
+			ulBytesLeft -= nBytesToWrite;
+			pucBuffer += nBytesToWrite;
+			nBytesWritten += nBytesToWrite;
+			pxFile->ulFilePointer += nBytesToWrite;
+			if( pxFile->ulFilePointer > pxFile->ulFileSize )
 			{
-				/* Not writing on a sector boundary, at this point the LBA is known. */
-				nBytesToWrite = pxIOManager->usSectorSize - ulRelBlockPos;
-				nBytesWritten = FF_WritePartial( pxFile, ulItemLBA, ulRelBlockPos, nBytesToWrite, pucBuffer, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-
-				ulBytesLeft -= nBytesWritten;
-				pucBuffer += nBytesWritten;
+				pxFile->ulFileSize = pxFile->ulFilePointer;
 			}
+		}
 
-			/*---------- Write sectors, up to a Cluster Boundary. */
-			ulBytesPerCluster = ( pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize );
-			ulRelClusterPos = FF_getClusterPosition( pxIOManager, pxFile->ulFilePointer, 1 );
+		/*---------- Write entire Clusters. */
+		if( ulBytesLeft >= ulBytesPerCluster )
+		{
+		uint32_t ulClusters;
 
-			if( ( ulRelClusterPos != 0 ) && ( ( ulRelClusterPos + ulBytesLeft ) >= ulBytesPerCluster ) )
+			FF_SetCluster( pxFile, &xError );
+			if( FF_isERR( xError ) )
 			{
-				/* Need to get to cluster boundary */
-				ulItemLBA = FF_SetCluster( pxFile, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
+				break;
+			}
 
-				ulSectors = pxIOManager->xPartition.ulSectorsPerCluster - ( ulRelClusterPos / pxIOManager->usSectorSize );
-				xError = FF_BlockWrite( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
+			ulClusters = ( ulBytesLeft / ulBytesPerCluster );
 
-				nBytesToWrite = ulSectors * pxIOManager->usSectorSize;
-				ulBytesLeft -= nBytesToWrite;
-				pucBuffer += nBytesToWrite;
-				nBytesWritten += nBytesToWrite;
-				pxFile->ulFilePointer += nBytesToWrite;
-				if( pxFile->ulFilePointer > pxFile->ulFileSize )
-				{
-					pxFile->ulFileSize = pxFile->ulFilePointer;
-				}
+			xError = FF_WriteClusters( pxFile, ulClusters, pucBuffer );
+			if( FF_isERR( xError ) )
+			{
+				break;
 			}
 
-			/*---------- Write entire Clusters. */
-			if( ulBytesLeft >= ulBytesPerCluster )
+			nBytesToWrite = ulBytesPerCluster * ulClusters;
+			ulBytesLeft -= nBytesToWrite;
+			pucBuffer += nBytesToWrite;
+			nBytesWritten += nBytesToWrite;
+			pxFile->ulFilePointer += nBytesToWrite;
+			if( pxFile->ulFilePointer > pxFile->ulFileSize )
 			{
-			uint32_t ulClusters;
-
-				FF_SetCluster( pxFile, &xError );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-
-				ulClusters = ( ulBytesLeft / ulBytesPerCluster );
-
-				xError = FF_WriteClusters( pxFile, ulClusters, pucBuffer );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-
-				nBytesToWrite = ulBytesPerCluster * ulClusters;
-				ulBytesLeft -= nBytesToWrite;
-				pucBuffer += nBytesToWrite;
-				nBytesWritten += nBytesToWrite;
-				pxFile->ulFilePointer += nBytesToWrite;
-				if( pxFile->ulFilePointer > pxFile->ulFileSize )
-				{
-					pxFile->ulFileSize = pxFile->ulFilePointer;
-				}
+				pxFile->ulFileSize = pxFile->ulFilePointer;
 			}
+		}
 
-			/*---------- Write Remaining Blocks */
-			while( ulBytesLeft >= ( uint32_t ) pxIOManager->usSectorSize )
+		/*---------- Write Remaining Blocks */
+		while( ulBytesLeft >= ( uint32_t ) pxIOManager->usSectorSize )
+		{
+			ulSectors = ulBytesLeft / pxIOManager->usSectorSize;
 			{
-				ulSectors = ulBytesLeft / pxIOManager->usSectorSize;
-				{
-					/* HT: I'd leave these pPart/ulOffset for readability... */
-					FF_Partition_t	*pPart = &( pxIOManager->xPartition );
-					uint32_t ulOffset = ( pxFile->ulFilePointer / pxIOManager->usSectorSize ) % pPart->ulSectorsPerCluster;
-					uint32_t ulRemain = pPart->ulSectorsPerCluster - ulOffset;
-					if( ulSectors > ulRemain )
-					{
-						ulSectors = ulRemain;
-					}
-				}
-
-				ulItemLBA = FF_SetCluster( pxFile, &xError );
-				if( FF_isERR( xError ) )
+				/* HT: I'd leave these pPart/ulOffset for readability... */
+				FF_Partition_t	*pPart = &( pxIOManager->xPartition );
+				uint32_t ulOffset = ( pxFile->ulFilePointer / pxIOManager->usSectorSize ) % pPart->ulSectorsPerCluster;
+				uint32_t ulRemain = pPart->ulSectorsPerCluster - ulOffset;
+				if( ulSectors > ulRemain )
 				{
-					break;
-				}
-
-				xError = FF_BlockWrite( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
-				if( FF_isERR( xError ) )
-				{
-					break;
-				}
-
-				nBytesToWrite = ulSectors * pxIOManager->usSectorSize;
-				ulBytesLeft -= nBytesToWrite;
-				pucBuffer += nBytesToWrite;
-				nBytesWritten += nBytesToWrite;
-				pxFile->ulFilePointer += nBytesToWrite;
-				if( pxFile->ulFilePointer > pxFile->ulFileSize )
-				{
-					pxFile->ulFileSize = pxFile->ulFilePointer;
+					ulSectors = ulRemain;
 				}
 			}
 
-			/*---------- Write (memcpy) Remaining Bytes */
-			if( ulBytesLeft == 0 )
+			ulItemLBA = FF_SetCluster( pxFile, &xError );
+			if( FF_isERR( xError ) )
 			{
 				break;
 			}
 
-			ulItemLBA = FF_SetCluster( pxFile, &xError );
+			xError = FF_BlockWrite( pxIOManager, ulItemLBA, ulSectors, pucBuffer, pdFALSE );
 			if( FF_isERR( xError ) )
 			{
 				break;
 			}
-			FF_WritePartial( pxFile, ulItemLBA, 0, ulBytesLeft, pucBuffer, &xError );
-			nBytesWritten += ulBytesLeft;
+
+			nBytesToWrite = ulSectors * pxIOManager->usSectorSize;
+			ulBytesLeft -= nBytesToWrite;
+			pucBuffer += nBytesToWrite;
+			nBytesWritten += nBytesToWrite;
+			pxFile->ulFilePointer += nBytesToWrite;
+			if( pxFile->ulFilePointer > pxFile->ulFileSize )
+			{
+				pxFile->ulFileSize = pxFile->ulFilePointer;
+			}
 		}
-		while( pdFALSE );
-	}
 
-	if( FF_isERR( xError ) )
-	{
-		lResult = xError;
-	}
-	else
-	{
-		lResult = ( int32_t )( nBytesWritten / ulElementSize );
+		/*---------- Write (memcpy) Remaining Bytes */
+		if( ulBytesLeft == 0 )
+		{
+			break;
+		}
+
+		ulItemLBA = FF_SetCluster( pxFile, &xError );
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+		FF_WritePartial( pxFile, ulItemLBA, 0, ulBytesLeft, pucBuffer, &xError );
+		nBytesWritten += ulBytesLeft;
 	}
+	while( pdFALSE );
 
-	return lResult;
-}	/* FF_Write() */
+	*pxError = xError;
+
+	return nBytesWritten;
+}	/* FF_WriteBytes() */
 /*-----------------------------------------------------------*/
 
+#if( ffconfigLOG_FILE_SUPPORT != 0 )
+
 /**
-*	@public
-*	@brief	Writes a char to a FILE.
-*
-*	@param	pxFile		FILE Pointer.
-*	@param	ucValue	Char to be placed in the file.
-*
-*	@return	Returns the value written to the file, or a value less than 0.
-*
-**/
-int32_t FF_PutC( FF_FILE *pxFile, uint8_t ucValue )
+ *	@private
+ *	@brief	Appends to a file that was opened with FF_MODE_LOG.
+ *
+ *	The sector that holds the end of the file is kept in the handle and only
+ *	written when it is full, or by FF_LogFlush().  The chain is extended with
+ *	ffconfigLOG_RESERVE_CLUSTERS spare clusters at a time, which FF_Close()
+ *	releases again.  The directory entry is brought up to date once every
+ *	ffconfigLOG_SYNC_INTERVAL_MS.
+ *
+ *	The handle was checked by FF_PrepareWrite().  The buffers of the vector
+ *	are appended while the handle's mutex is held, so appends of other tasks
+ *	will not come between them.
+ *
+ *	@return	The number of bytes written.
+ **/
+static uint32_t FF_WriteLog( FF_FILE *pxFile, const FF_IOVec_t *pxVector, BaseType_t xCount, uint32_t ulTotal, FF_Error_t *pxError )
 {
-uint32_t ulItemLBA;
+FF_IOManager_t *pxIOManager = pxFile->pxIOManager;
+uint32_t ulSectorSize = ( uint32_t ) pxIOManager->usSectorSize;
+uint32_t ulBytesPerCluster = ulSectorSize * pxIOManager->xPartition.ulSectorsPerCluster;
+uint32_t ulBytesWritten = 0;
+uint32_t ulBytesLeft = 0;
 uint32_t ulRelBlockPos;
-FF_Error_t xResult;
+uint32_t ulItemLBA;
+uint32_t ulCount;
+uint8_t *pucBuffer = NULL;
+BaseType_t xIndex = 0;
+FF_Error_t xError = FF_ERR_NONE;
 
-	if( pxFile == NULL )
-	{	/* Ensure we don't have a Null file pointer on a Public interface. */
-		xResult = FF_ERR_NULL_POINTER | FF_PUTC;
+	FF_PendSemaphore( pxFile->pvLogMutex );
+
+	if( ( pxFile->ulValidFlags & FF_VALID_FLAG_INVALID ) != 0 )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_FILE_MEDIA_REMOVED | FF_WRITE );
 	}
-	else if( ( pxFile->ucMode & FF_MODE_WRITE ) == 0 )
+	/* The chain must reach one byte beyond the data, see FF_Write(). */
+	else if( ( pxFile->ulChainLength == 0ul ) ||
+		( ( ( pxFile->ulFileSize + ulTotal ) / ulBytesPerCluster ) >= pxFile->ulChainLength ) )
 	{
-		xResult = FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_PUTC;
+		xError = FF_ExtendFile( pxFile, pxFile->ulFileSize + ulTotal + ( ffconfigLOG_RESERVE_CLUSTERS * ulBytesPerCluster ) );
 	}
-	else
+
+	while( FF_isERR( xError ) == pdFALSE )
 	{
-		xResult = FF_ERR_NONE;
-		do
+		if( ulBytesLeft == 0ul )
 		{
-			/* Make sure a write is after the append point. */
-			if( ( pxFile->ucMode & FF_MODE_APPEND ) != 0 )
-			{
-				if( pxFile->ulFilePointer < pxFile->ulFileSize )
-				{
-					xResult = FF_Seek( pxFile, 0, FF_SEEK_END );
-					if( FF_isERR( xResult ) )
-					{
-						break;
-					}
-				}
-			}
-
-			ulRelBlockPos = FF_getMinorBlockEntry( pxFile->pxIOManager, pxFile->ulFilePointer, 1 );
-
-			/* Handle File Space Allocation. */
-			/* We'll write 1 byte and always have a next cluster reserved. */
-			xResult = FF_ExtendFile( pxFile, pxFile->ulFilePointer + 2 );
-			if( FF_isERR( xResult ) )
-			{
-				break;
-			}
-
-			ulItemLBA = FF_SetCluster( pxFile, &xResult );
-			if( FF_isERR( xResult ) )
+			/* On to the next buffer of the vector. */
+			if( xIndex == xCount )
 			{
 				break;
 			}
-			FF_WritePartial( pxFile, ulItemLBA, ulRelBlockPos, 1, &ucValue, &xResult );
-
-			if( FF_isERR( xResult ) == pdFALSE )
-			{
-				xResult = ( FF_Error_t ) ucValue;
-			}
-
-		} while( pdFALSE );
-	}
-
-	return xResult;
-}	/* FF_PutC() */
-/*-----------------------------------------------------------*/
-
-/**
-*	@public
-*	@brief	Equivalent to fseek()
-*
-*	@param	pxFile		FF_FILE object that was created by FF_Open().
-*	@param	ulOffset	An integer (+/-) to seek to, from the specified origin.
-*	@param	xOrigin		Where to seek from. (FF_SEEK_SET seek from start, FF_SEEK_CUR seek from current position, or FF_SEEK_END seek from end of file).
-*
-*	@return 0 on Sucess,
-*	@return -2 if offset results in an invalid position in the file.
-*	@return FF_ERR_NULL_POINTER if a FF_FILE pointer was not received.
-*	@return -3 if an invalid origin was provided.
-*
-**/
-FF_Error_t FF_Seek( FF_FILE *pxFile, int32_t lOffset, BaseType_t xOrigin )
-{
-FF_Error_t xError;
-uint32_t ulPosition = 0ul;
 
-	xError = FF_CheckValid( pxFile );
+			ulBytesLeft = pxVector[ xIndex ].ulLength;
+			pucBuffer = ( uint8_t * ) pxVector[ xIndex ].pvBuffer;
+			xIndex++;
+			continue;
+		}
 
-	if( FF_isERR( xError ) == pdFALSE )
-	{
-		xError = FF_FlushCache( pxFile->pxIOManager );
+		/* A log file is only written at its end. */
+		pxFile->ulFilePointer = pxFile->ulFileSize;
+		ulRelBlockPos = pxFile->ulFileSize % ulSectorSize;
 
-		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+		if( ( ulRelBlockPos == 0ul ) && ( ulBytesLeft >= ulSectorSize ) )
 		{
-			if( FF_isERR( xError ) == pdFALSE )
-			{
-				/* Here we must ensure that if the user tries to seek, and we had data in the file's
-				write buffer that this is written to disk. */
-				if( ( pxFile->ucState & FF_BUFSTATE_WRITTEN ) != 0 )
-				{
-					xError = FF_BlockWrite( pxFile->pxIOManager, FF_FileLBA( pxFile ), 1, pxFile->pucBuffer, pdFALSE );
-				}
-				pxFile->ucState = FF_BUFSTATE_INVALID;
-			}
+			/* Whole sectors do not pass through the handle. */
+			ulCount = FF_WriteBytes( pxFile, ulBytesLeft - ( ulBytesLeft % ulSectorSize ), pucBuffer, &xError );
 		}
-		#endif	/* ffconfigOPTIMISE_UNALIGNED_ACCESS */
-
-		if( FF_isERR( xError ) == pdFALSE )
+		else
 		{
-			if( xOrigin == FF_SEEK_SET )
-			{
-				ulPosition = ( uint32_t )lOffset;
-			}
-			else if( xOrigin == FF_SEEK_CUR )
+			ulCount = 0ul;
+			if( pxFile->ulLogSectorLBA == 0ul )
 			{
-				if( lOffset >= ( int32_t ) 0 )
-				{
-					ulPosition = pxFile->ulFilePointer + ( ( uint32_t ) lOffset );
-				}
-				else
+				ulItemLBA = FF_SetCluster( pxFile, &xError );
+				if( ( FF_isERR( xError ) == pdFALSE ) && ( ulRelBlockPos != 0ul ) )
 				{
-					ulPosition = pxFile->ulFilePointer - ( ( uint32_t ) ( -lOffset ) );
+					/* The handle was opened or truncated halfway a sector. */
+					xError = FF_BlockRead( pxIOManager, ulItemLBA, 1, pxFile->pucLogSector, pdFALSE );
 				}
-			}
-			else if( xOrigin == FF_SEEK_END )
-			{
-				/* 'FF_SEEK_END' only allows zero or negative values. */
-				if( lOffset <= ( int32_t ) 0 )
+
+				if( FF_isERR( xError ) == pdFALSE )
 				{
-					ulPosition = pxFile->ulFileSize - ( ( uint32_t ) ( -lOffset ) );
+					pxFile->ulLogSectorLBA = ulItemLBA;
 				}
 			}
-			else
-			{
-				xError = ( FF_Error_t ) ( FF_SEEK | FF_ERR_FILE_SEEK_INVALID_ORIGIN );
-				/* To supress a compiler warning. */
-				ulPosition = ( uint32_t ) 0u;
-			}
 
 			if( FF_isERR( xError ) == pdFALSE )
 			{
-				if( ulPosition <= ( uint32_t ) pxFile->ulFileSize )
+				ulCount = ulSectorSize - ulRelBlockPos;
+				if( ulCount > ulBytesLeft )
 				{
-					if( ulPosition != ( uint32_t ) pxFile->ulFilePointer )
-					{
-						pxFile->ulFilePointer = ulPosition;
-						FF_SetCluster( pxFile, &xError );
-					}
+					ulCount = ulBytesLeft;
 				}
-				else
+
+				memcpy( pxFile->pucLogSector + ulRelBlockPos, pucBuffer, ulCount );
+				pxFile->ulFileSize += ulCount;
+				pxFile->xLogDirty = pdTRUE;
+
+				if( ( ulRelBlockPos + ulCount ) == ulSectorSize )
 				{
-					xError = ( FF_Error_t ) ( FF_SEEK | FF_ERR_FILE_SEEK_INVALID_POSITION );
+					/* The sector is full, the next byte goes to a new one. */
+					xError = FF_LogFlush( pxFile );
+					pxFile->ulLogSectorLBA = 0ul;
 				}
 			}
 		}
+
+		ulBytesWritten += ulCount;
+		ulBytesLeft -= ulCount;
+		pucBuffer += ulCount;
 	}
 
-	return xError;
-}	/* FF_Seek() */
-/*-----------------------------------------------------------*/
+	pxFile->ulFilePointer = pxFile->ulFileSize;
 
-#if( ffconfigREMOVABLE_MEDIA != 0 )
-	/**
-	*	@public
-	*	@brief	Invalidate all file handles belonging to pxIOManager
-	*
-	*	@param	pIoMan		FF_IOManager_t object that was created by FF_CreateIOManger().
-	*
-	*	@return 0 if no handles were open
-	*	@return >0 the amount of handles that were invalidated
-	*	@return <0 probably an invalid FF_IOManager_t pointer
-	*
-	**/
-	int32_t FF_Invalidate( FF_IOManager_t *pxIOManager )
+	if( ulBytesWritten != 0ul )
 	{
-	int32_t xResult;
-	FF_FILE *pxFileChain;
-
-		if( pxIOManager == NULL )
+		#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
 		{
-			xResult = FF_ERR_NULL_POINTER | FF_INVALIDATE;
+			FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_SIZE | FF_DIRENT_DIRTY_MODIFIED );
 		}
-		else
+		#endif
+		#if( ffconfigLOG_SYNC_INTERVAL_MS != 0 )
 		{
-			xResult = 0;
-			FF_PendSemaphore( pxIOManager->pvSemaphore );
+			if( ( FF_isERR( xError ) == pdFALSE ) &&
+				( ( xTaskGetTickCount() - pxFile->xLogSyncTime ) >= pdMS_TO_TICKS( ffconfigLOG_SYNC_INTERVAL_MS ) ) )
 			{
-				pxIOManager->ucFlags |= FF_IOMAN_DEVICE_IS_EXTRACTED;
-				/* Semaphore is required, or linked list might change */
-				pxFileChain = ( FF_FILE * ) pxIOManager->FirstFile;
-				if( pxFileChain != NULL )
-				{
-					/* Count elements in FirstFile */
-					do
-					{
-						pxFileChain->ulValidFlags |= FF_VALID_FLAG_INVALID;
-						xResult++;
-						pxFileChain = pxFileChain->pxNext;
-					}
-					while( pxFileChain != NULL );
-				}
+				/* Let a reader of the directory see the data written so far. */
+				xError = FF_SyncFile( pxFile );
 			}
+		}
+		#endif
+	}
 
-			FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+	FF_ReleaseSemaphore( pxFile->pvLogMutex );
+
+	*pxError = xError;
+
+	return ulBytesWritten;
+}	/* FF_WriteLog() */
+/*-----------------------------------------------------------*/
+
+/* Write the last sector of a log file, if it was changed.  The sector stays
+in the handle. */
+static FF_Error_t FF_LogFlush( FF_FILE *pxFile )
+{
+FF_Error_t xError = FF_ERR_NONE;
+
+	if( pxFile->xLogDirty != pdFALSE )
+	{
+		xError = FF_BlockWrite( pxFile->pxIOManager, pxFile->ulLogSectorLBA, 1, pxFile->pucLogSector, pdFALSE );
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			pxFile->xLogDirty = pdFALSE;
 		}
+	}
 
-		return xResult;
-	}	/* FF_Invalidate() */
-#endif /* ffconfigREMOVABLE_MEDIA */
+	return xError;
+}	/* FF_LogFlush() */
+/*-----------------------------------------------------------*/
+
+static void FF_LogFree( FF_FILE *pxFile )
+{
+	FF_DeleteSemaphore( pxFile->pvLogMutex );
+	ffconfigFREE( pxFile->pucLogSector );
+}	/* FF_LogFree() */
 /*-----------------------------------------------------------*/
 
+#endif /* ffconfigLOG_FILE_SUPPORT */
+
 /**
-*	@public
-*	@brief	Check validity of file handle
-*
-*	@param	pxFile		FF_FILE object that was created by FF_Open().
-*
-*	@return 0 on sucess.
-*	@return FF_ERR_NULL_POINTER       if a null pointer was provided.
-*	@return FF_ERR_FILE_BAD_HANDLE    if handle is not recognized
-*	@return FF_ERR_FILE_MEDIA_REMOVED please call FF_Close
-*
-**/
-FF_Error_t FF_CheckValid( FF_FILE *pxFile )
+ *	@private
+ *	@brief	Writes the buffers of a vector, in order, at the current position of
+ *			a file.  This is the common part of FF_Write() and FF_WriteV().
+ *
+ *	The handle is checked and the file is extended once for all buffers.  A
+ *	sector that is divided over two buffers is written to the medium once,
+ *	whole sectors inside a buffer are written directly.
+ *
+ *	@return	The number of bytes written.
+ **/
+static uint32_t FF_WriteVector( FF_FILE *pxFile, const FF_IOVec_t *pxVector, BaseType_t xCount, FF_Error_t xFunction, FF_Error_t *pxError )
 {
-	FF_FILE		*pxFileChain;
-	FF_Error_t	xError;
+uint32_t nBytesWritten = 0;
+uint32_t ulTotal = 0;
+BaseType_t xIndex;
+FF_Error_t xError;
+
+	xError = FF_PrepareWrite( pxFile, xFunction );
 
-	if( ( pxFile == NULL ) || ( pxFile->pxIOManager == NULL ) )
+	for( xIndex = 0; ( xIndex < xCount ) && ( FF_isERR( xError ) == pdFALSE ); xIndex++ )
 	{
-		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_CHECKVALID );
+		/* The file must reach one byte beyond the data, and the number of
+		bytes written must be returned as a positive int32_t. */
+		if( pxVector[ xIndex ].ulLength > 0x7FFFFFFFul - ulTotal )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_EXTEND_FAILED | xFunction );
+		}
+		else
+		{
+			ulTotal += pxVector[ xIndex ].ulLength;
+		}
+	}
+
+	if( ( FF_isERR( xError ) == pdFALSE ) && ( pxFile->ulFilePointer > 0xFFFFFFFEul - ulTotal ) )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_FILE_EXTEND_FAILED | xFunction );
+	}
+
+	#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	if( ( FF_isERR( xError ) == pdFALSE ) && ( ( pxFile->ucMode & FF_MODE_LOG ) != 0 ) )
+	{
+		nBytesWritten = FF_WriteLog( pxFile, pxVector, xCount, ulTotal, &xError );
 	}
 	else
+	#endif
+	if( FF_isERR( xError ) == pdFALSE )
 	{
-		FF_PendSemaphore( pxFile->pxIOManager->pvSemaphore );
+		/* Extend File for at least ulTotal!
+		Handle file-space allocation
+		+ 1 byte because the code assumes there is always a next cluster */
+		xError = FF_ExtendFile( pxFile, pxFile->ulFilePointer + ulTotal + 1 );
+
+		for( xIndex = 0; ( xIndex < xCount ) && ( FF_isERR( xError ) == pdFALSE ); xIndex++ )
 		{
-			pxFileChain = ( FF_FILE * ) pxFile->pxIOManager->FirstFile;
-			xError = ( FF_Error_t ) ( FF_ERR_FILE_BAD_HANDLE | FF_CHECKVALID );
-			while( pxFileChain != NULL )
+			if( pxVector[ xIndex ].ulLength != 0ul )
 			{
-				if( pxFileChain == pxFile )
-				{
-				#if( ffconfigREMOVABLE_MEDIA != 0 )
-					if( ( pxFileChain->ulValidFlags & FF_VALID_FLAG_INVALID ) != 0 )
-					{
-						/* The medium has been removed while this file handle was open. */
-						xError = ( FF_Error_t ) ( FF_ERR_FILE_MEDIA_REMOVED | FF_CHECKVALID );
-					}
-					else
-				#endif
-					{
-						/* Found the handle, so it is a valid / existing handle. */
-						xError = FF_ERR_NONE;
-					}
-
-					break;
-				}
-
-				pxFileChain = pxFileChain->pxNext;
+				nBytesWritten += FF_WriteBytes( pxFile, pxVector[ xIndex ].ulLength, ( uint8_t * ) pxVector[ xIndex ].pvBuffer, &xError );
 			}
 		}
-		FF_ReleaseSemaphore( pxFile->pxIOManager->pvSemaphore );
+		xError = FF_FinishWrite( pxFile, nBytesWritten, xError );
 	}
 
-	return xError;
-}	/* FF_CheckValid() */
-/*-----------------------------------------------------------*/
+	*pxError = xError;
 
-#if( ffconfigTIME_SUPPORT != 0 )
-	/**
-	*	@public
-	*	@brief	Set the time-stamp(s) of a file entry
-	*
-	*	@param	pxFile		FF_FILE object that was created by FF_Open().
-	*	@param	pxTime      FF_SystemTime_t the time stamp
-	*	@param	uxWhat       UBaseType_t a combination of enum ETimeMask
-	*
-	*	@return 0 or FF_Error_t
-	*
-	**/
-	FF_Error_t FF_SetFileTime( FF_FILE *pxFile, FF_SystemTime_t *pxTime, UBaseType_t uxWhat )
-	{
-	FF_DirEnt_t	xOriginalEntry;
-	FF_Error_t	xError;
+	return nBytesWritten;
+}	/* FF_WriteVector() */
+/*-----------------------------------------------------------*/
 
-		xError = FF_CheckValid( pxFile );
-		if( FF_isERR( xError ) == pdFALSE )
-		{
-			if( pxFile->ulValidFlags & FF_VALID_FLAG_DELETED )
-			{	/*if (pxFile->FileDeleted) */
-				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETFILETIME );
-			}
-			else if( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) == 0 )
-			{
-				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_SETFILETIME );
-			}
+/**
+ *	@public
+ *	@brief	Writes data to a File.
+ *
+ *	@param	pxFile			FILE Pointer.
+ *	@param	ulElementSize		Size of an Element of Data to be copied. (in bytes).
+ *	@param	ulCount			Number of Elements of Data to be copied. (ulElementSize * ulCount must not exceed ((2^31)-1) bytes. (2GB). For best performance, multiples of 512 bytes or Cluster sizes are best.
+ *	@param	pucBuffer			Byte-wise pucBuffer containing the data to be written.
+ *
+ * FF_Read() and FF_Write() work very similar. They both complete their task in 5 steps:
+ *	1. Write bytes up to a sector border:  FF_WritePartial()
+ *	2. Write sectors up to cluster border: FF_BlockWrite()
+ *	3. Write complete clusters:            FF_WriteClusters()
+ *	4. Write remaining sectors:            FF_BlockWrite()
+ *	5. Write remaining bytes:              FF_WritePartial()
+ *	@return
+**/
+int32_t FF_Write( FF_FILE *pxFile, uint32_t ulElementSize, uint32_t ulCount, uint8_t *pucBuffer )
+{
+FF_IOVec_t xVector;
+uint32_t nBytesWritten = 0;
+int32_t lResult;
+FF_Error_t xError;
+
+	if( pxFile == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_READ );
+	}
+	else
+	{
+		xVector.pvBuffer = pucBuffer;
+		xVector.ulLength = ulElementSize * ulCount;
+		nBytesWritten = FF_WriteVector( pxFile, &xVector, 1, FF_WRITE, &xError );
+	}
+
+	if( FF_isERR( xError ) )
+	{
+		lResult = xError;
+	}
+	else
+	{
+		lResult = ( int32_t )( nBytesWritten / ulElementSize );
+	}
+
+	return lResult;
+}	/* FF_Write() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@public
+ *	@brief	Equivalent to readv(): reads into a number of buffers, in order.
+ *
+ *	@param	pxFile		FF_FILE object that was created by FF_Open().
+ *	@param	pxVector	The buffers to be filled.
+ *	@param	xCount		The number of buffers.
+ *
+ *	@return The total number of bytes read, or a negative error code.
+ *
+ *	The handle is checked once.  A sector that is divided over two buffers is
+ *	read from the medium once, whole sectors inside a buffer are read directly.
+ **/
+int32_t FF_ReadV( FF_FILE *pxFile, const FF_IOVec_t *pxVector, BaseType_t xCount )
+{
+uint32_t ulBytesRead = 0;
+uint32_t ulLength;
+BaseType_t xIndex;
+int32_t lResult;
+FF_Error_t xError;
+
+	if( ( pxFile == NULL ) || ( ( pxVector == NULL ) && ( xCount != 0 ) ) )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_READV );
+	}
+	else
+	{
+		xError = FF_CheckValid( pxFile );
+		if( ( FF_isERR( xError ) == pdFALSE ) && ( ( pxFile->ucMode & FF_MODE_READ ) == 0 ) )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_READ_MODE | FF_READV );
+		}
+	}
+
+	for( xIndex = 0; ( xIndex < xCount ) && ( FF_isERR( xError ) == pdFALSE ); xIndex++ )
+	{
+		if( pxFile->ulFilePointer >= pxFile->ulFileSize )
+		{
+			break;
+		}
+
+		ulLength = pxVector[ xIndex ].ulLength;
+		if( ulLength > pxFile->ulFileSize - pxFile->ulFilePointer )
+		{
+			ulLength = pxFile->ulFileSize - pxFile->ulFilePointer;
+		}
+
+		if( ulLength != 0ul )
+		{
+			ulBytesRead += FF_ReadBytes( pxFile, ulLength, ( uint8_t * ) pxVector[ xIndex ].pvBuffer, &xError );
+		}
+	}
+
+	if( FF_isERR( xError ) )
+	{
+		lResult = xError;
+	}
+	else
+	{
+		lResult = ( int32_t ) ulBytesRead;
+	}
+
+	return lResult;
+}	/* FF_ReadV() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@public
+ *	@brief	Equivalent to writev(): writes a number of buffers, in order.
+ *
+ *	@param	pxFile		FF_FILE object that was created by FF_Open().
+ *	@param	pxVector	The buffers to be written.
+ *	@param	xCount		The number of buffers.
+ *
+ *	@return The total number of bytes written, or a negative error code.
+ *
+ *	The buffers are written as one, see FF_WriteVector().  Their total length
+ *	may not exceed 2 GB.
+ **/
+int32_t FF_WriteV( FF_FILE *pxFile, const FF_IOVec_t *pxVector, BaseType_t xCount )
+{
+uint32_t nBytesWritten = 0;
+int32_t lResult;
+FF_Error_t xError;
+
+	if( ( pxFile == NULL ) || ( ( pxVector == NULL ) && ( xCount != 0 ) ) )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_WRITEV );
+	}
+	else
+	{
+		nBytesWritten = FF_WriteVector( pxFile, pxVector, xCount, FF_WRITEV, &xError );
+	}
+
+	if( FF_isERR( xError ) )
+	{
+		lResult = xError;
+	}
+	else
+	{
+		lResult = ( int32_t ) nBytesWritten;
+	}
+
+	return lResult;
+}	/* FF_WriteV() */
+/*-----------------------------------------------------------*/
+
+/**
+*	@public
+*	@brief	Writes a char to a FILE.
+*
+*	@param	pxFile		FILE Pointer.
+*	@param	ucValue	Char to be placed in the file.
+*
+*	@return	Returns the value written to the file, or a value less than 0.
+*
+**/
+int32_t FF_PutC( FF_FILE *pxFile, uint8_t ucValue )
+{
+uint32_t ulItemLBA;
+uint32_t ulRelBlockPos;
+FF_Error_t xResult;
+
+	/* A handle that was closed may have been freed, it is not read before it
+	has been checked. */
+	xResult = FF_CheckValid( pxFile );
+
+	if( pxFile == NULL )
+	{	/* Ensure we don't have a Null file pointer on a Public interface. */
+		xResult = FF_ERR_NULL_POINTER | FF_PUTC;
+	}
+	else if( FF_isERR( xResult ) != pdFALSE )
+	{
+		/* FF_ERR_FILE_BAD_HANDLE or FF_ERR_FILE_MEDIA_REMOVED. */
+	}
+	else if( ( pxFile->ucMode & FF_MODE_WRITE ) == 0 )
+	{
+		xResult = FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_PUTC;
+	}
+#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	else if( ( pxFile->ucMode & FF_MODE_LOG ) != 0 )
+	{
+	FF_IOVec_t xVector;
+
+		xVector.pvBuffer = &ucValue;
+		xVector.ulLength = 1ul;
+		xResult = FF_ERR_NONE;
+		FF_WriteLog( pxFile, &xVector, 1, 1ul, &xResult );
+		if( FF_isERR( xResult ) == pdFALSE )
+		{
+			xResult = ( FF_Error_t ) ucValue;
+		}
+	}
+#endif
+	else
+	{
+		xResult = FF_ERR_NONE;
+		do
+		{
+			/* Make sure a write is after the append point. */
+			if( ( pxFile->ucMode & FF_MODE_APPEND ) != 0 )
+			{
+				if( pxFile->ulFilePointer < pxFile->ulFileSize )
+				{
+					xResult = FF_Seek( pxFile, 0, FF_SEEK_END );
+					if( FF_isERR( xResult ) )
+					{
+						break;
+					}
+				}
+			}
+
+			ulRelBlockPos = FF_getMinorBlockEntry( pxFile->pxIOManager, pxFile->ulFilePointer, 1 );
+
+			/* Handle File Space Allocation. */
+			/* We'll write 1 byte and always have a next cluster reserved. */
+			xResult = FF_ExtendFile( pxFile, pxFile->ulFilePointer + 2 );
+			if( FF_isERR( xResult ) )
+			{
+				break;
+			}
+
+			ulItemLBA = FF_SetCluster( pxFile, &xResult );
+			if( FF_isERR( xResult ) )
+			{
+				break;
+			}
+			FF_WritePartial( pxFile, ulItemLBA, ulRelBlockPos, 1, &ucValue, &xResult );
+
+			if( FF_isERR( xResult ) == pdFALSE )
+			{
+				#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+				{
+					FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_SIZE | FF_DIRENT_DIRTY_MODIFIED );
+				}
+				#endif
+				xResult = ( FF_Error_t ) ucValue;
+			}
+
+		} while( pdFALSE );
+	}
+
+	return xResult;
+}	/* FF_PutC() */
+/*-----------------------------------------------------------*/
+
+/**
+*	@public
+*	@brief	Equivalent to fseek()
+*
+*	@param	pxFile		FF_FILE object that was created by FF_Open().
+*	@param	ulOffset	An integer (+/-) to seek to, from the specified origin.
+*	@param	xOrigin		Where to seek from. (FF_SEEK_SET seek from start, FF_SEEK_CUR seek from current position, or FF_SEEK_END seek from end of file).
+*
+*	@return 0 on Sucess,
+*	@return -2 if offset results in an invalid position in the file.
+*	@return FF_ERR_NULL_POINTER if a FF_FILE pointer was not received.
+*	@return -3 if an invalid origin was provided.
+*
+**/
+FF_Error_t FF_Seek( FF_FILE *pxFile, int32_t lOffset, BaseType_t xOrigin )
+{
+FF_Error_t xError;
+uint32_t ulPosition = 0ul;
+
+	xError = FF_CheckValid( pxFile );
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		xError = FF_FlushCache( pxFile->pxIOManager );
+
+		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+		{
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				/* Here we must ensure that if the user tries to seek, and we had data in the file's
+				write buffer that this is written to disk. */
+				if( ( pxFile->ucState & FF_BUFSTATE_WRITTEN ) != 0 )
+				{
+					xError = FF_BlockWrite( pxFile->pxIOManager, FF_FileLBA( pxFile ), 1, pxFile->pucBuffer, pdFALSE );
+				}
+				pxFile->ucState = FF_BUFSTATE_INVALID;
+			}
+		}
+		#endif	/* ffconfigOPTIMISE_UNALIGNED_ACCESS */
+
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			if( xOrigin == FF_SEEK_SET )
+			{
+				ulPosition = ( uint32_t )lOffset;
+			}
+			else if( xOrigin == FF_SEEK_CUR )
+			{
+				if( lOffset >= ( int32_t ) 0 )
+				{
+					ulPosition = pxFile->ulFilePointer + ( ( uint32_t ) lOffset );
+				}
+				else
+				{
+					ulPosition = pxFile->ulFilePointer - ( ( uint32_t ) ( -lOffset ) );
+				}
+			}
+			else if( xOrigin == FF_SEEK_END )
+			{
+				/* 'FF_SEEK_END' only allows zero or negative values. */
+				if( lOffset <= ( int32_t ) 0 )
+				{
+					ulPosition = pxFile->ulFileSize - ( ( uint32_t ) ( -lOffset ) );
+				}
+			}
+			else
+			{
+				xError = ( FF_Error_t ) ( FF_SEEK | FF_ERR_FILE_SEEK_INVALID_ORIGIN );
+				/* To supress a compiler warning. */
+				ulPosition = ( uint32_t ) 0u;
+			}
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				if( ulPosition <= ( uint32_t ) pxFile->ulFileSize )
+				{
+					if( ulPosition != ( uint32_t ) pxFile->ulFilePointer )
+					{
+						pxFile->ulFilePointer = ulPosition;
+						FF_SetCluster( pxFile, &xError );
+					}
+				}
+				else
+				{
+					xError = ( FF_Error_t ) ( FF_SEEK | FF_ERR_FILE_SEEK_INVALID_POSITION );
+				}
+			}
+		}
+	}
+
+	return xError;
+}	/* FF_Seek() */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigREMOVABLE_MEDIA != 0 )
+	/**
+	*	@public
+	*	@brief	Invalidate all file handles belonging to pxIOManager
+	*
+	*	@param	pIoMan		FF_IOManager_t object that was created by FF_CreateIOManger().
+	*
+	*	@return 0 if no handles were open
+	*	@return >0 the amount of handles that were invalidated
+	*	@return <0 probably an invalid FF_IOManager_t pointer
+	*
+	**/
+	int32_t FF_Invalidate( FF_IOManager_t *pxIOManager )
+	{
+	int32_t xResult;
+	FF_FILE *pxFileChain;
+
+		if( pxIOManager == NULL )
+		{
+			xResult = FF_ERR_NULL_POINTER | FF_INVALIDATE;
+		}
+		else
+		{
+			xResult = 0;
+			FF_PendSemaphore( pxIOManager->pvSemaphore );
+			{
+				pxIOManager->ucFlags |= FF_IOMAN_DEVICE_IS_EXTRACTED;
+				/* Semaphore is required, or the table of open files might change. */
+				for( pxFileChain = FF_NextOpenFile( pxIOManager, NULL ); pxFileChain != NULL; pxFileChain = FF_NextOpenFile( pxIOManager, pxFileChain ) )
+				{
+					pxFileChain->ulValidFlags |= FF_VALID_FLAG_INVALID;
+					xResult++;
+				}
+			}
+
+			FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+		}
+
+		return xResult;
+	}	/* FF_Invalidate() */
+#endif /* ffconfigREMOVABLE_MEDIA */
+/*-----------------------------------------------------------*/
+
+/**
+*	@public
+*	@brief	Check validity of file handle
+*
+*	@param	pxFile		FF_FILE object that was created by FF_Open().
+*
+*	@return 0 on sucess.
+*	@return FF_ERR_NULL_POINTER       if a null pointer was provided.
+*	@return FF_ERR_FILE_BAD_HANDLE    if handle is not recognized
+*	@return FF_ERR_FILE_MEDIA_REMOVED please call FF_Close
+*
+**/
+FF_Error_t FF_CheckValid( FF_FILE *pxFile )
+{
+	FF_FILE		*pxHandle;
+	FF_Error_t	xError;
+
+	if( pxFile == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_CHECKVALID );
+	}
+	else
+	{
+		/* A handle that was closed may have been freed, so it is looked up
+		by its address before it is read.  The index only holds handles
+		that are in the table of open files of their I/O manager. */
+		taskENTER_CRITICAL();
+		{
+			for( pxHandle = pxOpenHandles[ prvHandleBucket( pxFile ) ]; pxHandle != NULL; pxHandle = pxHandle->pxNextHandle )
+			{
+				if( pxHandle == pxFile )
+				{
+					break;
+				}
+			}
+
+			if( pxHandle == NULL )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_BAD_HANDLE | FF_CHECKVALID );
+			}
+			else if( pxFile->pxIOManager == NULL )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_CHECKVALID );
+			}
+			/* A remount changes the expected tag. */
+			else if( pxFile->ulHandleTag != FF_FILE_HANDLE_TAG( pxFile->pxIOManager ) )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_BAD_HANDLE | FF_CHECKVALID );
+			}
+		#if( ffconfigREMOVABLE_MEDIA != 0 )
+			else if( ( pxFile->ulValidFlags & FF_VALID_FLAG_INVALID ) != 0 )
+			{
+				/* The medium has been removed while this file handle was open. */
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_MEDIA_REMOVED | FF_CHECKVALID );
+			}
+		#endif
+			else
+			{
+				/* Found the handle, so it is a valid / existing handle. */
+				xError = FF_ERR_NONE;
+				#if( ffconfigSTDIO_BUFFERS != 0 )
+				{
+					pxFFLastValidFile = pxFile;
+				}
+				#endif
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return xError;
+}	/* FF_CheckValid() */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigTIME_SUPPORT != 0 )
+	/**
+	*	@public
+	*	@brief	Set the time-stamp(s) of a file entry
+	*
+	*	@param	pxFile		FF_FILE object that was created by FF_Open().
+	*	@param	pxTime      FF_SystemTime_t the time stamp
+	*	@param	uxWhat       UBaseType_t a combination of enum ETimeMask
+	*
+	*	@return 0 or FF_Error_t
+	*
+	**/
+	FF_Error_t FF_SetFileTime( FF_FILE *pxFile, FF_SystemTime_t *pxTime, UBaseType_t uxWhat )
+	{
+	FF_DirEnt_t	xOriginalEntry;
+	FF_Error_t	xError;
+
+		xError = FF_CheckValid( pxFile );
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			if( pxFile->ulValidFlags & FF_VALID_FLAG_DELETED )
+			{	/*if (pxFile->FileDeleted) */
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETFILETIME );
+			}
+			else if( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) == 0 )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_SETFILETIME );
+			}
+			else
+			{
+				/* Update the Dirent! */
+				xError = FF_GetEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
+				if( FF_isERR( xError ) == pdFALSE )
+				{
+					if( uxWhat & ETimeCreate )
+					{
+						xOriginalEntry.xCreateTime = *pxTime;		/*/< Date and Time Created. */
+					}
+
+					if( uxWhat & ETimeMod )
+					{
+						xOriginalEntry.xModifiedTime = *pxTime;	/*/< Date and Time Modified. */
+						#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+						{
+							/* Don't overwrite the given time at close. */
+							pxFile->ucDirentDirty &= ~FF_DIRENT_DIRTY_MODIFIED;
+						}
+						#endif
+					}
+
+					if( uxWhat & ETimeAccess )
+					{
+						xOriginalEntry.xAccessedTime = *pxTime;	/*/< Date of Last Access. */
+					}
+
+					xError = FF_PutEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
+				}
+
+				if( FF_isERR( xError ) == pdFALSE )
+				{
+					xError = FF_FlushCache( pxFile->pxIOManager );		/* Ensure all modfied blocks are flushed to disk! */
+				}
+			}
+		}
+
+		return xError;
+	}	/* FF_SetFileTime() */
+#endif /* ffconfigTIME_SUPPORT */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigTIME_SUPPORT != 0 )
+	/**
+	*	@public
+	*	@brief	Set the time-stamp(s) of a file entry (by name)
+	*
+	*	@param	pxIOManager		FF_IOManager_t device handle
+	*	@param	pcPath		int8_t/FF_T_WCHAR name of the file
+	*	@param	pxTime       FF_SystemTime_t the time stamp
+	*	@param	uxWhat       UBaseType_t a combination of enum ETimeMask
+	*
+	*	@return 0 or FF_Error_t
+	*
+	**/
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	FF_Error_t FF_SetTime ( FF_IOManager_t * pxIOManager, const FF_T_WCHAR * pcPath, FF_SystemTime_t *pxTime, UBaseType_t uxWhat )
+	#else
+	FF_Error_t FF_SetTime ( FF_IOManager_t * pxIOManager, const char *pcPath, FF_SystemTime_t *pxTime, UBaseType_t uxWhat )
+	#endif	/* ffconfigUNICODE_UTF16_SUPPORT */
+	{
+	FF_DirEnt_t xOriginalEntry;
+	FF_Error_t xError;
+	uint32_t ulFileCluster;
+	BaseType_t xIndex;
+	FF_FindParams_t xFindParams;
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+		FF_T_WCHAR pcFileName[ffconfigMAX_FILENAME];
+	#else
+		char pcFileName[ffconfigMAX_FILENAME];
+	#endif	/* ffconfigUNICODE_UTF16_SUPPORT */
+
+		xIndex = ( BaseType_t ) STRLEN( pcPath );
+
+		memset( &xFindParams, '\0', sizeof( xFindParams ) );
+
+		while( xIndex != 0 )
+		{
+			if( pcPath[ xIndex ] == '\\' || pcPath[ xIndex ] == '/' )
+			{
+				break;
+			}
+
+			xIndex--;
+		}
+
+		STRNCPY( pcFileName, ( pcPath + xIndex + 1 ), ffconfigMAX_FILENAME );
+
+		if( xIndex == 0 )
+		{
+			xIndex = 1;
+		}
+
+		xFindParams.ulDirCluster = FF_FindDir( pxIOManager, pcPath, ( uint16_t ) xIndex, &xError );
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			if( xFindParams.ulDirCluster == 0 )
+			{
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
+			}
 			else
 			{
-				/* Update the Dirent! */
-				xError = FF_GetEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
-				if( FF_isERR( xError ) == pdFALSE )
+				ulFileCluster = FF_FindEntryInDir( pxIOManager, &xFindParams, pcFileName, 0, &xOriginalEntry, &xError );
+				if( ( FF_isERR( xError ) == pdFALSE ) || ( FF_GETERROR( xError ) == FF_ERR_DIR_END_OF_DIR ) )
+				{
+					if( ulFileCluster == 0ul )
+					{
+						/*FF_PRINTF ("FF_SetTime: Can not find '%s'\n", pcFileName); */
+						xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
+					}
+				}
+			}
+		}
+
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			/* Update the Dirent! */
+			if( uxWhat & ETimeCreate )
+			{
+				xOriginalEntry.xCreateTime = *pxTime;			/*/< Date and Time Created. */
+			}
+
+			if( uxWhat & ETimeMod )
+			{
+				xOriginalEntry.xModifiedTime = *pxTime;		/*/< Date and Time Modified. */
+			}
+
+			if( uxWhat & ETimeAccess )
+			{
+				xOriginalEntry.xAccessedTime = *pxTime;		/*/< Date of Last Access. */
+			}
+
+			xError = FF_PutEntry( pxIOManager, xOriginalEntry.usCurrentItem - 1, xFindParams.ulDirCluster, &xOriginalEntry, NULL );
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				xError = FF_FlushCache( pxIOManager );			/* Ensure all modified blocks are flushed to disk! */
+			}
+		}
+
+		return xError;
+	}	/* FF_SetTime() */
+#endif /* ffconfigTIME_SUPPORT */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+FF_Error_t FF_SetPerm( FF_IOManager_t * pxIOManager, const FF_T_WCHAR * pcPath, UBaseType_t aPerm )
+#else
+FF_Error_t FF_SetPerm( FF_IOManager_t * pxIOManager, const char *pcPath, UBaseType_t aPerm )
+#endif
+{
+FF_DirEnt_t xOriginalEntry;
+FF_Error_t xError;
+uint32_t ulFileCluster;
+BaseType_t xIndex;
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	FF_T_WCHAR pcFileName[ffconfigMAX_FILENAME];
+#else
+	char pcFileName[ffconfigMAX_FILENAME];
+#endif
+FF_FindParams_t xFindParams;
+
+	xIndex = ( BaseType_t ) STRLEN( pcPath );
+
+	memset( &xFindParams, '\0', sizeof( xFindParams ) );
+
+	while( xIndex != 0 )
+	{
+		if( pcPath[ xIndex ] == '\\' || pcPath[ xIndex ] == '/' )
+		{
+			break;
+		}
+
+		xIndex--;
+	}
+
+	STRNCPY( pcFileName, ( pcPath + xIndex + 1 ), ffconfigMAX_FILENAME );
+
+	if( xIndex == 0 )
+	{
+		xIndex = 1;
+	}
+
+	/* Open a do {} while( pdFALSE ) loop to allow the use of break statements. */
+	do
+	{
+		xFindParams.ulDirCluster = FF_FindDir( pxIOManager, pcPath, ( uint16_t ) xIndex, &xError );
+		if( xError )
+		{
+			break;
+		}
+
+		if( !xFindParams.ulDirCluster )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
+			break;
+		}
+
+		ulFileCluster = FF_FindEntryInDir( pxIOManager, &xFindParams, pcFileName, 0, &xOriginalEntry, &xError );
+		if( FF_isERR( xError ) )
+		{
+			break;
+		}
+
+		if( ulFileCluster == 0ul )
+		{
+			/*FF_PRINTF ("FF_SetTime: Can not find '%s'\n", pcFileName); */
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
+			break;
+		}
+
+		/*	#define FF_FAT_ATTR_READONLY		0x01 */
+		/*	#define FF_FAT_ATTR_HIDDEN			0x02 */
+		/*	#define FF_FAT_ATTR_SYSTEM			0x04 */
+		/*	#define FF_FAT_ATTR_VOLID			0x08 */
+		/*	#define FF_FAT_ATTR_DIR				0x10 */
+		/*	#define FF_FAT_ATTR_ARCHIVE			0x20 */
+		/*	#define FF_FAT_ATTR_LFN				0x0F */
+	#define FF_FAT_ATTR_USER	( ( uint8_t ) FF_FAT_ATTR_READONLY | FF_FAT_ATTR_HIDDEN | FF_FAT_ATTR_SYSTEM | FF_FAT_ATTR_ARCHIVE )
+		/* Update the Dirent! */
+		xOriginalEntry.ucAttrib &= ~FF_FAT_ATTR_USER;
+		xOriginalEntry.ucAttrib |= ( aPerm & FF_FAT_ATTR_USER );
+		xError = FF_PutEntry( pxIOManager, xOriginalEntry.usCurrentItem - 1, xFindParams.ulDirCluster, &xOriginalEntry, NULL );
+
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			xError = FF_FlushCache( pxIOManager );			/* Ensure all modfied blocks are flushed to disk! */
+		}
+	}
+	while( pdFALSE );
+
+	return xError;
+}	/* FF_SetPerm() */
+/*-----------------------------------------------------------*/
+
+/**
+*	@public
+*	@brief	Equivalent to fclose()
+*
+*	@param	pxFile		FF_FILE object that was created by FF_Open().
+*
+*	@return 0 on sucess.
+*	@return -1 if a null pointer was provided.
+*
+**/
+FF_Error_t FF_Close( FF_FILE *pxFile )
+{
+FF_Error_t xError;
+
+	/* Opening a do {} while( 0 )  loop to allow the use of the break statement. */
+	do
+	{
+		if( pxFile == NULL )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_CLOSE );
+			break;
+		}
+
+		/* It is important to check that user doesn't supply invalid
+		handle or a handle invalid because of "media removed" */
+		xError = FF_CheckValid( pxFile );
+
+		#if( ffconfigREMOVABLE_MEDIA != 0 )
+		{
+			if( FF_GETERROR( xError ) == FF_ERR_FILE_MEDIA_REMOVED )
+			{
+				prvRemoveOpenFile( pxFile );
+				#if( ffconfigZERO_COPY_READ != 0 )
 				{
-					if( uxWhat & ETimeCreate )
+					FF_ReadRelease( pxFile );
+				}
+				#endif
+				#if( ffconfigLOG_FILE_SUPPORT != 0 )
+				{
+					FF_LogFree( pxFile );
+				}
+				#endif	/* ffconfigLOG_FILE_SUPPORT */
+				#if( ffconfigSTDIO_BUFFERS != 0 )
+				{
+					if( ( pxFile->ucStdioFlags & FF_STDIO_ALLOCATED ) != 0 )
 					{
-						xOriginalEntry.xCreateTime = *pxTime;		/*/< Date and Time Created. */
+						ffconfigFREE( pxFile->pucStdioBuffer );
 					}
+					pxFile->pucStdioBuffer = NULL;
+					pxFile->ucStdioFlags = 0u;
+				}
+				#endif	/* ffconfigSTDIO_BUFFERS */
+				prvFreeFileHandle( pxFile->pxIOManager, pxFile );	/* So at least we have freed the pointer. */
+				xError = FF_ERR_NONE;
+				break;
+			}
+		}
+		#endif	/* ffconfigREMOVABLE_MEDIA */
 
-					if( uxWhat & ETimeMod )
-					{
-						xOriginalEntry.xModifiedTime = *pxTime;	/*/< Date and Time Modified. */
-					}
+		if( FF_isERR( xError ) )
+		{
+			/* FF_ERR_FILE_BAD_HANDLE or FF_ERR_NULL_POINTER */
+			break;
+		}
 
-					if( uxWhat & ETimeAccess )
-					{
-						xOriginalEntry.xAccessedTime = *pxTime;	/*/< Date of Last Access. */
-					}
+		/* So here we have a normal valid file handle. */
 
-					xError = FF_PutEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
-				}
+		#if( ffconfigZERO_COPY_READ != 0 )
+		{
+			/* A buffer that is still lent out returns to the cache. */
+			FF_ReadRelease( pxFile );
+		}
+		#endif
 
-				if( FF_isERR( xError ) == pdFALSE )
+		/* Sometimes FreeRTOS+FAT will leave a trailing cluster on the end of a cluster chain.
+		To ensure we're compliant we shall now check for this condition and truncate it. */
+		if( ( ( pxFile->ulValidFlags & FF_VALID_FLAG_DELETED ) == 0 ) &&
+			( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND | FF_MODE_CREATE ) ) != 0 ) )
+		{
+		uint32_t ulClusterSize;
+
+			/* File is not deleted and it was opened for writing or updating */
+			ulClusterSize = pxFile->pxIOManager->xPartition.usBlkSize * pxFile->pxIOManager->xPartition.ulSectorsPerCluster;
+
+			#if( ffconfigLOG_FILE_SUPPORT != 0 )
+			{
+				/* Write the end of a log file. */
+				xError = FF_LogFlush( pxFile );
+			}
+			#endif
+
+			if( FF_isERR( xError ) )
+			{
+				/* The directory entry will not be updated. */
+			}
+			else if( ( ( pxFile->ulFileSize % ulClusterSize ) == 0 ) && ( pxFile->ulObjectCluster != 0ul ) )
+			{
+				/* The file's length is a multiple of cluster size.  This means
+				that an extra cluster has been reserved, which wasn't necessary. */
+				xError = FF_Truncate( pxFile, pdTRUE );
+			}
+			#if( ffconfigLOG_FILE_SUPPORT != 0 )
+			else if( ( ( pxFile->ucMode & FF_MODE_LOG ) != 0 ) && ( pxFile->ulObjectCluster != 0ul ) )
+			{
+				/* Release the clusters that FF_WriteLog() reserved ahead. */
+				xError = FF_Truncate( pxFile, pdFALSE );
+			}
+			#endif
+
+			/* Get the directory entry and update it to show the new file size */
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				xError = FF_FlushDirent( pxFile );
+			}
+		}
+
+		/* Handle Linked list! */
+		prvRemoveOpenFile( pxFile );
+
+		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+		{
+			if( pxFile->pucBuffer != NULL )
+			{
+				/* Ensure any unaligned points are pushed to the disk! */
+				if( pxFile->ucState & FF_BUFSTATE_WRITTEN )
 				{
-					xError = FF_FlushCache( pxFile->pxIOManager );		/* Ensure all modfied blocks are flushed to disk! */
+				FF_Error_t xTempError;
+
+					xTempError = FF_BlockWrite( pxFile->pxIOManager, FF_FileLBA( pxFile ), 1, pxFile->pucBuffer, pdFALSE );
+					if( FF_isERR( xError ) == pdFALSE )
+					{
+						xError = xTempError;
+					}
 				}
 			}
 		}
+		#endif
+		#if( ffconfigLOG_FILE_SUPPORT != 0 )
+		{
+			FF_LogFree( pxFile );
+		}
+		#endif
+		#if( ffconfigSTDIO_BUFFERS != 0 )
+		{
+			/* Data still in the stream buffer is lost, ff_fclose() writes it
+			out before calling this function. */
+			if( ( pxFile->ucStdioFlags & FF_STDIO_ALLOCATED ) != 0 )
+			{
+				ffconfigFREE( pxFile->pucStdioBuffer );
+			}
 
-		return xError;
-	}	/* FF_SetFileTime() */
-#endif /* ffconfigTIME_SUPPORT */
+			/* A handle of the pool stays readable after the close: it must not
+			look buffered to ff_fgetc() and ff_fputc(). */
+			pxFile->pucStdioBuffer = NULL;
+			pxFile->ucStdioFlags = 0u;
+			pxFile->ulStdioIndex = 0u;
+			pxFile->ulStdioCount = 0u;
+		}
+		#endif
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			xError = FF_FlushCache( pxFile->pxIOManager ); /* Ensure all modified blocks are flushed to disk! */
+		}
+		prvFreeFileHandle( pxFile->pxIOManager, pxFile );
+	}
+	while( pdFALSE );
+
+	return xError;
+}	/* FF_Close() */
 /*-----------------------------------------------------------*/
 
-#if( ffconfigTIME_SUPPORT != 0 )
-	/**
-	*	@public
-	*	@brief	Set the time-stamp(s) of a file entry (by name)
-	*
-	*	@param	pxIOManager		FF_IOManager_t device handle
-	*	@param	pcPath		int8_t/FF_T_WCHAR name of the file
-	*	@param	pxTime       FF_SystemTime_t the time stamp
-	*	@param	uxWhat       UBaseType_t a combination of enum ETimeMask
-	*
-	*	@return 0 or FF_Error_t
-	*
-	**/
-	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
-	FF_Error_t FF_SetTime ( FF_IOManager_t * pxIOManager, const FF_T_WCHAR * pcPath, FF_SystemTime_t *pxTime, UBaseType_t uxWhat )
-	#else
-	FF_Error_t FF_SetTime ( FF_IOManager_t * pxIOManager, const char *pcPath, FF_SystemTime_t *pxTime, UBaseType_t uxWhat )
-	#endif	/* ffconfigUNICODE_UTF16_SUPPORT */
-	{
-	FF_DirEnt_t xOriginalEntry;
-	FF_Error_t xError;
-	uint32_t ulFileCluster;
-	BaseType_t xIndex;
-	FF_FindParams_t xFindParams;
-	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
-		FF_T_WCHAR pcFileName[ffconfigMAX_FILENAME];
-	#else
-		char pcFileName[ffconfigMAX_FILENAME];
-	#endif	/* ffconfigUNICODE_UTF16_SUPPORT */
+#if( ffconfigMMAP_SUPPORT != 0 )
+/**
+ *	@public
+ *	@brief	Gives direct access to the contents of a file, when the medium is
+ *			addressable memory.
+ *
+ *	@param	pxFile		A handle opened for reading only.  On success, it belongs
+ *						to the mapping and FF_UnmapFile() will close it.
+ *	@param	pxError		Receives FF_ERR_NONE or an error code.
+ *
+ *	@return	A mapping with one extent per run of clusters that are contiguous in
+ *			memory, or NULL.
+ *
+ *	While the handle is open, FF_Open() will refuse write access to the file,
+ *	so it can not be written, truncated, moved or removed.
+ **/
+FF_Mapping_t *FF_MapFile( FF_FILE *pxFile, FF_Error_t *pxError )
+{
+FF_IOManager_t *pxIOManager = NULL;
+FF_Disk_t *pxDisk = NULL;
+FF_Mapping_t *pxMapping = NULL;
+FF_FATBuffers_t xFATBuffers;
+uint32_t ulBytesPerCluster = 0ul;
+uint32_t ulClusterCount = 0ul;
+uint32_t ulExtentCount = 0ul;
+uint32_t ulCluster, ulIndex, ulLength, ulPart;
+uint8_t *pucData;
+const uint8_t *pucNext;
+BaseType_t xPass;
+FF_Error_t xError, xTempError;
+
+	if( pxFile == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_MAPFILE );
+	}
+	else
+	{
+		xError = FF_CheckValid( pxFile );
+	}
 
-		xIndex = ( BaseType_t ) STRLEN( pcPath );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		pxIOManager = pxFile->pxIOManager;
+		pxDisk = pxIOManager->xBlkDevice.pxDisk;
 
-		memset( &xFindParams, '\0', sizeof( xFindParams ) );
+		if( ( ( pxFile->ucMode & FF_MODE_READ ) == 0 ) ||
+			( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) != 0 ) )
+		{
+			/* Data that can be changed through the handle can not be mapped. */
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_READ_MODE | FF_MAPFILE );
+		}
+		else if( ( pxDisk == NULL ) || ( pxDisk->fnMapBlocks == NULL ) )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_MAPPABLE | FF_MAPFILE );
+		}
+		else
+		{
+			ulBytesPerCluster = pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize;
+			ulClusterCount = ( pxFile->ulFileSize + ulBytesPerCluster - 1 ) / ulBytesPerCluster;
 
-		while( xIndex != 0 )
+			/* Changes to the file that were made through the cache must be
+			in memory before it can be accessed directly. */
+			xError = FF_FlushCache( pxIOManager );
+		}
+	}
+
+	/* The first pass counts the extents, the second pass fills them in.  The
+	cluster chain can not change in the mean time because the file is open. */
+	for( xPass = 0; ( xPass < 2 ) && ( FF_isERR( xError ) == pdFALSE ); xPass++ )
+	{
+		ulExtentCount = 0ul;
+		ulLength = pxFile->ulFileSize;
+		ulCluster = pxFile->ulObjectCluster;
+		pucNext = NULL;
+
+		/* The chain is only read, other readers of the FAT may go on. */
+		FF_InitFATBuffers( &xFATBuffers, FF_MODE_READ );
+		FF_LockFATRead( pxIOManager );
 		{
-			if( pcPath[ xIndex ] == '\\' || pcPath[ xIndex ] == '/' )
+			for( ulIndex = 0; ulIndex < ulClusterCount; ulIndex++ )
 			{
-				break;
-			}
+				if( ulIndex != 0ul )
+				{
+					ulCluster = FF_getFATEntry( pxIOManager, ulCluster, &xError, &xFATBuffers );
+					if( FF_isERR( xError ) )
+					{
+						break;
+					}
+				}
 
-			xIndex--;
-		}
+				pucData = pxDisk->fnMapBlocks( pxDisk, FF_getRealLBA( pxIOManager, FF_Cluster2LBA( pxIOManager, ulCluster ) ),
+					pxIOManager->xPartition.ulSectorsPerCluster );
+				if( pucData == NULL )
+				{
+					xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_MAPPABLE | FF_MAPFILE );
+					break;
+				}
 
-		STRNCPY( pcFileName, ( pcPath + xIndex + 1 ), ffconfigMAX_FILENAME );
+				ulPart = ( ulLength < ulBytesPerCluster ) ? ulLength : ulBytesPerCluster;
+				if( pucData != pucNext )
+				{
+					/* This cluster does not follow the previous one in memory. */
+					if( pxMapping != NULL )
+					{
+						pxMapping->pxExtents[ ulExtentCount ].pucData = pucData;
+						pxMapping->pxExtents[ ulExtentCount ].ulLength = 0ul;
+					}
+					ulExtentCount++;
+				}
+				if( pxMapping != NULL )
+				{
+					pxMapping->pxExtents[ ulExtentCount - 1 ].ulLength += ulPart;
+				}
+				pucNext = pucData + ulBytesPerCluster;
+				ulLength -= ulPart;
+			}
+		}
+		FF_UnlockFATRead( pxIOManager );
 
-		if( xIndex == 0 )
+		xTempError = FF_ReleaseFATBuffers( pxIOManager, &xFATBuffers );
+		if( FF_isERR( xError ) == pdFALSE )
 		{
-			xIndex = 1;
+			xError = xTempError;
 		}
 
-		xFindParams.ulDirCluster = FF_FindDir( pxIOManager, pcPath, ( uint16_t ) xIndex, &xError );
-		if( FF_isERR( xError ) == pdFALSE )
+		if( ( FF_isERR( xError ) == pdFALSE ) && ( pxMapping == NULL ) )
 		{
-			if( xFindParams.ulDirCluster == 0 )
+			/* The extents are stored right behind the mapping. */
+			pxMapping = ( FF_Mapping_t * ) ffconfigMALLOC( sizeof( *pxMapping ) + ulExtentCount * sizeof( FF_MapExtent_t ) );
+			if( pxMapping == NULL )
 			{
-				xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
+				xError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_MAPFILE );
 			}
 			else
 			{
-				ulFileCluster = FF_FindEntryInDir( pxIOManager, &xFindParams, pcFileName, 0, &xOriginalEntry, &xError );
-				if( ( FF_isERR( xError ) == pdFALSE ) || ( FF_GETERROR( xError ) == FF_ERR_DIR_END_OF_DIR ) )
-				{
-					if( ulFileCluster == 0ul )
-					{
-						/*FF_PRINTF ("FF_SetTime: Can not find '%s'\n", pcFileName); */
-						xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
-					}
-				}
+				pxMapping->pxFile = pxFile;
+				pxMapping->ulLength = pxFile->ulFileSize;
+				pxMapping->ulExtentCount = ulExtentCount;
+				pxMapping->pxExtents = ( FF_MapExtent_t * ) ( pxMapping + 1 );
 			}
 		}
+	}
 
-		if( FF_isERR( xError ) == pdFALSE )
+	if( ( FF_isERR( xError ) != pdFALSE ) && ( pxMapping != NULL ) )
+	{
+		ffconfigFREE( pxMapping );
+		pxMapping = NULL;
+	}
+
+	if( pxError != NULL )
+	{
+		*pxError = xError;
+	}
+
+	return pxMapping;
+}	/* FF_MapFile() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@public
+ *	@brief	Ends a mapping made by FF_MapFile() and closes its file handle.
+ *
+ *	@param	pxMapping	The mapping, which will be freed.
+ *
+ *	@return	The result of FF_Close().
+ **/
+FF_Error_t FF_UnmapFile( FF_Mapping_t *pxMapping )
+{
+FF_Error_t xError;
+
+	if( pxMapping == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_MAPFILE );
+	}
+	else
+	{
+		xError = FF_Close( pxMapping->pxFile );
+		ffconfigFREE( pxMapping );
+	}
+
+	return xError;
+}	/* FF_UnmapFile() */
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigMMAP_SUPPORT */
+
+#if( ffconfigCOPYFILE_SUPPORT != 0 )
+/**
+ *	@private
+ *	@brief	Copies sectors from one place of a volume to another, without the
+ *			cache.  A medium that is addressable memory is copied in place,
+ *			others through '*ppucBuffer', which holds 'ulBufferSectors' sectors
+ *			and which is allocated when it is needed for the first time.  The
+ *			driver is used under the same rules as FF_BlockRead() and
+ *			FF_BlockWrite(), one buffer size at a time.
+ **/
+static FF_Error_t FF_CopySectors( FF_IOManager_t *pxIOManager, uint32_t ulFromLBA, uint32_t ulToLBA, uint32_t ulCount,
+	uint8_t **ppucBuffer, uint32_t ulBufferSectors )
+{
+FF_Error_t xError = FF_ERR_NONE;
+uint32_t ulSectors;
+#if( ffconfigMMAP_SUPPORT != 0 )
+	FF_Disk_t *pxDisk = pxIOManager->xBlkDevice.pxDisk;
+	BaseType_t xMapped = pdFALSE;
+	BaseType_t xLocked;
+	uint8_t *pucFrom;
+	uint8_t *pucTo;
+
+	if( ( pxDisk != NULL ) && ( pxDisk->fnMapBlocks != NULL ) )
+	{
+		xMapped = pdTRUE;
+	}
+	#if( ffconfigBLOCK_QUEUE != 0 )
+	{
+		if( pxIOManager->pxBlockQueue != NULL )
 		{
-			/* Update the Dirent! */
-			if( uxWhat & ETimeCreate )
+			/* The worker of the queue may be writing to the medium. */
+			xMapped = pdFALSE;
+		}
+	}
+	#endif
+#endif /* ffconfigMMAP_SUPPORT */
+
+	while( ulCount != 0ul )
+	{
+		ulSectors = ( ulCount < ulBufferSectors ) ? ulCount : ulBufferSectors;
+
+		#if( ffconfigMMAP_SUPPORT != 0 )
+		if( xMapped != pdFALSE )
+		{
+			/* A driver that is not re-entrant may only be used by the owner
+			of the semaphore, also when its memory is addressed directly. */
+			xLocked = ( ( pxIOManager->ucFlags & FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT ) == 0 ) ? pdTRUE : pdFALSE;
+			if( xLocked != pdFALSE )
 			{
-				xOriginalEntry.xCreateTime = *pxTime;			/*/< Date and Time Created. */
+				FF_PendSemaphore( pxIOManager->pvSemaphore );
 			}
 
-			if( uxWhat & ETimeMod )
+			pucFrom = pxDisk->fnMapBlocks( pxDisk, ulFromLBA, ulSectors );
+			pucTo = pxDisk->fnMapBlocks( pxDisk, ulToLBA, ulSectors );
+			if( ( pucFrom != NULL ) && ( pucTo != NULL ) )
 			{
-				xOriginalEntry.xModifiedTime = *pxTime;		/*/< Date and Time Modified. */
+				memcpy( pucTo, pucFrom, ( size_t ) ulSectors * pxIOManager->usSectorSize );
 			}
 
-			if( uxWhat & ETimeAccess )
+			if( xLocked != pdFALSE )
 			{
-				xOriginalEntry.xAccessedTime = *pxTime;		/*/< Date of Last Access. */
+				FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
 			}
 
-			xError = FF_PutEntry( pxIOManager, xOriginalEntry.usCurrentItem - 1, xFindParams.ulDirCluster, &xOriginalEntry, NULL );
+			if( ( pucFrom == NULL ) || ( pucTo == NULL ) )
+			{
+				/* Not addressable after all, continue through the driver. */
+				xMapped = pdFALSE;
+				continue;
+			}
+		}
+		else
+		#endif /* ffconfigMMAP_SUPPORT */
+		{
+			if( *ppucBuffer == NULL )
+			{
+				*ppucBuffer = ( uint8_t * ) ffconfigMALLOC( ( size_t ) ulBufferSectors * pxIOManager->usSectorSize );
+				if( *ppucBuffer == NULL )
+				{
+					xError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_COPYFILE );
+					break;
+				}
+			}
 
+			xError = FF_BlockRead( pxIOManager, ulFromLBA, ulSectors, *ppucBuffer, pdFALSE );
 			if( FF_isERR( xError ) == pdFALSE )
 			{
-				xError = FF_FlushCache( pxIOManager );			/* Ensure all modified blocks are flushed to disk! */
+				xError = FF_BlockWrite( pxIOManager, ulToLBA, ulSectors, *ppucBuffer, pdFALSE );
+			}
+			if( FF_isERR( xError ) )
+			{
+				break;
 			}
 		}
 
-		return xError;
-	}	/* FF_SetTime() */
-#endif /* ffconfigTIME_SUPPORT */
+		ulFromLBA += ulSectors;
+		ulToLBA += ulSectors;
+		ulCount -= ulSectors;
+	}
+
+	return xError;
+}	/* FF_CopySectors() */
 /*-----------------------------------------------------------*/
 
-#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
-FF_Error_t FF_SetPerm( FF_IOManager_t * pxIOManager, const FF_T_WCHAR * pcPath, UBaseType_t aPerm )
-#else
-FF_Error_t FF_SetPerm( FF_IOManager_t * pxIOManager, const char *pcPath, UBaseType_t aPerm )
-#endif
+/**
+ *	@private
+ *	@brief	Gives 'pxDest', which is empty, a copy of the contents of 'pxSource'.
+ *			The clusters are copied per run of clusters that are consecutive
+ *			in both files.
+ **/
+static FF_Error_t FF_CopyClusters( FF_FILE *pxSource, FF_FILE *pxDest )
 {
-FF_DirEnt_t xOriginalEntry;
-FF_Error_t xError;
-uint32_t ulFileCluster;
-BaseType_t xIndex;
-#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
-	FF_T_WCHAR pcFileName[ffconfigMAX_FILENAME];
-#else
-	char pcFileName[ffconfigMAX_FILENAME];
-#endif
-FF_FindParams_t xFindParams;
+FF_IOManager_t *pxIOManager = pxSource->pxIOManager;
+const uint32_t ulSectorsPerCluster = pxIOManager->xPartition.ulSectorsPerCluster;
+const uint32_t ulBytesPerCluster = ulSectorsPerCluster * pxIOManager->usSectorSize;
+uint32_t ulClustersLeft = ( pxSource->ulFileSize + ulBytesPerCluster - 1 ) / ulBytesPerCluster;
+uint32_t ulSectorsLeft = ( pxSource->ulFileSize + pxIOManager->usSectorSize - 1 ) / pxIOManager->usSectorSize;
+uint32_t ulBufferSectors = ffconfigCOPYFILE_BUFFER_SIZE / pxIOManager->usSectorSize;
+uint32_t ulFromCluster, ulToCluster, ulRun, ulToRun, ulSectors, ulFirst;
+uint8_t *pucBuffer = NULL;
+FF_Error_t xError = FF_ERR_NONE;
+FF_Error_t xTempError;
 
-	xIndex = ( BaseType_t ) STRLEN( pcPath );
+	if( ulBufferSectors > ulSectorsLeft )
+	{
+		ulBufferSectors = ulSectorsLeft;
+	}
+	if( ulBufferSectors == 0ul )
+	{
+		ulBufferSectors = 1ul;
+	}
 
-	memset( &xFindParams, '\0', sizeof( xFindParams ) );
+	if( pxDest->ulObjectCluster != 0ul )
+	{
+		/* Give back the cluster that FF_Open() allocated for the new file, it
+		will hardly ever be followed by enough free clusters. */
+		xError = FF_Truncate( pxDest, pdTRUE );
+	}
 
-	while( xIndex != 0 )
+	if( FF_isERR( xError ) == pdFALSE )
 	{
-		if( pcPath[ xIndex ] == '\\' || pcPath[ xIndex ] == '/' )
+		/* Let the chain of the copy start at a run of free clusters that is
+		long enough, so that FF_ExtendFile() allocates it in one piece. */
+		FF_LockFAT( pxIOManager );
 		{
-			break;
+			ulFirst = FF_FindFreeRun( pxIOManager, ulClustersLeft, &xError );
+			if( ulFirst != 0ul )
+			{
+				pxIOManager->xPartition.ulLastFreeCluster = ulFirst;
+			}
 		}
-
-		xIndex--;
+		FF_UnlockFAT( pxIOManager );
 	}
 
-	STRNCPY( pcFileName, ( pcPath + xIndex + 1 ), ffconfigMAX_FILENAME );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		xError = FF_ExtendFile( pxDest, pxSource->ulFileSize );
+	}
 
-	if( xIndex == 0 )
+	if( FF_isERR( xError ) == pdFALSE )
 	{
-		xIndex = 1;
+		/* The source may have sectors in the cache that were not written yet. */
+		xError = FF_FlushCache( pxIOManager );
 	}
 
-	/* Open a do {} while( pdFALSE ) loop to allow the use of break statements. */
-	do
+	ulFromCluster = pxSource->ulObjectCluster;
+	ulToCluster = pxDest->ulObjectCluster;
+
+	while( ( FF_isERR( xError ) == pdFALSE ) && ( ulClustersLeft != 0ul ) )
 	{
-		xFindParams.ulDirCluster = FF_FindDir( pxIOManager, pcPath, ( uint16_t ) xIndex, &xError );
-		if( xError )
+		ulRun = 1ul;
+		if( ulClustersLeft > 1ul )
 		{
-			break;
+			ulRun += FF_GetSequentialClusters( pxIOManager, ulFromCluster, ulClustersLeft - 1, &xError );
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				ulToRun = 1ul + FF_GetSequentialClusters( pxIOManager, ulToCluster, ulRun - 1, &xError );
+				if( ulToRun < ulRun )
+				{
+					ulRun = ulToRun;
+				}
+			}
+			if( FF_isERR( xError ) )
+			{
+				break;
+			}
 		}
 
-		if( !xFindParams.ulDirCluster )
+		ulSectors = ulRun * ulSectorsPerCluster;
+		if( ulSectors > ulSectorsLeft )
 		{
-			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
-			break;
+			/* Only the sectors that hold data of the last cluster. */
+			ulSectors = ulSectorsLeft;
 		}
 
-		ulFileCluster = FF_FindEntryInDir( pxIOManager, &xFindParams, pcFileName, 0, &xOriginalEntry, &xError );
-		if( FF_isERR( xError ) )
-		{
-			break;
-		}
+		xError = FF_CopySectors( pxIOManager,
+			FF_getRealLBA( pxIOManager, FF_Cluster2LBA( pxIOManager, ulFromCluster ) ),
+			FF_getRealLBA( pxIOManager, FF_Cluster2LBA( pxIOManager, ulToCluster ) ),
+			ulSectors, &pucBuffer, ulBufferSectors );
 
-		if( ulFileCluster == 0ul )
+		ulSectorsLeft -= ulSectors;
+		ulClustersLeft -= ulRun;
+
+		if( ( FF_isERR( xError ) == pdFALSE ) && ( ulClustersLeft != 0ul ) )
 		{
-			/*FF_PRINTF ("FF_SetTime: Can not find '%s'\n", pcFileName); */
-			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_FOUND | FF_SETTIME );
-			break;
+			ulFromCluster = FF_TraverseFAT( pxIOManager, ulFromCluster, ulRun, &xError );
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				ulToCluster = FF_TraverseFAT( pxIOManager, ulToCluster, ulRun, &xError );
+			}
 		}
+	}
 
-		/*	#define FF_FAT_ATTR_READONLY		0x01 */
-		/*	#define FF_FAT_ATTR_HIDDEN			0x02 */
-		/*	#define FF_FAT_ATTR_SYSTEM			0x04 */
-		/*	#define FF_FAT_ATTR_VOLID			0x08 */
-		/*	#define FF_FAT_ATTR_DIR				0x10 */
-		/*	#define FF_FAT_ATTR_ARCHIVE			0x20 */
-		/*	#define FF_FAT_ATTR_LFN				0x0F */
-	#define FF_FAT_ATTR_USER	( ( uint8_t ) FF_FAT_ATTR_READONLY | FF_FAT_ATTR_HIDDEN | FF_FAT_ATTR_SYSTEM | FF_FAT_ATTR_ARCHIVE )
-		/* Update the Dirent! */
-		xOriginalEntry.ucAttrib &= ~FF_FAT_ATTR_USER;
-		xOriginalEntry.ucAttrib |= ( aPerm & FF_FAT_ATTR_USER );
-		xError = FF_PutEntry( pxIOManager, xOriginalEntry.usCurrentItem - 1, xFindParams.ulDirCluster, &xOriginalEntry, NULL );
+	if( pucBuffer != NULL )
+	{
+		ffconfigFREE( pucBuffer );
+	}
 
-		if( FF_isERR( xError ) == pdFALSE )
-		{
-			xError = FF_FlushCache( pxIOManager );			/* Ensure all modfied blocks are flushed to disk! */
-		}
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		pxDest->ulFileSize = pxSource->ulFileSize;
+		pxDest->ulFilePointer = pxSource->ulFileSize;
+	}
+
+	xTempError = FF_FinishWrite( pxDest, pxDest->ulFileSize, xError );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		xError = xTempError;
 	}
-	while( pdFALSE );
 
 	return xError;
-}	/* FF_SetPerm() */
+}	/* FF_CopyClusters() */
 /*-----------------------------------------------------------*/
 
 /**
-*	@public
-*	@brief	Equivalent to fclose()
-*
-*	@param	pxFile		FF_FILE object that was created by FF_Open().
-*
-*	@return 0 on sucess.
-*	@return -1 if a null pointer was provided.
-*
-**/
-FF_Error_t FF_Close( FF_FILE *pxFile )
-{
-FF_FILE *pxFileChain;
-FF_DirEnt_t xOriginalEntry;
-FF_Error_t xError;
+ *	@private
+ *	@brief	Allocates the path of a temporary file in the directory of
+ *			'pcPath', "~cpNNNNN.tmp", with a number that no other copy in
+ *			progress uses and that no existing object has.
+ **/
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+static FF_T_WCHAR *prvCopyTempPath( FF_IOManager_t *pxIOManager, const FF_T_WCHAR *pcPath, FF_Error_t *pxError )
+#else
+static char *prvCopyTempPath( FF_IOManager_t *pxIOManager, const char *pcPath, FF_Error_t *pxError )
+#endif
+{
+static uint32_t ulCopyNumber = 0ul;
+static const char pcTail[] = "~cp00000.tmp";
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	FF_T_WCHAR *pcTemp;
+#else
+	char *pcTemp;
+#endif
+FF_FILE *pxFile;
+FF_Error_t xError = ( FF_Error_t ) ( FF_ERR_FILE_DESTINATION_EXISTS | FF_COPYFILE );
+size_t xLength, x;
+uint32_t ulNumber;
+BaseType_t xAttempt;
 
-	/* Opening a do {} while( 0 )  loop to allow the use of the break statement. */
-	do
+	/* The directory part, including the last separator. */
+	for( xLength = STRLEN( pcPath ); xLength != 0u; xLength-- )
 	{
-		if( pxFile == NULL )
+		if( ( pcPath[ xLength - 1u ] == '\\' ) || ( pcPath[ xLength - 1u ] == '/' ) )
 		{
-			xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_CLOSE );
 			break;
 		}
+	}
 
-		/* It is important to check that user doesn't supply invalid
-		handle or a handle invalid because of "media removed" */
-		xError = FF_CheckValid( pxFile );
+	pcTemp = ffconfigMALLOC( ( xLength + sizeof( pcTail ) ) * sizeof( pcPath[ 0 ] ) );
+	if( pcTemp == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_COPYFILE );
+	}
+	else
+	{
+		memcpy( pcTemp, pcPath, xLength * sizeof( pcPath[ 0 ] ) );
+		for( x = 0u; x < sizeof( pcTail ); x++ )
+		{
+			pcTemp[ xLength + x ] = pcTail[ x ];
+		}
 
-		#if( ffconfigREMOVABLE_MEDIA != 0 )
+		/* A file with the name may have been left behind when power was lost
+		during a copy, try a few numbers. */
+		for( xAttempt = 0; xAttempt < 16; xAttempt++ )
 		{
-			if( FF_GETERROR( xError ) == FF_ERR_FILE_MEDIA_REMOVED )
+			taskENTER_CRITICAL();
 			{
-				FF_PendSemaphore( pxFile->pxIOManager->pvSemaphore );
-				{
-					pxFileChain = ( FF_FILE * ) pxFile->pxIOManager->FirstFile;
-					if( pxFileChain == pxFile )
-					{
-						pxFile->pxIOManager->FirstFile = pxFile->pxNext;
-					}
-					else
-					{
-						while( pxFileChain )
-						{
-							if( pxFileChain->pxNext == pxFile )
-							{
-								pxFileChain->pxNext = pxFile->pxNext;
-								break;
-							}
+				ulNumber = ulCopyNumber++;
+			}
+			taskEXIT_CRITICAL();
 
-							pxFileChain = pxFileChain->pxNext;	/* Forgot this one */
-						}
-					}
-				}					/* Semaphore released, linked list was shortened! */
+			for( x = 7u; x >= 3u; x-- )
+			{
+				pcTemp[ xLength + x ] = ( char ) ( '0' + ( ulNumber % 10ul ) );
+				ulNumber /= 10ul;
+			}
 
-				FF_ReleaseSemaphore( pxFile->pxIOManager->pvSemaphore );
-				#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
-				{
-					ffconfigFREE( pxFile->pucBuffer );
-				}
-				#endif	/* ffconfigOPTIMISE_UNALIGNED_ACCESS */
-				ffconfigFREE( pxFile );	/* So at least we have freed the pointer. */
+			pxFile = FF_Open( pxIOManager, pcTemp, FF_MODE_READ, &xError );
+			if( pxFile != NULL )
+			{
+				FF_Close( pxFile );
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_DESTINATION_EXISTS | FF_COPYFILE );
+			}
+			else if( FF_GETERROR( xError ) == FF_ERR_FILE_NOT_FOUND )
+			{
 				xError = FF_ERR_NONE;
 				break;
 			}
+			else if( FF_GETERROR( xError ) != FF_ERR_FILE_OBJECT_IS_A_DIR )
+			{
+				/* E.g. the directory does not exist. */
+				break;
+			}
 		}
-		#endif	/* ffconfigREMOVABLE_MEDIA */
 
 		if( FF_isERR( xError ) )
 		{
-			/* FF_ERR_FILE_BAD_HANDLE or FF_ERR_NULL_POINTER */
-			break;
+			ffconfigFREE( pcTemp );
+			pcTemp = NULL;
 		}
+	}
 
-		/* So here we have a normal valid file handle. */
+	*pxError = xError;
 
-		/* Sometimes FreeRTOS+FAT will leave a trailing cluster on the end of a cluster chain.
-		To ensure we're compliant we shall now check for this condition and truncate it. */
-		if( ( ( pxFile->ulValidFlags & FF_VALID_FLAG_DELETED ) == 0 ) &&
-			( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND | FF_MODE_CREATE ) ) != 0 ) )
-		{
-		uint32_t ulClusterSize;
+	return pcTemp;
+}	/* prvCopyTempPath() */
+/*-----------------------------------------------------------*/
 
-			/* File is not deleted and it was opened for writing or updating */
-			ulClusterSize = pxFile->pxIOManager->xPartition.usBlkSize * pxFile->pxIOManager->xPartition.ulSectorsPerCluster;
+/**
+ *	@public
+ *	@brief	Copies a file to a new file on the same volume, without passing the
+ *			data through the cache or through a buffer of the caller.  The copy
+ *			is made under a temporary name in the directory of the destination
+ *			and gets its name when it is complete.
+ *
+ *	@param	pxIOManager		FF_IOManager_t object that was created by FF_CreateIOManger().
+ *	@param	pcSourceFile	The path of the file to copy.
+ *	@param	pcDestFile		The path of the copy.
+ *	@param	xFlags			FF_COPY_OVERWRITE to replace an existing file.
+ *
+ *	@return	FF_ERR_NONE on success, FF_ERR_FILE_DESTINATION_EXISTS, or another
+ *			error code.  After an error, no (partial) copy is left behind and
+ *			an existing destination has not been changed.
+ **/
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+FF_Error_t FF_CopyFile( FF_IOManager_t *pxIOManager, const FF_T_WCHAR *pcSourceFile, const FF_T_WCHAR *pcDestFile,
+	BaseType_t xFlags )
+#else
+FF_Error_t FF_CopyFile( FF_IOManager_t *pxIOManager, const char *pcSourceFile, const char *pcDestFile,
+	BaseType_t xFlags )
+#endif
+{
+FF_FILE *pxSource;
+FF_FILE *pxDest = NULL;
+FF_Error_t xError, xTempError;
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	FF_T_WCHAR *pcTempFile = NULL;
+#else
+	char *pcTempFile = NULL;
+#endif
+
+	if( pxIOManager == NULL )
+	{
+		pxSource = NULL;
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_COPYFILE );
+	}
+	else
+	{
+		pxSource = FF_Open( pxIOManager, pcSourceFile, FF_MODE_READ, &xError );
+	}
 
-			if( ( ( pxFile->ulFileSize % ulClusterSize ) == 0 ) && ( pxFile->ulObjectCluster != 0ul ) )
+	if( pxSource != NULL )
+	{
+		if( ( xFlags & FF_COPY_OVERWRITE ) == 0 )
+		{
+			/* Save the work when the destination exists already.  It may also
+			be created while the copy is made, FF_Move() will not replace it. */
+			pxDest = FF_Open( pxIOManager, pcDestFile, FF_MODE_READ, &xTempError );
+			if( ( pxDest != NULL ) || ( FF_GETERROR( xTempError ) == FF_ERR_FILE_OBJECT_IS_A_DIR ) )
 			{
-				/* The file's length is a multiple of cluster size.  This means
-				that an extra cluster has been reserved, which wasn't necessary. */
-				xError = FF_Truncate( pxFile, pdTRUE );
+				xError = ( FF_Error_t ) ( FF_ERR_FILE_DESTINATION_EXISTS | FF_COPYFILE );
 			}
-
-			/* Get the directory entry and update it to show the new file size */
-			if( FF_isERR( xError ) == pdFALSE )
+			if( pxDest != NULL )
 			{
-				xError = FF_GetEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
+				FF_Close( pxDest );
+				pxDest = NULL;
+			}
+		}
 
-				/* Now update the directory entry */
-				if( ( FF_isERR( xError ) == pdFALSE ) &&
-					( ( pxFile->ulFileSize != xOriginalEntry.ulFileSize ) || ( pxFile->ulFileSize == 0UL ) ) )
-				{
-					if( pxFile->ulFileSize == 0UL )
-					{
-						xOriginalEntry.ulObjectCluster = 0;
-					}
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			pcTempFile = prvCopyTempPath( pxIOManager, pcDestFile, &xError );
+		}
 
-					xOriginalEntry.ulFileSize = pxFile->ulFileSize;
-					xError = FF_PutEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
-				}
-			}
+		if( pcTempFile != NULL )
+		{
+			pxDest = FF_Open( pxIOManager, pcTempFile, FF_MODE_WRITE | FF_MODE_CREATE | FF_MODE_TRUNCATE, &xError );
 		}
 
-		/* Handle Linked list! */
-		FF_PendSemaphore( pxFile->pxIOManager->pvSemaphore );
-		{	/* Semaphore is required, or linked list could become corrupted. */
-			pxFileChain = ( FF_FILE * ) pxFile->pxIOManager->FirstFile;
-			if( pxFileChain == pxFile )
+		if( pxDest != NULL )
+		{
+			if( pxSource->ulFileSize != 0ul )
 			{
-				pxFile->pxIOManager->FirstFile = pxFile->pxNext;
+				xError = FF_CopyClusters( pxSource, pxDest );
 			}
-			else
+
+			xTempError = FF_Close( pxDest );
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				xError = xTempError;
+			}
+
+			if( ( FF_isERR( xError ) == pdFALSE ) && ( ( xFlags & FF_COPY_OVERWRITE ) != 0 ) )
 			{
-				while( pxFileChain )
+				/* The old file only goes now that the copy is complete.  It
+				stays when it can not be removed, e.g. because it is open. */
+				xTempError = FF_RmFile( pxIOManager, pcDestFile );
+				if( FF_isERR( xTempError ) && ( FF_GETERROR( xTempError ) != FF_ERR_FILE_NOT_FOUND ) )
 				{
-					if( pxFileChain->pxNext == pxFile )
-					{
-						/* Found it, remove it from the list. */
-						pxFileChain->pxNext = pxFile->pxNext;
-						break;
-					}
-					pxFileChain = pxFileChain->pxNext;
+					xError = xTempError;
 				}
 			}
-		}	/* Semaphore released, linked list was shortened! */
-		FF_ReleaseSemaphore( pxFile->pxIOManager->pvSemaphore );
 
-		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
-		{
-			if( pxFile->pucBuffer != NULL )
+			if( FF_isERR( xError ) == pdFALSE )
 			{
-				/* Ensure any unaligned points are pushed to the disk! */
-				if( pxFile->ucState & FF_BUFSTATE_WRITTEN )
+				/* Within one directory, FF_RenameDirent() checks the name again
+				while the directory is locked. */
+				xError = FF_Move( pxIOManager, pcTempFile, pcDestFile, pdFALSE );
+				if( ( FF_GETERROR( xError ) == FF_ERR_FILE_DESTINATION_EXISTS ) ||
+					( FF_GETERROR( xError ) == FF_ERR_DIR_OBJECT_EXISTS ) )
 				{
-				FF_Error_t xTempError;
-
-					xTempError = FF_BlockWrite( pxFile->pxIOManager, FF_FileLBA( pxFile ), 1, pxFile->pucBuffer, pdFALSE );
-					if( FF_isERR( xError ) == pdFALSE )
-					{
-						xError = xTempError;
-					}
+					xError = ( FF_Error_t ) ( FF_ERR_FILE_DESTINATION_EXISTS | FF_COPYFILE );
 				}
+			}
 
-				ffconfigFREE( pxFile->pucBuffer );
+			if( FF_isERR( xError ) )
+			{
+				/* Do not leave a partial copy. */
+				FF_RmFile( pxIOManager, pcTempFile );
 			}
 		}
-		#endif
+
+		if( pcTempFile != NULL )
+		{
+			ffconfigFREE( pcTempFile );
+		}
+
+		xTempError = FF_Close( pxSource );
 		if( FF_isERR( xError ) == pdFALSE )
 		{
-			xError = FF_FlushCache( pxFile->pxIOManager ); /* Ensure all modified blocks are flushed to disk! */
+			xError = xTempError;
 		}
-		ffconfigFREE( pxFile );
 	}
-	while( pdFALSE );
 
 	return xError;
-}	/* FF_Close() */
+}	/* FF_CopyFile() */
 /*-----------------------------------------------------------*/
+#endif	/* ffconfigCOPYFILE_SUPPORT */
 
 /**
 *	@public
@@ -2966,15 +4616,27 @@ FF_Error_t FF_SetEof( FF_FILE *pxFile )
 	if( ( ( pxFile->ulValidFlags & FF_VALID_FLAG_DELETED ) == 0 ) &&
 		( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND | FF_MODE_CREATE ) ) != 0 ) )
 	{
-		pxFile->ulFileSize = pxFile->ulFilePointer;
-		if( pxFile->ulObjectCluster != 0ul )
+		#if( ffconfigLOG_FILE_SUPPORT != 0 )
 		{
-			xError = FF_Truncate( pxFile, pdFALSE );
+			/* The last sector of a log file will be fetched again. */
+			xError = FF_LogFlush( pxFile );
+			pxFile->ulLogSectorLBA = 0ul;
 		}
-		else
+		#else
 		{
 			xError = FF_ERR_NONE;
 		}
+		#endif
+		pxFile->ulFileSize = pxFile->ulFilePointer;
+		#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+		{
+			FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_SIZE | FF_DIRENT_DIRTY_MODIFIED );
+		}
+		#endif
+		if( ( FF_isERR( xError ) == pdFALSE ) && ( pxFile->ulObjectCluster != 0ul ) )
+		{
+			xError = FF_Truncate( pxFile, pdFALSE );
+		}
 	}
 	else
 	{
@@ -2985,6 +4647,154 @@ FF_Error_t FF_SetEof( FF_FILE *pxFile )
 }	/* FF_SetEof() */
 /*-----------------------------------------------------------*/
 
+/**
+*	@public
+*	@brief	Writes the pending changes of a file to disk: the unaligned-access
+*			buffer, the directory entry and the sector cache.  Use it for files
+*			that must survive a power failure while they are open.
+*
+*	@param	pxFile		FF_FILE object that was created by FF_Open().
+*
+*	@return 0 on sucess.
+*	@return negative if some error occurred
+*
+**/
+FF_Error_t FF_SyncFile( FF_FILE *pxFile )
+{
+FF_Error_t xError;
+
+	if( pxFile == NULL )
+	{
+		xError = ( FF_Error_t ) ( FF_ERR_NULL_POINTER | FF_SYNCFILE );
+	}
+	else
+	{
+		xError = FF_CheckValid( pxFile );
+	}
+
+	if( ( FF_isERR( xError ) == pdFALSE ) &&
+		( ( pxFile->ulValidFlags & FF_VALID_FLAG_DELETED ) == 0 ) &&
+		( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND | FF_MODE_CREATE ) ) != 0 ) )
+	{
+		#if( ffconfigLOG_FILE_SUPPORT != 0 )
+		{
+			if( ( pxFile->ucMode & FF_MODE_LOG ) != 0 )
+			{
+				/* Appends have to wait until the size on disk covers the data. */
+				FF_PendSemaphore( pxFile->pvLogMutex );
+				xError = FF_LogFlush( pxFile );
+				pxFile->xLogSyncTime = xTaskGetTickCount();
+			}
+		}
+		#endif	/* ffconfigLOG_FILE_SUPPORT */
+
+		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+		{
+			if( ( pxFile->ucState & FF_BUFSTATE_WRITTEN ) != 0 )
+			{
+				/* The buffer remains valid, it is just no longer dirty. */
+				xError = FF_BlockWrite( pxFile->pxIOManager, FF_FileLBA( pxFile ), 1, pxFile->pucBuffer, pdFALSE );
+				if( FF_isERR( xError ) == pdFALSE )
+				{
+					pxFile->ucState &= ~FF_BUFSTATE_WRITTEN;
+				}
+			}
+		}
+		#endif	/* ffconfigOPTIMISE_UNALIGNED_ACCESS */
+
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			xError = FF_FlushDirent( pxFile );
+		}
+
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			xError = FF_FlushCache( pxFile->pxIOManager );
+		}
+
+		#if( ffconfigLOG_FILE_SUPPORT != 0 )
+		{
+			if( ( pxFile->ucMode & FF_MODE_LOG ) != 0 )
+			{
+				FF_ReleaseSemaphore( pxFile->pvLogMutex );
+			}
+		}
+		#endif	/* ffconfigLOG_FILE_SUPPORT */
+	}
+
+	return xError;
+}	/* FF_SyncFile() */
+/*-----------------------------------------------------------*/
+
+/* Write the size, the first cluster and, if changed, the modification time of
+an open file to its directory entry. */
+static FF_Error_t FF_FlushDirent( FF_FILE *pxFile )
+{
+FF_DirEnt_t xOriginalEntry;
+FF_Error_t xError;
+BaseType_t xDirty = pdFALSE;
+
+	xError = FF_GetEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
+
+	#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+	{
+		if( pxFile->ucDirentDirty != 0u )
+		{
+			xDirty = pdTRUE;
+		}
+	}
+	#endif
+
+	/* Now update the directory entry */
+	if( ( FF_isERR( xError ) == pdFALSE ) &&
+		( ( xDirty != pdFALSE ) || ( pxFile->ulFileSize != xOriginalEntry.ulFileSize ) || ( pxFile->ulFileSize == 0UL ) ) )
+	{
+		#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 ) && ( ffconfigTIME_SUPPORT != 0 )
+		{
+			if( ( pxFile->ucDirentDirty & FF_DIRENT_DIRTY_MODIFIED ) != 0u )
+			{
+				/* The time source is only consulted once per write-back. */
+				FF_GetSystemTime( &xOriginalEntry.xModifiedTime );
+			}
+		}
+		#endif
+
+		/* With deferred updates the entry may not have its first cluster yet.
+		A file of zero bytes has no cluster once FF_Close() truncated it. */
+		xOriginalEntry.ulObjectCluster = pxFile->ulObjectCluster;
+		xOriginalEntry.ulFileSize = pxFile->ulFileSize;
+		xError = FF_PutEntry( pxFile->pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
+
+		#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+		{
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pxFile->ucDirentDirty = 0u;
+			}
+		}
+		#endif
+	}
+
+	return xError;
+}	/* FF_FlushDirent() */
+/*-----------------------------------------------------------*/
+
+#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+	static void FF_SetDirentDirty( FF_FILE *pxFile, uint8_t ucBits )
+	{
+		#if( ffconfigDIRENT_SYNC_INTERVAL_MS != 0 )
+		{
+			if( pxFile->ucDirentDirty == 0u )
+			{
+				pxFile->xDirentDirtyTime = xTaskGetTickCount();
+			}
+		}
+		#endif
+		pxFile->ucDirentDirty |= ucBits;
+	}	/* FF_SetDirentDirty() */
+#endif /* ffconfigDEFERRED_DIRENT_UPDATE */
+/*-----------------------------------------------------------*/
+
 /**
 *	@public
 *	@brief	Truncate a file to 'pxFile->ulFileSize'
@@ -3039,25 +4849,33 @@ uint32_t ulClustersNeeded;
 
 			if( FF_isERR( xError ) == pdFALSE )
 			{
-			FF_DirEnt_t xOriginalEntry;
-
-				/* The directory denotes the address of the first data cluster of every file.
-				Now change it to 'ulAddrCurrentCluster': */
-				xError = FF_GetEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
-
-				if( FF_isERR( xError ) == pdFALSE )
+				#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+				{
+					FF_SetDirentDirty( pxFile, FF_DIRENT_DIRTY_CLUSTER );
+				}
+				#else
 				{
-					xOriginalEntry.ulObjectCluster = 0ul;
-					xError = FF_PutEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
+				FF_DirEnt_t xOriginalEntry;
+
+					/* The directory denotes the address of the first data cluster of every file.
+					Now change it to 'ulAddrCurrentCluster': */
+					xError = FF_GetEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry );
 
 					if( FF_isERR( xError ) == pdFALSE )
 					{
-						pxFile->ulObjectCluster = 0ul;
-						pxFile->ulChainLength = 0ul;
-						pxFile->ulCurrentCluster = 0ul;
-						pxFile->ulEndOfChain = 0ul;
+						xOriginalEntry.ulObjectCluster = 0ul;
+						xError = FF_PutEntry( pxIOManager, pxFile->usDirEntry, pxFile->ulDirCluster, &xOriginalEntry, NULL );
 					}
 				}
+				#endif /* ffconfigDEFERRED_DIRENT_UPDATE */
+
+				if( FF_isERR( xError ) == pdFALSE )
+				{
+					pxFile->ulObjectCluster = 0ul;
+					pxFile->ulChainLength = 0ul;
+					pxFile->ulCurrentCluster = 0ul;
+					pxFile->ulEndOfChain = 0ul;
+				}
 			}
 		}
 		else
@@ -3070,6 +4888,13 @@ uint32_t ulClustersNeeded;
 				{
 					xError = FF_UnlinkClusterChain( pxIOManager, ulTruncateCluster, 1 );
 				}
+
+				if( FF_isERR( xError ) == pdFALSE )
+				{
+					/* FF_ExtendFile() relies on these. */
+					pxFile->ulChainLength = ulClustersNeeded;
+					pxFile->ulEndOfChain = ulTruncateCluster;
+				}
 			}
 			FF_UnlockFAT( pxIOManager );
 		}
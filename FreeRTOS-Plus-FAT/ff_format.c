@@ -160,7 +160,7 @@ uint8_t ucFATType = 0;                 /* Either 'FF_T_FAT16' or 'FF_T_FAT32' */
 uint32_t ulVolumeID = 0;               /* A pseudo Volume ID */
 
 uint32_t ulSectorsPerFAT = 0;          /* Number of sectors used by a single FAT table */
-uint32_t ulClustersPerFATSector = 0;   /* # of clusters which can be described within a sector (256 or 128) */
+uint32_t ulClustersPerFATSector = 0;   /* # of clusters which can be described within a sector (256 or 128 per 512 bytes) */
 uint32_t ulSectorsPerCluster = 0;      /* Size of a cluster (# of sectors) */
 uint32_t ulUsableDataSectors = 0;      /* Usable data sectors (= SectorCount - (ulHiddenSectors + ulFATReservedSectors)) */
 uint32_t ulUsableDataClusters = 0;     /* equals "ulUsableDataSectors / ulSectorsPerCluster" */
@@ -171,6 +171,8 @@ uint8_t *pucSectorBuffer = 0;
 FF_SPartFound_t xPartitionsFound;
 FF_Part_t *pxMyPartition = 0;
 FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+const uint32_t ulBytesPerSector = pxIOManager->usSectorSize;	/* 512, 1024, 2048 or 4096 */
+const uint32_t ulSectorRatio = ulBytesPerSector / 512;			/* The size of a sector in units of 512 bytes */
 
 	FF_PartitionSearch( pxIOManager, &xPartitionsFound );
 	if( xPartitionNumber >= xPartitionsFound.iCount )
@@ -196,7 +198,9 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 		ucFATType = FF_T_FAT16;
 		iFAT32RootClusters = 0;
 		ulFATReservedSectors = 1u;
-		iFAT16RootSectors = ffconfigFAT16_ROOT_SECTORS; /* 32 sectors to get 512 dir entries */
+		/* ffconfigFAT16_ROOT_SECTORS counts 512-byte sectors: 32 of those hold
+		512 dir entries, whatever the size of the sectors of the disk. */
+		iFAT16RootSectors = ( int32_t ) ( ( ( ffconfigFAT16_ROOT_SECTORS * 512 ) + ulBytesPerSector - 1 ) / ulBytesPerSector );
 	}
 
 	/* Set start sector and length to allow FF_BlockRead/Write */
@@ -213,14 +217,16 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 	if( ucFATType == FF_T_FAT32 )
 	{
 		/* In FAT32, 4 bytes are needed to store the address (LBA) of a cluster.
-		Each FAT sector of 512 bytes can contain 512 / 4 = 128 entries. */
-		ulClustersPerFATSector = 128u;
+		Each FAT sector of 512 bytes can contain 512 / 4 = 128 entries, a
+		sector of 4096 bytes 1024 entries. */
+		ulClustersPerFATSector = ulBytesPerSector / 4u;
 	}
 	else
 	{
 		/* In FAT16, 2 bytes are needed to store the address (LBA) of a cluster.
-		Each FAT sector of 512 bytes can contain 512 / 2 = 256 entries. */
-		ulClustersPerFATSector = 256u;
+		Each FAT sector of 512 bytes can contain 512 / 2 = 256 entries, a
+		sector of 4096 bytes 2048 entries. */
+		ulClustersPerFATSector = ulBytesPerSector / 2u;
 	}
 
 	FF_PRINTF( "FF_Format: Secs %lu Rsvd %lu Hidden %lu Root %lu Data %lu\n",
@@ -289,7 +295,8 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 		}
 	}
 
-	if( ( ucFATType == FF_T_FAT32 ) && ( ulSectorCount >= 0x100000UL ) )	/* Larger than 0.5 GB */
+	if( ( ucFATType == FF_T_FAT32 ) && ( ulSectorCount >= ( 0x100000UL / ulSectorRatio ) ) &&	/* Larger than 0.5 GB */
+		( ulHiddenSectors < ( 8192 / ulSectorRatio ) ) )
 	{
 	uint32_t ulRemaining;
 		/*
@@ -298,14 +305,14 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 		 * See e.g. here:
 		 * http://3gfp.com/wp/2014/07/formatting-sd-cards-for-speed-and-lifetime/
 		 */
-		ulFATReservedSectors = 8192 - ulHiddenSectors;
+		ulFATReservedSectors = ( 8192 / ulSectorRatio ) - ulHiddenSectors;
 		ulNonDataSectors = ulFATReservedSectors + iFAT16RootSectors;
 
-		ulRemaining = (ulNonDataSectors + 2 * ulSectorsPerFAT) % 128;
+		ulRemaining = (ulNonDataSectors + 2 * ulSectorsPerFAT) % ( 128 / ulSectorRatio );
 		if( ulRemaining != 0 )
 		{
-			/* In order to get ClusterBeginLBA well aligned (on a 128 sector boundary) */
-			ulFATReservedSectors += ( 128 - ulRemaining );
+			/* In order to get ClusterBeginLBA well aligned (on a 64 KB boundary) */
+			ulFATReservedSectors += ( ( 128 / ulSectorRatio ) - ulRemaining );
 			ulNonDataSectors = ulFATReservedSectors + iFAT16RootSectors;
 		}
 		ulUsableDataSectors = ulSectorCount - ulNonDataSectors - 2 * ulSectorsPerFAT;
@@ -313,7 +320,7 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 	}
 	ulClusterBeginLBA	= ulHiddenSectors + ulFATReservedSectors + 2 * ulSectorsPerFAT;
 
-	pucSectorBuffer = ( uint8_t * ) ffconfigMALLOC( 512 );
+	pucSectorBuffer = ( uint8_t * ) ffconfigMALLOC( ulBytesPerSector );
 	if( pucSectorBuffer == NULL )
 	{
 		return FF_ERR_NOT_ENOUGH_MEMORY | FF_MODULE_FORMAT;
@@ -321,15 +328,15 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 
 /*  ======================================================================================= */
 
-	memset( pucSectorBuffer, '\0', 512 );
+	memset( pucSectorBuffer, '\0', ulBytesPerSector );
 
 	memcpy( pucSectorBuffer + OFS_BPB_jmpBoot_24, "\xEB\x00\x90" "FreeRTOS", 11 );   /* Includes OFS_BPB_OEMName_64 */
 
-	FF_putShort( pucSectorBuffer, OFS_BPB_BytsPerSec_16, 512 );   /* 0x00B / Only 512, 1024, 2048 or 4096 */
+	FF_putShort( pucSectorBuffer, OFS_BPB_BytsPerSec_16, ( uint16_t ) ulBytesPerSector );   /* 0x00B / Only 512, 1024, 2048 or 4096 */
 	FF_putShort( pucSectorBuffer, OFS_BPB_ResvdSecCnt_16, ( uint32_t ) ulFATReservedSectors ); /*  0x00E / 1 (FAT12/16) or 32 (FAT32) */
 
 	FF_putChar( pucSectorBuffer, OFS_BPB_NumFATs_8, 2);          /* 0x010 / 2 recommended */
-	FF_putShort( pucSectorBuffer, OFS_BPB_RootEntCnt_16, ( uint32_t ) ( iFAT16RootSectors * 512 ) / 32 ); /* 0x011 / 512 (FAT12/16) or 0 (FAT32) */
+	FF_putShort( pucSectorBuffer, OFS_BPB_RootEntCnt_16, ( uint32_t ) ( iFAT16RootSectors * ulBytesPerSector ) / 32 ); /* 0x011 / 512 (FAT12/16) or 0 (FAT32) */
 
 	/* For FAT12 and FAT16 volumes, this field contains the count of 32- */
 	/* byte directory entries in the root directory */
@@ -391,7 +398,7 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 
 		if( ucFATType == FF_T_FAT32 )
 		{
-			memset( pucSectorBuffer, '\0', 512 );
+			memset( pucSectorBuffer, '\0', ulBytesPerSector );
 
 			FF_putLong( pucSectorBuffer, OFS_FSI_32_LeadSig, 0x41615252 );  /* to validate that this is in fact an FSInfo sector. */
 			/* OFS_FSI_32_Reserved1		0x004 / 480 times 0 */
@@ -407,7 +414,7 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 		}
 
 		fatBeginLBA = ulHiddenSectors + ulFATReservedSectors;
-		memset( pucSectorBuffer, '\0', 512 );
+		memset( pucSectorBuffer, '\0', ulBytesPerSector );
 		switch( ucFATType )
 		{
 			case FF_T_FAT16:
@@ -430,7 +437,7 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 		{
 		int32_t addr;
 
-			memset( pucSectorBuffer, '\0', 512 );
+			memset( pucSectorBuffer, '\0', ulBytesPerSector );
 			for( addr = fatBeginLBA+1;
 				 addr < ( fatBeginLBA + ( int32_t ) ulSectorsPerFAT );
 				 addr++ )
@@ -482,7 +489,7 @@ FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
 				FF_BlockWrite( pxIOManager, ( uint32_t ) lAddress, 1, pucSectorBuffer, 0u );
 				if( lAddress == dirBegin )
 				{
-					memset( pucSectorBuffer, '\0', 512 );
+					memset( pucSectorBuffer, '\0', ulBytesPerSector );
 				}
 			}
 		}
@@ -582,7 +589,7 @@ FF_Error_t FF_Partition( FF_Disk_t *pxDisk, FF_PartitionParameters_t *pParams )
 			}
 			ulSummedSizes = 100;
 			break;
-		case eSizeIsSectors:     /* Assign fixed number of sectors (512 byte each) */
+		case eSizeIsSectors:     /* Assign fixed number of sectors (of the size used by the disk) */
 			if( ulSummedSizes > ulAvailable )
 			{
 				return FF_FORMATPARTITION | FF_ERR_IOMAN_BAD_MEMSIZE;
@@ -608,7 +615,7 @@ FF_Error_t FF_Partition( FF_Disk_t *pxDisk, FF_PartitionParameters_t *pParams )
 					case eSizeIsPercent:  /* Assign a percentage of the available space (sum of Sizes must be <= 100) */
 						ulSize = ( uint32_t ) ( ( ( uint64_t ) pParams->xSizes[ xPartitionNumber ] * ulAvailable) / ulSummedSizes );
 						break;
-					case eSizeIsSectors:     /* Assign fixed number of sectors (512 byte each) */
+					case eSizeIsSectors:     /* Assign fixed number of sectors (of the size used by the disk) */
 					default:                  /* Just for the compiler(s) */
 						ulSize = pParams->xSizes[ xPartitionNumber ];
 						break;
@@ -692,7 +699,7 @@ FF_Error_t FF_Partition( FF_Disk_t *pxDisk, FF_PartitionParameters_t *pParams )
 				}
 			}
 			pucBuffer = pxSectorBuffer->pucBuffer;
-			memset ( pucBuffer, 0, 512 );
+			memset ( pucBuffer, 0, pxIOManager->usSectorSize );
 			memcpy ( pucBuffer + OFS_BPB_jmpBoot_24, "\xEB\x00\x90" "FreeRTOS", 11 );   /* Includes OFS_BPB_OEMName_64 */
 
 			ulPartitionOffset = OFS_PTABLE_PART_0;
@@ -726,7 +733,7 @@ FF_Error_t FF_Partition( FF_Disk_t *pxDisk, FF_PartitionParameters_t *pParams )
 		}
 
 		pucBuffer = pxSectorBuffer->pucBuffer;
-		memset (pucBuffer, 0, 512 );
+		memset (pucBuffer, 0, pxIOManager->usSectorSize );
 		memcpy (pucBuffer + OFS_BPB_jmpBoot_24, "\xEB\x00\x90" "FreeRTOS", 11 );   /* Includes OFS_BPB_OEMName_64 */
 		ulPartitionOffset = OFS_PTABLE_PART_0;
 
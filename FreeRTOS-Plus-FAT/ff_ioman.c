@@ -71,6 +71,17 @@ static FF_Error_t FF_GetEfiPartitionEntry( FF_IOManager_t *pxIOManager, uint32_t
 
 static BaseType_t prvHasActiveHandles( FF_IOManager_t *pxIOManager );
 
+#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+	/* Allocate the pool of file handles, see prvAllocFileHandle() in ff_file.c. */
+	static FF_Error_t prvCreateFileHandlePool( FF_IOManager_t *pxIOManager );
+#endif
+
+#if( ffconfigCACHE_MAP_BLOCKS != 0 )
+	/* Point a buffer at a sector in the memory of the disk, or at its own
+	slot in the cache memory when the driver can not map the sector. */
+	static void prvMapBuffer( FF_IOManager_t *pxIOManager, FF_Buffer_t *pxBuffer, uint32_t ulSector );
+#endif
+
 
 /**
  *	@public
@@ -198,6 +209,28 @@ uint32_t usSectorSize = pxParameters->ulSectorSize;
 		}
 	}
 
+	#if( ffconfigBLOCK_QUEUE != 0 )
+	{
+		if( ( FF_isERR( xError ) == pdFALSE ) && ( pxParameters->xUseBlockQueue != pdFALSE ) )
+		{
+			xError = FF_BlockQueueCreate( pxIOManager );
+
+			/* The queue calls the driver one request at a time, so there is
+			no need to hold the semaphore while a sector is read. */
+			pxIOManager->ucFlags |= FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT;
+		}
+	}
+	#endif
+
+	#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+	{
+		if( FF_isERR( xError ) == pdFALSE )
+		{
+			xError = prvCreateFileHandlePool( pxIOManager );
+		}
+	}
+	#endif
+
 	if( FF_isERR( xError ) )
 	{
 		if( pxIOManager != NULL )
@@ -216,6 +249,44 @@ uint32_t usSectorSize = pxParameters->ulSectorSize;
 }	/* FF_CreateIOManger() */
 /*-----------------------------------------------------------*/
 
+#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+	static FF_Error_t prvCreateFileHandlePool( FF_IOManager_t *pxIOManager )
+	{
+	FF_Error_t xError = FF_ERR_NONE;
+	FF_FILE *pxHandles;
+	size_t uxSize = sizeof( FF_FILE ) * ffconfigFILE_HANDLE_POOL_SIZE;
+	BaseType_t xIndex;
+
+		#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+		{
+			/* The sector buffers of the handles follow the array. */
+			uxSize += ( size_t ) pxIOManager->usSectorSize * ffconfigFILE_HANDLE_POOL_SIZE;
+		}
+		#endif
+
+		pxHandles = ( FF_FILE * ) ffconfigMALLOC( uxSize );
+		if( pxHandles == NULL )
+		{
+			xError = FF_ERR_NOT_ENOUGH_MEMORY | FF_CREATEIOMAN;
+		}
+		else
+		{
+			memset( pxHandles, '\0', uxSize );
+			pxIOManager->pvFileHandlePool = pxHandles;
+
+			/* Put all handles on the free list, the first one at the head. */
+			for( xIndex = ffconfigFILE_HANDLE_POOL_SIZE - 1; xIndex >= 0; xIndex-- )
+			{
+				pxHandles[ xIndex ].pxNext = ( FF_FILE * ) pxIOManager->pvFreeFileHandles;
+				pxIOManager->pvFreeFileHandles = &( pxHandles[ xIndex ] );
+			}
+		}
+
+		return xError;
+	}	/* prvCreateFileHandlePool() */
+	/*-----------------------------------------------------------*/
+#endif /* ffconfigFILE_HANDLE_POOL_SIZE */
+
 /**
  *	@public
  *	@brief	Destroys an FF_IOManager_t object, and frees all assigned memory.
@@ -250,6 +321,21 @@ FF_Error_t xError;
 			ffconfigFREE( pxIOManager->pucCacheMem );
 		}
 
+		#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+		{
+			if( pxIOManager->pvFileHandlePool != NULL )
+			{
+				ffconfigFREE( pxIOManager->pvFileHandlePool );
+			}
+		}
+		#endif
+
+		#if( ffconfigBLOCK_QUEUE != 0 )
+		{
+			FF_BlockQueueDelete( pxIOManager );
+		}
+		#endif
+
 		/* Delete the event group object within the IO manager before deleting
 		the manager. */
 		FF_DeleteEvents( pxIOManager );
@@ -315,8 +401,12 @@ FF_Error_t xError;
 				/* If a buffers has no users and if it has been modified... */
 				if( ( pxIOManager->pxBuffers[ xIndex ].usNumHandles == 0 ) && ( pxIOManager->pxBuffers[ xIndex ].bModified == pdTRUE ) )
 				{
-					/* The buffer may be flushed to disk. */
-					FF_BlockWrite( pxIOManager, pxIOManager->pxBuffers[ xIndex ].ulSector, 1, pxIOManager->pxBuffers[ xIndex ].pucBuffer, pdTRUE );
+					/* The buffer may be flushed to disk.  A mapped buffer is
+					the sector itself, it needs no writing. */
+					if( pxIOManager->pxBuffers[ xIndex ].bMapped == pdFALSE )
+					{
+						FF_BlockWrite( pxIOManager, pxIOManager->pxBuffers[ xIndex ].ulSector, 1, pxIOManager->pxBuffers[ xIndex ].pucBuffer, pdTRUE );
+					}
 
 					/* Buffer has now been flushed, mark it as a read buffer and unmodified. */
 					pxIOManager->pxBuffers[ xIndex ].ucMode = FF_MODE_READ;
@@ -341,7 +431,19 @@ FF_Error_t xError;
 		{
 			/* Let the low-level driver also flush data.
 			See comments in ff_ioman.h. */
+			#if( ffconfigBLOCK_QUEUE != 0 )
+			{
+				/* The semaphore does not keep the block queue from calling
+				the driver. */
+				FF_BlockQueueLockDriver( pxIOManager );
+			}
+			#endif
 			pxIOManager->xBlkDevice.pxDisk->fnFlushApplicationHook( pxIOManager->xBlkDevice.pxDisk );
+			#if( ffconfigBLOCK_QUEUE != 0 )
+			{
+				FF_BlockQueueUnlockDriver( pxIOManager );
+			}
+			#endif
 		}
 
 		FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
@@ -389,6 +491,19 @@ const FF_Buffer_t *pxLastBuffer = &( pxIOManager->pxBuffers[ pxIOManager->usCach
 			}
 		}
 
+		#if( ffconfigCONCURRENT_READS != 0 )
+		{
+			if( ( pxMatchingBuffer != NULL ) && ( pxMatchingBuffer->bLoading != pdFALSE ) )
+			{
+				/* Another task is still reading this sector from the disk. */
+				pxMatchingBuffer = NULL;
+				FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+				FF_BufferWait( pxIOManager, FF_GETBUFFER_SLEEP_TIME_MS );
+				continue;
+			}
+		}
+		#endif
+
 		if( pxMatchingBuffer != NULL )
 		{
 			/* A Match was found process! */
@@ -442,7 +557,7 @@ const FF_Buffer_t *pxLastBuffer = &( pxIOManager->pxBuffers[ pxIOManager->usCach
 			if( pxRLUBuffer != NULL )
 			{
 				/* Process the suitable candidate. */
-				if( pxRLUBuffer->bModified == pdTRUE )
+				if( ( pxRLUBuffer->bModified == pdTRUE ) && ( pxRLUBuffer->bMapped == pdFALSE ) )
 				{
 					/* Along with the pdTRUE parameter to indicate semaphore has been claimed already. */
 					lRetVal = FF_BlockWrite( pxIOManager, pxRLUBuffer->ulSector, 1, pxRLUBuffer->pucBuffer, pdTRUE );
@@ -453,10 +568,51 @@ const FF_Buffer_t *pxLastBuffer = &( pxIOManager->pxBuffers[ pxIOManager->usCach
 					}
 				}
 
+				#if( ffconfigCACHE_MAP_BLOCKS != 0 )
+				{
+					prvMapBuffer( pxIOManager, pxRLUBuffer, ulSector );
+				}
+				#endif
+
 				if( ucMode == FF_MODE_WR_ONLY )
 				{
 					memset( pxRLUBuffer->pucBuffer, '\0', pxIOManager->usSectorSize );
 				}
+				else if( pxRLUBuffer->bMapped != pdFALSE )
+				{
+					/* The buffer is the sector itself, there is nothing to read. */
+				}
+				#if( ffconfigCONCURRENT_READS != 0 )
+				else if( ( pxIOManager->ucFlags & FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT ) != 0 )
+				{
+					/* Claim the buffer and read the sector without holding the
+					semaphore, so that other tasks can use the cache meanwhile.
+					Tasks that look for the same sector will wait for 'bLoading'
+					to be cleared. */
+					pxRLUBuffer->ucMode = ( ucMode & FF_MODE_RD_WR );
+					pxRLUBuffer->usNumHandles = 1;
+					pxRLUBuffer->ulSector = ulSector;
+					pxRLUBuffer->bModified = pdFALSE;
+					pxRLUBuffer->bValid = pdTRUE;
+					pxRLUBuffer->bLoading = pdTRUE;
+
+					FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+					lRetVal = FF_BlockRead( pxIOManager, ulSector, 1, pxRLUBuffer->pucBuffer, pdFALSE );
+					FF_PendSemaphore( pxIOManager->pvSemaphore );
+
+					pxRLUBuffer->bLoading = pdFALSE;
+					/* Wake up the tasks that wait for this sector. */
+					FF_BufferProceed( pxIOManager );
+
+					if( lRetVal < 0 )
+					{
+						pxRLUBuffer->bValid = pdFALSE;
+						pxRLUBuffer->usNumHandles = 0;
+						/* 'pxMatchingBuffer' is NULL. */
+						break;
+					}
+				}
+				#endif /* ffconfigCONCURRENT_READS */
 				else
 				{
 					lRetVal = FF_BlockRead( pxIOManager, ulSector, 1, pxRLUBuffer->pucBuffer, pdTRUE );
@@ -500,6 +656,33 @@ const FF_Buffer_t *pxLastBuffer = &( pxIOManager->pxBuffers[ pxIOManager->usCach
 }	/* FF_GetBuffer() */
 /*-----------------------------------------------------------*/
 
+#if( ffconfigCACHE_MAP_BLOCKS != 0 )
+	static void prvMapBuffer( FF_IOManager_t *pxIOManager, FF_Buffer_t *pxBuffer, uint32_t ulSector )
+	{
+	FF_Disk_t *pxDisk = pxIOManager->xBlkDevice.pxDisk;
+	uint8_t *pucSector = NULL;
+
+		if( ( pxDisk != NULL ) && ( pxDisk->fnMapBlocks != NULL ) )
+		{
+			pucSector = pxDisk->fnMapBlocks( pxDisk, ulSector, 1 );
+		}
+
+		if( pucSector != NULL )
+		{
+			pxBuffer->pucBuffer = pucSector;
+			pxBuffer->bMapped = pdTRUE;
+		}
+		else
+		{
+			/* Same as FF_IOMAN_InitBufferDescriptors(). */
+			pxBuffer->pucBuffer = pxIOManager->pucCacheMem +
+				( ( size_t ) ( pxBuffer - pxIOManager->pxBuffers ) * pxIOManager->usSectorSize );
+			pxBuffer->bMapped = pdFALSE;
+		}
+	}	/* prvMapBuffer() */
+	/*-----------------------------------------------------------*/
+#endif /* ffconfigCACHE_MAP_BLOCKS */
+
 /**
  *	@private
  *	@brief	Releases a buffer resource.
@@ -516,7 +699,7 @@ FF_Error_t FF_ReleaseBuffer( FF_IOManager_t *pxIOManager, FF_Buffer_t *pxBuffer
 	FF_PendSemaphore( pxIOManager->pvSemaphore );
 	{
 #if( ffconfigCACHE_WRITE_THROUGH != 0 )
-		if( pxBuffer->bModified == pdTRUE )
+		if( ( pxBuffer->bModified == pdTRUE ) && ( pxBuffer->bMapped == pdFALSE ) )
 		{
 			xError = FF_BlockWrite( pxIOManager, pxBuffer->ulSector, 1, pxBuffer->pucBuffer, pdTRUE );
 			if( FF_isERR( xError ) == pdFALSE )
@@ -563,6 +746,14 @@ int32_t slRetVal = 0;
 		}
 	}
 
+	#if( ffconfigBLOCK_QUEUE != 0 )
+	if( ( slRetVal == 0ul ) && ( pxIOManager->pxBlockQueue != NULL ) && ( pxIOManager->xBlkDevice.fnpReadBlocks != NULL ) )
+	{
+		/* The queue serialises the calls to the driver. */
+		slRetVal = FF_BlockQueueTransfer( pxIOManager, ulSectorLBA, ulNumSectors, ( uint8_t * ) pxBuffer, pdFALSE );
+	}
+	else
+	#endif
 	if( ( slRetVal == 0ul ) && ( pxIOManager->xBlkDevice.fnpReadBlocks != NULL ) )
 	{
 		do
@@ -610,6 +801,14 @@ int32_t slRetVal = 0;
 		}
 	}
 
+	#if( ffconfigBLOCK_QUEUE != 0 )
+	if( ( slRetVal == 0ul ) && ( pxIOManager->pxBlockQueue != NULL ) && ( pxIOManager->xBlkDevice.fnpWriteBlocks != NULL ) )
+	{
+		/* The queue serialises the calls to the driver. */
+		slRetVal = FF_BlockQueueTransfer( pxIOManager, ulSectorLBA, ulNumSectors, ( uint8_t * ) pxBuffer, pdTRUE );
+	}
+	else
+	#endif
 	if( ( slRetVal == 0ul ) && ( pxIOManager->xBlkDevice.fnpWriteBlocks != NULL ) )
 	{
 		do
@@ -1346,13 +1545,22 @@ partsFound.iCount = 0;
 			}
 		}
 		#endif
+		#if( ffconfigDIRENT_HINT_CACHE != 0 )
+		{
+			/* Hints from a previous volume are meaningless. */
+			memset( pxIOManager->xDirentHints, '\0', sizeof( pxIOManager->xDirentHints ) );
+			pxIOManager->ulDirentHintAge = 0;
+		}
+		#endif
 		#if( ffconfigPATH_CACHE != 0 )
 		{
 			memset( pxPartition->pxPathCache, '\0', sizeof( pxPartition->pxPathCache ) );
 		}
 		#endif
 		FF_IOMAN_InitBufferDescriptors( pxIOManager );
-		pxIOManager->FirstFile = 0;
+		FF_ResetOpenFiles( pxIOManager );
+		/* Handles that were open on a previous mount are no longer valid. */
+		pxIOManager->ulMountGeneration++;
 
 		xPartitionCount = FF_PartitionSearch( pxIOManager, &partsFound );
 		if( FF_isERR( xPartitionCount ) )
@@ -1603,7 +1811,7 @@ FF_IOManager_t *pxIOManager;
 				/* Active handles found on the cache. */
 				xError = FF_ERR_IOMAN_ACTIVE_HANDLES | FF_UNMOUNT;
 			}
-			else if( pxIOManager->FirstFile != NULL )
+			else if( pxIOManager->uxOpenFiles != 0u )
 			{
 				/* Open files in this partition. */
 				xError = FF_ERR_IOMAN_ACTIVE_HANDLES | FF_UNMOUNT;
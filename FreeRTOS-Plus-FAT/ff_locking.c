@@ -57,6 +57,9 @@ The masks below are used when calling Group Event functions. */
 each time when a sector buffer is released. */
 #define FF_BUF_LOCK_EVENT_BITS    ( ( const EventBits_t ) FF_BUF_LOCK )
 
+/* Set by the last task that releases a read lock on the FAT. */
+#define FF_FAT_READ_LOCK_EVENT_BITS    ( ( const EventBits_t ) FF_FAT_READ_LOCK )
+
 /*-----------------------------------------------------------*/
 
 BaseType_t FF_TrySemaphore( void *pxSemaphore, uint32_t ulTime_ms )
@@ -110,12 +113,40 @@ void FF_Sleep( uint32_t ulTime_ms )
 }
 /*-----------------------------------------------------------*/
 
+void *FF_CreateSemaphore( void )
+{
+	return ( void * ) xSemaphoreCreateRecursiveMutex();
+}
+/*-----------------------------------------------------------*/
+
+void FF_DeleteSemaphore( void *pxSemaphore )
+{
+	if( pxSemaphore != NULL )
+	{
+		vSemaphoreDelete( ( SemaphoreHandle_t ) pxSemaphore );
+	}
+}
+/*-----------------------------------------------------------*/
+
 void FF_DeleteEvents( FF_IOManager_t *pxIOManager )
 {
 	if( pxIOManager->xEventGroup != NULL )
 	{
 		vEventGroupDelete( pxIOManager->xEventGroup );
 	}
+	#if( ffconfigDIRECTORY_LOCKS != 0 )
+	{
+	BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < ffconfigDIRECTORY_LOCK_DEPTH; xIndex++ )
+		{
+			if( pxIOManager->xDirLocks[ xIndex ].pvMutex != NULL )
+			{
+				vSemaphoreDelete( ( SemaphoreHandle_t ) pxIOManager->xDirLocks[ xIndex ].pvMutex );
+			}
+		}
+	}
+	#endif /* ffconfigDIRECTORY_LOCKS */
 }
 /*-----------------------------------------------------------*/
 
@@ -135,14 +166,109 @@ BaseType_t xResult;
 		xResult = pdFALSE;
 	}
 
+	#if( ffconfigDIRECTORY_LOCKS != 0 )
+	{
+	BaseType_t xIndex;
+
+		for( xIndex = 0; ( xResult != pdFALSE ) && ( xIndex < ffconfigDIRECTORY_LOCK_DEPTH ); xIndex++ )
+		{
+			pxIOManager->xDirLocks[ xIndex ].pvMutex = ( void * ) xSemaphoreCreateRecursiveMutex();
+			if( pxIOManager->xDirLocks[ xIndex ].pvMutex == NULL )
+			{
+				/* The caller will call FF_DeleteEvents() to clean up. */
+				xResult = pdFALSE;
+			}
+		}
+	}
+	#endif /* ffconfigDIRECTORY_LOCKS */
+
 	return xResult;
 }
 /*-----------------------------------------------------------*/
 
-void FF_LockDirectory( FF_IOManager_t *pxIOManager )
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	/* Find the slot that is bound to 'ulDirCluster', or bind a free slot to it.
+	Returns NULL when all slots are in use by other directories.  Must be called
+	from a critical section. */
+	static FF_DirLock_t *prvClaimDirLock( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster )
+	{
+	FF_DirLock_t *pxLock = pxIOManager->xDirLocks;
+	FF_DirLock_t *pxLast = pxIOManager->xDirLocks + ffconfigDIRECTORY_LOCK_DEPTH;
+	FF_DirLock_t *pxFree = NULL;
+
+		for( ; pxLock < pxLast; pxLock++ )
+		{
+			if( pxLock->uxUsers == 0u )
+			{
+				if( pxFree == NULL )
+				{
+					pxFree = pxLock;
+				}
+			}
+			else if( pxLock->ulDirCluster == ulDirCluster )
+			{
+				break;
+			}
+		}
+
+		if( pxLock == pxLast )
+		{
+			pxLock = pxFree;
+			if( pxLock != NULL )
+			{
+				pxLock->ulDirCluster = ulDirCluster;
+			}
+		}
+
+		if( pxLock != NULL )
+		{
+			pxLock->uxUsers++;
+		}
+
+		return pxLock;
+	}
+#endif /* ffconfigDIRECTORY_LOCKS */
+/*-----------------------------------------------------------*/
+
+void FF_LockDirectory( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster )
 {
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	FF_DirLock_t *pxLock;
+
+	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+	{
+		/* Scheduler not yet active. */
+		return;
+	}
+	for( ;; )
+	{
+		taskENTER_CRITICAL();
+		{
+			pxLock = prvClaimDirLock( pxIOManager, ulDirCluster );
+		}
+		taskEXIT_CRITICAL();
+
+		if( pxLock != NULL )
+		{
+			break;
+		}
+		/* All slots are bound to other directories.  Wait until a slot is
+		released, the time-out is only a safety net. */
+		xEventGroupWaitBits( pxIOManager->xEventGroup,
+			FF_DIR_LOCK_EVENT_BITS, /* uxBitsToWaitFor */
+			FF_DIR_LOCK_EVENT_BITS, /* xClearOnExit */
+			pdFALSE,                /* xWaitForAllBits n.a. */
+			pdMS_TO_TICKS( 100UL ) );
+	}
+
+	/* Tasks that change other directories are not blocked.  A task of
+	higher priority that waits here will lend its priority to the owner. */
+	xSemaphoreTakeRecursive( ( SemaphoreHandle_t ) pxLock->pvMutex, portMAX_DELAY );
+#else
 	EventBits_t xBits;
 
+	( void ) ulDirCluster;
+
 	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
 	{
 		/* Scheduler not yet active. */
@@ -169,11 +295,111 @@ void FF_LockDirectory( FF_IOManager_t *pxIOManager )
 			break;
 		}
 	}
+#endif /* ffconfigDIRECTORY_LOCKS */
+}
+/*-----------------------------------------------------------*/
+
+void FF_LockDirectoryPair( FF_IOManager_t *pxIOManager, uint32_t ulParentCluster, uint32_t ulDirCluster )
+{
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	FF_DirLock_t *pxParent;
+	FF_DirLock_t *pxDir = NULL;
+
+	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+	{
+		/* Scheduler not yet active. */
+		return;
+	}
+	for( ;; )
+	{
+		/* Both slots or none, so a task never waits for a slot while it holds
+		one. */
+		taskENTER_CRITICAL();
+		{
+			pxParent = prvClaimDirLock( pxIOManager, ulParentCluster );
+			if( pxParent != NULL )
+			{
+				pxDir = prvClaimDirLock( pxIOManager, ulDirCluster );
+				if( pxDir == NULL )
+				{
+					pxParent->uxUsers--;
+					pxParent = NULL;
+				}
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		if( pxParent != NULL )
+		{
+			break;
+		}
+		xEventGroupWaitBits( pxIOManager->xEventGroup,
+			FF_DIR_LOCK_EVENT_BITS, /* uxBitsToWaitFor */
+			FF_DIR_LOCK_EVENT_BITS, /* xClearOnExit */
+			pdFALSE,                /* xWaitForAllBits n.a. */
+			pdMS_TO_TICKS( 100UL ) );
+	}
+
+	/* The parent always comes first.  Only this function takes two directory
+	locks, and a task that holds a lock on a directory only waits for one of
+	its subdirectories, so the tasks can not wait for each other in a
+	circle. */
+	xSemaphoreTakeRecursive( ( SemaphoreHandle_t ) pxParent->pvMutex, portMAX_DELAY );
+	xSemaphoreTakeRecursive( ( SemaphoreHandle_t ) pxDir->pvMutex, portMAX_DELAY );
+#else
+	/* The lock covers all directories. */
+	( void ) ulDirCluster;
+	FF_LockDirectory( pxIOManager, ulParentCluster );
+#endif /* ffconfigDIRECTORY_LOCKS */
 }
 /*-----------------------------------------------------------*/
 
-void FF_UnlockDirectory( FF_IOManager_t *pxIOManager )
+void FF_UnlockDirectory( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster )
 {
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	FF_DirLock_t *pxLock = pxIOManager->xDirLocks;
+	FF_DirLock_t *pxLast = pxIOManager->xDirLocks + ffconfigDIRECTORY_LOCK_DEPTH;
+	BaseType_t xReleased = pdFALSE;
+	BaseType_t xGiven;
+
+	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+	{
+		/* Scheduler not yet active. */
+		return;
+	}
+	/* The slot can not be re-bound while this task is one of its users. */
+	for( ; pxLock < pxLast; pxLock++ )
+	{
+		if( ( pxLock->uxUsers != 0u ) && ( pxLock->ulDirCluster == ulDirCluster ) )
+		{
+			break;
+		}
+	}
+	configASSERT( pxLock < pxLast );
+
+	/* Giving fails if this task is not the owner. */
+	xGiven = xSemaphoreGiveRecursive( ( SemaphoreHandle_t ) pxLock->pvMutex );
+	configASSERT( xGiven != pdFALSE );
+	( void ) xGiven;
+
+	taskENTER_CRITICAL();
+	{
+		pxLock->uxUsers--;
+		if( pxLock->uxUsers == 0u )
+		{
+			xReleased = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xReleased != pdFALSE )
+	{
+		/* Wake-up the tasks that are waiting for a free slot. */
+		xEventGroupSetBits( pxIOManager->xEventGroup, FF_DIR_LOCK_EVENT_BITS );
+	}
+#else
+	( void ) ulDirCluster;
+
 	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
 	{
 		/* Scheduler not yet active. */
@@ -181,6 +407,19 @@ void FF_UnlockDirectory( FF_IOManager_t *pxIOManager )
 	}
 	configASSERT( ( xEventGroupGetBits( pxIOManager->xEventGroup ) & FF_DIR_LOCK_EVENT_BITS ) == 0 );
 	xEventGroupSetBits( pxIOManager->xEventGroup, FF_DIR_LOCK_EVENT_BITS );
+#endif /* ffconfigDIRECTORY_LOCKS */
+}
+/*-----------------------------------------------------------*/
+
+void FF_UnlockDirectoryPair( FF_IOManager_t *pxIOManager, uint32_t ulParentCluster, uint32_t ulDirCluster )
+{
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	FF_UnlockDirectory( pxIOManager, ulDirCluster );
+	FF_UnlockDirectory( pxIOManager, ulParentCluster );
+#else
+	( void ) ulDirCluster;
+	FF_UnlockDirectory( pxIOManager, ulParentCluster );
+#endif /* ffconfigDIRECTORY_LOCKS */
 }
 /*-----------------------------------------------------------*/
 
@@ -225,7 +464,16 @@ void FF_Assert_Lock( FF_IOManager_t *pxIOManager, uint32_t aBits )
 
 	if( ( aBits & FF_FAT_LOCK_EVENT_BITS ) != 0 )
 	{
-		configASSERT( ( pxIOManager->pvFATLockHandle != NULL ) && ( pxIOManager->pvFATLockHandle == handle ) );
+		#if( ffconfigCONCURRENT_READS != 0 )
+		{
+			/* Readers are not registered by task, any reader will do. */
+			configASSERT( ( pxIOManager->pvFATLockHandle == handle ) || ( pxIOManager->uxFATReaders != 0u ) );
+		}
+		#else
+		{
+			configASSERT( ( pxIOManager->pvFATLockHandle != NULL ) && ( pxIOManager->pvFATLockHandle == handle ) );
+		}
+		#endif
 
 		/* In case configASSERT() is not defined. */
 		( void ) pxIOManager;
@@ -233,17 +481,11 @@ void FF_Assert_Lock( FF_IOManager_t *pxIOManager, uint32_t aBits )
 	}
 }
 
-void FF_LockFAT( FF_IOManager_t *pxIOManager )
+/* Wait until the FAT lock bit is high, and clear it. */
+static void prvTakeFATBit( FF_IOManager_t *pxIOManager )
 {
 EventBits_t xBits;
 
-	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
-	{
-		/* Scheduler not yet active. */
-		return;
-	}
-	configASSERT( FF_Has_Lock( pxIOManager, FF_FAT_LOCK ) == pdFALSE );
-
 	for( ;; )
 	{
 		/* Called when a task want to make changes to the FAT area.
@@ -262,13 +504,93 @@ EventBits_t xBits;
 		{
 			/* This task has cleared the desired bit.
 			It now 'owns' the resource. */
-			pxIOManager->pvFATLockHandle = xTaskGetCurrentTaskHandle();
 			break;
 		}
 	}
 }
 /*-----------------------------------------------------------*/
 
+void FF_LockFAT( FF_IOManager_t *pxIOManager )
+{
+	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+	{
+		/* Scheduler not yet active. */
+		return;
+	}
+	configASSERT( FF_Has_Lock( pxIOManager, FF_FAT_LOCK ) == pdFALSE );
+
+	prvTakeFATBit( pxIOManager );
+
+	#if( ffconfigCONCURRENT_READS != 0 )
+	{
+		/* Holding the bit keeps new readers out.  Now wait for the readers that
+		are still walking a chain. */
+		while( pxIOManager->uxFATReaders != 0u )
+		{
+			xEventGroupWaitBits( pxIOManager->xEventGroup,
+				FF_FAT_READ_LOCK_EVENT_BITS, /* uxBitsToWaitFor */
+				FF_FAT_READ_LOCK_EVENT_BITS, /* xClearOnExit */
+				pdFALSE,                     /* xWaitForAllBits n.a. */
+				pdMS_TO_TICKS( 10000UL ) );
+		}
+	}
+	#endif
+
+	pxIOManager->pvFATLockHandle = xTaskGetCurrentTaskHandle();
+}
+/*-----------------------------------------------------------*/
+
+#if( ffconfigCONCURRENT_READS != 0 )
+	void FF_LockFATRead( FF_IOManager_t *pxIOManager )
+	{
+		if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+		{
+			/* Scheduler not yet active. */
+			return;
+		}
+		configASSERT( FF_Has_Lock( pxIOManager, FF_FAT_LOCK ) == pdFALSE );
+
+		/* The bit is only held for as long as it takes to register, so that a
+		reader waits for a writer but not for other readers. */
+		prvTakeFATBit( pxIOManager );
+		taskENTER_CRITICAL();
+		{
+			pxIOManager->uxFATReaders++;
+		}
+		taskEXIT_CRITICAL();
+		xEventGroupSetBits( pxIOManager->xEventGroup, FF_FAT_LOCK_EVENT_BITS );
+	}
+	/*-----------------------------------------------------------*/
+
+	void FF_UnlockFATRead( FF_IOManager_t *pxIOManager )
+	{
+	BaseType_t xLast = pdFALSE;
+
+		if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
+		{
+			/* Scheduler not yet active. */
+			return;
+		}
+		taskENTER_CRITICAL();
+		{
+			configASSERT( pxIOManager->uxFATReaders != 0u );
+			pxIOManager->uxFATReaders--;
+			if( pxIOManager->uxFATReaders == 0u )
+			{
+				xLast = pdTRUE;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		if( xLast != pdFALSE )
+		{
+			/* Wake-up a writer that waits in FF_LockFAT(). */
+			xEventGroupSetBits( pxIOManager->xEventGroup, FF_FAT_READ_LOCK_EVENT_BITS );
+		}
+	}
+	/*-----------------------------------------------------------*/
+#endif /* ffconfigCONCURRENT_READS */
+
 void FF_UnlockFAT( FF_IOManager_t *pxIOManager )
 {
 	if( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING )
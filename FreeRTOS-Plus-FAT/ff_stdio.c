@@ -60,6 +60,15 @@ in a call to ff_truncate(). */
 /* The directory entries '.' and '..' will show a file size of 1 KB. */
 #define stdioDOT_ENTRY_FILE_SIZE			1024
 
+/* The position in a file as seen by the caller, which differs from the handle's
+position while the stream buffer holds data that was read ahead (ulStdioCount),
+or data that is not written yet (ulStdioIndex without ulStdioCount). */
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	#define stdioPOSITION( pxStream )	( ( pxStream )->ulFilePointer + ( pxStream )->ulStdioIndex - ( pxStream )->ulStdioCount )
+#else
+	#define stdioPOSITION( pxStream )	( ( pxStream )->ulFilePointer )
+#endif
+
 /*-----------------------------------------------------------*/
 
 #if( ffconfigHAS_CWD == 1 )
@@ -135,6 +144,50 @@ int prvFFErrorToErrno( FF_Error_t xError );
 	static uint32_t prvFileTime( FF_SystemTime_t *pxTime );
 #endif
 
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	/*
+	 * Returns pdTRUE when pxStream is a valid handle that has a stream buffer.
+	 * A handle that was closed already may have been freed, so its fields are
+	 * only read when it is the handle that FF_CheckValid() accepted last, or
+	 * after FF_CheckValid() accepted it now.
+	 */
+	static BaseType_t prvStdioBuffered( FF_FILE *pxStream );
+
+	/*
+	 * Write out the data in the stream buffer, or give back the data that was
+	 * read ahead, so that the position of the handle is the position that the
+	 * caller sees.  Called before any access that does not use the buffer.
+	 * Returns the error of FF_CheckValid() for an invalid handle.
+	 */
+	static FF_Error_t prvStdioSync( FF_FILE *pxStream );
+
+	/*
+	 * Read ahead into the stream buffer.  Returns the number of bytes read or
+	 * an error code, which is FF_ERR_FILE_READ_ZERO at the end of the file.
+	 */
+	static int32_t prvStdioFill( FF_FILE *pxStream );
+
+	/*
+	 * Make the stream buffer ready to receive data to be written.
+	 */
+	static FF_Error_t prvStdioStartWrite( FF_FILE *pxStream );
+
+	/*
+	 * FF_GetLine() working on the stream buffer.
+	 */
+	static int32_t prvStdioGetLine( FF_FILE *pxStream, char *pcLine, uint32_t ulLimit );
+
+	#if( ffconfigFPRINTF_SUPPORT == 1 )
+		/*
+		 * Format text straight into the stream buffer.
+		 */
+		static int prvStdioPrintf( FF_FILE *pxStream, const char *pcFormat, va_list xArgs );
+	#endif
+#else
+	/* Without stream buffers there is nothing to synchronise. */
+	#define prvStdioSync( pxStream )	( FF_ERR_NONE )
+#endif
+
 /*-----------------------------------------------------------*/
 
 FF_FILE *ff_fopen( const char *pcFile, const char *pcMode )
@@ -187,7 +240,7 @@ uint8_t ucMode;
 
 int ff_fclose( FF_FILE *pxStream )
 {
-FF_Error_t xError;
+FF_Error_t xError, xSyncError;
 int iReturn, ff_errno;
 
 	#if( ffconfigDEV_SUPPORT != 0 )
@@ -202,7 +255,15 @@ int iReturn, ff_errno;
 	}
 	#endif
 
+	/* Write out the data that is still in the stream buffer.  A handle that
+	was closed already is refused by both calls. */
+	xSyncError = prvStdioSync( pxStream );
+
 	xError = FF_Close( pxStream );
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		xError = xSyncError;
+	}
 	ff_errno = prvFFErrorToErrno( xError );
 
 	if( ff_errno == 0 )
@@ -227,13 +288,19 @@ int ff_fseek( FF_FILE *pxStream, long lOffset, int iWhence )
 FF_Error_t xError;
 int iReturn, ff_errno;
 
+	xError = prvStdioSync( pxStream );
+
+	if( FF_isERR( xError ) != pdFALSE )
+	{
+		/* The stream buffer could not be written out. */
+	}
 #if( ffconfigDEV_SUPPORT != 0 )
-	if( pxStream->pxDevNode != NULL )
+	else if( pxStream->pxDevNode != NULL )
 	{
 		xError = FF_Device_Seek( pxStream, lOffset, iWhence );
 	}
-	else
 #endif
+	else
 	{
 		xError = FF_Seek( pxStream, lOffset, iWhence );
 	}
@@ -282,7 +349,7 @@ long ff_ftell( FF_FILE *pxStream )
 {
 long lResult;
 
-	if( pxStream == NULL )
+	if( FF_isERR( FF_CheckValid( pxStream ) ) != pdFALSE )
 	{
 		/* Store the errno to thread local storage. */
 		stdioSET_ERRNO( pdFREERTOS_ERRNO_EBADF );
@@ -292,7 +359,7 @@ long lResult;
 	}
 	else
 	{
-		lResult = ( long ) pxStream->ulFilePointer;
+		lResult = ( long ) stdioPOSITION( pxStream );
 	}
 
 	return lResult;
@@ -309,7 +376,7 @@ FF_Error_t xError;
 	{
 		/* Store the errno to thread local storage. */
 		stdioSET_ERRNO( 0 );
-		if( pxStream->ulFilePointer >= pxStream->ulFileSize )
+		if( stdioPOSITION( pxStream ) >= pxStream->ulFileSize )
 		{
 			iResult = pdTRUE;
 		}
@@ -337,13 +404,19 @@ int32_t iReturned;
 size_t xReturn;
 int ff_errno;
 
+	iReturned = prvStdioSync( pxStream );
+
+	if( FF_isERR( iReturned ) != pdFALSE )
+	{
+		/* The stream buffer could not be written out. */
+	}
 #if( ffconfigDEV_SUPPORT != 0 )
-	if( pxStream->pxDevNode != NULL )
+	else if( pxStream->pxDevNode != NULL )
 	{
 		iReturned = FF_Device_Read( pvBuffer, xSize, xItems, pxStream );
 	}
-	else
 #endif
+	else
 	{
 		iReturned = FF_Read( pxStream, xSize, xItems, (uint8_t *)pvBuffer );
 	}
@@ -365,159 +438,810 @@ int ff_errno;
 	/* Store the errno to thread local storage. */
 	stdioSET_ERRNO( ff_errno );
 
-	return xReturn;
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+int32_t ff_readv( FF_FILE *pxStream, const FF_IOVec_t *pxVector, int iCount )
+{
+int32_t iReturned;
+int ff_errno;
+
+	iReturned = prvStdioSync( pxStream );
+
+	if( FF_isERR( iReturned ) != pdFALSE )
+	{
+		/* The stream buffer could not be written out. */
+	}
+#if( ffconfigDEV_SUPPORT != 0 )
+	else if( pxStream->pxDevNode != NULL )
+	{
+	int iIndex;
+
+		iReturned = 0;
+		for( iIndex = 0; iIndex < iCount; iIndex++ )
+		{
+			iReturned += ( int32_t ) FF_Device_Read( pxVector[ iIndex ].pvBuffer, 1, pxVector[ iIndex ].ulLength, pxStream );
+		}
+	}
+#endif
+	else
+	{
+		iReturned = FF_ReadV( pxStream, pxVector, ( BaseType_t ) iCount );
+	}
+
+	ff_errno = prvFFErrorToErrno( iReturned );
+
+	if( ff_errno != pdFREERTOS_ERRNO_NONE )
+	{
+		iReturned = -1;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iReturned;
+}
+/*-----------------------------------------------------------*/
+
+int32_t ff_writev( FF_FILE *pxStream, const FF_IOVec_t *pxVector, int iCount )
+{
+int32_t iReturned;
+int ff_errno;
+
+	iReturned = prvStdioSync( pxStream );
+
+	if( FF_isERR( iReturned ) != pdFALSE )
+	{
+		/* The stream buffer could not be written out. */
+	}
+#if( ffconfigDEV_SUPPORT != 0 )
+	else if( pxStream->pxDevNode != NULL )
+	{
+	int iIndex;
+
+		iReturned = 0;
+		for( iIndex = 0; iIndex < iCount; iIndex++ )
+		{
+			iReturned += ( int32_t ) FF_Device_Write( pxVector[ iIndex ].pvBuffer, 1, pxVector[ iIndex ].ulLength, pxStream );
+		}
+	}
+#endif
+	else
+	{
+		iReturned = FF_WriteV( pxStream, pxVector, ( BaseType_t ) iCount );
+	}
+
+	ff_errno = prvFFErrorToErrno( iReturned );
+
+	if( ff_errno != pdFREERTOS_ERRNO_NONE )
+	{
+		iReturned = -1;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iReturned;
+}
+/*-----------------------------------------------------------*/
+
+#if( ffconfigZERO_COPY_READ != 0 )
+size_t ff_fread_zc( const void **ppvData, size_t xMaxLength, FF_FILE * pxStream )
+{
+int32_t iReturned;
+size_t xReturn;
+int ff_errno;
+
+	iReturned = prvStdioSync( pxStream );
+
+	if( FF_isERR( iReturned ) != pdFALSE )
+	{
+		/* The stream buffer could not be written out. */
+	}
+#if( ffconfigDEV_SUPPORT != 0 )
+	else if( pxStream->pxDevNode != NULL )
+	{
+		/* Devices have no sectors that can be lent out. */
+		iReturned = ( int32_t ) ( FF_ERR_NULL_POINTER | FF_READBORROW );
+	}
+#endif
+	else
+	{
+		iReturned = FF_ReadBorrow( pxStream, ( uint32_t ) xMaxLength, ( const uint8_t ** ) ppvData );
+	}
+
+	ff_errno = prvFFErrorToErrno( iReturned );
+
+	if( ff_errno == pdFREERTOS_ERRNO_NONE )
+	{
+		xReturn = ( size_t ) iReturned;
+	}
+	else
+	{
+		xReturn = 0;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+int ff_fread_release( FF_FILE *pxStream )
+{
+FF_Error_t iResult;
+int iReturn, ff_errno;
+
+	iResult = FF_ReadRelease( pxStream );
+
+	ff_errno = prvFFErrorToErrno( iResult );
+
+	if( ff_errno == 0 )
+	{
+		iReturn = 0;
+	}
+	else
+	{
+		iReturn = FF_EOF;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iReturn;
+}
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigZERO_COPY_READ */
+
+size_t ff_fwrite( const void *pvBuffer, size_t xSize, size_t xItems, FF_FILE * pxStream )
+{
+int32_t iReturned;
+size_t xReturn;
+int ff_errno;
+
+	iReturned = prvStdioSync( pxStream );
+
+	if( FF_isERR( iReturned ) != pdFALSE )
+	{
+		/* The stream buffer could not be written out. */
+	}
+#if( ffconfigDEV_SUPPORT != 0 )
+	else if( pxStream->pxDevNode != NULL )
+	{
+		iReturned = FF_Device_Write( pvBuffer, xSize, xItems, pxStream );
+	}
+#endif
+	else
+	{
+		iReturned = FF_Write( pxStream, xSize, xItems, (uint8_t *)pvBuffer );
+	}
+
+	ff_errno = prvFFErrorToErrno( iReturned );
+
+	if( ff_errno == pdFREERTOS_ERRNO_NONE )
+	{
+		/* As per the standard fwrite() semantics, the return value is the
+		number of complete items read, which will only equal the number of bytes
+		transferred when the item size is 1. */
+		xReturn = ( size_t ) iReturned;
+	}
+	else
+	{
+		xReturn = 0;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+int ff_fgetc( FF_FILE * pxStream )
+{
+int32_t iResult;
+int ff_errno;
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	if( prvStdioBuffered( pxStream ) != pdFALSE )
+	{
+		if( pxStream->ulStdioIndex < pxStream->ulStdioCount )
+		{
+			/* The character was read ahead.  The handle is checked again
+			when the buffer is filled, errno is left alone. */
+			return ( int ) pxStream->pucStdioBuffer[ pxStream->ulStdioIndex++ ];
+		}
+
+		iResult = prvStdioFill( pxStream );
+		if( FF_isERR( iResult ) == pdFALSE )
+		{
+			iResult = ( int32_t ) pxStream->pucStdioBuffer[ pxStream->ulStdioIndex++ ];
+		}
+	}
+	else
+#endif
+	{
+		iResult = FF_GetC( pxStream );
+	}
+	ff_errno = prvFFErrorToErrno( iResult );
+
+	if( ff_errno != 0 )
+	{
+		iResult = FF_EOF;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iResult;
+}
+/*-----------------------------------------------------------*/
+
+int ff_fputc( int iChar, FF_FILE *pxStream )
+{
+int iResult, ff_errno;
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	if( prvStdioBuffered( pxStream ) != pdFALSE )
+	{
+		if( ( ( pxStream->ucStdioFlags & FF_STDIO_WRITING ) != 0 ) &&
+			( ( pxStream->ulStdioIndex + 1 ) < pxStream->ulStdioSize ) &&
+			( ( iChar != '\n' ) || ( ( pxStream->ucStdioFlags & FF_STDIO_LINE ) == 0 ) ) )
+		{
+			/* The character fits and does not fill the buffer or end a
+			line.  The handle is checked again when the buffer is written
+			out, errno is left alone. */
+			pxStream->pucStdioBuffer[ pxStream->ulStdioIndex++ ] = ( uint8_t ) iChar;
+			return ( int ) ( uint8_t ) iChar;
+		}
+
+		iResult = prvStdioStartWrite( pxStream );
+		if( FF_isERR( iResult ) == pdFALSE )
+		{
+			pxStream->pucStdioBuffer[ pxStream->ulStdioIndex++ ] = ( uint8_t ) iChar;
+			iResult = ( int ) ( uint8_t ) iChar;
+
+			if( ( pxStream->ulStdioIndex >= pxStream->ulStdioSize ) ||
+				( ( iChar == '\n' ) && ( ( pxStream->ucStdioFlags & FF_STDIO_LINE ) != 0 ) ) )
+			{
+			FF_Error_t xError;
+
+				xError = prvStdioSync( pxStream );
+				if( FF_isERR( xError ) != pdFALSE )
+				{
+					iResult = xError;
+				}
+			}
+		}
+	}
+	else
+#endif
+	{
+		iResult = FF_PutC( pxStream, ( uint8_t ) iChar );
+	}
+	ff_errno = prvFFErrorToErrno( iResult );
+
+	if( ff_errno != 0 )
+	{
+		iResult = FF_EOF;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iResult;
+}
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFPRINTF_SUPPORT == 1 )
+
+	int ff_fprintf( FF_FILE * pxStream, const char *pcFormat, ... )
+	{
+	int iCount;
+	size_t xResult;
+	char *pcBuffer;
+	va_list xArgs;
+
+		#if( ffconfigSTDIO_BUFFERS != 0 )
+		{
+			if( prvStdioBuffered( pxStream ) != pdFALSE )
+			{
+				va_start( xArgs, pcFormat );
+				iCount = prvStdioPrintf( pxStream, pcFormat, xArgs );
+				va_end( xArgs );
+
+				return iCount;
+			}
+		}
+		#endif
+
+		pcBuffer = ( char * ) ffconfigMALLOC( ffconfigFPRINTF_BUFFER_LENGTH );
+		if( pcBuffer == NULL )
+		{
+			/* Store the errno to thread local storage. */
+			stdioSET_ERRNO( pdFREERTOS_ERRNO_ENOMEM );
+			iCount = -1;
+		}
+		else
+		{
+			va_start( xArgs, pcFormat );
+			iCount = vsnprintf( pcBuffer, ffconfigFPRINTF_BUFFER_LENGTH, pcFormat, xArgs );
+			va_end( xArgs );
+
+			/* ff_fwrite() will set ff_errno. */
+			if( iCount > 0 )
+			{
+				xResult = ff_fwrite( pcBuffer, ( size_t ) 1, ( size_t ) iCount, pxStream );
+				if( xResult < ( size_t ) iCount )
+				{
+					iCount = -1;
+				}
+			}
+
+			ffconfigFREE( pcBuffer );
+		}
+
+		return iCount;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
+/*_RB_ to comply with the norm, the second parameter should be an int, but size_t
+is more appropriate. */
+char *ff_fgets( char *pcBuffer, size_t xCount, FF_FILE *pxStream )
+{
+int32_t xResult;
+int ff_errno;
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	if( prvStdioBuffered( pxStream ) != pdFALSE )
+	{
+		xResult = prvStdioGetLine( pxStream, pcBuffer, ( uint32_t ) xCount );
+	}
+	else
+#endif
+	{
+		xResult = FF_GetLine( pxStream, ( char * ) pcBuffer, xCount );
+	}
+
+	/* This call seems to result in errno being incorrectly set to
+	FF_ERR_IOMAN_NO_MOUNTABLE_PARTITION when an EOF is encountered. */
+	ff_errno = prvFFErrorToErrno( xResult );
+
+	if( ff_errno != 0 )
+	{
+		pcBuffer = NULL;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return pcBuffer;
+}
+/*-----------------------------------------------------------*/
+
+int ff_seteof( FF_FILE *pxStream )
+{
+FF_Error_t iResult;
+int iReturn, ff_errno;
+
+	iResult = prvStdioSync( pxStream );
+
+	if( FF_isERR( iResult ) == pdFALSE )
+	{
+		iResult = FF_SetEof( pxStream );
+	}
+
+	ff_errno = prvFFErrorToErrno( iResult );
+
+	if( ff_errno == 0 )
+	{
+		iReturn = 0;
+	}
+	else
+	{
+		iReturn = FF_EOF;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iReturn;
+}
+/*-----------------------------------------------------------*/
+
+int ff_fflush( FF_FILE *pxStream )
+{
+FF_Error_t iResult;
+int iReturn, ff_errno;
+
+	iResult = prvStdioSync( pxStream );
+
+	if( FF_isERR( iResult ) == pdFALSE )
+	{
+		iResult = FF_SyncFile( pxStream );
+	}
+
+	ff_errno = prvFFErrorToErrno( iResult );
+
+	if( ff_errno == 0 )
+	{
+		iReturn = 0;
+	}
+	else
+	{
+		iReturn = FF_EOF;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iReturn;
+}
+/*-----------------------------------------------------------*/
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+int ff_setvbuf( FF_FILE *pxStream, char *pcBuffer, int iMode, size_t xSize )
+{
+FF_Error_t xError;
+uint8_t *pucAllocated = NULL;
+int ff_errno;
+
+	if( FF_isERR( FF_CheckValid( pxStream ) ) != pdFALSE )
+	{
+		ff_errno = pdFREERTOS_ERRNO_EBADF;
+	}
+	else if( ( ( iMode != FF_IOFBF ) && ( iMode != FF_IOLBF ) && ( iMode != FF_IONBF ) ) ||
+			 ( ( iMode != FF_IONBF ) && ( xSize == 0u ) ) )
+	{
+		ff_errno = pdFREERTOS_ERRNO_EINVAL;
+	}
+#if( ffconfigDEV_SUPPORT != 0 )
+	else if( pxStream->pxDevNode != NULL )
+	{
+		/* Devices are accessed with their own read and write functions. */
+		ff_errno = pdFREERTOS_ERRNO_EINVAL;
+	}
+#endif
+	else
+	{
+		/* The old buffer may still hold data. */
+		xError = prvStdioSync( pxStream );
+		ff_errno = prvFFErrorToErrno( xError );
+
+		if( ( ff_errno == 0 ) && ( iMode != FF_IONBF ) && ( pcBuffer == NULL ) )
+		{
+			pucAllocated = ( uint8_t * ) ffconfigMALLOC( xSize );
+			if( pucAllocated == NULL )
+			{
+				ff_errno = pdFREERTOS_ERRNO_ENOMEM;
+			}
+		}
+
+		if( ff_errno == 0 )
+		{
+			if( ( pxStream->ucStdioFlags & FF_STDIO_ALLOCATED ) != 0 )
+			{
+				ffconfigFREE( pxStream->pucStdioBuffer );
+			}
+
+			pxStream->pucStdioBuffer = NULL;
+			pxStream->ulStdioSize = 0u;
+			pxStream->ucStdioFlags = 0u;
+
+			if( iMode != FF_IONBF )
+			{
+				if( pucAllocated != NULL )
+				{
+					pxStream->pucStdioBuffer = pucAllocated;
+					pxStream->ucStdioFlags = FF_STDIO_ALLOCATED;
+				}
+				else
+				{
+					pxStream->pucStdioBuffer = ( uint8_t * ) pcBuffer;
+				}
+
+				pxStream->ulStdioSize = ( uint32_t ) xSize;
+
+				if( iMode == FF_IOLBF )
+				{
+					pxStream->ucStdioFlags |= FF_STDIO_LINE;
+				}
+			}
+		}
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return ( ff_errno == 0 ) ? 0 : -1;
 }
 /*-----------------------------------------------------------*/
 
-size_t ff_fwrite( const void *pvBuffer, size_t xSize, size_t xItems, FF_FILE * pxStream )
+static BaseType_t prvStdioBuffered( FF_FILE *pxStream )
 {
-int32_t iReturned;
-size_t xReturn;
-int ff_errno;
+BaseType_t xReturn = pdFALSE;
 
-#if( ffconfigDEV_SUPPORT != 0 )
-	if( pxStream->pxDevNode != NULL )
+	/* A run of calls on the same stream only needs the comparison. */
+	if( ( ( pxStream != NULL ) && ( pxStream == pxFFLastValidFile ) ) ||
+		( FF_isERR( FF_CheckValid( pxStream ) ) == pdFALSE ) )
 	{
-		iReturned = FF_Device_Write( pvBuffer, xSize, xItems, pxStream );
+		xReturn = ( pxStream->pucStdioBuffer != NULL ) ? pdTRUE : pdFALSE;
 	}
-	else
-#endif
+
+	return xReturn;
+}	/* prvStdioBuffered() */
+/*-----------------------------------------------------------*/
+
+static FF_Error_t prvStdioSync( FF_FILE *pxStream )
+{
+FF_Error_t xError;
+int32_t lWritten;
+
+	xError = FF_CheckValid( pxStream );
+
+	if( ( FF_isERR( xError ) == pdFALSE ) && ( pxStream->pucStdioBuffer != NULL ) )
 	{
-		iReturned = FF_Write( pxStream, xSize, xItems, (uint8_t *)pvBuffer );
+		if( ( pxStream->ucStdioFlags & FF_STDIO_WRITING ) != 0 )
+		{
+			if( pxStream->ulStdioIndex != 0u )
+			{
+				lWritten = FF_Write( pxStream, 1, pxStream->ulStdioIndex, pxStream->pucStdioBuffer );
+				if( FF_isERR( lWritten ) != pdFALSE )
+				{
+					xError = lWritten;
+				}
+			}
+		}
+		else if( pxStream->ulStdioIndex < pxStream->ulStdioCount )
+		{
+			/* Move the handle back to the first byte that was not consumed. */
+			xError = FF_Seek( pxStream, -( int32_t ) ( pxStream->ulStdioCount - pxStream->ulStdioIndex ), FF_SEEK_CUR );
+		}
+
+		/* Even when an error occurred, the buffer is considered empty. */
+		pxStream->ulStdioIndex = 0u;
+		pxStream->ulStdioCount = 0u;
+		pxStream->ucStdioFlags &= ( uint8_t ) ~( FF_STDIO_READING | FF_STDIO_WRITING );
 	}
 
-	ff_errno = prvFFErrorToErrno( iReturned );
+	return xError;
+}	/* prvStdioSync() */
+/*-----------------------------------------------------------*/
 
-	if( ff_errno == pdFREERTOS_ERRNO_NONE )
+static int32_t prvStdioFill( FF_FILE *pxStream )
+{
+int32_t lCount;
+
+	lCount = prvStdioSync( pxStream );
+
+	if( FF_isERR( lCount ) == pdFALSE )
 	{
-		/* As per the standard fwrite() semantics, the return value is the
-		number of complete items read, which will only equal the number of bytes
-		transferred when the item size is 1. */
-		xReturn = ( size_t ) iReturned;
+		lCount = FF_Read( pxStream, 1, pxStream->ulStdioSize, pxStream->pucStdioBuffer );
+
+		if( lCount == 0 )
+		{
+			/* The same code as FF_GetC() returns at the end of the file. */
+			lCount = ( int32_t ) ( FF_ERR_FILE_READ_ZERO | FF_READ );
+		}
+		else if( FF_isERR( lCount ) == pdFALSE )
+		{
+			pxStream->ulStdioCount = ( uint32_t ) lCount;
+			pxStream->ucStdioFlags |= FF_STDIO_READING;
+		}
 	}
-	else
+
+	return lCount;
+}	/* prvStdioFill() */
+/*-----------------------------------------------------------*/
+
+static FF_Error_t prvStdioStartWrite( FF_FILE *pxStream )
+{
+FF_Error_t xError = FF_ERR_NONE;
+
+	if( ( pxStream->ucStdioFlags & FF_STDIO_WRITING ) == 0 )
 	{
-		xReturn = 0;
-	}
+		xError = FF_CheckValid( pxStream );
 
-	/* Store the errno to thread local storage. */
-	stdioSET_ERRNO( ff_errno );
+		if( FF_isERR( xError ) != pdFALSE )
+		{
+			/* The mode of the handle can not be trusted. */
+		}
+		else if( ( pxStream->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) == 0 )
+		{
+			/* Report it now, and not when the buffer is written out. */
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_PUTC );
+		}
+		else
+		{
+			xError = prvStdioSync( pxStream );
+			pxStream->ucStdioFlags |= FF_STDIO_WRITING;
+		}
+	}
 
-	return xReturn;
-}
+	return xError;
+}	/* prvStdioStartWrite() */
 /*-----------------------------------------------------------*/
 
-int ff_fgetc( FF_FILE * pxStream )
+static int32_t prvStdioGetLine( FF_FILE *pxStream, char *pcLine, uint32_t ulLimit )
 {
-int32_t iResult;
-int ff_errno;
-
-	iResult = FF_GetC( pxStream );
-	ff_errno = prvFFErrorToErrno( iResult );
+uint32_t ulIndex = 0u;
+int32_t lResult = FF_ERR_NONE;
+char cChar;
 
-	if( ff_errno != 0 )
+	if( pcLine == NULL )
 	{
-		iResult = FF_EOF;
+		lResult = ( int32_t ) ( FF_ERR_NULL_POINTER | FF_GETLINE );
 	}
+	else if( ulLimit != 0u )
+	{
+		while( ( ulIndex + 1u ) < ulLimit )
+		{
+			if( pxStream->ulStdioIndex >= pxStream->ulStdioCount )
+			{
+				lResult = prvStdioFill( pxStream );
 
-	/* Store the errno to thread local storage. */
-	stdioSET_ERRNO( ff_errno );
+				if( FF_isERR( lResult ) != pdFALSE )
+				{
+					if( ( FF_GETERROR( lResult ) == FF_ERR_FILE_READ_ZERO ) && ( ulIndex > 0u ) )
+					{
+						/* The last line of the file has no linefeed. */
+						lResult = FF_ERR_NONE;
+					}
+					break;
+				}
+			}
 
-	return iResult;
-}
-/*-----------------------------------------------------------*/
+			cChar = ( char ) pxStream->pucStdioBuffer[ pxStream->ulStdioIndex++ ];
+			pcLine[ ulIndex++ ] = cChar;
 
-int ff_fputc( int iChar, FF_FILE *pxStream )
-{
-int iResult, ff_errno;
+			if( cChar == '\n' )
+			{
+				break;
+			}
+		}
 
-	iResult = FF_PutC( pxStream, ( uint8_t ) iChar );
-	ff_errno = prvFFErrorToErrno( iResult );
+		/* Make sure that the resulting string always ends with a zero. */
+		pcLine[ ulIndex ] = '\0';
+	}
 
-	if( ff_errno != 0 )
+	if( FF_isERR( lResult ) == pdFALSE )
 	{
-		iResult = FF_EOF;
+		/* Return the number of bytes read. */
+		lResult = ( int32_t ) ulIndex;
 	}
 
-	/* Store the errno to thread local storage. */
-	stdioSET_ERRNO( ff_errno );
-
-	return iResult;
-}
+	return lResult;
+}	/* prvStdioGetLine() */
 /*-----------------------------------------------------------*/
 
 #if( ffconfigFPRINTF_SUPPORT == 1 )
+static int prvStdioPrintf( FF_FILE *pxStream, const char *pcFormat, va_list xArgs )
+{
+FF_Error_t xError;
+int iCount = -1;
+size_t xSpace;
+char *pcText;
+char *pcAllocated = NULL;
+va_list xCopy;
 
-	int ff_fprintf( FF_FILE * pxStream, const char *pcFormat, ... )
+	xError = prvStdioStartWrite( pxStream );
+
+	if( FF_isERR( xError ) == pdFALSE )
 	{
-	int iCount;
-	size_t xResult;
-	char *pcBuffer;
-	va_list xArgs;
+		pcText = ( char * ) ( pxStream->pucStdioBuffer + pxStream->ulStdioIndex );
+		xSpace = ( size_t ) ( pxStream->ulStdioSize - pxStream->ulStdioIndex );
 
-		pcBuffer = ( char * ) ffconfigMALLOC( ffconfigFPRINTF_BUFFER_LENGTH );
-		if( pcBuffer == NULL )
+		va_copy( xCopy, xArgs );
+		iCount = vsnprintf( pcText, xSpace, pcFormat, xCopy );
+		va_end( xCopy );
+
+		if( iCount < 0 )
 		{
-			/* Store the errno to thread local storage. */
-			stdioSET_ERRNO( pdFREERTOS_ERRNO_ENOMEM );
-			iCount = -1;
+			/* An encoding error, nothing is written. */
+		}
+		else if( ( size_t ) iCount < xSpace )
+		{
+			/* The text fits behind the data that is already waiting. */
+			pxStream->ulStdioIndex += ( uint32_t ) iCount;
 		}
 		else
 		{
-			va_start( xArgs, pcFormat );
-			iCount = vsnprintf( pcBuffer, ffconfigFPRINTF_BUFFER_LENGTH, pcFormat, xArgs );
-			va_end( xArgs );
+			/* Make room.  vsnprintf() wrote a zero at the end of the
+			buffer, which is not part of the data. */
+			pxStream->ulStdioIndex = ( uint32_t ) ( pcText - ( char * ) pxStream->pucStdioBuffer );
+			xError = prvStdioSync( pxStream );
 
-			/* ff_fwrite() will set ff_errno. */
-			if( iCount > 0 )
+			if( FF_isERR( xError ) == pdFALSE )
 			{
-				xResult = ff_fwrite( pcBuffer, ( size_t ) 1, ( size_t ) iCount, pxStream );
-				if( xResult < ( size_t ) iCount )
+				pxStream->ucStdioFlags |= FF_STDIO_WRITING;
+
+				if( ( size_t ) iCount < ( size_t ) pxStream->ulStdioSize )
 				{
-					iCount = -1;
+					pcText = ( char * ) pxStream->pucStdioBuffer;
+					vsnprintf( pcText, ( size_t ) pxStream->ulStdioSize, pcFormat, xArgs );
+					pxStream->ulStdioIndex = ( uint32_t ) iCount;
+				}
+				else
+				{
+					/* Too long for the stream buffer, write it directly. */
+					pcAllocated = ( char * ) ffconfigMALLOC( ( size_t ) iCount + 1u );
+					if( pcAllocated == NULL )
+					{
+						xError = ( FF_Error_t ) ( FF_ERR_NOT_ENOUGH_MEMORY | FF_WRITE );
+					}
+					else
+					{
+					int32_t lWritten;
+
+						vsnprintf( pcAllocated, ( size_t ) iCount + 1u, pcFormat, xArgs );
+						lWritten = FF_Write( pxStream, 1, ( uint32_t ) iCount, ( uint8_t * ) pcAllocated );
+						if( FF_isERR( lWritten ) != pdFALSE )
+						{
+							xError = lWritten;
+						}
+						ffconfigFREE( pcAllocated );
+						pcText = NULL;
+					}
 				}
 			}
+		}
 
-			ffconfigFREE( pcBuffer );
+		if( ( FF_isERR( xError ) == pdFALSE ) && ( iCount > 0 ) && ( pcText != NULL ) &&
+			( ( pxStream->ucStdioFlags & FF_STDIO_LINE ) != 0 ) &&
+			( memchr( pcText, '\n', ( size_t ) iCount ) != NULL ) )
+		{
+			xError = prvStdioSync( pxStream );
 		}
+	}
 
-		return iCount;
+	if( FF_isERR( xError ) != pdFALSE )
+	{
+		/* Store the errno to thread local storage. */
+		stdioSET_ERRNO( prvFFErrorToErrno( xError ) );
+		iCount = -1;
 	}
 
-#endif
+	return iCount;
+}	/* prvStdioPrintf() */
 /*-----------------------------------------------------------*/
+#endif	/* ffconfigFPRINTF_SUPPORT */
 
-/*_RB_ to comply with the norm, the second parameter should be an int, but size_t
-is more appropriate. */
-char *ff_fgets( char *pcBuffer, size_t xCount, FF_FILE *pxStream )
-{
-int32_t xResult;
-int ff_errno;
+#endif	/* ffconfigSTDIO_BUFFERS */
 
-	xResult = FF_GetLine( pxStream, ( char * ) pcBuffer, xCount );
-
-	/* This call seems to result in errno being incorrectly set to
-	FF_ERR_IOMAN_NO_MOUNTABLE_PARTITION when an EOF is encountered. */
-	ff_errno = prvFFErrorToErrno( xResult );
+#if( ffconfigMMAP_SUPPORT != 0 )
+FF_Mapping_t *ff_mmap_ro( const char *pcFile )
+{
+FF_FILE *pxStream;
+FF_Mapping_t *pxMapping = NULL;
+FF_Error_t xError;
 
-	if( ff_errno != 0 )
+	pxStream = ff_fopen( pcFile, "r" );
+	if( pxStream != NULL )
 	{
-		pcBuffer = NULL;
-	}
+		pxMapping = FF_MapFile( pxStream, &xError );
+		if( pxMapping == NULL )
+		{
+			ff_fclose( pxStream );
+		}
 
-	/* Store the errno to thread local storage. */
-	stdioSET_ERRNO( ff_errno );
+		/* Store the errno to thread local storage. */
+		stdioSET_ERRNO( prvFFErrorToErrno( xError ) );
+	}
 
-	return pcBuffer;
+	return pxMapping;
 }
 /*-----------------------------------------------------------*/
 
-int ff_seteof( FF_FILE *pxStream )
+int ff_munmap( FF_Mapping_t *pxMapping )
 {
 FF_Error_t iResult;
 int iReturn, ff_errno;
 
-	iResult = FF_SetEof( pxStream );
+	iResult = FF_UnmapFile( pxMapping );
 
 	ff_errno = prvFFErrorToErrno( iResult );
 
@@ -527,7 +1251,7 @@ int iReturn, ff_errno;
 	}
 	else
 	{
-		iReturn = FF_EOF;
+		iReturn = -1;
 	}
 
 	/* Store the errno to thread local storage. */
@@ -536,6 +1260,7 @@ int iReturn, ff_errno;
 	return iReturn;
 }
 /*-----------------------------------------------------------*/
+#endif	/* ffconfigMMAP_SUPPORT */
 
 /*_RB_ The norm would be to return an int, but in either case it is not clear
 what state the file is left in (open/closed). */
@@ -989,6 +1714,92 @@ int ff_errno = 0, iReturn;
 }
 /*-----------------------------------------------------------*/
 
+#if( ffconfigCOPYFILE_SUPPORT != 0 )
+int ff_copyfile( const char *pcSource, const char *pcDest, int iFlags )
+{
+FF_DirHandler_t xHandlers[ 2 ];
+FF_Error_t xError;
+int ff_errno = 0;
+#if( ffconfigHAS_CWD != 0 )
+	char *pcSourceCopy;
+	size_t xSize;
+#endif
+
+	/* In case a CWD is used, get the absolute path */
+	pcSource = prvABSPath( pcSource );
+
+	/* Find the i/o manager which can handle this path */
+	if( FF_FS_Find( pcSource, &xHandlers[ 0 ] ) == pdFALSE )
+	{
+		ff_errno = pdFREERTOS_ERRNO_ENXIO;	/* No such device or address */
+	}
+	else
+	{
+		#if( ffconfigHAS_CWD != 0 )
+		{
+			/* prvABSPath() returns a pointer to the task storage space, which
+			is used again for the second path. */
+			xSize = strlen( xHandlers[ 0 ].pcPath ) + 1;
+			pcSourceCopy = ( char * ) ffconfigMALLOC( xSize );
+
+			if( pcSourceCopy == NULL )
+			{
+				ff_errno = pdFREERTOS_ERRNO_ENOMEM;
+			}
+			else
+			{
+				memcpy( pcSourceCopy, xHandlers[ 0 ].pcPath, xSize );
+				xHandlers[ 0 ].pcPath = pcSourceCopy;
+			}
+		}
+		#endif /* ffconfigHAS_CWD != 0 */
+
+		if( ff_errno == 0 )
+		{
+			pcDest = prvABSPath( pcDest );
+
+			if( FF_FS_Find( pcDest, &( xHandlers[ 1 ] ) ) == pdFALSE )
+			{
+				ff_errno = pdFREERTOS_ERRNO_ENXIO;	/* No such device or address */
+			}
+			else if( xHandlers[ 0 ].pxManager != xHandlers[ 1 ].pxManager )
+			{
+				/* The clusters can only be copied within one volume. */
+				ff_errno = pdFREERTOS_ERRNO_EXDEV;
+			}
+			else
+			{
+				xError = FF_CopyFile( xHandlers[ 0 ].pxManager, xHandlers[ 0 ].pcPath, xHandlers[ 1 ].pcPath,
+					( BaseType_t ) iFlags );
+
+				ff_errno = prvFFErrorToErrno( xError );
+
+				#if ffconfigUSE_NOTIFY
+				{
+					if( FF_isERR( xError ) == pdFALSE )
+					{
+						callFileEvents( pcDest, eFileCreate );
+					}
+				}
+				#endif
+			}
+
+			#if( ffconfigHAS_CWD != 0 )
+			{
+				ffconfigFREE( pcSourceCopy );
+			}
+			#endif
+		}
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return ( ff_errno == 0 ) ? 0 : -1;
+}
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigCOPYFILE_SUPPORT */
+
 int ff_stat( const char *pcName, FF_Stat_t *pxStatBuffer )
 {
 FF_DirEnt_t xDirEntry;
@@ -1434,6 +2245,23 @@ FF_Error_t xError;
 					pxFindData->xDirectoryHandler.u.bits.bAddDotEntries = 0;
 				}
 
+				#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+				{
+					if( pxFindData->xDirectoryEntry.pcWildCard[ 0 ] != '\0' )
+					{
+					BaseType_t xMatch;
+
+						/* The pseudo entries must match the pattern as well. */
+						xMatch = FF_WildCardMatch( &( pxFindData->xDirectoryEntry.xWildCard ),
+							pxFindData->xDirectoryEntry.pcWildCard, pxFindData->xDirectoryEntry.pcFileName );
+						if( ( xMatch != pdFALSE ) == ( pxFindData->xDirectoryEntry.xInvertWildCard != pdFALSE ) )
+						{
+							continue;
+						}
+					}
+				}
+				#endif /* ffconfigFINDAPI_ALLOW_WILDCARDS */
+
 				pxFindData->xDirectoryEntry.ucAttrib = FF_FAT_ATTR_READONLY | FF_FAT_ATTR_DIR;
 				pxFindData->xDirectoryEntry.ulFileSize = stdioDOT_ENTRY_FILE_SIZE;
 				#if( ffconfigTIME_SUPPORT != 0 )
@@ -1577,7 +2405,13 @@ size_t ff_filelength( FF_FILE *pxStream )
 FF_Error_t xReturned;
 uint32_t ulLength;
 
-	xReturned = FF_GetFileSize( pxStream, &( ulLength ) );
+	/* Data in the stream buffer may make the file longer. */
+	xReturned = prvStdioSync( pxStream );
+
+	if( FF_isERR( xReturned ) == pdFALSE )
+	{
+		xReturned = FF_GetFileSize( pxStream, &( ulLength ) );
+	}
 
 	if( FF_isERR( xReturned ) != pdFALSE )
 	{
@@ -1811,6 +2645,8 @@ int prvFFErrorToErrno( FF_Error_t xError )
 	case FF_ERR_FILE_MEDIA_REMOVED:				return pdFREERTOS_ERRNO_ENODEV;		/* File handle got invalid because media was removed. */
 	case FF_ERR_FILE_SEEK_INVALID_POSITION:		return pdFREERTOS_ERRNO_ESPIPE;		/* Illegal position, outside the file's space */
 	case FF_ERR_FILE_SEEK_INVALID_ORIGIN:		return pdFREERTOS_ERRNO_EINVAL;		/* Seeking beyond end of file. */
+	case FF_ERR_FILE_NOT_MAPPABLE:				return pdFREERTOS_ERRNO_EOPNOTSUPP;	/* The medium can not be accessed in place. */
+	case FF_ERR_FILE_BORROW_LIMIT:				return pdFREERTOS_ERRNO_ENOBUFS;	/* No more cache buffers can be lent out. */
 
 	/* Directory Error Codes                    50 +. */
 	case FF_ERR_DIR_OBJECT_EXISTS:				return pdFREERTOS_ERRNO_EEXIST;		/* A file or folder of the same name already exists in the current directory. */
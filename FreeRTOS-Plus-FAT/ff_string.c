@@ -234,6 +234,34 @@
 	}
 #endif	/* ffconfigUNICODE_UTF16_SUPPORT */
 
+/**
+ *	@private
+ *	@brief	Matches a string against a wild-card pattern with '*' and '?'.
+ *			When one pattern is used many times, compile it once with
+ *			FF_WildCardCompile() and call FF_WildCardMatch() instead.
+ *
+ **/
+
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	#if( ffconfigUNICODE_UTF16_SUPPORT == 0 )
+	BaseType_t FF_wildcompare( const char *pcWildCard, const char *pszString )
+	{
+	char pcPattern[ ffconfigMAX_FILENAME ];
+	#else
+	BaseType_t FF_wildcompare( const FF_T_WCHAR *pcWildCard, const FF_T_WCHAR *pszString )
+	{
+	FF_T_WCHAR pcPattern[ ffconfigMAX_FILENAME ];
+	#endif
+	FF_WildCard_t xWildCard;
+
+		STRNCPY( pcPattern, pcWildCard, ffconfigMAX_FILENAME );
+		pcPattern[ ffconfigMAX_FILENAME - 1 ] = '\0';
+		FF_WildCardCompile( &xWildCard, pcPattern );
+
+		return FF_WildCardMatch( &xWildCard, pcPattern, pszString );
+	}
+#endif	/* ffconfigFINDAPI_ALLOW_WILDCARDS */
+
 /**
  *	@private
  *	@brief	A re-entrant Strtok function. No documentation is provided :P
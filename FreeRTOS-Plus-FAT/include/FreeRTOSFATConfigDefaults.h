@@ -156,6 +156,252 @@ will be removed. */
 	#define	ffconfigOPTIMISE_UNALIGNED_ACCESS	0
 #endif
 
+#if !defined( ffconfigZERO_COPY_READ )
+	/* Set to 1 to include FF_ReadBorrow() and ff_fread_zc(), which let the
+	caller look at file data in place, inside a sector of the cache, instead
+	of having it copied to a buffer of its own.  Each handle can hold one
+	such sector at a time.  A few buffers of the cache are never lent out,
+	they are needed to access the FAT and the directories.
+
+	Set to 0 to leave these functions out. */
+	#define	ffconfigZERO_COPY_READ				0
+#endif
+
+#if !defined( ffconfigMMAP_SUPPORT )
+	/* Set to 1 to include FF_MapFile() and ff_mmap_ro(), which give read-only
+	access to a file in place on media that are addressable memory.  The
+	driver must provide FF_Disk_t::fnMapBlocks, as the RAM disk does.
+
+	Set to 0 to leave these functions out. */
+	#define	ffconfigMMAP_SUPPORT				0
+#endif
+
+#if !defined( ffconfigCACHE_MAP_BLOCKS )
+	/* Set to 1 to let the cache use the memory of the disk itself, on media
+	that are addressable memory and whose driver provides
+	FF_Disk_t::fnMapBlocks, as the RAM disk does.  FF_GetBuffer() then points
+	the buffer at the sector instead of reading a copy of it, and flushing a
+	buffer writes nothing.  The cache only keeps track of which sectors are in
+	use.
+
+	Changes reach the disk when they are made, instead of when the buffer is
+	flushed.  That makes no difference for volatile memory, where nothing
+	survives a reset, but do not use it for memory that must stay consistent
+	when power is lost.
+
+	Set to 0 to always copy sectors into the cache memory. */
+	#define	ffconfigCACHE_MAP_BLOCKS			0
+#endif
+
+#if !defined( ffconfigRAMDISK_LAZY_ZERO )
+	/* Set to 1 to let the RAM disk driver keep a small bitmap of the regions
+	of its memory that have never been written.  Those regions read as zeros,
+	so the memory does not have to be cleared when the disk is created, and
+	writing zeros to them costs nothing.  A region is cleared the first time
+	that data is written to it.  The bitmap takes one bit per 4 KB of disk.
+
+	Set to 0 to clear the whole RAM disk when it is created. */
+	#define	ffconfigRAMDISK_LAZY_ZERO			0
+#endif
+
+#if !defined( ffconfigRAMDISK_SNAPSHOT )
+	/* Set to 1 to include FF_RAMDiskSnapshotStart() and friends in the RAM
+	disk driver.  A snapshot freezes the contents of the disk at one point in
+	time, without stopping the file system for as long as it takes to copy
+	the disk: each sector is copied to a save area the first time it is
+	written afterwards, and a background task reads the snapshot out in
+	sector order. */
+	#define	ffconfigRAMDISK_SNAPSHOT			0
+#endif
+
+#if !defined( ffconfigRAMDISK_SECTOR_SIZE )
+	/* The size of the sectors of the RAM disk: 512, 1024, 2048 or 4096 bytes.
+	The disk is formatted with this sector size.  Larger sectors mean fewer
+	driver calls, fewer FAT sectors and fewer cache buffers to search for the
+	same amount of data, but every cache buffer takes a full sector. */
+	#define	ffconfigRAMDISK_SECTOR_SIZE			512
+#endif
+
+#if !defined( ffconfigZRAMDISK_PAGE_SECTORS )
+	/* The compressed RAM disk (ff_zramdisk.c) compresses this many sectors at
+	a time.  Larger pages compress better, but every partial write of a page
+	that is not in its cache costs a decompression, and an eviction costs a
+	compression of the whole page.  8 KB pages store source text in about
+	10% less memory than 4 KB pages. */
+	#define	ffconfigZRAMDISK_PAGE_SECTORS		16
+#endif
+
+#if !defined( ffconfigZRAMDISK_CACHE_PAGES )
+	/* The number of decompressed pages that the compressed RAM disk keeps in
+	its cache.  Each takes ffconfigZRAMDISK_PAGE_SECTORS * 512 bytes. */
+	#define	ffconfigZRAMDISK_CACHE_PAGES		4
+#endif
+
+#if !defined( ffconfigSTDIO_BUFFERS )
+	/* Set to 1 to include ff_setvbuf(), which gives a stream a buffer of its
+	own.  ff_fgetc(), ff_fputc(), ff_fgets() and ff_fprintf() will work on
+	that buffer, and only call the +FAT functions to fill or to empty it.
+
+	Set to 0 to leave ff_setvbuf() out.  Each character will then be handled
+	by FF_GetC() or FF_PutC(). */
+	#define	ffconfigSTDIO_BUFFERS				0
+#endif
+
+#if !defined( ffconfigCOPYFILE_SUPPORT )
+	/* Set to 1 to include FF_CopyFile() and ff_copyfile(), which copy a file
+	within a volume cluster by cluster, without passing the data through the
+	cache.
+
+	Set to 0 to leave these functions out. */
+	#define	ffconfigCOPYFILE_SUPPORT			0
+#endif
+
+#if !defined( ffconfigCOPYFILE_BUFFER_SIZE )
+	/* The size in bytes of the buffer that FF_CopyFile() allocates to move
+	sectors on media that can not be accessed in place.  It is rounded down
+	to whole sectors. */
+	#define	ffconfigCOPYFILE_BUFFER_SIZE		4096
+#endif
+
+#if !defined( ffconfigAIO_SUPPORT )
+	/* Set to 1 to include ff_aio_read(), ff_aio_write(), ff_aio_fsync() and
+	ff_aio_cancel(), see ff_aio.h.  The requests are executed by worker tasks
+	which are created when the first request is submitted.
+
+	Set to 0 to leave these functions out. */
+	#define	ffconfigAIO_SUPPORT					0
+#endif
+
+#if !defined( ffconfigAIO_WORKER_COUNT )
+	/* The number of worker tasks that execute asynchronous requests.  Requests
+	for different files can be executed in parallel by different workers. */
+	#define	ffconfigAIO_WORKER_COUNT			2
+#endif
+
+#if !defined( ffconfigAIO_WORKER_PRIORITY )
+	/* The FreeRTOS priority of the worker tasks. */
+	#define	ffconfigAIO_WORKER_PRIORITY			( tskIDLE_PRIORITY + 1 )
+#endif
+
+#if !defined( ffconfigAIO_WORKER_STACK_SIZE )
+	/* The stack size of the worker tasks, in words.  The stdio functions use
+	less stack than the path based functions, which declare buffers of
+	ffconfigMAX_FILENAME bytes. */
+	#define	ffconfigAIO_WORKER_STACK_SIZE		( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+#if !defined( ffconfigLOG_FILE_SUPPORT )
+	/* Set to 1 to support the FF_MODE_LOG open flag.  A log file is written at
+	its end only: the handle keeps the last sector of the file, clusters are
+	reserved ffconfigLOG_RESERVE_CLUSTERS at a time, and the size is written to
+	the directory entry once per ffconfigLOG_SYNC_INTERVAL_MS.  Several tasks
+	may append through the same handle.
+
+	Set to 0 to treat FF_MODE_LOG as an ordinary append mode. */
+	#define	ffconfigLOG_FILE_SUPPORT			0
+#endif
+
+#if !defined( ffconfigLOG_RESERVE_CLUSTERS )
+	/* The number of clusters that a log file is extended with beyond its data.
+	FF_Close() releases the clusters that were not used. */
+	#define	ffconfigLOG_RESERVE_CLUSTERS		8
+#endif
+
+#if( ffconfigLOG_RESERVE_CLUSTERS < 1 )
+	#error ffconfigLOG_RESERVE_CLUSTERS must be at least 1
+#endif
+
+#if !defined( ffconfigLOG_SYNC_INTERVAL_MS )
+	/* When non-zero, an append to a log file also writes its last sector and
+	its directory entry if these were last written at least this many
+	milliseconds ago.  Set to 0 to only write them when the sector is full, and
+	at sync or close. */
+	#define	ffconfigLOG_SYNC_INTERVAL_MS		1000
+#endif
+
+#if !defined( ffconfigCONCURRENT_READS )
+	/* Set to 1 to let tasks read different files in parallel.  Walking a
+	cluster chain takes a shared lock on the FAT instead of the exclusive one,
+	and when the driver sets FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT, a sector that
+	is missing from the cache is read without holding the I/O manager
+	semaphore.
+
+	Set to 0 to serialise all chain walks and cache misses. */
+	#define	ffconfigCONCURRENT_READS			0
+#endif
+
+#if !defined( ffconfigFILE_HANDLE_POOL_SIZE )
+	/* The number of file handles that each I/O manager keeps in a pool of its
+	own, together with their unaligned access buffers.  Opening and closing a
+	file takes a handle from the pool and gives it back without calling
+	ffconfigMALLOC() or ffconfigFREE(), which avoids fragmenting the heap.
+	When the pool is empty, handles are allocated from the heap as usual.
+
+	Set to 0 to always allocate file handles from the heap. */
+	#define	ffconfigFILE_HANDLE_POOL_SIZE		0
+#endif
+
+#if !defined( ffconfigOPEN_FILE_BUCKETS )
+	/* The I/O manager keeps its open files in a table of this many lists,
+	hashed on the directory entry of the file.  FF_Open() only looks at the
+	list of the entry it opens to detect a conflicting open, and FF_Close()
+	only at the list that the handle is in.
+
+	The default of 1 keeps all open files in a single list. */
+	#define	ffconfigOPEN_FILE_BUCKETS			1
+#endif
+
+#if( ffconfigOPEN_FILE_BUCKETS < 1 )
+	#error ffconfigOPEN_FILE_BUCKETS must be at least 1
+#endif
+
+#if !defined( ffconfigHANDLE_INDEX_BUCKETS )
+	/* FF_CheckValid() finds a handle by its address before it reads it, in
+	a table of this many lists that is shared by all I/O managers.  The
+	lists are walked in a critical section, so they should stay short: use
+	about as many buckets as there are files open at the same time.
+
+	Must be a power of two. */
+	#define	ffconfigHANDLE_INDEX_BUCKETS		16
+#endif
+
+#if( ( ffconfigHANDLE_INDEX_BUCKETS < 1 ) || ( ( ffconfigHANDLE_INDEX_BUCKETS & ( ffconfigHANDLE_INDEX_BUCKETS - 1 ) ) != 0 ) )
+	#error ffconfigHANDLE_INDEX_BUCKETS must be a power of two
+#endif
+
+#if !defined( ffconfigBLOCK_QUEUE )
+	/* Set to 1 to include the block queue, see ff_blkqueue.h.  A driver that
+	sets 'xUseBlockQueue' in its creation parameters gets a queue between the
+	I/O manager and itself: concurrent requests for adjacent sectors are
+	merged into one driver call, and the requests are ordered by task
+	priority and sector number.  This pays off for media where each command
+	has a cost of its own, such as SD cards and NOR flash.  The queue makes
+	the driver calls one at a time, so the I/O manager treats the device as
+	reentrant.
+
+	Set to 0 to always call the driver directly. */
+	#define	ffconfigBLOCK_QUEUE					0
+#endif
+
+#if !defined( ffconfigBLOCK_QUEUE_DEPTH )
+	/* The number of requests that a block queue can hold.  A task finding
+	the queue full waits for a free entry. */
+	#define	ffconfigBLOCK_QUEUE_DEPTH			8
+#endif
+
+#if !defined( ffconfigBLOCK_QUEUE_MERGE_SECTORS )
+	/* The largest number of sectors that merged requests may add up to.
+	Requests with buffers that do not follow each other in memory are merged
+	through a buffer of this many sectors, allocated with the queue. */
+	#define	ffconfigBLOCK_QUEUE_MERGE_SECTORS	16
+#endif
+
+#if !defined( ffconfigBLOCK_QUEUE_DEADLINE_MS )
+	/* A request that has waited this long is served before requests of a
+	higher priority or further along the disk. */
+	#define	ffconfigBLOCK_QUEUE_DEADLINE_MS		100
+#endif
+
 #if !defined( ffconfigCACHE_WRITE_THROUGH )
 	/* Input and output to a disk uses buffers that are only flushed at the
 	following times:
@@ -233,12 +479,17 @@ will be removed. */
 #endif
 
 #if !defined( ffconfigFINDAPI_ALLOW_WILDCARDS )
-	/* For now must be set to 0. */
+	/* Set to 1 to let ff_findfirst() filter on a pattern with '*' and '?' in
+	the last token of the path, e.g. "*.bin" in the directory "/ram/log".  A last token that ends
+	in ':' lists the entries that do not match.  A last token without any of
+	these characters is taken as the directory to be listed.  The pattern is
+	compiled once per ff_findfirst(), and entries are skipped on their first or
+	last characters before their long name is decoded. */
 	#define	ffconfigFINDAPI_ALLOW_WILDCARDS		0
 #endif
 
 #if !defined( ffconfigWILDCARD_CASE_INSENSITIVE )
-	/* For now must be set to 0. */
+	/* Set to 1 to let wild-card patterns ignore the case of ASCII letters. */
 	#define	ffconfigWILDCARD_CASE_INSENSITIVE	0
 #endif
 
@@ -285,6 +536,65 @@ will be removed. */
 	#endif
 #endif	/* ffconfigHASH_CACHE != 0 */
 
+#if !defined( ffconfigDIRENT_HINT_CACHE )
+	/* Set to 1 to remember, per directory, where free directory entries can be
+	found: the first free run of each length and the position of the
+	end-of-directory marker.  Creating many files in one directory then no
+	longer rescans all existing entries to find a free slot.
+
+	Set to 0 to always search for free entries from the start of the
+	directory. */
+	#define	ffconfigDIRENT_HINT_CACHE			0
+#endif
+
+#if !defined( ffconfigDIRENT_HINT_DEPTH )
+	/* Only used if ffconfigDIRENT_HINT_CACHE is 1.
+
+	Sets the number of directories for which free-entry hints are kept.  The
+	least recently used directory is forgotten when a new one is needed. */
+	#define	ffconfigDIRENT_HINT_DEPTH			8
+#endif
+
+#if !defined( ffconfigDEFERRED_DIRENT_UPDATE )
+	/* Set to 1 to keep changes to the size, the first cluster and the
+	modification time of an open file in its handle, and write them to its
+	directory entry only once: when the file is closed, when FF_SyncFile() or
+	ff_fflush() is called, or after ffconfigDIRENT_SYNC_INTERVAL_MS.
+
+	Set to 0 to write the first cluster of a file to its directory entry as
+	soon as it is allocated. */
+	#define	ffconfigDEFERRED_DIRENT_UPDATE		0
+#endif
+
+#if !defined( ffconfigDIRENT_SYNC_INTERVAL_MS )
+	/* Only used if ffconfigDEFERRED_DIRENT_UPDATE is 1.
+
+	When non-zero, a write to a file will also write its directory entry if
+	the entry has been out of date for at least this many milliseconds.  Set to
+	0 to only write it at close or sync. */
+	#define	ffconfigDIRENT_SYNC_INTERVAL_MS		0
+#endif
+
+#if !defined( ffconfigDIRECTORY_LOCKS )
+	/* Set to 1 to lock directories individually, keyed by their first cluster,
+	instead of taking a single lock for all directory changes on a volume.
+	Tasks that create or remove files in different directories can then work
+	in parallel.  The FAT itself is still protected by one lock.
+
+	Set to 0 to use a single directory lock per volume. */
+	#define	ffconfigDIRECTORY_LOCKS				0
+#endif
+
+#if !defined( ffconfigDIRECTORY_LOCK_DEPTH )
+	/* Only used if ffconfigDIRECTORY_LOCKS is 1.
+
+	Sets the number of directories that can be locked at the same time.  Each
+	slot holds a recursive mutex, so a waiting task of higher priority will
+	raise the priority of the owner.  A task that finds all slots in use waits
+	until one is released. */
+	#define	ffconfigDIRECTORY_LOCK_DEPTH		4
+#endif
+
 #if !defined( ffconfigMKDIR_RECURSIVE )
 	/* Set to 1 to add a parameter to ff_mkdir() that allows an entire directory
 	tree to be created in one go, rather than having to create one directory in
@@ -0,0 +1,119 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/*
+	ff_aio.h
+
+	Asynchronous versions of ff_fread(), ff_fwrite() and ff_fflush().  The
+	requests are queued and executed by a small pool of worker tasks, so the
+	caller can continue while the medium is busy.
+*/
+
+#ifndef FF_AIO_H
+#define FF_AIO_H
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+
+/* FreeRTOS+FAT includes. */
+#include "ff_headers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if( ffconfigAIO_SUPPORT != 0 )
+
+/* Return values of ff_aio_cancel(). */
+#define FF_AIO_CANCELED		0	/* The request was removed from the queue. */
+#define FF_AIO_NOTCANCELED	1	/* A worker is executing the request. */
+#define FF_AIO_ALLDONE		2	/* The request was not queued (any more). */
+
+/* Status of a request, see FF_AIORequest_t::xStatus. */
+typedef enum
+{
+	eAIOIdle = 0,		/* Never submitted. */
+	eAIOQueued,			/* Waiting for a worker. */
+	eAIOBusy,			/* Being executed by a worker. */
+	eAIODone,			/* Finished, lResult and iErrno are valid. */
+	eAIOCancelled		/* Removed from the queue by ff_aio_cancel(). */
+} eAIOStatus_t;
+
+struct xFF_AIO_REQUEST;
+typedef void ( *FF_AIOCallback_t )( struct xFF_AIO_REQUEST *pxRequest );
+
+/* A request must be cleared before it is submitted for the first time, and it
+must remain valid until it is done or cancelled.  The same request may be
+submitted again as soon as it is no longer queued or busy. */
+typedef struct xFF_AIO_REQUEST
+{
+	/* To be set by the caller. */
+	FF_FILE *pxFile;
+	void *pvBuffer;
+	uint32_t ulLength;
+	int32_t lOffset;				/* Absolute file offset, or -1 to use the current position. */
+	UBaseType_t uxPriority;			/* Requests with a higher value are executed first. */
+
+	/* Any combination of these will be used to signal completion. */
+	TaskHandle_t xNotifyTask;		/* Receives xTaskNotifyGive(). */
+	FF_AIOCallback_t fnCallback;	/* Called from the worker task. */
+	void *pvCallbackContext;
+	EventGroupHandle_t xEventGroup;	/* Gets 'uxEventBits' set. */
+	EventBits_t uxEventBits;
+
+	/* Results, valid once xStatus is eAIODone. */
+	volatile int32_t lResult;		/* Bytes transferred, or 0 / -1 as ff_fflush() returns. */
+	volatile int iErrno;			/* errno as set by the stdio function. */
+
+	/* Private to ff_aio.c. */
+	volatile eAIOStatus_t xStatus;
+	uint8_t ucOperation;
+	struct xFF_AIO_REQUEST *pxNext;
+} FF_AIORequest_t;
+
+/* Each function returns 0 when the request has been queued, or -1 with errno
+set when it could not be queued.  Requests for the same file are executed in
+the order in which they were submitted, regardless of their priority. */
+int ff_aio_read( FF_AIORequest_t *pxRequest );
+int ff_aio_write( FF_AIORequest_t *pxRequest );
+int ff_aio_fsync( FF_AIORequest_t *pxRequest );
+
+/* Remove a request from the queue if no worker has taken it yet.  Returns
+FF_AIO_CANCELED, FF_AIO_NOTCANCELED or FF_AIO_ALLDONE. */
+int ff_aio_cancel( FF_AIORequest_t *pxRequest );
+
+/* Returns pdTRUE once the request is no longer queued or busy. */
+BaseType_t ff_aio_done( const FF_AIORequest_t *pxRequest );
+
+#endif /* ffconfigAIO_SUPPORT */
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* FF_AIO_H */
@@ -0,0 +1,85 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/*
+	ff_blkqueue.h
+
+	An optional request queue between the I/O manager and a block device
+	driver.  Tasks that call FF_BlockRead() or FF_BlockWrite() at the same
+	time queue their requests, and the driver is called for one batch at a
+	time: requests for adjacent sectors are merged into a single driver call,
+	higher priority tasks are served first, and otherwise the queue sweeps
+	across the disk like an elevator.  A request that has waited longer than
+	ffconfigBLOCK_QUEUE_DEADLINE_MS is served next.
+*/
+
+#ifndef FF_BLKQUEUE_H
+#define FF_BLKQUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if( ffconfigBLOCK_QUEUE != 0 )
+
+/* Counters that show how well requests are being merged. */
+typedef struct xFF_BLOCK_QUEUE_STATS
+{
+	uint32_t ulRequests;		/* Requests passed to FF_BlockQueueTransfer(). */
+	uint32_t ulDriverCalls;		/* Transfers passed to the driver. */
+	uint32_t ulMerged;			/* Requests that shared a transfer with an earlier one. */
+	uint32_t ulCopied;			/* Transfers that went through the merge buffer. */
+	uint32_t ulExpired;			/* Requests served because their deadline had passed. */
+} FF_BlockQueueStats_t;
+
+/* Called by FF_CreateIOManger() when 'xUseBlockQueue' is set in the creation
+parameters.  It may also be called for an I/O manager that is not mounted. */
+FF_Error_t FF_BlockQueueCreate( FF_IOManager_t *pxIOManager );
+void FF_BlockQueueDelete( FF_IOManager_t *pxIOManager );
+
+/* Called by FF_BlockRead() and FF_BlockWrite(), it returns when the transfer
+is done, with the value returned by the driver. */
+int32_t FF_BlockQueueTransfer( FF_IOManager_t *pxIOManager, uint32_t ulSectorLBA, uint32_t ulNumSectors,
+	uint8_t *pucBuffer, BaseType_t xIsWrite );
+
+/* To be called by a driver that has an 'fnStartBlocks' function, when the
+transfer that was started has finished. */
+void FF_BlockQueueComplete( FF_Disk_t *pxDisk, int32_t lResult );
+void FF_BlockQueueCompleteFromISR( FF_Disk_t *pxDisk, int32_t lResult, BaseType_t *pxHigherPriorityTaskWoken );
+
+/* Keep the driver from being called while e.g. the flush hook runs. */
+void FF_BlockQueueLockDriver( FF_IOManager_t *pxIOManager );
+void FF_BlockQueueUnlockDriver( FF_IOManager_t *pxIOManager );
+
+void FF_BlockQueueGetStats( FF_IOManager_t *pxIOManager, FF_BlockQueueStats_t *pxStats );
+
+#endif /* ffconfigBLOCK_QUEUE */
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* FF_BLKQUEUE_H */
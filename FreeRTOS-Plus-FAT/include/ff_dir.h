@@ -54,6 +54,21 @@ typedef struct
 	FF_Buffer_t *pxBuffer;
 } FF_FetchContext_t;
 
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	/* A wild-card pattern as prepared by FF_WildCardCompile().  The literal
+	characters before the first and after the last '*' are compared first, the
+	segments between the stars are searched from left to right.  '?' matches
+	any character. */
+	typedef struct
+	{
+		uint16_t usLength;			/* Number of characters in the pattern. */
+		uint16_t usPrefixLength;	/* Characters before the first '*'. */
+		uint16_t usSuffixLength;	/* Characters after the last '*'. */
+		uint16_t usMinLength;		/* Characters that are not a '*'. */
+		BaseType_t xHasStar;
+	} FF_WildCard_t;
+#endif
+
 typedef struct
 {
 	uint32_t ulFileSize;
@@ -79,6 +94,7 @@ typedef struct
 		char pcWildCard[ ffconfigMAX_FILENAME ];
 	#endif
 	BaseType_t xInvertWildCard;
+	FF_WildCard_t xWildCard;
 #endif
 
 #if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
@@ -112,6 +128,19 @@ typedef struct
 
 FF_Error_t FF_FindNext( FF_IOManager_t *pxIOManager, FF_DirEnt_t *pxDirent );
 
+#if( ffconfigFINDAPI_ALLOW_WILDCARDS != 0 )
+	/* FF_WildCardCompile() may change 'pcPattern': stars are merged and, when
+	ffconfigWILDCARD_CASE_INSENSITIVE is set, letters are put in lower case.
+	FF_WildCardMatch() must be called with the same pattern. */
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+		void FF_WildCardCompile( FF_WildCard_t *pxWildCard, FF_T_WCHAR *pcPattern );
+		BaseType_t FF_WildCardMatch( const FF_WildCard_t *pxWildCard, const FF_T_WCHAR *pcPattern, const FF_T_WCHAR *pcName );
+	#else
+		void FF_WildCardCompile( FF_WildCard_t *pxWildCard, char *pcPattern );
+		BaseType_t FF_WildCardMatch( const FF_WildCard_t *pxWildCard, const char *pcPattern, const char *pcName );
+	#endif
+#endif
+
 static portINLINE void FF_RewindFind( FF_DirEnt_t *pxDirent )
 {
 	pxDirent->usCurrentItem = 0;
@@ -179,6 +208,11 @@ typedef struct _FF_FIND_PARAMS FF_FindParams_t;
 int32_t FF_FindShortName( FF_IOManager_t *pxIOManager, FF_FindParams_t *findParams );
 
 FF_Error_t FF_CreateDirent( FF_IOManager_t *pxIOManager, FF_FindParams_t *findParams, FF_DirEnt_t *pxDirent );
+#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+	FF_Error_t FF_RenameDirent( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, uint16_t usEntry, FF_T_WCHAR *pcName, uint16_t *pusNewEntry );
+#else
+	FF_Error_t FF_RenameDirent( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster, uint16_t usEntry, char *pcName, uint16_t *pusNewEntry );
+#endif
 FF_Error_t FF_ExtendDirectory( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster );
 FF_Error_t FF_RmLFNs( FF_IOManager_t *pxIOManager, uint16_t usDirEntry, FF_FetchContext_t *pContext );
 
@@ -190,6 +224,10 @@ FF_Error_t FF_RmLFNs( FF_IOManager_t *pxIOManager, uint16_t usDirEntry, FF_Fetch
 	void FF_UnHashDir( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster );
 #endif
 
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	void FF_UnHintDir( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster );
+#endif
+
 struct SBuffStats {
 	unsigned sectorMatch;
 	unsigned sectorMiss;
@@ -145,6 +145,13 @@
 #define FF_SETFILETIME				( ( 24		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
 #define FF_INITBUF					( ( 25		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
 #define FF_SETEOF					( ( 26		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_SYNCFILE					( ( 27		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_READBORROW				( ( 28		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_READRELEASE				( ( 29		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_MAPFILE					( ( 30		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_READV					( ( 31		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_WRITEV					( ( 32		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_COPYFILE					( ( 33		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
 
 /*----- FF_FAT - The FreeRTOS+FAT FAT handling routines. */
 #define FF_GETFATENTRY				( ( 1		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FAT )
@@ -216,6 +223,8 @@
 #define FF_ERR_FILE_READ_ZERO				44	/* Used internally. */
 #define FF_ERR_FILE_SEEK_INVALID_ORIGIN		45	/* Seeking beyond end of file. */
 #define FF_ERR_FILE_SEEK_INVALID_POSITION	46	/* Bad value for the 'whence' parameter. */
+#define FF_ERR_FILE_NOT_MAPPABLE			47	/* The medium can not be accessed in place. */
+#define FF_ERR_FILE_BORROW_LIMIT			48	/* No more cache buffers can be lent out. */
 
 /* Directory Error Codes                    50 + */
 #define FF_ERR_DIR_OBJECT_EXISTS			50	/* A file or folder of the same name already exists in the current directory. */
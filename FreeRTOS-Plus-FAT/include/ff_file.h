@@ -65,23 +65,93 @@ typedef struct _FF_FILE
 	uint32_t ulFilePointer;			/* Current Position Pointer. */
 	uint32_t ulDirCluster;			/* Cluster Number that the Dirent is in. */
 	uint32_t ulValidFlags;			/* Handle validation flags. */
+	uint32_t ulHandleTag;			/* FF_FILE_HANDLE_TAG() while the handle is open, see FF_CheckValid(). */
 
 #if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
 	uint8_t *pucBuffer;				/* A buffer for providing fast unaligned access. */
 	uint8_t ucState;				/* State information about the buffer. */
+#endif
+#if( ffconfigZERO_COPY_READ != 0 )
+	FF_Buffer_t *pxBorrowed;		/* Cache buffer lent out by FF_ReadBorrow(), or NULL. */
 #endif
 	uint8_t ucMode;					/* Mode that File Was opened in. */
 	uint16_t usDirEntry;			/* Dirent Entry Number describing this file. */
+#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+	uint8_t ucDirentDirty;			/* FF_DIRENT_DIRTY_xxx: changes not yet written to the directory entry. */
+	#if( ffconfigDIRENT_SYNC_INTERVAL_MS != 0 )
+		TickType_t xDirentDirtyTime;	/* Time at which the entry became dirty. */
+	#endif
+#endif
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	uint8_t *pucStdioBuffer;		/* Stream buffer set by ff_setvbuf(), or NULL. */
+	uint32_t ulStdioSize;			/* Size of pucStdioBuffer. */
+	uint32_t ulStdioIndex;			/* Next byte to read from, or to write to, pucStdioBuffer. */
+	uint32_t ulStdioCount;			/* Number of bytes read ahead into pucStdioBuffer. */
+	uint8_t ucStdioFlags;			/* FF_STDIO_xxx. */
+#endif
+
+#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	uint8_t *pucLogSector;			/* FF_MODE_LOG: copy of the sector that holds the end of the file. */
+	uint32_t ulLogSectorLBA;		/* LBA of pucLogSector, or 0 when it must be fetched. */
+	BaseType_t xLogDirty;			/* pucLogSector has bytes that are not written yet. */
+	TickType_t xLogSyncTime;		/* Time at which the size was last written to the directory entry. */
+	void *pvLogMutex;				/* Serialises the tasks that append through this handle. */
+#endif
 
 #if( ffconfigDEV_SUPPORT != 0 )
 	struct SFileCache *pxDevNode;
 #endif
 	struct _FF_FILE *pxNext;		/* Pointer to the next file object in the linked list. */
+	struct _FF_FILE *pxNextHandle;	/* Next open handle with the same address hash, see FF_CheckValid(). */
 } FF_FILE;
 
 #define FF_VALID_FLAG_INVALID	0x00000001
 #define FF_VALID_FLAG_DELETED	0x00000002
 
+/* The value of 'FF_FILE::ulHandleTag' for a handle that is open on the current
+mount of pxIOManager. */
+#define FF_FILE_HANDLE_TAG( pxIOManager )	( ( ( pxIOManager )->ulMountGeneration << 8 ) | 0xF5ul )
+
+#if( ffconfigDEFERRED_DIRENT_UPDATE != 0 )
+	/* Bits in 'FF_FILE::ucDirentDirty'. */
+	#define FF_DIRENT_DIRTY_CLUSTER		0x01	/* The first cluster of the file has changed. */
+	#define FF_DIRENT_DIRTY_SIZE		0x02	/* The file size has changed. */
+	#define FF_DIRENT_DIRTY_MODIFIED	0x04	/* The file was written, update the modification time. */
+#endif
+
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	/* Bits in 'FF_FILE::ucStdioFlags', maintained by ff_stdio.c. */
+	#define FF_STDIO_READING			0x01	/* The stream buffer holds data that was read ahead. */
+	#define FF_STDIO_WRITING			0x02	/* The stream buffer holds data that is not written yet. */
+	#define FF_STDIO_LINE				0x04	/* Line buffered: write out after each linefeed. */
+	#define FF_STDIO_ALLOCATED			0x08	/* The stream buffer was allocated by ff_setvbuf(). */
+#endif
+
+/* One buffer of a vectored read or write. */
+typedef struct xFF_IOVEC
+{
+	void *pvBuffer;
+	uint32_t ulLength;
+} FF_IOVec_t;
+
+#if( ffconfigMMAP_SUPPORT != 0 )
+	/* A part of a mapped file that is stored contiguously. */
+	typedef struct xFF_MAP_EXTENT
+	{
+		const uint8_t *pucData;
+		uint32_t ulLength;
+	} FF_MapExtent_t;
+
+	typedef struct xFF_MAPPING
+	{
+		FF_FILE *pxFile;				/* Keeps the file from being changed or removed. */
+		uint32_t ulLength;				/* The size of the file. */
+		uint32_t ulExtentCount;			/* 1 when the file is contiguous, 0 when it is empty. */
+		FF_MapExtent_t *pxExtents;		/* The file's data, in order. */
+	} FF_Mapping_t;
+#endif
+
 /*---------- PROTOTYPES */
 /* PUBLIC (Interfaces): */
 
@@ -101,6 +171,19 @@ typedef struct _FF_FILE
 		BaseType_t bDeleteIfExists );
 #endif	/* ffconfigUNICODE_UTF16_SUPPORT */
 
+#if( ffconfigCOPYFILE_SUPPORT != 0 )
+	/* Flags for FF_CopyFile(). */
+	#define FF_COPY_OVERWRITE	0x01	/* Replace the destination when it exists. */
+
+	#if( ffconfigUNICODE_UTF16_SUPPORT != 0 )
+		FF_Error_t FF_CopyFile( FF_IOManager_t *pxIOManager, const FF_T_WCHAR *pcSourceFile, const FF_T_WCHAR *pcDestFile,
+			BaseType_t xFlags );
+	#else
+		FF_Error_t FF_CopyFile( FF_IOManager_t *pxIOManager, const char *pcSourceFile, const char *pcDestFile,
+			BaseType_t xFlags );
+	#endif
+#endif	/* ffconfigCOPYFILE_SUPPORT */
+
 #if( ffconfigTIME_SUPPORT != 0 )
 	enum {
 		ETimeCreate = 1,
@@ -124,11 +207,33 @@ typedef struct _FF_FILE
 
 FF_Error_t FF_SetEof( FF_FILE *pFile );
 
+/* Write pending changes of an open file to its directory entry and flush the
+cache, so they will survive a power failure. */
+FF_Error_t FF_SyncFile( FF_FILE *pFile );
+
 FF_Error_t FF_Close( FF_FILE *pFile );
+#if( ffconfigMMAP_SUPPORT != 0 )
+	/* Map a file that was opened for reading only.  On success, the mapping
+	owns the handle and FF_UnmapFile() will close it. */
+	FF_Mapping_t *FF_MapFile( FF_FILE *pFile, FF_Error_t *pxError );
+	FF_Error_t FF_UnmapFile( FF_Mapping_t *pxMapping );
+#endif
 int32_t FF_GetC( FF_FILE *pFile );
 int32_t FF_GetLine( FF_FILE *pFile, char *szLine, uint32_t ulLimit );
 int32_t FF_Read( FF_FILE *pFile, uint32_t ElementSize, uint32_t Count, uint8_t *buffer );
+#if( ffconfigZERO_COPY_READ != 0 )
+	/* Read without copying: '*ppucData' will point into a cache buffer that
+	holds at most 'ulMaxLength' bytes from the current position, up to the end
+	of the sector.  The buffer stays valid until FF_ReadRelease(), the next
+	FF_ReadBorrow() or FF_Close().  Returns the number of bytes lent out, 0 at
+	the end of the file, or a negative error code.  FF_ERR_FILE_BORROW_LIMIT
+	means that all the cache buffers that may be lent out are in use. */
+	int32_t FF_ReadBorrow( FF_FILE *pFile, uint32_t ulMaxLength, const uint8_t **ppucData );
+	FF_Error_t FF_ReadRelease( FF_FILE *pFile );
+#endif
 int32_t FF_Write( FF_FILE *pFile, uint32_t ElementSize, uint32_t Count, uint8_t *buffer );
+int32_t FF_ReadV( FF_FILE *pFile, const FF_IOVec_t *pxVector, BaseType_t xCount );
+int32_t FF_WriteV( FF_FILE *pFile, const FF_IOVec_t *pxVector, BaseType_t xCount );
 BaseType_t FF_isEOF( FF_FILE *pFile );
 int32_t FF_BytesLeft( FF_FILE *pFile ); /* Returns # of bytes left to read. */
 
@@ -154,6 +259,21 @@ uint8_t	FF_GetModeBits( const char *Mode );
 
 FF_Error_t FF_CheckValid( FF_FILE *pFile );   /* Check if pFile is a valid FF_FILE pointer. */
 
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	/* The handle that FF_CheckValid() accepted last, or NULL once that handle
+	has been closed.  ff_stdio.c compares a stream against it before it takes
+	a character from, or puts one into, the stream buffer, instead of looking
+	the handle up for every character. */
+	extern FF_FILE * volatile pxFFLastValidFile;
+#endif
+
+/* Iterate over the open files of pxIOManager, starting with pxFile == NULL.
+The caller must hold the I/O manager semaphore. */
+FF_FILE *FF_NextOpenFile( FF_IOManager_t *pxIOManager, FF_FILE *pxFile );
+
+/* Called by FF_Mount(): forget the open files of a previous mount. */
+void FF_ResetOpenFiles( FF_IOManager_t *pxIOManager );
+
 #if( ffconfigREMOVABLE_MEDIA != 0 )
 	int32_t FF_Invalidate( FF_IOManager_t *pxIOManager ); /* Invalidate all handles belonging to pxIOManager. */
 #endif
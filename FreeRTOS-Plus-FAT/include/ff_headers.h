@@ -51,6 +51,7 @@ extern "C" {
 #include "ff_string.h"
 #include "ff_format.h"
 #include "ff_locking.h"
+#include "ff_blkqueue.h"
 
 /* See if any older defines with a prefix "FF_" are still defined: */
 #include "ff_old_config_defines.h"
@@ -51,6 +51,7 @@ extern "C" {
 #define FF_MODE_APPEND			0x04		/* FILE Mode Append Access. */
 #define	FF_MODE_CREATE			0x08		/* FILE Mode Create file if not existing. */
 #define FF_MODE_TRUNCATE		0x10		/* FILE Mode Truncate an Existing file. */
+#define FF_MODE_LOG				0x20		/* FILE Mode Append-only log file, see ffconfigLOG_FILE_SUPPORT. */
 #define FF_MODE_VIRGIN			0x40		/* Buffer mode: do not fetch content from disk. Used for write-only buffers. */
 #define FF_MODE_DIR				0x80		/* Special Mode to open a Dir. (Internal use ONLY!) */
 
@@ -109,12 +110,63 @@ typedef struct
 	BaseType_t FF_isHashSet( FF_HashTable_t *pxHash, uint32_t ulHash );
 #endif /* ffconfigHASH_CACHE */
 
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	/* Free runs of 1 .. FF_DIRENT_HINT_CLASSES entries are tracked separately.
+	Longer runs share the last class. */
+	#define FF_DIRENT_HINT_CLASSES		8
+	#define FF_DIRENT_HINT_UNKNOWN		0xFFFFu
+
+	/* usFreeRun[ x ] is a lower bound: no run of ( x + 1 ) free entries starts
+	before it.  usEndOfDir is the index of the 0x00 end-of-directory marker, from
+	where on all entries are free, or FF_DIRENT_HINT_UNKNOWN. */
+	struct xDIRENT_HINT
+	{
+		uint32_t ulDirCluster;		/* The Starting Cluster of the dir that the hints describe. */
+		uint32_t ulLastUsed;		/* Age stamp, the oldest hint will be recycled. */
+		uint16_t usEndOfDir;
+		uint16_t usFreeRun[ FF_DIRENT_HINT_CLASSES ];
+	};
+
+	typedef struct xDIRENT_HINT FF_DirentHint_t;
+#endif /* ffconfigDIRENT_HINT_CACHE */
+
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	/* A slot in the table of directory locks.  A slot is bound to a directory
+	as long as at least one task holds or waits for its lock. */
+	struct xDIR_LOCK
+	{
+		uint32_t ulDirCluster;		/* The Starting Cluster of the locked dir. */
+		UBaseType_t uxUsers;		/* Number of tasks holding or waiting for this lock. */
+		void *pvMutex;				/* A recursive mutex, which gives priority inheritance. */
+	};
+
+	typedef struct xDIR_LOCK FF_DirLock_t;
+#endif /* ffconfigDIRECTORY_LOCKS */
+
 /* A forward declaration for the I/O manager, to be used in 'struct xFFDisk'. */
 struct _FF_IOMAN;
 struct xFFDisk;
 
 typedef void ( *FF_FlushApplicationHook )( struct xFFDisk *pxDisk );
 
+#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+	/* Drivers of media that are addressable memory, such as a RAM disk, may
+	return the address of 'ulSectorNumber' when 'ulSectorCount' sectors are
+	stored contiguously from there, or NULL.  Used by FF_MapFile() and by
+	FF_GetBuffer(). */
+	typedef uint8_t *( *FF_MapBlocksHook )( struct xFFDisk *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount );
+#endif
+
+#if( ffconfigBLOCK_QUEUE != 0 )
+	/* Drivers that can transfer in the background, e.g. with DMA, may start
+	a transfer, return 0 and call FF_BlockQueueComplete() or
+	FF_BlockQueueCompleteFromISR() when it is done.  Any other value is taken
+	as the result of the transfer.  Only used by the block queue, which also
+	falls back to the read and write functions before the scheduler runs. */
+	typedef int32_t ( *FF_StartBlocksHook )( struct xFFDisk *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber,
+		uint32_t ulSectorCount, BaseType_t xIsWrite );
+#endif
+
 /*
  * Some low-level drivers also need to flush data to a device.
  * Use an Application hook that will be called every time when
@@ -165,6 +217,16 @@ struct xFFDisk
 	/* See comments here above. */
 	FF_FlushApplicationHook fnFlushApplicationHook;
 
+#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+	/* Optional, see comments here above. */
+	FF_MapBlocksHook fnMapBlocks;
+#endif
+
+#if( ffconfigBLOCK_QUEUE != 0 )
+	/* Optional, see comments here above. */
+	FF_StartBlocksHook fnStartBlocks;
+#endif
+
 	/* Field that can optionally be set to a signature that is unique to the
 	media.  Read and write functions can check the ulSignature field to validate
 	the media type before they attempt to access the pvTag field, or perform any
@@ -200,7 +262,9 @@ typedef struct
 	uint8_t			*pucBuffer;		/* Pointer to the cache block. */
 	uint32_t		ucMode : 8,		/* Read or Write mode. */
 					bModified : 1,	/* If the sector was modified since read. */
-					bValid : 1;		/* Initially FALSE. */
+					bValid : 1,		/* Initially FALSE. */
+					bLoading : 1,	/* The sector is being read outside the semaphore, see FF_GetBuffer(). */
+					bMapped : 1;	/* pucBuffer points at the sector in the memory of the disk. */
 	uint16_t		usNumHandles;	/* Number of objects using this buffer. */
 	uint16_t		usPersistance;	/* For the persistance algorithm. */
 } FF_Buffer_t;
@@ -264,8 +328,12 @@ typedef struct
  *	FreeRTOS+FAT functions around an object like this.
  **/
 #define FF_FAT_LOCK			0x01	/* Lock bit mask for FAT table locking. */
-#define FF_DIR_LOCK			0x02	/* Lock bit mask for DIR modification locking. */
+#define FF_DIR_LOCK			0x02	/* Lock bit mask for DIR modification locking, or for a free slot in 'xDirLocks'. */
 #define FF_BUF_LOCK			0x04	/* Lock bit mask for buffers. */
+#define FF_FAT_READ_LOCK	0x08	/* Set when the last reader has released the FAT, see FF_LockFATRead(). */
+
+/* The block queue, private to ff_blkqueue.c. */
+struct xFF_BLOCK_QUEUE;
 
 /**
  *	@public
@@ -278,17 +346,39 @@ typedef struct _FF_IOMAN
 	FF_Partition_t	xPartition;			/* A partition description. */
 	FF_Buffer_t		*pxBuffers;			/* Pointer to an array of buffer descriptors. */
 	void			*pvSemaphore;		/* Pointer to a Semaphore object. (For buffer description modifications only!). */
-	void			*FirstFile;			/* Pointer to the first File object. */
+	void			*pvOpenFiles[ ffconfigOPEN_FILE_BUCKETS ];	/* The open files, hashed on their directory entry, see FF_NextOpenFile(). */
+	UBaseType_t		uxOpenFiles;		/* The number of handles in 'pvOpenFiles'. */
+	uint32_t		ulMountGeneration;	/* Incremented at every mount, part of FF_FILE_HANDLE_TAG(). */
 	void			*xEventGroup;		/* An event group, used for locking FAT, DIR and Buffers. Replaces ucLocks. */
 	uint8_t			*pucCacheMem;		/* Pointer to a block of memory for the cache. */
 	uint16_t		usSectorSize;		/* The sector size that IOMAN is configured to. */
 	uint16_t		usCacheSize;		/* Size of the cache in number of Sectors. */
 	uint8_t			ucPreventFlush;		/* Flushing to disk only allowed when 0. */
 	uint8_t			ucFlags;			/* Bit-Mask: identifying allocated pointers and other flags */
+#if( ffconfigZERO_COPY_READ != 0 )
+	uint16_t		usBorrowedBuffers;	/* The number of cache buffers lent out by FF_ReadBorrow(). */
+#endif
 #if( ffconfigHASH_CACHE != 0 )
 	FF_HashTable_t	xHashCache[ ffconfigHASH_CACHE_DEPTH ];
+#endif
+#if( ffconfigDIRENT_HINT_CACHE != 0 )
+	FF_DirentHint_t	xDirentHints[ ffconfigDIRENT_HINT_DEPTH ];
+	uint32_t		ulDirentHintAge;	/* Incremented on every hint lookup, for the LRU. */
+#endif
+#if( ffconfigDIRECTORY_LOCKS != 0 )
+	FF_DirLock_t	xDirLocks[ ffconfigDIRECTORY_LOCK_DEPTH ];
 #endif
 	void			*pvFATLockHandle;
+#if( ffconfigCONCURRENT_READS != 0 )
+	volatile UBaseType_t uxFATReaders;	/* The number of tasks that hold FF_LockFATRead(). */
+#endif
+#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+	void			*pvFileHandlePool;	/* An array of ffconfigFILE_HANDLE_POOL_SIZE file handles, followed by their sector buffers. */
+	void			*pvFreeFileHandles;	/* The handles of the pool that are not in use, linked through 'pxNext'. */
+#endif
+#if( ffconfigBLOCK_QUEUE != 0 )
+	struct xFF_BLOCK_QUEUE *pxBlockQueue;	/* NULL when the driver is called directly. */
+#endif
 } FF_IOManager_t;
 
 /* Bit values for 'FF_IOManager_t::ucFlags': */
@@ -310,6 +400,9 @@ typedef struct xFF_CREATION_PARAMETERS
 	FF_Disk_t *pxDisk;				/* Some properties of the disk driver. */
 	void *pvSemaphore;				/* Pointer to a Semaphore object. */
 	BaseType_t xBlockDeviceIsReentrant;	/* Make non-zero if ffRead/ffWrite are re-entrant. */
+#if( ffconfigBLOCK_QUEUE != 0 )
+	BaseType_t xUseBlockQueue;		/* Make non-zero to pass the requests through a block queue. */
+#endif
 } FF_CreationParameters_t;
 
 /*---------- PROTOTYPES (in order of appearance). */
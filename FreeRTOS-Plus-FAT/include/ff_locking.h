@@ -49,17 +49,29 @@ BaseType_t	FF_TrySemaphore			( void *pSemaphore, uint32_t TimeMs );
 void		FF_ReleaseSemaphore		( void *pSemaphore );
 void		FF_Sleep				( uint32_t TimeMs );
 
+/* Create and delete a recursive mutex that is taken with FF_PendSemaphore(). */
+void		*FF_CreateSemaphore		( void );
+void		FF_DeleteSemaphore		( void *pSemaphore );
+
 /* Create an event group and bind it to an I/O manager. */
 BaseType_t	FF_CreateEvents( FF_IOManager_t *pxIOManager );
 
 /* Delete an event group. */
 void FF_DeleteEvents( FF_IOManager_t *pxIOManager );
 
-/* Get a lock on all DIR operations for a given I/O manager. */
-void FF_LockDirectory( FF_IOManager_t *pxIOManager );
+/* Get a lock on changes to the directory that starts at 'ulDirCluster'.  When
+ffconfigDIRECTORY_LOCKS is 0, all directories of the I/O manager are locked. */
+void FF_LockDirectory( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster );
+
+/* Release the lock obtained with FF_LockDirectory(). */
+void FF_UnlockDirectory( FF_IOManager_t *pxIOManager, uint32_t ulDirCluster );
+
+/* Lock a directory and its subdirectory 'ulDirCluster' together, the parent
+first.  No other directory lock may be held by the calling task. */
+void FF_LockDirectoryPair( FF_IOManager_t *pxIOManager, uint32_t ulParentCluster, uint32_t ulDirCluster );
 
-/* Release the lock on all DIR operations. */
-void FF_UnlockDirectory( FF_IOManager_t *pxIOManager );
+/* Release the locks obtained with FF_LockDirectoryPair(). */
+void FF_UnlockDirectoryPair( FF_IOManager_t *pxIOManager, uint32_t ulParentCluster, uint32_t ulDirCluster );
 
 /* Get a lock on all FAT operations for a given I/O manager. */
 void FF_LockFAT( FF_IOManager_t *pxIOManager );
@@ -67,6 +79,19 @@ void FF_LockFAT( FF_IOManager_t *pxIOManager );
 /* Release the lock on all FAT operations. */
 void FF_UnlockFAT( FF_IOManager_t *pxIOManager );
 
+#if( ffconfigCONCURRENT_READS != 0 )
+	/* Get a shared lock on the FAT for walking cluster chains.  Any number of
+	tasks may hold it, FF_LockFAT() waits until they have all released it.  The
+	lock is not recursive. */
+	void FF_LockFATRead( FF_IOManager_t *pxIOManager );
+
+	/* Release the lock obtained with FF_LockFATRead(). */
+	void FF_UnlockFATRead( FF_IOManager_t *pxIOManager );
+#else
+	#define FF_LockFATRead( pxIOManager )		FF_LockFAT( pxIOManager )
+	#define FF_UnlockFATRead( pxIOManager )		FF_UnlockFAT( pxIOManager )
+#endif
+
 /* Called from FF_GetBuffer() as long as no buffer is available. */
 BaseType_t FF_BufferWait( FF_IOManager_t *pxIOManager, uint32_t xWaitMS );
 
@@ -56,6 +56,11 @@ extern "C" {
 /* Error return from some functions. */
 #define FF_EOF	(-1)
 
+/* Buffering modes for ff_setvbuf(). */
+#define FF_IOFBF	0	/* Fully buffered. */
+#define FF_IOLBF	1	/* Line buffered. */
+#define FF_IONBF	2	/* Unbuffered. */
+
 /* Bits used in the FF_Stat_t structure. */
 #define	FF_IFDIR	0040000u	/* directory */
 #define	FF_IFCHR	0020000u	/* character special */
@@ -191,6 +196,30 @@ int ff_feof( FF_FILE *pxStream );
 size_t ff_fread( void *pvBuffer, size_t xSize, size_t xItems, FF_FILE * pxStream );
 size_t ff_fwrite( const void *pvBuffer, size_t xSize, size_t xItems, FF_FILE * pxStream );
 
+/* Equivalent to readv() and writev(): transfer a number of buffers in one
+call.  Return the number of bytes transferred, or -1 and set errno. */
+int32_t ff_readv( FF_FILE *pxStream, const FF_IOVec_t *pxVector, int iCount );
+int32_t ff_writev( FF_FILE *pxStream, const FF_IOVec_t *pxVector, int iCount );
+
+#if( ffconfigZERO_COPY_READ != 0 )
+	/* Like ff_fread(), but without a copy: '*ppvData' will point to at most
+	'xMaxLength' bytes of the file inside a cache buffer, never past the end of
+	a sector.  Call again for the next part.  The data stays valid until
+	ff_fread_release(), the next ff_fread_zc() or ff_fclose() on the stream. */
+	size_t ff_fread_zc( const void **ppvData, size_t xMaxLength, FF_FILE * pxStream );
+	int ff_fread_release( FF_FILE *pxStream );
+#endif
+
+#if( ffconfigMMAP_SUPPORT != 0 )
+	/* Map a file on a RAM-resident volume for reading in place.  When the file
+	is contiguous, 'pxExtents[ 0 ]' covers all of it; otherwise the extents
+	list its parts in order.  The file can not be written, truncated, renamed
+	or removed until ff_munmap() is called.  Returns NULL and sets errno on
+	failure. */
+	FF_Mapping_t *ff_mmap_ro( const char *pcFile );
+	int ff_munmap( FF_Mapping_t *pxMapping );
+#endif
+
 /* Whenever possible, use ellipsis parameter type checking.
 _RB_ Compiler specifics need to be moved to the compiler specific header files. */
 #if defined(__GNUC__)
@@ -205,6 +234,17 @@ int ff_fgetc( FF_FILE * pxStream);
 int ff_fputc( int iChar, FF_FILE *pxStream );
 char *ff_fgets( char *pcBuffer, size_t xCount, FF_FILE *pxStream );
 
+#if( ffconfigSTDIO_BUFFERS != 0 )
+	/* Equivalent to setvbuf(): give the stream a buffer of 'xSize' bytes, in
+	which ff_fgetc(), ff_fputc(), ff_fgets() and ff_fprintf() do their work.
+	When 'pcBuffer' is NULL the buffer will be allocated, and freed when the
+	stream is closed.  'iMode' is FF_IOFBF, FF_IOLBF or FF_IONBF.  Pending
+	data is written out by the other stdio functions, which see the position
+	that the caller sees.  Use ff_fclose(), not FF_Close(), on such a stream.
+	A buffered stream must not be shared between tasks. */
+	int ff_setvbuf( FF_FILE *pxStream, char *pcBuffer, int iMode, size_t xSize );
+#endif
+
 
 /*-----------------------------------------------------------
  * Change length of file (truncate)
@@ -291,6 +331,13 @@ int ff_remove( const char *pcPath );
  *-----------------------------------------------------------*/
 int ff_rename( const char *pcOldName, const char *pcNewName, int bDeleteIfExists );
 
+#if( ffconfigCOPYFILE_SUPPORT != 0 )
+	/* Copy a file within a file system, without a buffer of the caller.  'iFlags'
+	may contain FF_COPY_OVERWRITE to replace an existing 'pcDest'.  Returns 0,
+	or -1 and sets errno, e.g. to EEXIST or to EXDEV for different volumes. */
+	int ff_copyfile( const char *pcSource, const char *pcDest, int iFlags );
+#endif
+
 
 /*-----------------------------------------------------------
  * Get the status of a file.
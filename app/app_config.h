@@ -62,4 +62,13 @@ limitations under the License.
  */
 #define RECV_BUFFER_LEN                  ( 50 )
 
+/* Settings for ramdisk.c */
+
+/*
+ * When set to 1, the RAM disk is mounted from the FAT image that the build
+ * generates from build/rootfs, instead of being formatted at start-up and
+ * filled by unpacking the tar file.
+ */
+#define RAMDISK_FROM_IMAGE               ( 1 )
+
 #endif  /* _APP_CONFIG_H_ */
@@ -85,6 +85,7 @@ void startupTask(void* pvParameters)
     lResult = ff_chdir( "/ram" );
     printf("Status of ff_chdir = %ld\n",lResult);
 
+#if ( RAMDISK_FROM_IMAGE == 0 )
     /*
     ** Unpack tar file
     */
@@ -98,6 +99,13 @@ void startupTask(void* pvParameters)
                 (unsigned long)&_binary_tarfile_size);
 
     printf("Utar_FromMemory returned - status = %d\n",status); 
+#else
+    /*
+    ** The RAM disk was mounted from a prebuilt image, the files in
+    ** build/rootfs are already there.
+    */
+    (void) status;
+#endif
 
     /* 
     ** For this demo, create two tasks: 
@@ -0,0 +1,408 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Scheduler include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "portmacro.h"
+
+/* FreeRTOS+FAT includes. */
+#include "ff_headers.h"
+#include "ff_filedisk.h"
+#include "ff_sys.h"
+
+/*
+ * A disk that keeps its sectors in a file of the host, for the Posix port of
+ * FreeRTOS.  The file is a plain disk image, like the ones written by
+ * tools/mkfatimage, and it can be examined with the tools of the host after
+ * the simulation ends.
+ *
+ * Sectors are transferred with pread() and pwrite().  These do not share a
+ * file position, so the driver is reentrant.  Nothing is cached by the
+ * driver itself: what is not in the cache of the I/O manager comes from the
+ * page cache of the host.
+ */
+
+#define fileHIDDEN_SECTOR_COUNT		8
+#define filePRIMARY_PARTITIONS		1
+#define filePARTITION_NUMBER		0 /* Only a single partition is used. */
+
+/* Used as a magic number to indicate that an FF_Disk_t structure is a file
+disk. */
+#define fileSIGNATURE				0x46494c45
+
+/* The file descriptor is stored in the pvTag member of the FF_Disk_t
+structure. */
+#define fileDESCRIPTOR( pxDisk )	( ( int ) ( intptr_t ) ( pxDisk )->pvTag )
+
+/* The size of the sectors, as passed to FF_FileDiskInit(). */
+#define fileSECTOR_SIZE( pxDisk )	( ( uint32_t ) ( pxDisk )->pxIOManager->usSectorSize )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The functions that read from and write to the file.
+ */
+static int32_t prvReadFile( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+static int32_t prvWriteFile( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*
+ * Checks the parameters of a read or a write, returns lOutOfBounds when the
+ * sectors are not on the disk.
+ */
+static int32_t prvCheckAccess( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, int32_t lOutOfBounds );
+
+/*
+ * Transfers the sectors, continuing after partial transfers and after
+ * interruptions by the tick signal of the Posix port.
+ */
+static int32_t prvTransfer( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, BaseType_t xIsWrite );
+
+/*
+ * Partitions and formats a new disk.
+ */
+static FF_Error_t prvPartitionAndFormatDisk( FF_Disk_t *pxDisk );
+
+/*-----------------------------------------------------------*/
+
+/* Create a disk on the host file pcFileName, which is created when it does
+not exist.
+
+ + The sectors are ulSectorSize bytes: 512, 1024, 2048 or 4096.  A file
+   that holds a disk must be opened with the sector size it was formatted
+   with.
+ + A file that is shorter than ulSectorCount sectors is extended with zeros.
+   This does not take space on the host until the sectors are written.  Like
+   the RAM disk, the disk can so be mounted from an image of mkfatimage,
+   which only holds the sectors in use.  ulSectorCount must then be the disk
+   size that was passed to mkfatimage.
+ + An empty file is partitioned and formatted.
+ + A longer file is mounted as it is, its size determines the number of
+   sectors.
+ + xIOManagerCacheSize is the size of the IO manager's cache, which must be a
+   multiple of the sector size, and at least twice as big as the sector size.
+ + With xUseBlockQueue, the requests of the I/O manager pass through a block
+   queue (ff_blkqueue.c), which needs ffconfigBLOCK_QUEUE.
+*/
+FF_Disk_t *FF_FileDiskInit( char *pcName, const char *pcFileName, uint32_t ulSectorCount, uint32_t ulSectorSize,
+	size_t xIOManagerCacheSize, BaseType_t xUseBlockQueue )
+{
+FF_Error_t xError = FF_ERR_NONE;
+FF_Disk_t *pxDisk = NULL;
+FF_CreationParameters_t xParameters;
+struct stat xStat;
+BaseType_t xFileOk = pdFALSE;
+BaseType_t xMustFormat = pdFALSE;
+int iFile;
+
+	/* Check the validity of the ulSectorSize and xIOManagerCacheSize
+	parameters. */
+	configASSERT( ( ulSectorSize == 512 ) || ( ulSectorSize == 1024 ) || ( ulSectorSize == 2048 ) || ( ulSectorSize == 4096 ) );
+	configASSERT( ( xIOManagerCacheSize % ulSectorSize ) == 0 );
+	configASSERT( ( xIOManagerCacheSize >= ( 2 * ulSectorSize ) ) );
+
+	iFile = open( pcFileName, O_RDWR | O_CREAT, 0644 );
+
+	if( ( iFile >= 0 ) && ( fstat( iFile, &xStat ) == 0 ) )
+	{
+		xMustFormat = ( xStat.st_size < ( off_t ) ulSectorSize );
+
+		if( xStat.st_size < ( off_t ) ulSectorCount * ( off_t ) ulSectorSize )
+		{
+			xFileOk = ( ftruncate( iFile, ( off_t ) ulSectorCount * ( off_t ) ulSectorSize ) == 0 );
+		}
+		else
+		{
+			/* A partial sector at the end of the file is not used. */
+			ulSectorCount = ( uint32_t ) ( xStat.st_size / ( off_t ) ulSectorSize );
+			xFileOk = pdTRUE;
+		}
+	}
+
+	if( xFileOk == pdFALSE )
+	{
+		FF_PRINTF( "FF_FileDiskInit: %s: %s\n", pcFileName, strerror( errno ) );
+
+		if( iFile >= 0 )
+		{
+			close( iFile );
+		}
+	}
+	else
+	{
+		pxDisk = ( FF_Disk_t * ) pvPortMalloc( sizeof( FF_Disk_t ) );
+
+		if( pxDisk == NULL )
+		{
+			FF_PRINTF( "FF_FileDiskInit: Malloc failed\n" );
+			close( iFile );
+		}
+	}
+
+	if( pxDisk != NULL )
+	{
+		memset( pxDisk, '\0', sizeof( FF_Disk_t ) );
+
+		pxDisk->pvTag = ( void * ) ( intptr_t ) iFile;
+		pxDisk->ulSignature = fileSIGNATURE;
+		pxDisk->ulNumberOfSectors = ulSectorCount;
+
+		memset( &xParameters, '\0', sizeof( xParameters ) );
+		xParameters.pucCacheMemory = NULL;
+		xParameters.ulMemorySize = xIOManagerCacheSize;
+		xParameters.ulSectorSize = ( BaseType_t ) ulSectorSize;
+		xParameters.fnWriteBlocks = prvWriteFile;
+		xParameters.fnReadBlocks = prvReadFile;
+		xParameters.pxDisk = pxDisk;
+
+		/* pread() and pwrite() may be called by several tasks at the same
+		time, the semaphore only protects the FAT data structures. */
+		xParameters.pvSemaphore = ( void * ) xSemaphoreCreateRecursiveMutex();
+		xParameters.xBlockDeviceIsReentrant = pdTRUE;
+
+		#if( ffconfigBLOCK_QUEUE != 0 )
+		{
+			xParameters.xUseBlockQueue = xUseBlockQueue;
+		}
+		#else
+		{
+			if( xUseBlockQueue != pdFALSE )
+			{
+				FF_PRINTF( "FF_FileDiskInit: ffconfigBLOCK_QUEUE is not set, the driver is called directly\n" );
+			}
+		}
+		#endif
+
+		pxDisk->pxIOManager = FF_CreateIOManger( &xParameters, &xError );
+
+		if( ( pxDisk->pxIOManager != NULL ) && ( FF_isERR( xError ) == pdFALSE ) )
+		{
+			pxDisk->xStatus.bIsInitialised = pdTRUE;
+
+			if( xMustFormat != pdFALSE )
+			{
+				xError = prvPartitionAndFormatDisk( pxDisk );
+			}
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pxDisk->xStatus.bPartitionNumber = filePARTITION_NUMBER;
+				xError = FF_Mount( pxDisk, filePARTITION_NUMBER );
+				FF_PRINTF( "FF_FileDiskInit: FF_Mount: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+			}
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pxDisk->xStatus.bIsMounted = pdTRUE;
+				FF_FS_Add( pcName, pxDisk );
+			}
+		}
+		else
+		{
+			FF_PRINTF( "FF_FileDiskInit: FF_CreateIOManger: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+			FF_FileDiskDelete( pxDisk );
+			pxDisk = NULL;
+		}
+	}
+
+	return pxDisk;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_FileDiskDelete( FF_Disk_t *pxDisk )
+{
+BaseType_t xReturn = pdPASS;
+void *pvSemaphore;
+
+	if( pxDisk != NULL )
+	{
+		if( pxDisk->pxIOManager != NULL )
+		{
+			if( FF_isERR( FF_FlushCache( pxDisk->pxIOManager ) ) != pdFALSE )
+			{
+				xReturn = pdFAIL;
+			}
+
+			/* The semaphore was created by FF_FileDiskInit(). */
+			pvSemaphore = pxDisk->pxIOManager->pvSemaphore;
+			FF_DeleteIOManager( pxDisk->pxIOManager );
+			FF_DeleteSemaphore( pvSemaphore );
+		}
+
+		/* The image must be complete when the simulation has ended. */
+		if( ( fsync( fileDESCRIPTOR( pxDisk ) ) != 0 ) || ( close( fileDESCRIPTOR( pxDisk ) ) != 0 ) )
+		{
+			xReturn = pdFAIL;
+		}
+
+		pxDisk->ulSignature = 0;
+		pxDisk->xStatus.bIsInitialised = 0;
+		vPortFree( pxDisk );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvCheckAccess( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, int32_t lOutOfBounds )
+{
+int32_t lReturn = FF_ERR_NONE;
+
+	if( ( pxDisk == NULL ) || ( pucBuffer == NULL ) )
+	{
+		lReturn = FF_ERR_NULL_POINTER | FF_ERRFLAG;
+	}
+	else if( pxDisk->ulSignature != fileSIGNATURE )
+	{
+		/* The disk structure is not valid because it doesn't contain a
+		magic number written to the disk when it was created. */
+		lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+	}
+	else if( pxDisk->xStatus.bIsInitialised == pdFALSE )
+	{
+		/* The disk has not been initialised. */
+		lReturn = lOutOfBounds | FF_ERRFLAG;
+	}
+	else if( ( ulSectorNumber >= pxDisk->ulNumberOfSectors ) ||
+			 ( ( pxDisk->ulNumberOfSectors - ulSectorNumber ) < ulSectorCount ) )
+	{
+		/* The sectors are not within the bounds of the disk. */
+		lReturn = lOutOfBounds | FF_ERRFLAG;
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvReadFile( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+
+	lReturn = prvCheckAccess( pxDisk, pucDestination, ulSectorNumber, ulSectorCount, FF_ERR_IOMAN_OUT_OF_BOUNDS_READ );
+
+	if( lReturn == FF_ERR_NONE )
+	{
+		lReturn = prvTransfer( pxDisk, pucDestination, ulSectorNumber, ulSectorCount, pdFALSE );
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvWriteFile( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+
+	lReturn = prvCheckAccess( pxDisk, pucSource, ulSectorNumber, ulSectorCount, FF_ERR_IOMAN_OUT_OF_BOUNDS_WRITE );
+
+	if( lReturn == FF_ERR_NONE )
+	{
+		lReturn = prvTransfer( pxDisk, pucSource, ulSectorNumber, ulSectorCount, pdTRUE );
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvTransfer( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, BaseType_t xIsWrite )
+{
+off_t xOffset = ( off_t ) ulSectorNumber * ( off_t ) fileSECTOR_SIZE( pxDisk );
+size_t xLeft = ( size_t ) ulSectorCount * fileSECTOR_SIZE( pxDisk );
+ssize_t xDone;
+int32_t lReturn = FF_ERR_NONE;
+
+	while( ( xLeft > 0 ) && ( lReturn == FF_ERR_NONE ) )
+	{
+		if( xIsWrite != pdFALSE )
+		{
+			xDone = pwrite( fileDESCRIPTOR( pxDisk ), pucBuffer, xLeft, xOffset );
+		}
+		else
+		{
+			xDone = pread( fileDESCRIPTOR( pxDisk ), pucBuffer, xLeft, xOffset );
+		}
+
+		if( xDone > 0 )
+		{
+			pucBuffer += xDone;
+			xOffset += xDone;
+			xLeft -= ( size_t ) xDone;
+		}
+		else if( ( xDone < 0 ) && ( errno == EINTR ) )
+		{
+			/* Interrupted by a signal before anything was transferred. */
+		}
+		else
+		{
+			/* An error of the host, or the file was truncated meanwhile. */
+			FF_PRINTF( "FF_FileDisk: %s of sector %lu failed: %s\n", ( xIsWrite != pdFALSE ) ? "write" : "read",
+				( unsigned long ) ( xOffset / ( off_t ) fileSECTOR_SIZE( pxDisk ) ), ( xDone < 0 ) ? strerror( errno ) : "end of file" );
+			lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+		}
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static FF_Error_t prvPartitionAndFormatDisk( FF_Disk_t *pxDisk )
+{
+FF_PartitionParameters_t xPartition;
+FF_Error_t xError;
+
+	/* Create a single partition that fills all available space on the disk.
+	FF_Partition() and FF_Format() take the size of the sectors from the I/O
+	manager. */
+	memset( &xPartition, '\0', sizeof( xPartition ) );
+	xPartition.ulSectorCount = pxDisk->ulNumberOfSectors;
+	xPartition.ulHiddenSectors = fileHIDDEN_SECTOR_COUNT;
+	xPartition.xPrimaryCount = filePRIMARY_PARTITIONS;
+	xPartition.eSizeType = eSizeIsQuota;
+
+	/* Partition the disk */
+	xError = FF_Partition( pxDisk, &xPartition );
+	FF_PRINTF( "FF_Partition: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		/* Format the partition. */
+		xError = FF_Format( pxDisk, filePARTITION_NUMBER, pdTRUE, pdTRUE );
+		FF_PRINTF( "FF_FileDiskInit: FF_Format: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+	}
+
+	return xError;
+}
+/*-----------------------------------------------------------*/
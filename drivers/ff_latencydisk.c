@@ -0,0 +1,630 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Scheduler include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "portmacro.h"
+
+/* FreeRTOS+FAT includes. */
+#include "ff_headers.h"
+#include "ff_latencydisk.h"
+#include "ff_sys.h"
+
+/*
+ * Not a disk by itself, but a layer that is put under the I/O manager of an
+ * existing disk.  It passes every read and write on to the disk's own
+ * driver, and accounts the time that a flash device would have needed for
+ * it:
+ *
+ * + Every command costs ulCommandUs, so merging adjacent sectors into one
+ *   transfer pays off like it does on an SD card.
+ * + Every sector costs ulReadSectorUs or ulWriteSectorUs.
+ * + A write erases every erase block that it touches.  The sectors of the
+ *   block that the write does not cover have to be read and written again,
+ *   which makes small and unaligned writes expensive, as on simple media
+ *   without a write buffer.  The erases of each block are counted as wear.
+ *
+ * RAM and host disks are so fast that the time of the host says little
+ * about the media of the target.  The simulated time does, and it does not
+ * depend on the host: the effect of changes to the cache, the block queue or
+ * the allocation of clusters can be compared between runs.
+ *
+ * With 'xDelayCaller' the device also takes its time.  It executes one
+ * command at a time, and a task that transfers sectors is delayed until its
+ * command would have finished.  The delays are whole ticks, the part of a
+ * tick that is left is added to the next command.  Tasks then compete for
+ * the device like they do on the target, which is what the block queue is
+ * made for.
+ */
+
+/* A typical SD card: about 20 MB/s read, 10 MB/s write, and erase blocks of
+64 KB. */
+#define latencyDEFAULT_COMMAND_US		200UL
+#define latencyDEFAULT_READ_SECTOR_US	25UL
+#define latencyDEFAULT_WRITE_SECTOR_US	50UL
+#define latencyDEFAULT_ERASE_SECTORS	128UL
+#define latencyDEFAULT_ERASE_US			2000UL
+
+#define latencyUS_PER_TICK				( 1000000UL / ( uint32_t ) configTICK_RATE_HZ )
+
+typedef struct xLATENCY_DISK
+{
+	struct xLATENCY_DISK *pxNext;
+	FF_Disk_t *pxDisk;
+
+	/* The driver of the disk, called for every transfer. */
+	FF_ReadBlocks_t fnReadBlocks;
+	FF_WriteBlocks_t fnWriteBlocks;
+	#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+		FF_MapBlocksHook fnMapBlocks;
+	#endif
+	#if( ffconfigBLOCK_QUEUE != 0 )
+		FF_StartBlocksHook fnStartBlocks;
+	#endif
+
+	FF_LatencyDiskParameters_t xParameters;
+
+	/* Transfers of several tasks may be accounted at the same time, this
+	mutex protects xStats and pulWear. */
+	SemaphoreHandle_t xStatsMutex;
+	FF_LatencyDiskStats_t xStats;
+
+	/* The number of erases of each erase block. */
+	uint32_t ulEraseBlockCount;
+	uint32_t *pulWear;
+
+	/* With 'xDelayCaller': when the device finishes the last command that it
+	was given, in ticks and the microseconds of a tick that has begun.  Also
+	protected by xStatsMutex. */
+	TickType_t xDeviceFree;
+	uint32_t ulDeviceFreeUs;
+
+	/* The callers that use the model, FF_LatencyDiskDetach() frees it when
+	they are done. */
+	volatile UBaseType_t uxUsers;
+} LatencyDisk_t;
+
+/* The disks that have a latency model attached.  The list, and the use counts
+of its entries, are only accessed with the scheduler suspended. */
+static LatencyDisk_t *pxLatencyDisks = NULL;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Replace the read and write functions of the driver.
+ */
+static int32_t prvReadLatency( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+static int32_t prvWriteLatency( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*
+ * Returns the latency model of a disk, or NULL.  The scheduler must be
+ * suspended.
+ */
+static LatencyDisk_t *prvFindLatencyDisk( FF_Disk_t *pxDisk );
+
+/*
+ * Returns the latency model of a disk, or NULL, and counts the caller as a
+ * user until it calls prvReleaseLatencyDisk().
+ */
+static LatencyDisk_t *prvTakeLatencyDisk( FF_Disk_t *pxDisk );
+static void prvReleaseLatencyDisk( LatencyDisk_t *pxLatency );
+
+/*
+ * Frees a model that is not in the list.
+ */
+static void prvFreeLatencyDisk( LatencyDisk_t *pxLatency );
+
+/*
+ * Adds the time of a transfer that the driver has done to the statistics,
+ * and with 'xDelayCaller' waits until the device would be done.
+ */
+static void prvAccount( LatencyDisk_t *pxLatency, uint32_t ulSectorNumber, uint32_t ulSectorCount, BaseType_t xIsWrite );
+
+/*-----------------------------------------------------------*/
+
+void FF_LatencyDiskDefaults( FF_LatencyDiskParameters_t *pxParameters )
+{
+	memset( pxParameters, '\0', sizeof( FF_LatencyDiskParameters_t ) );
+	pxParameters->ulCommandUs = latencyDEFAULT_COMMAND_US;
+	pxParameters->ulReadSectorUs = latencyDEFAULT_READ_SECTOR_US;
+	pxParameters->ulWriteSectorUs = latencyDEFAULT_WRITE_SECTOR_US;
+	pxParameters->ulEraseBlockSectors = latencyDEFAULT_ERASE_SECTORS;
+	pxParameters->ulEraseUs = latencyDEFAULT_ERASE_US;
+	pxParameters->xDelayCaller = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_LatencyDiskAttach( FF_Disk_t *pxDisk, const FF_LatencyDiskParameters_t *pxParameters )
+{
+LatencyDisk_t *pxLatency = NULL;
+BaseType_t xReturn = pdFAIL;
+
+	if( ( pxDisk == NULL ) || ( pxDisk->pxIOManager == NULL ) || ( pxDisk->ulNumberOfSectors == 0 ) )
+	{
+		FF_PRINTF( "FF_LatencyDiskAttach: the disk has not been created\n" );
+	}
+	else
+	{
+		pxLatency = ( LatencyDisk_t * ) pvPortMalloc( sizeof( LatencyDisk_t ) );
+	}
+
+	if( pxLatency != NULL )
+	{
+		memset( pxLatency, '\0', sizeof( LatencyDisk_t ) );
+		pxLatency->pxDisk = pxDisk;
+		pxLatency->xDeviceFree = xTaskGetTickCount();
+
+		if( pxParameters != NULL )
+		{
+			pxLatency->xParameters = *pxParameters;
+		}
+		else
+		{
+			FF_LatencyDiskDefaults( &( pxLatency->xParameters ) );
+		}
+
+		if( pxLatency->xParameters.ulEraseBlockSectors != 0 )
+		{
+			pxLatency->ulEraseBlockCount = ( pxDisk->ulNumberOfSectors + pxLatency->xParameters.ulEraseBlockSectors - 1 ) /
+				pxLatency->xParameters.ulEraseBlockSectors;
+			pxLatency->pulWear = ( uint32_t * ) pvPortMalloc( pxLatency->ulEraseBlockCount * sizeof( uint32_t ) );
+		}
+
+		pxLatency->xStatsMutex = xSemaphoreCreateMutex();
+
+		if( ( pxLatency->xStatsMutex == NULL ) || ( ( pxLatency->ulEraseBlockCount != 0 ) && ( pxLatency->pulWear == NULL ) ) )
+		{
+			FF_PRINTF( "FF_LatencyDiskAttach: Malloc failed\n" );
+			prvFreeLatencyDisk( pxLatency );
+			pxLatency = NULL;
+		}
+		else if( pxLatency->pulWear != NULL )
+		{
+			memset( pxLatency->pulWear, '\0', pxLatency->ulEraseBlockCount * sizeof( uint32_t ) );
+		}
+	}
+
+	if( pxLatency != NULL )
+	{
+		/* Take over the driver.  Mapping sectors and starting transfers in
+		the background would bypass the model, so they are switched off.
+		Cache buffers that are mapped already stay mapped until they are
+		reused: attach the model right after the disk is created. */
+		vTaskSuspendAll();
+		{
+			if( prvFindLatencyDisk( pxDisk ) == NULL )
+			{
+				pxLatency->fnReadBlocks = pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks;
+				pxLatency->fnWriteBlocks = pxDisk->pxIOManager->xBlkDevice.fnpWriteBlocks;
+				pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks = prvReadLatency;
+				pxDisk->pxIOManager->xBlkDevice.fnpWriteBlocks = prvWriteLatency;
+
+				#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+				{
+					pxLatency->fnMapBlocks = pxDisk->fnMapBlocks;
+					pxDisk->fnMapBlocks = NULL;
+				}
+				#endif
+				#if( ffconfigBLOCK_QUEUE != 0 )
+				{
+					pxLatency->fnStartBlocks = pxDisk->fnStartBlocks;
+					pxDisk->fnStartBlocks = NULL;
+				}
+				#endif
+
+				pxLatency->pxNext = pxLatencyDisks;
+				pxLatencyDisks = pxLatency;
+
+				xReturn = pdPASS;
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		if( xReturn == pdFAIL )
+		{
+			FF_PRINTF( "FF_LatencyDiskAttach: already attached\n" );
+			prvFreeLatencyDisk( pxLatency );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_LatencyDiskDetach( FF_Disk_t *pxDisk )
+{
+LatencyDisk_t *pxLatency = NULL;
+LatencyDisk_t **ppxLink;
+BaseType_t xReturn = pdFAIL;
+
+	vTaskSuspendAll();
+	{
+		for( ppxLink = &pxLatencyDisks; *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+		{
+			pxLatency = *ppxLink;
+
+			if( pxLatency->pxDisk == pxDisk )
+			{
+				*ppxLink = pxLatency->pxNext;
+
+				pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks = pxLatency->fnReadBlocks;
+				pxDisk->pxIOManager->xBlkDevice.fnpWriteBlocks = pxLatency->fnWriteBlocks;
+
+				#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+				{
+					pxDisk->fnMapBlocks = pxLatency->fnMapBlocks;
+				}
+				#endif
+				#if( ffconfigBLOCK_QUEUE != 0 )
+				{
+					pxDisk->fnStartBlocks = pxLatency->fnStartBlocks;
+				}
+				#endif
+
+				xReturn = pdPASS;
+				break;
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	if( xReturn == pdPASS )
+	{
+		/* No new transfers find the model now, but transfers that started
+		before may still account their time. */
+		while( pxLatency->uxUsers != 0 )
+		{
+			vTaskDelay( 1 );
+		}
+
+		prvFreeLatencyDisk( pxLatency );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_LatencyDiskResetStats( FF_Disk_t *pxDisk )
+{
+LatencyDisk_t *pxLatency = prvTakeLatencyDisk( pxDisk );
+BaseType_t xReturn = pdFAIL;
+
+	if( pxLatency != NULL )
+	{
+		xSemaphoreTake( pxLatency->xStatsMutex, portMAX_DELAY );
+		{
+			memset( &( pxLatency->xStats ), '\0', sizeof( pxLatency->xStats ) );
+		}
+		xSemaphoreGive( pxLatency->xStatsMutex );
+
+		prvReleaseLatencyDisk( pxLatency );
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_LatencyDiskGetStats( FF_Disk_t *pxDisk, FF_LatencyDiskStats_t *pxStats )
+{
+LatencyDisk_t *pxLatency = prvTakeLatencyDisk( pxDisk );
+BaseType_t xReturn = pdFAIL;
+uint32_t ulBlock;
+
+	if( ( pxLatency != NULL ) && ( pxStats != NULL ) )
+	{
+		xSemaphoreTake( pxLatency->xStatsMutex, portMAX_DELAY );
+		{
+			*pxStats = pxLatency->xStats;
+
+			/* The wear is summarised here, the transfers only count. */
+			pxStats->ulWearMin = ( pxLatency->ulEraseBlockCount != 0 ) ? pxLatency->pulWear[ 0 ] : 0;
+			pxStats->ulWearMax = pxStats->ulWearMin;
+			pxStats->ulWearMaxBlock = 0;
+
+			for( ulBlock = 1; ulBlock < pxLatency->ulEraseBlockCount; ulBlock++ )
+			{
+				if( pxLatency->pulWear[ ulBlock ] < pxStats->ulWearMin )
+				{
+					pxStats->ulWearMin = pxLatency->pulWear[ ulBlock ];
+				}
+				if( pxLatency->pulWear[ ulBlock ] > pxStats->ulWearMax )
+				{
+					pxStats->ulWearMax = pxLatency->pulWear[ ulBlock ];
+					pxStats->ulWearMaxBlock = ulBlock;
+				}
+			}
+		}
+		xSemaphoreGive( pxLatency->xStatsMutex );
+
+		xReturn = pdPASS;
+	}
+
+	if( pxLatency != NULL )
+	{
+		prvReleaseLatencyDisk( pxLatency );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_LatencyDiskShowStats( FF_Disk_t *pxDisk )
+{
+FF_LatencyDiskStats_t xStats;
+BaseType_t xReturn;
+uint32_t ulCommands;
+
+	xReturn = FF_LatencyDiskGetStats( pxDisk, &xStats );
+
+	if( xReturn == pdPASS )
+	{
+		ulCommands = xStats.ulReadCommands + xStats.ulWriteCommands;
+
+		FF_PRINTF( "Device time    %8lu.%03lu ms\n", ( unsigned long ) ( xStats.ullDeviceUs / 1000ULL ), ( unsigned long ) ( xStats.ullDeviceUs % 1000ULL ) );
+		FF_PRINTF( "Commands       %8lu, %lu us each on average\n", ( unsigned long ) ulCommands,
+			( unsigned long ) ( ( ulCommands != 0 ) ? ( xStats.ullDeviceUs / ulCommands ) : 0 ) );
+		FF_PRINTF( "Read           %8lu commands, %lu sectors\n", ( unsigned long ) xStats.ulReadCommands, ( unsigned long ) xStats.ulSectorsRead );
+		FF_PRINTF( "Written        %8lu commands, %lu sectors\n", ( unsigned long ) xStats.ulWriteCommands, ( unsigned long ) xStats.ulSectorsWritten );
+		FF_PRINTF( "Erased         %8lu blocks, %lu partly written\n", ( unsigned long ) xStats.ulErases, ( unsigned long ) xStats.ulPartialErases );
+		FF_PRINTF( "Copied         %8lu sectors to complete erase blocks\n", ( unsigned long ) xStats.ulSectorsCopied );
+		FF_PRINTF( "Wear           %8lu to %lu erases per block, most in block %lu\n", ( unsigned long ) xStats.ulWearMin,
+			( unsigned long ) xStats.ulWearMax, ( unsigned long ) xStats.ulWearMaxBlock );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static LatencyDisk_t *prvFindLatencyDisk( FF_Disk_t *pxDisk )
+{
+LatencyDisk_t *pxLatency;
+
+	for( pxLatency = pxLatencyDisks; pxLatency != NULL; pxLatency = pxLatency->pxNext )
+	{
+		if( pxLatency->pxDisk == pxDisk )
+		{
+			break;
+		}
+	}
+
+	return pxLatency;
+}
+/*-----------------------------------------------------------*/
+
+static LatencyDisk_t *prvTakeLatencyDisk( FF_Disk_t *pxDisk )
+{
+LatencyDisk_t *pxLatency;
+
+	vTaskSuspendAll();
+	{
+		pxLatency = prvFindLatencyDisk( pxDisk );
+
+		if( pxLatency != NULL )
+		{
+			pxLatency->uxUsers++;
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return pxLatency;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseLatencyDisk( LatencyDisk_t *pxLatency )
+{
+	vTaskSuspendAll();
+	{
+		pxLatency->uxUsers--;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static void prvFreeLatencyDisk( LatencyDisk_t *pxLatency )
+{
+	if( pxLatency->xStatsMutex != NULL )
+	{
+		vSemaphoreDelete( pxLatency->xStatsMutex );
+	}
+
+	if( pxLatency->pulWear != NULL )
+	{
+		vPortFree( pxLatency->pulWear );
+	}
+
+	vPortFree( pxLatency );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvReadLatency( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+LatencyDisk_t *pxLatency = prvTakeLatencyDisk( pxDisk );
+FF_ReadBlocks_t fnReadBlocks;
+int32_t lReturn;
+
+	if( pxLatency == NULL )
+	{
+		/* Detached after the I/O manager had chosen this function: the
+		driver of the disk is back in place. */
+		fnReadBlocks = pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks;
+
+		if( fnReadBlocks != prvReadLatency )
+		{
+			lReturn = fnReadBlocks( pucDestination, ulSectorNumber, ulSectorCount, pxDisk );
+		}
+		else
+		{
+			lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+		}
+	}
+	else
+	{
+		lReturn = pxLatency->fnReadBlocks( pucDestination, ulSectorNumber, ulSectorCount, pxDisk );
+
+		/* The driver has checked the bounds. */
+		if( FF_isERR( lReturn ) == pdFALSE )
+		{
+			prvAccount( pxLatency, ulSectorNumber, ulSectorCount, pdFALSE );
+		}
+
+		prvReleaseLatencyDisk( pxLatency );
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvWriteLatency( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+LatencyDisk_t *pxLatency = prvTakeLatencyDisk( pxDisk );
+FF_WriteBlocks_t fnWriteBlocks;
+int32_t lReturn;
+
+	if( pxLatency == NULL )
+	{
+		fnWriteBlocks = pxDisk->pxIOManager->xBlkDevice.fnpWriteBlocks;
+
+		if( fnWriteBlocks != prvWriteLatency )
+		{
+			lReturn = fnWriteBlocks( pucSource, ulSectorNumber, ulSectorCount, pxDisk );
+		}
+		else
+		{
+			lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+		}
+	}
+	else
+	{
+		lReturn = pxLatency->fnWriteBlocks( pucSource, ulSectorNumber, ulSectorCount, pxDisk );
+
+		if( FF_isERR( lReturn ) == pdFALSE )
+		{
+			prvAccount( pxLatency, ulSectorNumber, ulSectorCount, pdTRUE );
+		}
+
+		prvReleaseLatencyDisk( pxLatency );
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAccount( LatencyDisk_t *pxLatency, uint32_t ulSectorNumber, uint32_t ulSectorCount, BaseType_t xIsWrite )
+{
+const FF_LatencyDiskParameters_t *pxParameters = &( pxLatency->xParameters );
+uint64_t ullUs = pxParameters->ulCommandUs;
+uint32_t ulBlock, ulLastBlock, ulBlockStart, ulBlockSectors, ulFirst, ulEnd, ulCopied;
+TickType_t xNow, xDelay = 0;
+
+	xSemaphoreTake( pxLatency->xStatsMutex, portMAX_DELAY );
+	{
+		if( xIsWrite == pdFALSE )
+		{
+			ullUs += ( uint64_t ) ulSectorCount * pxParameters->ulReadSectorUs;
+			pxLatency->xStats.ulReadCommands++;
+			pxLatency->xStats.ulSectorsRead += ulSectorCount;
+		}
+		else
+		{
+			ullUs += ( uint64_t ) ulSectorCount * pxParameters->ulWriteSectorUs;
+			pxLatency->xStats.ulWriteCommands++;
+			pxLatency->xStats.ulSectorsWritten += ulSectorCount;
+
+			if( ( pxLatency->ulEraseBlockCount != 0 ) && ( ulSectorCount != 0 ) )
+			{
+				ulBlock = ulSectorNumber / pxParameters->ulEraseBlockSectors;
+				ulLastBlock = ( ulSectorNumber + ulSectorCount - 1 ) / pxParameters->ulEraseBlockSectors;
+
+				for( ; ( ulBlock <= ulLastBlock ) && ( ulBlock < pxLatency->ulEraseBlockCount ); ulBlock++ )
+				{
+					/* The last erase block may extend beyond the disk. */
+					ulBlockStart = ulBlock * pxParameters->ulEraseBlockSectors;
+					ulBlockSectors = pxLatency->pxDisk->ulNumberOfSectors - ulBlockStart;
+					if( ulBlockSectors > pxParameters->ulEraseBlockSectors )
+					{
+						ulBlockSectors = pxParameters->ulEraseBlockSectors;
+					}
+
+					/* The sectors of the block before and after the ones
+					written must be preserved. */
+					ulFirst = ( ulSectorNumber > ulBlockStart ) ? ulSectorNumber : ulBlockStart;
+					ulEnd = ulSectorNumber + ulSectorCount;
+					if( ulEnd > ( ulBlockStart + ulBlockSectors ) )
+					{
+						ulEnd = ulBlockStart + ulBlockSectors;
+					}
+					ulCopied = ulBlockSectors - ( ulEnd - ulFirst );
+
+					ullUs += pxParameters->ulEraseUs;
+					ullUs += ( uint64_t ) ulCopied * ( pxParameters->ulReadSectorUs + pxParameters->ulWriteSectorUs );
+
+					pxLatency->xStats.ulErases++;
+					pxLatency->pulWear[ ulBlock ]++;
+
+					if( ulCopied != 0 )
+					{
+						pxLatency->xStats.ulPartialErases++;
+						pxLatency->xStats.ulSectorsCopied += ulCopied;
+					}
+				}
+			}
+		}
+
+		pxLatency->xStats.ullDeviceUs += ullUs;
+
+		if( pxParameters->xDelayCaller != pdFALSE )
+		{
+			/* A device that has been idle starts at the current tick.  The
+			difference of the tick counts is used, they may wrap. */
+			xNow = xTaskGetTickCount();
+			if( ( TickType_t ) ( pxLatency->xDeviceFree - xNow ) > ( portMAX_DELAY / 2 ) )
+			{
+				pxLatency->xDeviceFree = xNow;
+				pxLatency->ulDeviceFreeUs = 0;
+			}
+
+			ullUs += pxLatency->ulDeviceFreeUs;
+			pxLatency->xDeviceFree += ( TickType_t ) ( ullUs / latencyUS_PER_TICK );
+			pxLatency->ulDeviceFreeUs = ( uint32_t ) ( ullUs % latencyUS_PER_TICK );
+			xDelay = pxLatency->xDeviceFree - xNow;
+		}
+	}
+	xSemaphoreGive( pxLatency->xStatsMutex );
+
+	if( xDelay != 0 )
+	{
+		vTaskDelay( xDelay );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,91 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+#ifndef __LATENCYDISK_H__
+
+#define __LATENCYDISK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ff_headers.h"
+
+/* The timing of the modelled device, in microseconds.  A sector is a sector
+of the I/O manager of the disk. */
+typedef struct xLATENCY_DISK_PARAMETERS
+{
+	uint32_t ulCommandUs;			/* Overhead of every read or write command. */
+	uint32_t ulReadSectorUs;		/* Time to transfer one sector that is read. */
+	uint32_t ulWriteSectorUs;		/* Time to transfer and program one sector that is written. */
+	uint32_t ulEraseBlockSectors;	/* Sectors in an erase block, 0 when the device does not erase. */
+	uint32_t ulEraseUs;				/* Time to erase one erase block. */
+	BaseType_t xDelayCaller;		/* Non-zero to delay the tasks until the device would be done. */
+} FF_LatencyDiskParameters_t;
+
+/* What the device did since FF_LatencyDiskAttach() or the last call to
+FF_LatencyDiskResetStats(), except for the wear, which is never reset. */
+typedef struct xLATENCY_DISK_STATS
+{
+	uint64_t ullDeviceUs;			/* Total simulated time the device was busy. */
+	uint32_t ulReadCommands;
+	uint32_t ulWriteCommands;
+	uint32_t ulSectorsRead;
+	uint32_t ulSectorsWritten;
+	uint32_t ulErases;				/* Erase blocks that were erased. */
+	uint32_t ulPartialErases;		/* Erases of blocks that a write did not cover entirely. */
+	uint32_t ulSectorsCopied;		/* Sectors read and written again because of partial erases. */
+	uint32_t ulWearMin;				/* The fewest erases of any erase block. */
+	uint32_t ulWearMax;				/* The most erases of any erase block. */
+	uint32_t ulWearMaxBlock;		/* The erase block that was erased most. */
+} FF_LatencyDiskStats_t;
+
+/* The timing of a typical SD card, which only accounts the time */
+void FF_LatencyDiskDefaults( FF_LatencyDiskParameters_t *pxParameters );
+
+/* Let an existing disk behave like a device with the timing of pxParameters,
+or of a typical SD card when it is NULL.  Each read and write of the disk's
+driver is accounted as simulated device time.  The data is only delayed when
+'xDelayCaller' is set */
+BaseType_t FF_LatencyDiskAttach( FF_Disk_t *pxDisk, const FF_LatencyDiskParameters_t *pxParameters );
+
+/* Restore the driver of the disk.  Reads and writes that are in progress are
+waited for, they still account their time */
+BaseType_t FF_LatencyDiskDetach( FF_Disk_t *pxDisk );
+
+/* Start a new workload: clear everything but the wear */
+BaseType_t FF_LatencyDiskResetStats( FF_Disk_t *pxDisk );
+
+BaseType_t FF_LatencyDiskGetStats( FF_Disk_t *pxDisk, FF_LatencyDiskStats_t *pxStats );
+
+/* Show the simulated device time of the workload and the wear */
+BaseType_t FF_LatencyDiskShowStats( FF_Disk_t *pxDisk );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __LATENCYDISK_H__ */
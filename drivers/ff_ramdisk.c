@@ -44,15 +44,45 @@
 #define ramHIDDEN_SECTOR_COUNT		8
 #define ramPRIMARY_PARTITIONS		1
 #define ramHUNDRED_64_BIT			100ULL
-#define ramSECTOR_SIZE				512UL
+#define ramSECTOR_SIZE				( ( uint32_t ) ffconfigRAMDISK_SECTOR_SIZE )
 #define ramPARTITION_NUMBER			0 /* Only a single partition is used. */
 #define ramBYTES_PER_KB				( 1024ull )
-#define ramSECTORS_PER_KB			( ramBYTES_PER_KB / 512ull )
 
 /* Used as a magic number to indicate that an FF_Disk_t structure is a RAM
 disk. */
 #define ramSIGNATURE				0x41404342
 
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+	/* The state of a snapshot, stored directly behind the FF_Disk_t
+	structure.  The bitmap, the table and the slots are in the save area that
+	was passed to FF_RAMDiskSnapshotStart(). */
+	typedef struct xRAM_SNAPSHOT
+	{
+		uint32_t *pulPreserved;		/* One bit per sector, set when its old contents are in a slot. */
+		uint32_t *pulSlotSectors;	/* The sector that is stored in each slot. */
+		uint8_t *pucSlots;
+		uint32_t ulSlotCount;
+		uint32_t ulSlotsUsed;
+		uint32_t ulNextSector;		/* Sectors before this one have been read out. */
+		BaseType_t xActive;
+		BaseType_t xLost;			/* The save area ran full. */
+	} RAMSnapshot_t;
+
+	#define ramSNAPSHOT( pxDisk )		( ( RAMSnapshot_t * ) ( ( pxDisk ) + 1 ) )
+	#define ramSNAPSHOT_SIZE			sizeof( RAMSnapshot_t )
+#else
+	#define ramSNAPSHOT_SIZE			0
+#endif
+
+#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+	/* Each bit of the map of unwritten regions stands for 4 KB of the disk.
+	The map is allocated together with the FF_Disk_t structure, and stored
+	behind it and the snapshot state.  A set bit means the region was never
+	written and reads as zeros. */
+	#define ramZERO_REGION_SECTORS		( 4096UL / ramSECTOR_SIZE )
+	#define ramUNWRITTEN_MAP( pxDisk )	( ( uint32_t * ) ( ( ( uint8_t * ) ( ( pxDisk ) + 1 ) ) + ramSNAPSHOT_SIZE ) )
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -67,6 +97,14 @@ static int32_t prvWriteRAM( uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_
  */
 static int32_t prvReadRAM( uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
 
+#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+	/*
+	 * Returns the address of a sector within the RAM buffer, so that files can
+	 * be read in place, and cache buffers can use the sector itself.
+	 */
+	static uint8_t *prvMapRAM( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount );
+#endif
+
 /*
  * This is the driver for a RAM disk.  Unlike most media types, RAM disks are
  * volatile so are created anew each time the system is booted.  As the disk is
@@ -74,6 +112,47 @@ static int32_t prvReadRAM( uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t
  */
 static FF_Error_t prvPartitionAndFormatDisk( FF_Disk_t *pxDisk );
 
+/*
+ * Creates the disk and mounts it.  When ulImageSectors is not zero the first
+ * ulImageSectors sectors of the RAM buffer hold a partitioned and formatted
+ * disk, which is mounted as it is.  Otherwise the disk is formatted.
+ */
+static FF_Disk_t *prvCreateRAMDisk( char *pcName, uint8_t *pucDataBuffer, uint32_t ulSectorCount, size_t xIOManagerCacheSize, uint32_t ulImageSectors );
+
+#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+	/*
+	 * Returns pdTRUE if region ulRegion has never been written.
+	 */
+	static BaseType_t prvRegionIsUnwritten( FF_Disk_t *pxDisk, uint32_t ulRegion );
+
+	/*
+	 * Gives the unwritten region that holds ulSectorNumber its contents:
+	 * zeros, overwritten by ulChunk sectors from pucSource if that is not
+	 * NULL, and marks it as written.
+	 */
+	static void prvFillRegion( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulChunk, const uint8_t *pucSource );
+
+	/*
+	 * Returns the number of sectors from ulSectorNumber up to the end of its
+	 * region, or up to ulLastSector if that comes first.
+	 */
+	static uint32_t prvRegionChunk( uint32_t ulSectorNumber, uint32_t ulLastSector );
+#endif
+
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+	/*
+	 * Returns pdTRUE if the current contents of any of the sectors are still
+	 * part of an active snapshot: they have been neither preserved nor read out.
+	 */
+	static BaseType_t prvSnapshotShares( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount );
+
+	/*
+	 * Copies the sectors that are about to be written to the save area of the
+	 * snapshot, if they are still part of it.
+	 */
+	static void prvPreserveSectors( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* This is the prototype of the function used to initialise the RAM disk driver.
@@ -82,30 +161,86 @@ Other media drivers do not have to have the same prototype.
 In this example:
  + pcName is the name to give the disk within FreeRTOS+FAT's virtual file system.
  + pucDataBuffer is the start of the RAM to use as the disk.
- + ulSectorCount is effectively the size of the disk, each sector is 512 bytes.
+ + ulSectorCount is effectively the size of the disk, each sector is
+   ffconfigRAMDISK_SECTOR_SIZE bytes.
  + xIOManagerCacheSize is the size of the IO manager's cache, which must be a
    multiple of the sector size, and at least twice as big as the sector size.
 */
 FF_Disk_t *FF_RAMDiskInit( char *pcName, uint8_t *pucDataBuffer, uint32_t ulSectorCount, size_t xIOManagerCacheSize )
 {
-FF_Error_t xError;
+	return prvCreateRAMDisk( pcName, pucDataBuffer, ulSectorCount, xIOManagerCacheSize, 0 );
+}
+/*-----------------------------------------------------------*/
+
+/* Create a RAM disk from a disk image that was prepared on the host, see
+tools/mkfatimage.c.  The image is mounted as it is, so there is no need to
+clear, partition or format the disk at start-up.
+
+ + pucImage / xImageSize describe the image.  The image may be shorter than
+   the disk: it only has to contain the sectors that are in use.
+ + When pucImage equals pucDataBuffer the image is used in place, it must then
+   be writable and ulSectorCount sectors long.  Otherwise the image is copied
+   into pucDataBuffer once.  The remainder of pucDataBuffer is left untouched:
+   it only holds free clusters, which are written before they are read.  With
+   ffconfigRAMDISK_LAZY_ZERO it also reads as zeros.
+ + ulSectorCount must be the disk size that was passed to mkfatimage.
+*/
+FF_Disk_t *FF_RAMDiskInitFromImage( char *pcName, uint8_t *pucDataBuffer, uint32_t ulSectorCount,
+	const uint8_t *pucImage, size_t xImageSize, size_t xIOManagerCacheSize )
+{
+uint32_t ulImageSectors = ( uint32_t ) ( ( xImageSize + ramSECTOR_SIZE - 1 ) / ramSECTOR_SIZE );
+
+	configASSERT( ( xImageSize != 0 ) && ( xImageSize <= ( ulSectorCount * ramSECTOR_SIZE ) ) );
+
+	if( pucImage != pucDataBuffer )
+	{
+		memcpy( pucDataBuffer, pucImage, xImageSize );
+
+		/* Complete the last sector of the image. */
+		memset( pucDataBuffer + xImageSize, '\0', ( ulImageSectors * ramSECTOR_SIZE ) - xImageSize );
+	}
+
+	return prvCreateRAMDisk( pcName, pucDataBuffer, ulSectorCount, xIOManagerCacheSize, ulImageSectors );
+}
+/*-----------------------------------------------------------*/
+
+static FF_Disk_t *prvCreateRAMDisk( char *pcName, uint8_t *pucDataBuffer, uint32_t ulSectorCount, size_t xIOManagerCacheSize, uint32_t ulImageSectors )
+{
+FF_Error_t xError = FF_ERR_NONE;
 FF_Disk_t *pxDisk = NULL;
 FF_CreationParameters_t xParameters;
+size_t xMapSize = 0;
 
 	/* Check the validity of the xIOManagerCacheSize parameter. */
 	configASSERT( ( xIOManagerCacheSize % ramSECTOR_SIZE ) == 0 );
 	configASSERT( ( xIOManagerCacheSize >= ( 2 * ramSECTOR_SIZE ) ) );
 
+	#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+	{
+		/* One bit per region, in whole 32-bit words. */
+		xMapSize = ( ( ( ulSectorCount + ramZERO_REGION_SECTORS - 1 ) / ramZERO_REGION_SECTORS ) + 31 ) / 32;
+		xMapSize *= sizeof( uint32_t );
+	}
+	#endif
+
 	/* Attempt to allocated the FF_Disk_t structure. */
-	pxDisk = ( FF_Disk_t * ) pvPortMalloc( sizeof( FF_Disk_t ) );
+	pxDisk = ( FF_Disk_t * ) pvPortMalloc( sizeof( FF_Disk_t ) + ramSNAPSHOT_SIZE + xMapSize );
 
 	if( pxDisk != NULL )
 	{
-		/* Start with every member of the structure set to zero. */
-		memset( pxDisk, '\0', sizeof( FF_Disk_t ) );
+		/* Start with every member of the structure set to zero, and no
+		snapshot. */
+		memset( pxDisk, '\0', sizeof( FF_Disk_t ) + ramSNAPSHOT_SIZE );
 
-		/* Clear the entire space. */
-		memset( pucDataBuffer, '\0', ulSectorCount * ramSECTOR_SIZE );
+		#if( ffconfigRAMDISK_LAZY_ZERO == 0 )
+		{
+			if( ulImageSectors == 0 )
+			{
+				/* Clear the entire space. */
+				memset( pucDataBuffer, '\0', ulSectorCount * ramSECTOR_SIZE );
+			}
+		}
+		#endif
 
 		/* The pvTag member of the FF_Disk_t structure allows the structure to be
 		extended to also include media specific parameters.  The only media
@@ -122,6 +257,37 @@ FF_CreationParameters_t xParameters;
 		write functions. */
 		pxDisk->ulNumberOfSectors = ulSectorCount;
 
+		#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+		{
+		uint32_t ulRegion, ulImageRegions, ulImageEnd;
+
+			/* Nothing has been written yet, apart from the image, so the RAM
+			buffer itself does not have to be cleared. */
+			memset( ramUNWRITTEN_MAP( pxDisk ), 0xff, xMapSize );
+
+			ulImageRegions = ( ulImageSectors + ramZERO_REGION_SECTORS - 1 ) / ramZERO_REGION_SECTORS;
+			for( ulRegion = 0; ulRegion < ulImageRegions; ulRegion++ )
+			{
+				ramUNWRITTEN_MAP( pxDisk )[ ulRegion / 32 ] &= ~( 1ul << ( ulRegion % 32 ) );
+			}
+
+			/* Clear the part of the last region that follows the image. */
+			ulImageEnd = ulImageRegions * ramZERO_REGION_SECTORS;
+			if( ulImageEnd > ulSectorCount )
+			{
+				ulImageEnd = ulSectorCount;
+			}
+			memset( pucDataBuffer + ( ulImageSectors * ramSECTOR_SIZE ), '\0', ( ulImageEnd - ulImageSectors ) * ramSECTOR_SIZE );
+		}
+		#endif
+
+		#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+		{
+			/* The disk is memory, so files and cache buffers can be mapped. */
+			pxDisk->fnMapBlocks = prvMapRAM;
+		}
+		#endif
+
 		/* Create the IO manager that will be used to control the RAM disk. */
 		memset( &xParameters, '\0', sizeof( xParameters ) );
 		xParameters.pucCacheMemory = NULL;
@@ -131,11 +297,15 @@ FF_CreationParameters_t xParameters;
 		xParameters.fnReadBlocks = prvReadRAM;
 		xParameters.pxDisk = pxDisk;
 
-		/* Driver is reentrant so xBlockDeviceIsReentrant can be set to pdTRUE.
-		In this case the semaphore is only used to protect FAT data
-		structures. */
+		/* The driver is reentrant: the read and write functions only use
+		their parameters and the FF_Disk_t structure, which does not change
+		after this function.  The only exceptions are the map of unwritten
+		regions, see prvFillRegion(), and the state of a snapshot, see
+		prvPreserveSectors().  The semaphore is therefore only used
+		to protect FAT data structures, and tasks can copy sectors to and from
+		the disk at the same time. */
 		xParameters.pvSemaphore = ( void * ) xSemaphoreCreateRecursiveMutex();
-		xParameters.xBlockDeviceIsReentrant = pdFALSE;
+		xParameters.xBlockDeviceIsReentrant = pdTRUE;
 
 		pxDisk->pxIOManager = FF_CreateIOManger( &xParameters, &xError );
 
@@ -149,7 +319,10 @@ FF_CreationParameters_t xParameters;
 			known that the disk has not been used before, and cannot already
 			contain any partitions.  Most media drivers will not perform
 			this step because the media will have already been partitioned. */
-			xError = prvPartitionAndFormatDisk( pxDisk );
+			if( ulImageSectors == 0 )
+			{
+				xError = prvPartitionAndFormatDisk( pxDisk );
+			}
 
 			if( FF_isERR( xError ) == pdFALSE )
 			{
@@ -191,13 +364,18 @@ FF_CreationParameters_t xParameters;
 
 BaseType_t FF_RAMDiskDelete( FF_Disk_t *pxDisk )
 {
+void *pvSemaphore;
+
 	if( pxDisk != NULL )
 	{
 		pxDisk->ulSignature = 0;
 		pxDisk->xStatus.bIsInitialised = 0;
 		if( pxDisk->pxIOManager != NULL )
 		{
+			/* The semaphore was created by prvCreateRAMDisk(). */
+			pvSemaphore = pxDisk->pxIOManager->pvSemaphore;
 			FF_DeleteIOManager( pxDisk->pxIOManager );
+			FF_DeleteSemaphore( pvSemaphore );
 		}
 
 		vPortFree( pxDisk );
@@ -212,7 +390,7 @@ static int32_t prvReadRAM( uint8_t *pucDestination, uint32_t ulSectorNumber, uin
 int32_t lReturn;
 uint8_t *pucSource;
 
-	if( pxDisk != NULL )
+	if( ( pxDisk != NULL ) && ( pucDestination != NULL ) )
 	{
 		if( pxDisk->ulSignature != ramSIGNATURE )
 		{
@@ -223,17 +401,17 @@ uint8_t *pucSource;
 		else if( pxDisk->xStatus.bIsInitialised == pdFALSE )
 		{
 			/* The disk has not been initialised. */
-			lReturn = FF_ERR_IOMAN_OUT_OF_BOUNDS_WRITE | FF_ERRFLAG;
+			lReturn = FF_ERR_IOMAN_OUT_OF_BOUNDS_READ | FF_ERRFLAG;
 		}
 		else if( ulSectorNumber >= pxDisk->ulNumberOfSectors )
 		{
 			/* The start sector is not within the bounds of the disk. */
-			lReturn = ( FF_ERR_IOMAN_OUT_OF_BOUNDS_WRITE | FF_ERRFLAG );
+			lReturn = ( FF_ERR_IOMAN_OUT_OF_BOUNDS_READ | FF_ERRFLAG );
 		}
 		else if( ( pxDisk->ulNumberOfSectors - ulSectorNumber ) < ulSectorCount )
 		{
 			/* The end sector is not within the bounds of the disk. */
-			lReturn = ( FF_ERR_IOMAN_OUT_OF_BOUNDS_WRITE | FF_ERRFLAG );
+			lReturn = ( FF_ERR_IOMAN_OUT_OF_BOUNDS_READ | FF_ERRFLAG );
 		}
 		else
 		{
@@ -243,11 +421,41 @@ uint8_t *pucSource;
 			/* Move to the start of the sector being read. */
 			pucSource += ( ramSECTOR_SIZE * ulSectorNumber );
 
-			/* Copy the data from the disk.  As this is a RAM disk this can be
-			done using memcpy(). */
-			memcpy( ( void * ) pucDestination,
-					( void * ) pucSource,
-					( size_t ) ( ulSectorCount * ramSECTOR_SIZE ) );
+			#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+			{
+			uint32_t ulLastSector = ulSectorNumber + ulSectorCount;
+			uint32_t ulChunk;
+			size_t xLength;
+
+				/* Regions that were never written read as zeros. */
+				while( ulSectorNumber < ulLastSector )
+				{
+					ulChunk = prvRegionChunk( ulSectorNumber, ulLastSector );
+					xLength = ( size_t ) ( ulChunk * ramSECTOR_SIZE );
+
+					if( prvRegionIsUnwritten( pxDisk, ulSectorNumber / ramZERO_REGION_SECTORS ) != pdFALSE )
+					{
+						memset( ( void * ) pucDestination, '\0', xLength );
+					}
+					else
+					{
+						memcpy( ( void * ) pucDestination, ( void * ) pucSource, xLength );
+					}
+
+					ulSectorNumber += ulChunk;
+					pucDestination += xLength;
+					pucSource += xLength;
+				}
+			}
+			#else
+			{
+				/* Copy the data from the disk.  As this is a RAM disk this can be
+				done using memcpy(). */
+				memcpy( ( void * ) pucDestination,
+						( void * ) pucSource,
+						( size_t ) ( ulSectorCount * ramSECTOR_SIZE ) );
+			}
+			#endif
 
 			lReturn = FF_ERR_NONE;
 		}
@@ -266,7 +474,7 @@ static int32_t prvWriteRAM( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_
 int32_t lReturn = FF_ERR_NONE;
 uint8_t *pucDestination;
 
-	if( pxDisk != NULL )
+	if( ( pxDisk != NULL ) && ( pucSource != NULL ) )
 	{
 		if( pxDisk->ulSignature != ramSIGNATURE )
 		{
@@ -291,17 +499,64 @@ uint8_t *pucDestination;
 		}
 		else
 		{
+			#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+			{
+				/* A snapshot keeps the old contents. */
+				prvPreserveSectors( pxDisk, ulSectorNumber, ulSectorCount );
+			}
+			#endif
+
 			/* Obtain the location of the RAM being used as the disk. */
 			pucDestination = ( uint8_t * ) pxDisk->pvTag;
 
 			/* Move to the sector being written to. */
 			pucDestination += ( ramSECTOR_SIZE * ulSectorNumber );
 
-			/* Write to the disk.  As this is a RAM disk the write can use a
-			memcpy(). */
-			memcpy( ( void * ) pucDestination,
-					( void * ) pucSource,
-					( size_t ) ulSectorCount * ( size_t ) ramSECTOR_SIZE );
+			#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+			{
+			uint32_t ulLastSector = ulSectorNumber + ulSectorCount;
+			uint32_t ulChunk, ulRegion;
+			size_t xLength, xIndex;
+
+				while( ulSectorNumber < ulLastSector )
+				{
+					ulChunk = prvRegionChunk( ulSectorNumber, ulLastSector );
+					xLength = ( size_t ) ( ulChunk * ramSECTOR_SIZE );
+					ulRegion = ulSectorNumber / ramZERO_REGION_SECTORS;
+
+					if( prvRegionIsUnwritten( pxDisk, ulRegion ) != pdFALSE )
+					{
+						/* Writing zeros to a region that reads as zeros
+						changes nothing.  FF_Format() and FF_ClearCluster()
+						write a lot of zeros. */
+						for( xIndex = 0; ( xIndex < xLength ) && ( pucSource[ xIndex ] == 0u ); xIndex++ )
+						{
+						}
+
+						if( xIndex < xLength )
+						{
+							prvFillRegion( pxDisk, ulSectorNumber, ulChunk, pucSource );
+						}
+					}
+					else
+					{
+						memcpy( ( void * ) pucDestination, ( void * ) pucSource, xLength );
+					}
+
+					ulSectorNumber += ulChunk;
+					pucDestination += xLength;
+					pucSource += xLength;
+				}
+			}
+			#else
+			{
+				/* Write to the disk.  As this is a RAM disk the write can use a
+				memcpy(). */
+				memcpy( ( void * ) pucDestination,
+						( void * ) pucSource,
+						( size_t ) ulSectorCount * ( size_t ) ramSECTOR_SIZE );
+			}
+			#endif
 
 			lReturn = FF_ERR_NONE;
 		}
@@ -315,6 +570,197 @@ uint8_t *pucDestination;
 }
 /*-----------------------------------------------------------*/
 
+#if( ffconfigMMAP_SUPPORT != 0 ) || ( ffconfigCACHE_MAP_BLOCKS != 0 )
+static uint8_t *prvMapRAM( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount )
+{
+uint8_t *pucReturn = NULL;
+BaseType_t xMappable = pdFALSE;
+
+	if( ( pxDisk != NULL ) &&
+		( pxDisk->ulSignature == ramSIGNATURE ) &&
+		( pxDisk->xStatus.bIsInitialised != pdFALSE ) &&
+		( ulSectorNumber < pxDisk->ulNumberOfSectors ) &&
+		( ( pxDisk->ulNumberOfSectors - ulSectorNumber ) >= ulSectorCount ) )
+	{
+		xMappable = pdTRUE;
+	}
+
+	#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+	{
+		/* The caller may write to the memory, which would bypass the
+		copy-on-write in prvWriteRAM().  Sectors that still belong to a
+		snapshot are not mapped, the caller then uses prvReadRAM() and
+		prvWriteRAM() instead.  Once a sector has been preserved or read out
+		it can be mapped again. */
+		if( ( xMappable != pdFALSE ) && ( prvSnapshotShares( pxDisk, ulSectorNumber, ulSectorCount ) != pdFALSE ) )
+		{
+			xMappable = pdFALSE;
+		}
+	}
+	#endif
+
+	if( xMappable != pdFALSE )
+	{
+		#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+		{
+		uint32_t ulSector;
+
+			/* The caller will access the memory directly, so it must hold
+			the zeros that the unwritten regions stand for. */
+			for( ulSector = ulSectorNumber; ulSector < ulSectorNumber + ulSectorCount; ulSector += prvRegionChunk( ulSector, ulSectorNumber + ulSectorCount ) )
+			{
+				if( prvRegionIsUnwritten( pxDisk, ulSector / ramZERO_REGION_SECTORS ) != pdFALSE )
+				{
+					prvFillRegion( pxDisk, ulSector, 0, NULL );
+				}
+			}
+		}
+		#endif
+
+		/* The sectors of a RAM disk are always contiguous. */
+		pucReturn = ( ( uint8_t * ) pxDisk->pvTag ) + ( ramSECTOR_SIZE * ulSectorNumber );
+	}
+
+	return pucReturn;
+}
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigMMAP_SUPPORT || ffconfigCACHE_MAP_BLOCKS */
+
+#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+static BaseType_t prvRegionIsUnwritten( FF_Disk_t *pxDisk, uint32_t ulRegion )
+{
+uint32_t *pulMap = ramUNWRITTEN_MAP( pxDisk );
+BaseType_t xReturn = pdFALSE;
+
+	if( ( pulMap[ ulRegion / 32 ] & ( 1ul << ( ulRegion % 32 ) ) ) != 0ul )
+	{
+		xReturn = pdTRUE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFillRegion( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulChunk, const uint8_t *pucSource )
+{
+uint32_t *pulMap = ramUNWRITTEN_MAP( pxDisk );
+uint8_t *pucDisk = ( uint8_t * ) pxDisk->pvTag;
+uint32_t ulRegion = ulSectorNumber / ramZERO_REGION_SECTORS;
+uint32_t ulFirstSector = ulRegion * ramZERO_REGION_SECTORS;
+uint32_t ulSectors = ramZERO_REGION_SECTORS;
+
+	/* The last region may be shorter. */
+	if( ( pxDisk->ulNumberOfSectors - ulFirstSector ) < ulSectors )
+	{
+		ulSectors = pxDisk->ulNumberOfSectors - ulFirstSector;
+	}
+
+	/* This happens once per region, and the driver is reentrant: keep other
+	tasks out while the region is filled and the bit is cleared.  The bit is
+	cleared last, so a task that reads the region at the same time sees
+	either the zeros from the map or the final contents. */
+	vTaskSuspendAll();
+	{
+		if( ( pulMap[ ulRegion / 32 ] & ( 1ul << ( ulRegion % 32 ) ) ) != 0ul )
+		{
+			if( ulChunk < ulSectors )
+			{
+				memset( pucDisk + ( ramSECTOR_SIZE * ulFirstSector ), '\0', ( size_t ) ( ulSectors * ramSECTOR_SIZE ) );
+			}
+			if( pucSource != NULL )
+			{
+				memcpy( pucDisk + ( ramSECTOR_SIZE * ulSectorNumber ), pucSource, ( size_t ) ( ulChunk * ramSECTOR_SIZE ) );
+			}
+			pulMap[ ulRegion / 32 ] &= ~( 1ul << ( ulRegion % 32 ) );
+		}
+		else if( pucSource != NULL )
+		{
+			/* Another task filled the region in the meantime. */
+			memcpy( pucDisk + ( ramSECTOR_SIZE * ulSectorNumber ), pucSource, ( size_t ) ( ulChunk * ramSECTOR_SIZE ) );
+		}
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRegionChunk( uint32_t ulSectorNumber, uint32_t ulLastSector )
+{
+uint32_t ulChunk = ramZERO_REGION_SECTORS - ( ulSectorNumber % ramZERO_REGION_SECTORS );
+
+	if( ulChunk > ( ulLastSector - ulSectorNumber ) )
+	{
+		ulChunk = ulLastSector - ulSectorNumber;
+	}
+
+	return ulChunk;
+}
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigRAMDISK_LAZY_ZERO */
+
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+static BaseType_t prvSnapshotShares( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount )
+{
+RAMSnapshot_t *pxSnapshot = ramSNAPSHOT( pxDisk );
+uint32_t ulSector;
+BaseType_t xReturn = pdFALSE;
+
+	if( ( pxSnapshot->xActive != pdFALSE ) && ( pxSnapshot->xLost == pdFALSE ) )
+	{
+		/* Sectors that have been read out are no longer needed. */
+		ulSector = ( ulSectorNumber > pxSnapshot->ulNextSector ) ? ulSectorNumber : pxSnapshot->ulNextSector;
+
+		for( ; ulSector < ( ulSectorNumber + ulSectorCount ); ulSector++ )
+		{
+			if( ( pxSnapshot->pulPreserved[ ulSector / 32 ] & ( 1ul << ( ulSector % 32 ) ) ) == 0ul )
+			{
+				xReturn = pdTRUE;
+				break;
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPreserveSectors( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount )
+{
+RAMSnapshot_t *pxSnapshot = ramSNAPSHOT( pxDisk );
+uint32_t ulSector;
+
+	for( ulSector = ulSectorNumber; ulSector < ( ulSectorNumber + ulSectorCount ); ulSector++ )
+	{
+		if( prvSnapshotShares( pxDisk, ulSector, 1 ) != pdFALSE )
+		{
+			/* Copy one sector at a time, so that the scheduler is never
+			suspended for longer than that.  The reader of the snapshot and
+			other writers may have got here first, so check again. */
+			vTaskSuspendAll();
+			{
+				if( prvSnapshotShares( pxDisk, ulSector, 1 ) != pdFALSE )
+				{
+					if( pxSnapshot->ulSlotsUsed < pxSnapshot->ulSlotCount )
+					{
+						( void ) prvReadRAM( pxSnapshot->pucSlots + ( pxSnapshot->ulSlotsUsed * ramSECTOR_SIZE ), ulSector, 1, pxDisk );
+						pxSnapshot->pulSlotSectors[ pxSnapshot->ulSlotsUsed ] = ulSector;
+						pxSnapshot->ulSlotsUsed++;
+						pxSnapshot->pulPreserved[ ulSector / 32 ] |= ( 1ul << ( ulSector % 32 ) );
+					}
+					else
+					{
+						/* Rather than failing the write, give up the
+						snapshot.  FF_RAMDiskSnapshotRead() will report it. */
+						pxSnapshot->xLost = pdTRUE;
+					}
+				}
+			}
+			( void ) xTaskResumeAll();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigRAMDISK_SNAPSHOT */
+
 static FF_Error_t prvPartitionAndFormatDisk( FF_Disk_t *pxDisk )
 {
 FF_PartitionParameters_t xPartition;
@@ -394,8 +840,8 @@ BaseType_t xReturn = pdPASS;
 				( ( uint64_t )pxIOManager->xPartition.ulDataSectors ) );
 		}
 
-		ulTotalSizeKB = pxIOManager->xPartition.ulDataSectors / ramSECTORS_PER_KB;
-		ulFreeSizeKB = ( uint32_t ) ( ullFreeSectors / ramSECTORS_PER_KB );
+		ulTotalSizeKB = ( uint32_t ) ( ( ( uint64_t ) pxIOManager->xPartition.ulDataSectors * ramSECTOR_SIZE ) / ramBYTES_PER_KB );
+		ulFreeSizeKB = ( uint32_t ) ( ( ullFreeSectors * ramSECTOR_SIZE ) / ramBYTES_PER_KB );
 
 		/* It is better not to use the 64-bit format such as %Lu because it
 		might not be implemented. */
@@ -421,3 +867,164 @@ void FF_RAMDiskFlush( FF_Disk_t *pxDisk )
 }
 /*-----------------------------------------------------------*/
 
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+/* Take a snapshot of the disk, that can be read out with
+FF_RAMDiskSnapshotRead() while the file system continues to be used.
+
+Nothing is copied here.  Instead, prvWriteRAM() copies each sector to the save
+area the first time that it is written afterwards, unless the sector has been
+read out already.  A write therefore waits for at most one sector copy.
+
+ + pucSaveArea must be aligned on 4 bytes.  It holds a bitmap of one bit per
+   sector of the disk, followed by as many slots of the sector size plus 4 bytes as fit.  When a
+   sector must be preserved and no slot is left, the snapshot is given up
+   rather than failing the write, and FF_RAMDiskSnapshotRead() reports
+   FF_ERR_IOMAN_NOT_ENOUGH_FREE_SPACE.
+
+The snapshot holds the disk as it is after the IO manager's cache has been
+flushed.  Call it when no file is being written, for instance after closing
+the files, so that the snapshot holds a consistent file system.
+*/
+BaseType_t FF_RAMDiskSnapshotStart( FF_Disk_t *pxDisk, uint8_t *pucSaveArea, size_t xSaveAreaSize )
+{
+RAMSnapshot_t *pxSnapshot;
+size_t xMapSize;
+BaseType_t xReturn = pdFAIL;
+
+	if( ( pxDisk != NULL ) && ( pxDisk->ulSignature == ramSIGNATURE ) && ( pxDisk->pxIOManager != NULL ) && ( pucSaveArea != NULL ) )
+	{
+		pxSnapshot = ramSNAPSHOT( pxDisk );
+		xMapSize = ( ( pxDisk->ulNumberOfSectors + 31 ) / 32 ) * sizeof( uint32_t );
+
+		configASSERT( ( ( ( size_t ) pucSaveArea ) % sizeof( uint32_t ) ) == 0 );
+
+		if( ( pxSnapshot->xActive == pdFALSE ) && ( xSaveAreaSize >= xMapSize ) )
+		{
+			/* Changes that were made through the cache must be on the disk
+			before it is frozen. */
+			FF_FlushCache( pxDisk->pxIOManager );
+
+			FF_PendSemaphore( pxDisk->pxIOManager->pvSemaphore );
+			{
+				pxSnapshot->pulPreserved = ( uint32_t * ) pucSaveArea;
+				pxSnapshot->ulSlotCount = ( uint32_t ) ( ( xSaveAreaSize - xMapSize ) / ( ramSECTOR_SIZE + sizeof( uint32_t ) ) );
+				pxSnapshot->pulSlotSectors = pxSnapshot->pulPreserved + ( xMapSize / sizeof( uint32_t ) );
+				pxSnapshot->pucSlots = ( uint8_t * ) ( pxSnapshot->pulSlotSectors + pxSnapshot->ulSlotCount );
+				pxSnapshot->ulSlotsUsed = 0;
+				pxSnapshot->ulNextSector = 0;
+				pxSnapshot->xLost = pdFALSE;
+				memset( pxSnapshot->pulPreserved, '\0', xMapSize );
+				pxSnapshot->xActive = pdTRUE;
+
+				#if( ffconfigCACHE_MAP_BLOCKS != 0 )
+				{
+				FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+				UBaseType_t uxIndex;
+
+					/* Buffers that were mapped before point into the disk
+					itself, changes made through them would not pass through
+					prvWriteRAM().  Preserve their sectors now. */
+					for( uxIndex = 0; uxIndex < pxIOManager->usCacheSize; uxIndex++ )
+					{
+						if( pxIOManager->pxBuffers[ uxIndex ].bMapped != pdFALSE )
+						{
+							prvPreserveSectors( pxDisk, pxIOManager->pxBuffers[ uxIndex ].ulSector, 1 );
+						}
+					}
+				}
+				#endif
+			}
+			FF_ReleaseSemaphore( pxDisk->pxIOManager->pvSemaphore );
+
+			xReturn = pdPASS;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+/* Copies the next ulSectorCount sectors of the snapshot to pucBuffer.  The
+snapshot is read out once, from the first sector to the last, by a single
+task.  Returns the number of sectors copied, which is zero after the last
+sector. */
+int32_t FF_RAMDiskSnapshotRead( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorCount )
+{
+RAMSnapshot_t *pxSnapshot;
+int32_t lReturn = 0;
+uint32_t ulSector, ulSlot;
+BaseType_t xPreserved;
+
+	if( ( pxDisk == NULL ) || ( pucBuffer == NULL ) )
+	{
+		lReturn = FF_ERR_NULL_POINTER | FF_ERRFLAG;
+	}
+	else if( ( pxDisk->ulSignature != ramSIGNATURE ) || ( ramSNAPSHOT( pxDisk )->xActive == pdFALSE ) )
+	{
+		lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+	}
+	else
+	{
+		pxSnapshot = ramSNAPSHOT( pxDisk );
+
+		while( ( ( uint32_t ) lReturn < ulSectorCount ) && ( pxSnapshot->ulNextSector < pxDisk->ulNumberOfSectors ) )
+		{
+			/* A writer may not change the sector while it is copied, nor
+			preserve it after it was checked. */
+			vTaskSuspendAll();
+			{
+				ulSector = pxSnapshot->ulNextSector;
+				xPreserved = ( ( pxSnapshot->pulPreserved[ ulSector / 32 ] & ( 1ul << ( ulSector % 32 ) ) ) != 0ul ) ? pdTRUE : pdFALSE;
+
+				if( xPreserved == pdFALSE )
+				{
+					( void ) prvReadRAM( pucBuffer, ulSector, 1, pxDisk );
+				}
+
+				pxSnapshot->ulNextSector++;
+			}
+			( void ) xTaskResumeAll();
+
+			if( xPreserved != pdFALSE )
+			{
+				/* The sector was written after the snapshot was taken.  A
+				slot never changes once filled, so it can be copied with the
+				scheduler running. */
+				for( ulSlot = 0; pxSnapshot->pulSlotSectors[ ulSlot ] != ulSector; ulSlot++ )
+				{
+				}
+				memcpy( pucBuffer, pxSnapshot->pucSlots + ( ulSlot * ramSECTOR_SIZE ), ( size_t ) ramSECTOR_SIZE );
+			}
+
+			pucBuffer += ramSECTOR_SIZE;
+			lReturn++;
+		}
+
+		if( pxSnapshot->xLost != pdFALSE )
+		{
+			FF_PRINTF( "FF_RAMDiskSnapshotRead: the save area ran full, the snapshot is lost\n" );
+			lReturn = FF_ERR_IOMAN_NOT_ENOUGH_FREE_SPACE | FF_ERRFLAG;
+		}
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_RAMDiskSnapshotStop( FF_Disk_t *pxDisk )
+{
+BaseType_t xReturn = pdFAIL;
+
+	if( ( pxDisk != NULL ) && ( pxDisk->ulSignature == ramSIGNATURE ) )
+	{
+		/* Writers check this flag with the scheduler suspended, so none of
+		them uses the save area after this. */
+		ramSNAPSHOT( pxDisk )->xActive = pdFALSE;
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+#endif	/* ffconfigRAMDISK_SNAPSHOT */
+
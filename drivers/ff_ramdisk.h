@@ -34,15 +34,30 @@ extern "C" {
 
 #include "ff_headers.h"
 
-/* Create a RAM disk, supplying enough memory to hold N sectors of 512 bytes each */
+/* Create a RAM disk, supplying enough memory to hold N sectors of ffconfigRAMDISK_SECTOR_SIZE bytes each */
 FF_Disk_t *FF_RAMDiskInit( char *pcName, uint8_t *pucDataBuffer, uint32_t ulSectorCount, size_t xIOManagerCacheSize );
 
+/* Create a RAM disk that mounts a prebuilt disk image, either in place or after copying it into pucDataBuffer */
+FF_Disk_t *FF_RAMDiskInitFromImage( char *pcName, uint8_t *pucDataBuffer, uint32_t ulSectorCount,
+	const uint8_t *pucImage, size_t xImageSize, size_t xIOManagerCacheSize );
+
 /* Release all resources */
 BaseType_t FF_RAMDiskDelete( FF_Disk_t *pxDisk );
 
 /* Show some partition information */
 BaseType_t FF_RAMDiskShowPartition( FF_Disk_t *pxDisk );
 
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+	/* Take a copy-on-write snapshot of the disk, pucSaveArea holds the old contents of the sectors that are written meanwhile */
+	BaseType_t FF_RAMDiskSnapshotStart( FF_Disk_t *pxDisk, uint8_t *pucSaveArea, size_t xSaveAreaSize );
+
+	/* Read the next sectors of the snapshot, returns the number of sectors read, zero at the end, or an error code */
+	int32_t FF_RAMDiskSnapshotRead( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorCount );
+
+	/* Release the snapshot */
+	BaseType_t FF_RAMDiskSnapshotStop( FF_Disk_t *pxDisk );
+#endif
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
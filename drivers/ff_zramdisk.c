@@ -0,0 +1,1019 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+/* Scheduler include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "portmacro.h"
+
+/* FreeRTOS+FAT includes. */
+#include "ff_headers.h"
+#include "ff_zramdisk.h"
+#include "ff_sys.h"
+
+/*
+ * A RAM disk that keeps its contents compressed.
+ *
+ * The disk is divided in pages of ffconfigZRAMDISK_PAGE_SECTORS sectors.
+ * Every page is compressed on its own with a small LZ77 codec (the LZF
+ * format: literal runs and back references into the previous 8 KB), and
+ * stored in a chain of zramCHUNK_SIZE byte chunks taken from the arena that
+ * was passed to FF_ZRAMDiskInit().  Pages that only hold zeros take no space
+ * at all, and a page that does not compress is stored as it is.
+ *
+ * A small cache of ffconfigZRAMDISK_CACHE_PAGES decompressed pages sits in
+ * front of the arena.  Sectors are read from and written to the cache; a
+ * page is only compressed again when it is evicted, or by FF_ZRAMDiskFlush().
+ * When a cached page is first written, enough chunks are reserved to store it
+ * uncompressed, so that evicting it can not fail.  If the arena has no room for
+ * that, the page is compressed straight away, and the write fails when even
+ * the compressed page does not fit.  The data on the disk stays consistent
+ * when the arena runs full.
+ *
+ * The cache and the codec's hash table are shared by all accesses, so unlike
+ * the plain RAM disk this driver is not reentrant.
+ */
+
+#define zramHIDDEN_SECTOR_COUNT		8
+#define zramPRIMARY_PARTITIONS		1
+#define zramSECTOR_SIZE				512UL
+#define zramPARTITION_NUMBER		0 /* Only a single partition is used. */
+#define zramPAGE_SIZE				( ffconfigZRAMDISK_PAGE_SECTORS * zramSECTOR_SIZE )
+
+/* The arena is handed out in chunks of this size. */
+#define zramCHUNK_SIZE				128UL
+#define zramPAGE_CHUNKS				( zramPAGE_SIZE / zramCHUNK_SIZE )
+
+/* Marks the end of a chain of chunks, and a page that holds only zeros. */
+#define zramNO_CHUNK				0xFFFFFFFFUL
+
+/* Marks an unused cache entry. */
+#define zramNO_PAGE					0xFFFFFFFFUL
+
+/* The size of the codec's hash table, as a power of two. */
+#define zramHASH_BITS				12
+#define zramHASH_SIZE				( 1UL << zramHASH_BITS )
+
+/* Limits of the LZF format. */
+#define zramMAX_LITERAL				32
+#define zramMAX_OFFSET				8192
+#define zramMAX_MATCH				264
+
+/* Used as a magic number to indicate that an FF_Disk_t structure is a
+compressed RAM disk. */
+#define zramSIGNATURE				0x5A524D44
+
+#if( zramPAGE_SIZE > 0xFFFFUL )
+	#error ffconfigZRAMDISK_PAGE_SECTORS is too large
+#endif
+
+/* One decompressed page in the cache. */
+typedef struct xZRAM_CACHE_PAGE
+{
+	uint8_t *pucData;
+	uint32_t ulPage;
+	uint32_t ulLRU;
+	uint32_t ulReserved;		/* Chunks reserved to store the page. */
+	BaseType_t xDirty;
+} ZRAMCachePage_t;
+
+/* Where a page is stored in the arena. */
+typedef struct xZRAM_PAGE
+{
+	uint32_t ulFirstChunk;		/* zramNO_CHUNK for a page of zeros. */
+	uint16_t usLength;			/* zramPAGE_SIZE for a page stored as it is. */
+} ZRAMPage_t;
+
+/* The driver's data, pointed to by FF_Disk_t::pvTag. */
+typedef struct xZRAM_DISK
+{
+	uint8_t *pucArena;
+	uint32_t ulChunkCount;
+	uint32_t ulFreeChunks;
+	uint32_t ulFirstFreeChunk;
+	uint32_t ulReservedChunks;	/* Free chunks set aside for dirty pages in the cache. */
+	uint32_t *pulNextChunk;		/* Links the chunks of a page, and the free chunks. */
+	ZRAMPage_t *pxPages;
+	uint32_t ulPageCount;
+	ZRAMCachePage_t xCache[ ffconfigZRAMDISK_CACHE_PAGES ];
+	uint32_t ulLRUCounter;
+	uint8_t *pucScratch;		/* The compressed form of one page. */
+	uint16_t *pusHash;			/* Positions + 1 of recent 3-byte sequences. */
+
+	/* Statistics. */
+	uint32_t ulCacheHits;
+	uint32_t ulCacheMisses;
+	uint32_t ulStoredPages;		/* Pages that are not all zeros. */
+	uint32_t ulStoredBytes;		/* Their compressed size. */
+	uint64_t ullCompressedBytes;
+	uint64_t ullDecompressedBytes;
+	TickType_t xCompressTicks;
+	TickType_t xDecompressTicks;
+} ZRAMDisk_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The functions that read from and write to the media, through the cache of
+ * decompressed pages.
+ */
+static int32_t prvReadZRAM( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+static int32_t prvWriteZRAM( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*
+ * Returns the cache entry that holds page ulPage, after evicting and loading
+ * pages as needed.  When xOverwrite is pdTRUE the caller is about to write
+ * the entire page, so its old contents are not decompressed.  Returns NULL
+ * when an evicted page could not be stored.
+ */
+static ZRAMCachePage_t *prvGetPage( ZRAMDisk_t *pxZRAM, uint32_t ulPage, BaseType_t xOverwrite );
+
+/*
+ * Compresses a cached page into the arena.
+ */
+static BaseType_t prvStorePage( ZRAMDisk_t *pxZRAM, ZRAMCachePage_t *pxEntry );
+
+/*
+ * Decompresses a page from the arena into a cache entry.
+ */
+static BaseType_t prvLoadPage( ZRAMDisk_t *pxZRAM, ZRAMCachePage_t *pxEntry );
+
+/*
+ * Returns the chunks of a page to the free list.
+ */
+static void prvFreeChunks( ZRAMDisk_t *pxZRAM, uint32_t ulPage );
+
+/*
+ * Marks a cached page as dirty.  Returns pdFAIL when the arena has no room to
+ * store it, in which case the page is reloaded, undoing the caller's change.
+ */
+static BaseType_t prvSetDirty( ZRAMDisk_t *pxZRAM, ZRAMCachePage_t *pxEntry );
+
+/*
+ * The codec.  prvCompress() returns 0 if the result would not fit in
+ * xOutLimit bytes, prvDecompress() returns 0 for corrupt input.
+ */
+static size_t prvCompress( ZRAMDisk_t *pxZRAM, const uint8_t *pucIn, size_t xInLength, uint8_t *pucOut, size_t xOutLimit );
+static size_t prvDecompress( const uint8_t *pucIn, size_t xInLength, uint8_t *pucOut, size_t xOutLength );
+
+/*
+ * Checks the parameters of a read or a write.
+ */
+static int32_t prvCheckAccess( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, int32_t lOutOfBounds );
+
+/*
+ * The disk is new, so it must be partitioned and formatted.
+ */
+static FF_Error_t prvPartitionAndFormatDisk( FF_Disk_t *pxDisk );
+
+/*-----------------------------------------------------------*/
+
+/* Create a compressed RAM disk.
+
+ + pcName is the name to give the disk within FreeRTOS+FAT's virtual file system.
+ + pucArena / xArenaSize is the memory in which the compressed sectors are
+   stored.  Its size limits how much data the disk can hold, depending on how
+   well the data compresses.
+ + ulSectorCount is the size of the disk as seen by FreeRTOS+FAT, each sector
+   is 512 bytes.  This may be several times larger than the arena.
+ + xIOManagerCacheSize is the size of the IO manager's cache, which must be a
+   multiple of the sector size, and at least twice as big as the sector size.
+
+The page table, the chunk links and the page cache are allocated with
+pvPortMalloc(): 8 bytes per page, 4 bytes per chunk and
+ffconfigZRAMDISK_CACHE_PAGES + 1 pages.
+*/
+FF_Disk_t *FF_ZRAMDiskInit( char *pcName, uint8_t *pucArena, size_t xArenaSize, uint32_t ulSectorCount, size_t xIOManagerCacheSize )
+{
+FF_Error_t xError = FF_ERR_NONE;
+FF_Disk_t *pxDisk = NULL;
+ZRAMDisk_t *pxZRAM = NULL;
+FF_CreationParameters_t xParameters;
+uint32_t ulIndex;
+size_t xSize;
+
+	/* Check the validity of the parameters. */
+	configASSERT( ( xIOManagerCacheSize % zramSECTOR_SIZE ) == 0 );
+	configASSERT( ( xIOManagerCacheSize >= ( 2 * zramSECTOR_SIZE ) ) );
+	configASSERT( ( ulSectorCount % ffconfigZRAMDISK_PAGE_SECTORS ) == 0 );
+	configASSERT( xArenaSize >= zramCHUNK_SIZE );
+
+	pxDisk = ( FF_Disk_t * ) pvPortMalloc( sizeof( FF_Disk_t ) );
+	pxZRAM = ( ZRAMDisk_t * ) pvPortMalloc( sizeof( ZRAMDisk_t ) );
+
+	if( ( pxDisk != NULL ) && ( pxZRAM != NULL ) )
+	{
+		memset( pxDisk, '\0', sizeof( FF_Disk_t ) );
+		memset( pxZRAM, '\0', sizeof( ZRAMDisk_t ) );
+
+		pxZRAM->pucArena = pucArena;
+		pxZRAM->ulChunkCount = ( uint32_t ) ( xArenaSize / zramCHUNK_SIZE );
+		pxZRAM->ulPageCount = ulSectorCount / ffconfigZRAMDISK_PAGE_SECTORS;
+
+		/* The bookkeeping and the page buffers are allocated as one block,
+		which is freed again in FF_ZRAMDiskDelete(). */
+		xSize = ( pxZRAM->ulChunkCount * sizeof( uint32_t ) ) +
+				( pxZRAM->ulPageCount * sizeof( ZRAMPage_t ) ) +
+				( zramHASH_SIZE * sizeof( uint16_t ) ) +
+				( ( ffconfigZRAMDISK_CACHE_PAGES + 1 ) * zramPAGE_SIZE );
+		pxZRAM->pulNextChunk = ( uint32_t * ) pvPortMalloc( xSize );
+	}
+
+	if( ( pxZRAM != NULL ) && ( pxZRAM->pulNextChunk != NULL ) )
+	{
+		pxZRAM->pxPages = ( ZRAMPage_t * ) ( pxZRAM->pulNextChunk + pxZRAM->ulChunkCount );
+		pxZRAM->pusHash = ( uint16_t * ) ( pxZRAM->pxPages + pxZRAM->ulPageCount );
+		pxZRAM->pucScratch = ( uint8_t * ) ( pxZRAM->pusHash + zramHASH_SIZE );
+
+		/* All chunks are free, and all pages hold zeros. */
+		for( ulIndex = 0; ulIndex < pxZRAM->ulChunkCount; ulIndex++ )
+		{
+			pxZRAM->pulNextChunk[ ulIndex ] = ulIndex + 1;
+		}
+		pxZRAM->pulNextChunk[ pxZRAM->ulChunkCount - 1 ] = zramNO_CHUNK;
+		pxZRAM->ulFirstFreeChunk = 0;
+		pxZRAM->ulFreeChunks = pxZRAM->ulChunkCount;
+
+		for( ulIndex = 0; ulIndex < pxZRAM->ulPageCount; ulIndex++ )
+		{
+			pxZRAM->pxPages[ ulIndex ].ulFirstChunk = zramNO_CHUNK;
+			pxZRAM->pxPages[ ulIndex ].usLength = 0;
+		}
+
+		for( ulIndex = 0; ulIndex < ffconfigZRAMDISK_CACHE_PAGES; ulIndex++ )
+		{
+			pxZRAM->xCache[ ulIndex ].pucData = pxZRAM->pucScratch + ( ( ulIndex + 1 ) * zramPAGE_SIZE );
+			pxZRAM->xCache[ ulIndex ].ulPage = zramNO_PAGE;
+		}
+
+		pxDisk->pvTag = ( void * ) pxZRAM;
+		pxDisk->ulSignature = zramSIGNATURE;
+		pxDisk->ulNumberOfSectors = ulSectorCount;
+
+		memset( &xParameters, '\0', sizeof( xParameters ) );
+		xParameters.pucCacheMemory = NULL;
+		xParameters.ulMemorySize = xIOManagerCacheSize;
+		xParameters.ulSectorSize = zramSECTOR_SIZE;
+		xParameters.fnWriteBlocks = prvWriteZRAM;
+		xParameters.fnReadBlocks = prvReadZRAM;
+		xParameters.pxDisk = pxDisk;
+
+		/* The page cache is shared, so the driver is not reentrant: the
+		semaphore also serialises the accesses to the disk. */
+		xParameters.pvSemaphore = ( void * ) xSemaphoreCreateRecursiveMutex();
+		xParameters.xBlockDeviceIsReentrant = pdFALSE;
+
+		pxDisk->pxIOManager = FF_CreateIOManger( &xParameters, &xError );
+
+		if( ( pxDisk->pxIOManager != NULL ) && ( FF_isERR( xError ) == pdFALSE ) )
+		{
+			pxDisk->xStatus.bIsInitialised = pdTRUE;
+
+			xError = prvPartitionAndFormatDisk( pxDisk );
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pxDisk->xStatus.bPartitionNumber = zramPARTITION_NUMBER;
+				xError = FF_Mount( pxDisk, zramPARTITION_NUMBER );
+				FF_PRINTF( "FF_ZRAMDiskInit: FF_Mount: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+			}
+
+			if( FF_isERR( xError ) == pdFALSE )
+			{
+				pxDisk->xStatus.bIsMounted = pdTRUE;
+				FF_FS_Add( pcName, pxDisk );
+			}
+		}
+		else
+		{
+			FF_PRINTF( "FF_ZRAMDiskInit: FF_CreateIOManger: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+			FF_ZRAMDiskDelete( pxDisk );
+			pxDisk = NULL;
+		}
+	}
+	else
+	{
+		FF_PRINTF( "FF_ZRAMDiskInit: Malloc failed\n" );
+
+		if( pxZRAM != NULL )
+		{
+			vPortFree( pxZRAM );
+		}
+
+		if( pxDisk != NULL )
+		{
+			vPortFree( pxDisk );
+			pxDisk = NULL;
+		}
+	}
+
+	return pxDisk;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_ZRAMDiskDelete( FF_Disk_t *pxDisk )
+{
+ZRAMDisk_t *pxZRAM;
+void *pvSemaphore;
+
+	if( pxDisk != NULL )
+	{
+		pxZRAM = ( ZRAMDisk_t * ) pxDisk->pvTag;
+		pxDisk->ulSignature = 0;
+		pxDisk->xStatus.bIsInitialised = 0;
+		if( pxDisk->pxIOManager != NULL )
+		{
+			/* The semaphore was created by FF_ZRAMDiskInit(). */
+			pvSemaphore = pxDisk->pxIOManager->pvSemaphore;
+			FF_DeleteIOManager( pxDisk->pxIOManager );
+			FF_DeleteSemaphore( pvSemaphore );
+		}
+
+		if( pxZRAM != NULL )
+		{
+			vPortFree( pxZRAM->pulNextChunk );
+			vPortFree( pxZRAM );
+		}
+
+		vPortFree( pxDisk );
+	}
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_ZRAMDiskFlush( FF_Disk_t *pxDisk )
+{
+ZRAMDisk_t *pxZRAM;
+BaseType_t xReturn = pdPASS;
+UBaseType_t uxIndex;
+
+	if( ( pxDisk == NULL ) || ( pxDisk->ulSignature != zramSIGNATURE ) || ( pxDisk->pxIOManager == NULL ) )
+	{
+		xReturn = pdFAIL;
+	}
+	else
+	{
+		/* First the IO manager's cache, then the page cache. */
+		FF_FlushCache( pxDisk->pxIOManager );
+
+		pxZRAM = ( ZRAMDisk_t * ) pxDisk->pvTag;
+
+		FF_PendSemaphore( pxDisk->pxIOManager->pvSemaphore );
+		{
+			for( uxIndex = 0; uxIndex < ffconfigZRAMDISK_CACHE_PAGES; uxIndex++ )
+			{
+				if( ( pxZRAM->xCache[ uxIndex ].xDirty != pdFALSE ) && ( prvStorePage( pxZRAM, &( pxZRAM->xCache[ uxIndex ] ) ) == pdFAIL ) )
+				{
+					xReturn = pdFAIL;
+				}
+			}
+		}
+		FF_ReleaseSemaphore( pxDisk->pxIOManager->pvSemaphore );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FF_ZRAMDiskShowStats( FF_Disk_t *pxDisk )
+{
+ZRAMDisk_t *pxZRAM;
+BaseType_t xReturn;
+uint32_t ulUsedBytes, ulRatio, ulCompressKBs = 0, ulDecompressKBs = 0;
+
+	/* The sizes are only up to date when no page is waiting in the cache. */
+	xReturn = FF_ZRAMDiskFlush( pxDisk );
+
+	if( xReturn == pdPASS )
+	{
+		pxZRAM = ( ZRAMDisk_t * ) pxDisk->pvTag;
+		ulUsedBytes = ( pxZRAM->ulChunkCount - pxZRAM->ulFreeChunks ) * zramCHUNK_SIZE;
+
+		/* In hundredths: 250 means that the data takes 2.5 times less space. */
+		ulRatio = ( ulUsedBytes != 0 ) ? ( uint32_t ) ( ( ( uint64_t ) pxZRAM->ulStoredPages * zramPAGE_SIZE * 100ULL ) / ulUsedBytes ) : 0;
+
+		/* The codec time is measured in ticks around every call.  Single
+		calls are shorter than a tick, but the sum is accurate over many calls. */
+		if( pxZRAM->xCompressTicks != 0 )
+		{
+			ulCompressKBs = ( uint32_t ) ( ( pxZRAM->ullCompressedBytes * configTICK_RATE_HZ ) / ( 1024ULL * pxZRAM->xCompressTicks ) );
+		}
+		if( pxZRAM->xDecompressTicks != 0 )
+		{
+			ulDecompressKBs = ( uint32_t ) ( ( pxZRAM->ullDecompressedBytes * configTICK_RATE_HZ ) / ( 1024ULL * pxZRAM->xDecompressTicks ) );
+		}
+
+		FF_PRINTF( "Stored pages   %8lu of %lu (%lu bytes each)\n", ( unsigned long ) pxZRAM->ulStoredPages, ( unsigned long ) pxZRAM->ulPageCount, ( unsigned long ) zramPAGE_SIZE );
+		FF_PRINTF( "Compressed     %8lu bytes, %lu bytes of arena in use\n", ( unsigned long ) pxZRAM->ulStoredBytes, ( unsigned long ) ulUsedBytes );
+		FF_PRINTF( "Arena free     %8lu of %lu bytes\n", ( unsigned long ) ( pxZRAM->ulFreeChunks * zramCHUNK_SIZE ), ( unsigned long ) ( pxZRAM->ulChunkCount * zramCHUNK_SIZE ) );
+		FF_PRINTF( "Ratio          %5lu.%02lu\n", ( unsigned long ) ( ulRatio / 100 ), ( unsigned long ) ( ulRatio % 100 ) );
+		FF_PRINTF( "Page cache     %8lu hits %lu misses\n", ( unsigned long ) pxZRAM->ulCacheHits, ( unsigned long ) pxZRAM->ulCacheMisses );
+		FF_PRINTF( "Compress       %8lu KB at %lu KB/s\n", ( unsigned long ) ( pxZRAM->ullCompressedBytes / 1024 ), ( unsigned long ) ulCompressKBs );
+		FF_PRINTF( "Decompress     %8lu KB at %lu KB/s\n", ( unsigned long ) ( pxZRAM->ullDecompressedBytes / 1024 ), ( unsigned long ) ulDecompressKBs );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvCheckAccess( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, int32_t lOutOfBounds )
+{
+int32_t lReturn = FF_ERR_NONE;
+
+	if( ( pxDisk == NULL ) || ( pucBuffer == NULL ) )
+	{
+		lReturn = FF_ERR_NULL_POINTER | FF_ERRFLAG;
+	}
+	else if( pxDisk->ulSignature != zramSIGNATURE )
+	{
+		/* The disk structure is not valid because it doesn't contain a
+		magic number written to the disk when it was created. */
+		lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+	}
+	else if( pxDisk->xStatus.bIsInitialised == pdFALSE )
+	{
+		/* The disk has not been initialised. */
+		lReturn = lOutOfBounds | FF_ERRFLAG;
+	}
+	else if( ( ulSectorNumber >= pxDisk->ulNumberOfSectors ) ||
+			 ( ( pxDisk->ulNumberOfSectors - ulSectorNumber ) < ulSectorCount ) )
+	{
+		/* The sectors are not within the bounds of the disk. */
+		lReturn = lOutOfBounds | FF_ERRFLAG;
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvReadZRAM( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+ZRAMDisk_t *pxZRAM;
+ZRAMCachePage_t *pxEntry;
+uint32_t ulOffset, ulCount;
+
+	lReturn = prvCheckAccess( pxDisk, pucDestination, ulSectorNumber, ulSectorCount, FF_ERR_IOMAN_OUT_OF_BOUNDS_READ );
+
+	if( lReturn == FF_ERR_NONE )
+	{
+		pxZRAM = ( ZRAMDisk_t * ) pxDisk->pvTag;
+
+		while( ulSectorCount != 0 )
+		{
+			/* Copy as many sectors as there are in this page. */
+			ulOffset = ulSectorNumber % ffconfigZRAMDISK_PAGE_SECTORS;
+			ulCount = ffconfigZRAMDISK_PAGE_SECTORS - ulOffset;
+			if( ulCount > ulSectorCount )
+			{
+				ulCount = ulSectorCount;
+			}
+
+			pxEntry = prvGetPage( pxZRAM, ulSectorNumber / ffconfigZRAMDISK_PAGE_SECTORS, pdFALSE );
+			if( pxEntry == NULL )
+			{
+				lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+				break;
+			}
+
+			memcpy( pucDestination, pxEntry->pucData + ( ulOffset * zramSECTOR_SIZE ), ( size_t ) ( ulCount * zramSECTOR_SIZE ) );
+
+			pucDestination += ulCount * zramSECTOR_SIZE;
+			ulSectorNumber += ulCount;
+			ulSectorCount -= ulCount;
+		}
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvWriteZRAM( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+ZRAMDisk_t *pxZRAM;
+ZRAMCachePage_t *pxEntry;
+uint32_t ulOffset, ulCount;
+
+	lReturn = prvCheckAccess( pxDisk, pucSource, ulSectorNumber, ulSectorCount, FF_ERR_IOMAN_OUT_OF_BOUNDS_WRITE );
+
+	if( lReturn == FF_ERR_NONE )
+	{
+		pxZRAM = ( ZRAMDisk_t * ) pxDisk->pvTag;
+
+		while( ulSectorCount != 0 )
+		{
+			ulOffset = ulSectorNumber % ffconfigZRAMDISK_PAGE_SECTORS;
+			ulCount = ffconfigZRAMDISK_PAGE_SECTORS - ulOffset;
+			if( ulCount > ulSectorCount )
+			{
+				ulCount = ulSectorCount;
+			}
+
+			/* A write of a whole page does not need the old contents. */
+			pxEntry = prvGetPage( pxZRAM, ulSectorNumber / ffconfigZRAMDISK_PAGE_SECTORS,
+				( ulCount == ffconfigZRAMDISK_PAGE_SECTORS ) ? pdTRUE : pdFALSE );
+			if( pxEntry == NULL )
+			{
+				lReturn = FF_ERR_IOMAN_DRIVER_FATAL_ERROR | FF_ERRFLAG;
+				break;
+			}
+
+			memcpy( pxEntry->pucData + ( ulOffset * zramSECTOR_SIZE ), pucSource, ( size_t ) ( ulCount * zramSECTOR_SIZE ) );
+
+			if( prvSetDirty( pxZRAM, pxEntry ) == pdFAIL )
+			{
+				lReturn = FF_ERR_IOMAN_NOT_ENOUGH_FREE_SPACE | FF_ERRFLAG;
+				break;
+			}
+
+			pucSource += ulCount * zramSECTOR_SIZE;
+			ulSectorNumber += ulCount;
+			ulSectorCount -= ulCount;
+		}
+	}
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static ZRAMCachePage_t *prvGetPage( ZRAMDisk_t *pxZRAM, uint32_t ulPage, BaseType_t xOverwrite )
+{
+ZRAMCachePage_t *pxEntry = NULL, *pxVictim = NULL;
+UBaseType_t uxIndex;
+
+	for( uxIndex = 0; uxIndex < ffconfigZRAMDISK_CACHE_PAGES; uxIndex++ )
+	{
+		if( pxZRAM->xCache[ uxIndex ].ulPage == ulPage )
+		{
+			pxEntry = &( pxZRAM->xCache[ uxIndex ] );
+			break;
+		}
+
+		/* Prefer an unused entry, otherwise the least recently used. */
+		if( ( pxVictim == NULL ) ||
+			( ( pxVictim->ulPage != zramNO_PAGE ) &&
+			  ( ( pxZRAM->xCache[ uxIndex ].ulPage == zramNO_PAGE ) || ( pxZRAM->xCache[ uxIndex ].ulLRU < pxVictim->ulLRU ) ) ) )
+		{
+			pxVictim = &( pxZRAM->xCache[ uxIndex ] );
+		}
+	}
+
+	if( pxEntry != NULL )
+	{
+		pxZRAM->ulCacheHits++;
+	}
+	else
+	{
+		pxZRAM->ulCacheMisses++;
+
+		if( ( pxVictim->xDirty == pdFALSE ) || ( prvStorePage( pxZRAM, pxVictim ) == pdPASS ) )
+		{
+			pxVictim->ulPage = ulPage;
+
+			if( xOverwrite != pdFALSE )
+			{
+				/* The caller fills the page. */
+				pxEntry = pxVictim;
+			}
+			else if( prvLoadPage( pxZRAM, pxVictim ) == pdPASS )
+			{
+				pxEntry = pxVictim;
+			}
+			else
+			{
+				pxVictim->ulPage = zramNO_PAGE;
+			}
+		}
+	}
+
+	if( pxEntry != NULL )
+	{
+		pxEntry->ulLRU = ++pxZRAM->ulLRUCounter;
+	}
+
+	return pxEntry;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvStorePage( ZRAMDisk_t *pxZRAM, ZRAMCachePage_t *pxEntry )
+{
+ZRAMPage_t *pxPage = &( pxZRAM->pxPages[ pxEntry->ulPage ] );
+const uint8_t *pucSource = pxZRAM->pucScratch;
+size_t xLength = 0, xIndex;
+uint32_t ulNeeded, ulOwned, ulChunk, ulPrevious = zramNO_CHUNK;
+BaseType_t xReturn = pdPASS;
+TickType_t xStart;
+
+	/* Pages of zeros are not stored. */
+	for( xIndex = 0; ( xIndex < zramPAGE_SIZE ) && ( pxEntry->pucData[ xIndex ] == 0u ); xIndex++ )
+	{
+	}
+
+	if( xIndex < zramPAGE_SIZE )
+	{
+		xStart = xTaskGetTickCount();
+		xLength = prvCompress( pxZRAM, pxEntry->pucData, zramPAGE_SIZE, pxZRAM->pucScratch, zramPAGE_SIZE - 1 );
+		pxZRAM->xCompressTicks += xTaskGetTickCount() - xStart;
+		pxZRAM->ullCompressedBytes += zramPAGE_SIZE;
+
+		if( xLength == 0 )
+		{
+			/* The page does not compress, store it as it is. */
+			pucSource = pxEntry->pucData;
+			xLength = zramPAGE_SIZE;
+		}
+	}
+
+	/* Make sure there is room before letting go of the old copy. */
+	ulNeeded = ( uint32_t ) ( ( xLength + zramCHUNK_SIZE - 1 ) / zramCHUNK_SIZE );
+	ulOwned = ( uint32_t ) ( ( pxPage->usLength + zramCHUNK_SIZE - 1 ) / zramCHUNK_SIZE );
+
+	/* The chunks reserved for this page may be used, but not those of the
+	other dirty pages. */
+	if( ( ulNeeded + pxZRAM->ulReservedChunks ) > ( pxZRAM->ulFreeChunks + ulOwned + pxEntry->ulReserved ) )
+	{
+		xReturn = pdFAIL;
+	}
+	else
+	{
+		pxZRAM->ulReservedChunks -= pxEntry->ulReserved;
+		pxEntry->ulReserved = 0;
+		prvFreeChunks( pxZRAM, pxEntry->ulPage );
+
+		if( xLength != 0 )
+		{
+			pxZRAM->ulStoredPages++;
+			pxZRAM->ulStoredBytes += ( uint32_t ) xLength;
+		}
+		pxPage->usLength = ( uint16_t ) xLength;
+
+		/* Copy the data into a chain of free chunks. */
+		for( xIndex = 0; xIndex < xLength; xIndex += zramCHUNK_SIZE )
+		{
+			ulChunk = pxZRAM->ulFirstFreeChunk;
+			pxZRAM->ulFirstFreeChunk = pxZRAM->pulNextChunk[ ulChunk ];
+			pxZRAM->ulFreeChunks--;
+
+			if( ulPrevious == zramNO_CHUNK )
+			{
+				pxPage->ulFirstChunk = ulChunk;
+			}
+			else
+			{
+				pxZRAM->pulNextChunk[ ulPrevious ] = ulChunk;
+			}
+			pxZRAM->pulNextChunk[ ulChunk ] = zramNO_CHUNK;
+			ulPrevious = ulChunk;
+
+			memcpy( pxZRAM->pucArena + ( ulChunk * zramCHUNK_SIZE ), pucSource + xIndex,
+				( ( xLength - xIndex ) < zramCHUNK_SIZE ) ? ( xLength - xIndex ) : zramCHUNK_SIZE );
+		}
+
+		pxEntry->xDirty = pdFALSE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvLoadPage( ZRAMDisk_t *pxZRAM, ZRAMCachePage_t *pxEntry )
+{
+ZRAMPage_t *pxPage = &( pxZRAM->pxPages[ pxEntry->ulPage ] );
+uint8_t *pucTarget;
+size_t xIndex;
+uint32_t ulChunk;
+BaseType_t xReturn = pdPASS;
+TickType_t xStart;
+
+	if( pxPage->ulFirstChunk == zramNO_CHUNK )
+	{
+		memset( pxEntry->pucData, '\0', zramPAGE_SIZE );
+	}
+	else
+	{
+		/* A page that was stored as it is is copied straight into the cache,
+		otherwise the chunks are gathered first. */
+		pucTarget = ( pxPage->usLength == zramPAGE_SIZE ) ? pxEntry->pucData : pxZRAM->pucScratch;
+
+		ulChunk = pxPage->ulFirstChunk;
+		for( xIndex = 0; xIndex < pxPage->usLength; xIndex += zramCHUNK_SIZE )
+		{
+			memcpy( pucTarget + xIndex, pxZRAM->pucArena + ( ulChunk * zramCHUNK_SIZE ),
+				( ( pxPage->usLength - xIndex ) < zramCHUNK_SIZE ) ? ( pxPage->usLength - xIndex ) : zramCHUNK_SIZE );
+			ulChunk = pxZRAM->pulNextChunk[ ulChunk ];
+		}
+
+		if( pxPage->usLength != zramPAGE_SIZE )
+		{
+			xStart = xTaskGetTickCount();
+			if( prvDecompress( pxZRAM->pucScratch, pxPage->usLength, pxEntry->pucData, zramPAGE_SIZE ) != zramPAGE_SIZE )
+			{
+				FF_PRINTF( "prvLoadPage: page %lu is corrupt\n", ( unsigned long ) pxEntry->ulPage );
+				xReturn = pdFAIL;
+			}
+			pxZRAM->xDecompressTicks += xTaskGetTickCount() - xStart;
+			pxZRAM->ullDecompressedBytes += zramPAGE_SIZE;
+		}
+	}
+
+	pxEntry->xDirty = pdFALSE;
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSetDirty( ZRAMDisk_t *pxZRAM, ZRAMCachePage_t *pxEntry )
+{
+BaseType_t xReturn = pdPASS;
+uint32_t ulOwned;
+
+	if( pxEntry->xDirty == pdFALSE )
+	{
+		/* Storing the page will free the chunks that it holds now. */
+		ulOwned = ( uint32_t ) ( ( pxZRAM->pxPages[ pxEntry->ulPage ].usLength + zramCHUNK_SIZE - 1 ) / zramCHUNK_SIZE );
+		pxEntry->xDirty = pdTRUE;
+
+		if( ( pxZRAM->ulFreeChunks - pxZRAM->ulReservedChunks ) >= ( zramPAGE_CHUNKS - ulOwned ) )
+		{
+			pxEntry->ulReserved = zramPAGE_CHUNKS - ulOwned;
+			pxZRAM->ulReservedChunks += pxEntry->ulReserved;
+		}
+		else if( prvStorePage( pxZRAM, pxEntry ) == pdFAIL )
+		{
+			/* The old contents are still in the arena. */
+			FF_PRINTF( "prvSetDirty: arena full\n" );
+			if( prvLoadPage( pxZRAM, pxEntry ) == pdFAIL )
+			{
+				pxEntry->ulPage = zramNO_PAGE;
+			}
+			xReturn = pdFAIL;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFreeChunks( ZRAMDisk_t *pxZRAM, uint32_t ulPage )
+{
+ZRAMPage_t *pxPage = &( pxZRAM->pxPages[ ulPage ] );
+uint32_t ulChunk, ulNext;
+
+	if( pxPage->ulFirstChunk != zramNO_CHUNK )
+	{
+		pxZRAM->ulStoredPages--;
+		pxZRAM->ulStoredBytes -= pxPage->usLength;
+	}
+
+	for( ulChunk = pxPage->ulFirstChunk; ulChunk != zramNO_CHUNK; ulChunk = ulNext )
+	{
+		ulNext = pxZRAM->pulNextChunk[ ulChunk ];
+		pxZRAM->pulNextChunk[ ulChunk ] = pxZRAM->ulFirstFreeChunk;
+		pxZRAM->ulFirstFreeChunk = ulChunk;
+		pxZRAM->ulFreeChunks++;
+	}
+
+	pxPage->ulFirstChunk = zramNO_CHUNK;
+	pxPage->usLength = 0;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvCompress( ZRAMDisk_t *pxZRAM, const uint8_t *pucIn, size_t xInLength, uint8_t *pucOut, size_t xOutLimit )
+{
+const uint8_t *pucEnd = pucIn + xInLength;
+const uint8_t *pucPos = pucIn;
+const uint8_t *pucMatch;
+uint8_t *pucOutPos = pucOut;
+uint8_t *pucOutEnd = pucOut + xOutLimit;
+uint8_t *pucLiteralCount;
+size_t xLength, xMaxLength, xOffset;
+uint32_t ulHash;
+size_t xReturn = 0;
+
+	memset( pxZRAM->pusHash, '\0', zramHASH_SIZE * sizeof( uint16_t ) );
+
+	/* Every literal run is preceded by its length - 1. */
+	pucLiteralCount = pucOutPos++;
+	*pucLiteralCount = 0xFF;
+
+	while( pucPos < pucEnd )
+	{
+		pucMatch = NULL;
+
+		if( ( pucEnd - pucPos ) >= 3 )
+		{
+			ulHash = ( ( ( uint32_t ) pucPos[ 0 ] << 16 ) | ( ( uint32_t ) pucPos[ 1 ] << 8 ) | pucPos[ 2 ] ) * 2654435761UL;
+			ulHash >>= ( 32 - zramHASH_BITS );
+
+			if( pxZRAM->pusHash[ ulHash ] != 0 )
+			{
+				pucMatch = pucIn + pxZRAM->pusHash[ ulHash ] - 1;
+			}
+			pxZRAM->pusHash[ ulHash ] = ( uint16_t ) ( ( pucPos - pucIn ) + 1 );
+
+			if( ( pucMatch != NULL ) &&
+				( ( ( size_t ) ( pucPos - pucMatch ) > zramMAX_OFFSET ) ||
+				  ( pucMatch[ 0 ] != pucPos[ 0 ] ) || ( pucMatch[ 1 ] != pucPos[ 1 ] ) || ( pucMatch[ 2 ] != pucPos[ 2 ] ) ) )
+			{
+				pucMatch = NULL;
+			}
+		}
+
+		if( pucMatch != NULL )
+		{
+			xMaxLength = ( size_t ) ( pucEnd - pucPos );
+			if( xMaxLength > zramMAX_MATCH )
+			{
+				xMaxLength = zramMAX_MATCH;
+			}
+
+			for( xLength = 3; ( xLength < xMaxLength ) && ( pucMatch[ xLength ] == pucPos[ xLength ] ); xLength++ )
+			{
+			}
+
+			/* Close the literal run, or take back its unused length byte. */
+			if( *pucLiteralCount == 0xFF )
+			{
+				pucOutPos--;
+			}
+
+			/* A back reference takes up to 3 bytes, and is followed by the
+			length byte of the next literal run. */
+			if( ( pucOutEnd - pucOutPos ) < 4 )
+			{
+				break;
+			}
+
+			xOffset = ( size_t ) ( pucPos - pucMatch ) - 1;
+			if( ( xLength - 2 ) < 7 )
+			{
+				*( pucOutPos++ ) = ( uint8_t ) ( ( ( xLength - 2 ) << 5 ) | ( xOffset >> 8 ) );
+			}
+			else
+			{
+				*( pucOutPos++ ) = ( uint8_t ) ( ( 7 << 5 ) | ( xOffset >> 8 ) );
+				*( pucOutPos++ ) = ( uint8_t ) ( xLength - 2 - 7 );
+			}
+			*( pucOutPos++ ) = ( uint8_t ) xOffset;
+
+			pucPos += xLength;
+			pucLiteralCount = pucOutPos++;
+			*pucLiteralCount = 0xFF;
+		}
+		else
+		{
+			if( pucOutPos >= pucOutEnd )
+			{
+				break;
+			}
+
+			*( pucOutPos++ ) = *( pucPos++ );
+			*pucLiteralCount = ( uint8_t ) ( *pucLiteralCount + 1 );
+
+			if( *pucLiteralCount == ( zramMAX_LITERAL - 1 ) )
+			{
+				/* The run is full, start a new one. */
+				if( pucOutPos >= pucOutEnd )
+				{
+					break;
+				}
+				pucLiteralCount = pucOutPos++;
+				*pucLiteralCount = 0xFF;
+			}
+		}
+	}
+
+	if( pucPos == pucEnd )
+	{
+		if( *pucLiteralCount == 0xFF )
+		{
+			/* The last run is empty. */
+			pucOutPos--;
+		}
+		xReturn = ( size_t ) ( pucOutPos - pucOut );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvDecompress( const uint8_t *pucIn, size_t xInLength, uint8_t *pucOut, size_t xOutLength )
+{
+const uint8_t *pucEnd = pucIn + xInLength;
+const uint8_t *pucMatch;
+uint8_t *pucOutPos = pucOut;
+uint8_t *pucOutEnd = pucOut + xOutLength;
+size_t xLength, xOffset;
+uint8_t ucControl;
+size_t xReturn = 0;
+
+	while( pucIn < pucEnd )
+	{
+		ucControl = *( pucIn++ );
+
+		if( ucControl < zramMAX_LITERAL )
+		{
+			xLength = ( size_t ) ucControl + 1;
+			if( ( ( size_t ) ( pucEnd - pucIn ) < xLength ) || ( ( size_t ) ( pucOutEnd - pucOutPos ) < xLength ) )
+			{
+				break;
+			}
+			memcpy( pucOutPos, pucIn, xLength );
+			pucIn += xLength;
+			pucOutPos += xLength;
+		}
+		else
+		{
+			xLength = ucControl >> 5;
+			if( ( xLength == 7 ) && ( pucIn < pucEnd ) )
+			{
+				xLength += *( pucIn++ );
+			}
+			if( pucIn >= pucEnd )
+			{
+				break;
+			}
+			xOffset = ( ( ( size_t ) ucControl & 0x1F ) << 8 ) + *( pucIn++ ) + 1;
+			xLength += 2;
+
+			if( ( xOffset > ( size_t ) ( pucOutPos - pucOut ) ) || ( ( size_t ) ( pucOutEnd - pucOutPos ) < xLength ) )
+			{
+				break;
+			}
+
+			/* The source may overlap the destination, copy byte by byte. */
+			pucMatch = pucOutPos - xOffset;
+			while( xLength-- != 0 )
+			{
+				*( pucOutPos++ ) = *( pucMatch++ );
+			}
+		}
+	}
+
+	if( pucIn == pucEnd )
+	{
+		xReturn = ( size_t ) ( pucOutPos - pucOut );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static FF_Error_t prvPartitionAndFormatDisk( FF_Disk_t *pxDisk )
+{
+FF_PartitionParameters_t xPartition;
+FF_Error_t xError;
+
+	/* Create a single partition that fills all available space on the disk. */
+	memset( &xPartition, '\0', sizeof( xPartition ) );
+	xPartition.ulSectorCount = pxDisk->ulNumberOfSectors;
+	xPartition.ulHiddenSectors = zramHIDDEN_SECTOR_COUNT;
+	xPartition.xPrimaryCount = zramPRIMARY_PARTITIONS;
+	xPartition.eSizeType = eSizeIsQuota;
+
+	/* Partition the disk */
+	xError = FF_Partition( pxDisk, &xPartition );
+	FF_PRINTF( "FF_Partition: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		/* Format the partition. */
+		xError = FF_Format( pxDisk, zramPARTITION_NUMBER, pdTRUE, pdTRUE );
+		FF_PRINTF( "FF_ZRAMDiskInit: FF_Format: %s\n", ( const char * ) FF_GetErrMessage( xError ) );
+	}
+
+	return xError;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,54 @@
+/*
+ * FreeRTOS+FAT build 191128 - Note:  FreeRTOS+FAT is still in the lab!
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ * Authors include James Walmsley, Hein Tibosch and Richard Barry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ *
+ */
+
+#ifndef __ZRAMDISK_H__
+
+#define __ZRAMDISK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ff_headers.h"
+
+/* Create a compressed RAM disk of ulSectorCount sectors of 512 bytes each,
+which stores its sectors compressed in the xArenaSize bytes at pucArena */
+FF_Disk_t *FF_ZRAMDiskInit( char *pcName, uint8_t *pucArena, size_t xArenaSize, uint32_t ulSectorCount, size_t xIOManagerCacheSize );
+
+/* Release all resources */
+BaseType_t FF_ZRAMDiskDelete( FF_Disk_t *pxDisk );
+
+/* Write back the pages held in the decompressed page cache */
+BaseType_t FF_ZRAMDiskFlush( FF_Disk_t *pxDisk );
+
+/* Show the compression ratio, the use of the arena and the codec throughput */
+BaseType_t FF_ZRAMDiskShowStats( FF_Disk_t *pxDisk );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __ZRAMDISK_H__ */
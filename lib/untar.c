@@ -25,8 +25,6 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
-#include <sys/stat.h>
-#include <fcntl.h>
 
 #include "untar.h"
 #include "ff_headers.h"
@@ -151,6 +151,63 @@ than 512 bytes are being used.  When set to 1 each file handle will
 allocate a 512-byte character buffer to facilitate "unaligned access". */
 #define	ffconfigOPTIMISE_UNALIGNED_ACCESS	1
 
+/* Set to 1 to include FF_ReadBorrow() and ff_fread_zc(), which let the
+caller look at file data in place, inside a sector of the cache, instead
+of having it copied to a buffer of its own. */
+#define	ffconfigZERO_COPY_READ	1
+
+/* Set to 1 to include FF_MapFile() and ff_mmap_ro(), which give read-only
+access to a file in place on media that are addressable memory, such as the
+RAM disk. */
+#define	ffconfigMMAP_SUPPORT	1
+
+/* Set to 1 to let cache buffers point into the memory of a RAM disk,
+instead of holding a copy of the sector. */
+#define	ffconfigCACHE_MAP_BLOCKS	1
+
+/* Set to 1 to let the RAM disk clear its memory lazily, instead of clearing
+all of it when the disk is created. */
+#define	ffconfigRAMDISK_LAZY_ZERO	1
+
+/* Set to 1 to let the RAM disk take copy-on-write snapshots of itself, that
+can be read out while the file system is in use. */
+#define	ffconfigRAMDISK_SNAPSHOT	1
+
+/* Set to 1 to include ff_setvbuf(), which gives a stream a buffer in which
+ff_fgetc(), ff_fputc(), ff_fgets() and ff_fprintf() do their work. */
+#define	ffconfigSTDIO_BUFFERS	1
+
+/* Set to 1 to include FF_CopyFile() and ff_copyfile().  On the RAM disk the
+clusters are copied in place; other media use a buffer of
+ffconfigCOPYFILE_BUFFER_SIZE bytes. */
+#define	ffconfigCOPYFILE_SUPPORT		1
+#define	ffconfigCOPYFILE_BUFFER_SIZE	4096
+
+/* Set to 1 to include ff_aio_read(), ff_aio_write(), ff_aio_fsync() and
+ff_aio_cancel(), executed by ffconfigAIO_WORKER_COUNT worker tasks. */
+#define	ffconfigAIO_SUPPORT				1
+#define	ffconfigAIO_WORKER_COUNT		2
+#define	ffconfigAIO_WORKER_PRIORITY		( tskIDLE_PRIORITY + 1 )
+#define	ffconfigAIO_WORKER_STACK_SIZE	512
+
+/* Set to 1 to support FF_MODE_LOG: appends that keep the last sector in the
+handle, reserve clusters ahead and publish the size once a second. */
+#define	ffconfigLOG_FILE_SUPPORT		1
+#define	ffconfigLOG_RESERVE_CLUSTERS	8
+#define	ffconfigLOG_SYNC_INTERVAL_MS	1000
+
+/* Set to 1 to let tasks read different files in parallel: chain walks share
+the FAT lock and cache misses are read outside the I/O manager semaphore. */
+#define	ffconfigCONCURRENT_READS		1
+
+/* The number of file handles, and their unaligned access buffers, that are
+kept in a pool instead of being allocated from the heap at every open. */
+#define	ffconfigFILE_HANDLE_POOL_SIZE	8
+
+/* The number of lists in the table of open files, hashed on the directory
+entry of each file. */
+#define	ffconfigOPEN_FILE_BUCKETS		32
+
 /* Input and output to a disk uses buffers that are only flushed at the
 following times:
 
@@ -229,6 +286,14 @@ Sets the maximum number of paths that can exist in the patch cache at any
 one time. */
 #define	ffconfigPATH_CACHE_DEPTH 8
 
+/* Set to 1 to let ff_findfirst() filter on a pattern, e.g. "*.bin".
+The last token of the path is only taken as a pattern when it contains a '*'
+or a '?', or ends with ':' to list the entries that do not match. */
+#define ffconfigFINDAPI_ALLOW_WILDCARDS	1
+
+/* Set to 1 to let wild-card patterns ignore the case of ASCII letters. */
+#define ffconfigWILDCARD_CASE_INSENSITIVE	1
+
 /* Set to 1 to calculate a HASH value for each existing short file name.
 Use of HASH values can improve performance when working with large
 directories, or with files that have a similar name.
@@ -244,6 +309,32 @@ Set to CRC8 or CRC16 to use 8-bit or 16-bit HASH values respectively. */
 /*_RB_ Not in FreeRTOSFFConfigDefaults.h. */
 #define ffconfigHASH_CACHE_DEPTH 64
 
+/* Set to 1 to remember, per directory, where free directory entries can be
+found, so that Untar_FromMemory() and loggers creating many files in one
+directory do not rescan it for every new file. */
+#define	ffconfigDIRENT_HINT_CACHE	1
+
+/* Only used if ffconfigDIRENT_HINT_CACHE is 1.
+Sets the number of directories for which free-entry hints are kept. */
+#define	ffconfigDIRENT_HINT_DEPTH	8
+
+/* Set to 1 to lock each directory separately while it is being changed, so
+that tasks working in different directories do not block each other.  Set
+to 0 to use a single directory lock for the whole volume. */
+#define	ffconfigDIRECTORY_LOCKS	1
+
+/* Only used if ffconfigDIRECTORY_LOCKS is 1.
+Sets the number of directories that can be locked at the same time. */
+#define	ffconfigDIRECTORY_LOCK_DEPTH	4
+
+/* Set to 1 to collect changes to the size, first cluster and time of an open
+file, and write its directory entry only once at close or sync. */
+#define	ffconfigDEFERRED_DIRENT_UPDATE	1
+
+/* Only used if ffconfigDEFERRED_DIRENT_UPDATE is 1.
+A write will also update the directory entry once it is this old, in ms. */
+#define	ffconfigDIRENT_SYNC_INTERVAL_MS	2000
+
 /* Set to 1 to add a parameter to ff_mkdir() that allows an entire directory
 tree to be created in one go, rather than having to create one directory in
 the tree at a time.  For example mkdir( "/etc/settings/network", pdTRUE );.
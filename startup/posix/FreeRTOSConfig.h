@@ -0,0 +1,66 @@
+/*
+ * FreeRTOS configuration of the host build ('make host'), which runs the
+ * kernel, FreeRTOS+FAT and the application as a Linux process on top of the
+ * Posix port in FreeRTOS-LTS-Kernel/portable/ThirdParty/GCC/Posix.
+ *
+ * It follows startup/FreeRTOSConfig.h, apart from the settings that depend
+ * on the host:
+ * - Every task is a thread with its stack on the FreeRTOS heap.  Stacks are
+ *   counted in words of 8 bytes, and must be larger than PTHREAD_STACK_MIN
+ *   (16 KB).  glibc's printf() alone takes several KB.
+ * - heap_3.c takes its memory from malloc(), so configTOTAL_HEAP_SIZE is
+ *   not used.  Valgrind and AddressSanitizer see every allocation.
+ * - The Posix port has no interrupt priorities.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configUSE_PREEMPTION              1
+#define configUSE_IDLE_HOOK               0
+#define configUSE_TICK_HOOK               0
+#define configTICK_RATE_HZ                ( ( TickType_t ) 1000 )
+#define configMAX_PRIORITIES              ( 5 )
+#define configMINIMAL_STACK_SIZE          ( ( unsigned short ) 4096 )
+#define configTOTAL_HEAP_SIZE             ( ( size_t ) ( 64 * 1024 * 1024 ) )
+#define configMAX_TASK_NAME_LEN           ( 16 )
+#define configUSE_TRACE_FACILITY          0
+#define configUSE_16_BIT_TICKS            0
+#define configIDLE_SHOULD_YIELD           1
+#define configUSE_APPLICATION_TASK_TAG    1
+#define configUSE_MUTEXES                 1
+#define configUSE_CO_ROUTINES             0
+#define configMAX_CO_ROUTINE_PRIORITIES   ( 2 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+
+#define INCLUDE_vTaskPrioritySet              1
+#define INCLUDE_uxTaskPriorityGet             1
+#define INCLUDE_vTaskDelete                   1
+#define INCLUDE_vTaskCleanUpResources         0
+#define INCLUDE_vTaskSuspend                  1
+#define INCLUDE_vTaskDelayUntil               1
+#define INCLUDE_vTaskDelay                    1
+#define INCLUDE_xTaskGetSchedulerState        1
+#define INCLUDE_xTaskGetCurrentTaskHandle     1
+#define INCLUDE_xTaskGetIdleTaskHandle        1
+
+#define configCHECK_FOR_STACK_OVERFLOW  0
+#define configUSE_RECURSIVE_MUTEXES     1
+#define configQUEUE_REGISTRY_SIZE       0
+#define configUSE_MALLOC_FAILED_HOOK    1
+#define configUSE_COUNTING_SEMAPHORES   1
+#define configUSE_ALTERNATIVE_API       0
+
+#define configUSE_TIMERS                1
+#define configTIMER_TASK_PRIORITY       2
+#define configTIMER_QUEUE_LENGTH        20
+#define configTIMER_TASK_STACK_DEPTH    ( configMINIMAL_STACK_SIZE * 2 )
+
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS      3
+
+extern void vAssertCalled( const char *pcFile, uint32_t ulLine );
+#define configASSERT( x )  if( ( x ) == 0 ) vAssertCalled( __FILE__, __LINE__ )
+
+#endif /* FREERTOS_CONFIG_H */
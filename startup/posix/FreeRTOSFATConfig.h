@@ -0,0 +1,20 @@
+/*
+ * FreeRTOS+FAT configuration of the host build ('make host'): the same as
+ * the target's, with the stack sizes of the Posix port and the block queue.
+ */
+
+#ifndef _FF_HOST_CONFIG_H_
+#define _FF_HOST_CONFIG_H_
+
+#include "../FreeRTOSFATConfig.h"
+
+/* Threads of the Posix port need at least PTHREAD_STACK_MIN bytes. */
+#undef	ffconfigAIO_WORKER_STACK_SIZE
+#define	ffconfigAIO_WORKER_STACK_SIZE	configMINIMAL_STACK_SIZE
+
+/* The file disk passes its requests through the block queue with '-q', and
+the tests of 'make test' exercise it. */
+#undef	ffconfigBLOCK_QUEUE
+#define	ffconfigBLOCK_QUEUE				1
+
+#endif /* _FF_HOST_CONFIG_H_ */
@@ -0,0 +1,218 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The disk of the host build, which takes the place of startup/ramdisk.c.
+ * The application finds it at the same path.  By default the disk lives in
+ * a file of the host, see drivers/ff_filedisk.c.  The Makefile prepares
+ * "host.img" from build/rootfs, in the way the target's RAM disk image is
+ * made.  With '-l' an SD card is simulated under the disk, to compare the
+ * device time that workloads need, and with '-d' the tasks also wait for
+ * it.  With '-q' the requests of the file disk pass through the block queue
+ * (ff_blkqueue.c).
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* FreeRTOS includes. */
+#include <FreeRTOS.h>
+#include "task.h"
+
+/* FreeRTOS+FAT includes. */
+#include "ff_headers.h"
+#include "ff_filedisk.h"
+#include "ff_ramdisk.h"
+#include "ff_latencydisk.h"
+
+#include "app_config.h"
+
+/* Where the disk is mounted. */
+#define hostDISK_NAME				"/ram"
+
+/* The size of the disk, which must match RAMDISK_SECTORS in build/Makefile.
+Larger images keep their own size.  FF_Format() only makes FAT16 and FAT32,
+which need at least 4085 clusters: disks with large sectors are made larger,
+the file on the host is sparse. */
+#define hostDISK_BYTES				( 5UL * 1024UL * 1024UL ) /* 5M bytes. */
+#define hostMIN_SECTORS				8192UL
+#define hostDISK_SECTORS			( ( ( hostDISK_BYTES / ulHostDiskSectorSize ) > hostMIN_SECTORS ) ? \
+										( hostDISK_BYTES / ulHostDiskSectorSize ) : hostMIN_SECTORS )
+#define hostIO_MANAGER_CACHE_SIZE	( 15UL * ulHostDiskSectorSize )
+
+/* Set by main() from the command line. */
+const char *pcHostDiskImage = "host.img";
+BaseType_t xHostDiskInMemory = pdFALSE;
+BaseType_t xHostDiskLatency = pdFALSE;
+BaseType_t xHostDiskDelay = pdFALSE;
+BaseType_t xHostDiskQueue = pdFALSE;
+
+/* The images that build/Makefile makes have sectors of 512 bytes.  Other
+sizes need a new image, which the file disk formats. */
+uint32_t ulHostDiskSectorSize = 512UL;
+
+static FF_Disk_t *pxHostDisk = NULL;
+
+/* The copy of the image that the RAM disk uses. */
+static uint8_t *pucHostImage = NULL;
+
+/*
+ * Reads the whole image into pucHostImage and mounts it with the RAM disk
+ * driver.  This profiles the RAM disk, which the target uses, rather than
+ * the file disk.
+ */
+static FF_Disk_t *prvLoadRAMDisk( void );
+
+/*-----------------------------------------------------------*/
+
+void CreateRamDisk( void )
+{
+FF_LatencyDiskParameters_t xLatency;
+
+	if( ( xHostDiskInMemory != pdFALSE ) && ( ulHostDiskSectorSize != ffconfigRAMDISK_SECTOR_SIZE ) )
+	{
+		/* The RAM disk has the sector size of its configuration. */
+		printf( "The RAM disk has sectors of %lu bytes\n", ( unsigned long ) ffconfigRAMDISK_SECTOR_SIZE );
+	}
+	else if( xHostDiskInMemory != pdFALSE )
+	{
+		printf( "Loading %s into a RAM disk\n", pcHostDiskImage );
+		pxHostDisk = prvLoadRAMDisk();
+	}
+	else
+	{
+		printf( "Calling FF_FileDiskInit for %s, %lu bytes per sector\n", pcHostDiskImage, ( unsigned long ) ulHostDiskSectorSize );
+		pxHostDisk = FF_FileDiskInit( hostDISK_NAME, pcHostDiskImage, hostDISK_SECTORS, ulHostDiskSectorSize,
+			hostIO_MANAGER_CACHE_SIZE, xHostDiskQueue );
+	}
+
+	configASSERT( pxHostDisk );
+
+	if( xHostDiskLatency != pdFALSE )
+	{
+		/* Account the time an SD card would need from here on. */
+		FF_LatencyDiskDefaults( &xLatency );
+		xLatency.xDelayCaller = xHostDiskDelay;
+
+		if( FF_LatencyDiskAttach( pxHostDisk, &xLatency ) != pdPASS )
+		{
+			printf( "Could not simulate the latency of %s\n", pcHostDiskImage );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Writes the cached sectors to the image, and closes it.
+ */
+void CloseHostDisk( void )
+{
+#if( ffconfigBLOCK_QUEUE != 0 )
+	FF_BlockQueueStats_t xQueueStats;
+#endif
+
+	if( pxHostDisk != NULL )
+	{
+		if( xHostDiskLatency != pdFALSE )
+		{
+			/* The sectors still in the cache are part of the workload. */
+			FF_FlushCache( pxHostDisk->pxIOManager );
+			printf( "Simulated SD card:\n" );
+			FF_LatencyDiskShowStats( pxHostDisk );
+			FF_LatencyDiskDetach( pxHostDisk );
+		}
+
+		#if( ffconfigBLOCK_QUEUE != 0 )
+		{
+			if( pxHostDisk->pxIOManager->pxBlockQueue != NULL )
+			{
+				FF_BlockQueueGetStats( pxHostDisk->pxIOManager, &xQueueStats );
+				printf( "Block queue: %lu requests in %lu driver calls, %lu merged, %lu copied, %lu past the deadline\n",
+					( unsigned long ) xQueueStats.ulRequests, ( unsigned long ) xQueueStats.ulDriverCalls,
+					( unsigned long ) xQueueStats.ulMerged, ( unsigned long ) xQueueStats.ulCopied,
+					( unsigned long ) xQueueStats.ulExpired );
+			}
+		}
+		#endif
+
+		if( xHostDiskInMemory != pdFALSE )
+		{
+			FF_RAMDiskDelete( pxHostDisk );
+			free( pucHostImage );
+			pucHostImage = NULL;
+		}
+		else if( FF_FileDiskDelete( pxHostDisk ) != pdPASS )
+		{
+			printf( "Could not save %s\n", pcHostDiskImage );
+		}
+
+		pxHostDisk = NULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static FF_Disk_t *prvLoadRAMDisk( void )
+{
+FF_Disk_t *pxDisk = NULL;
+FILE *pxFile;
+long lSize = 0;
+size_t xDiskSize = 0;
+
+	pxFile = fopen( pcHostDiskImage, "rb" );
+
+	if( ( pxFile != NULL ) && ( fseek( pxFile, 0L, SEEK_END ) == 0 ) )
+	{
+		lSize = ftell( pxFile );
+		rewind( pxFile );
+	}
+
+	if( lSize >= ( long ) ulHostDiskSectorSize )
+	{
+		/* A partial sector at the end of the file is not used.  Images of
+		mkfatimage only hold the sectors in use, the rest of the disk reads
+		as zeros. */
+		lSize -= lSize % ( long ) ulHostDiskSectorSize;
+		xDiskSize = ( size_t ) lSize;
+		if( xDiskSize < ( hostDISK_SECTORS * ulHostDiskSectorSize ) )
+		{
+			xDiskSize = hostDISK_SECTORS * ulHostDiskSectorSize;
+		}
+		pucHostImage = ( uint8_t * ) calloc( 1, xDiskSize );
+	}
+
+	if( ( pucHostImage != NULL ) && ( fread( pucHostImage, 1, ( size_t ) lSize, pxFile ) == ( size_t ) lSize ) )
+	{
+		/* Mount the image in place. */
+		pxDisk = FF_RAMDiskInitFromImage( hostDISK_NAME, pucHostImage, ( uint32_t ) ( xDiskSize / ulHostDiskSectorSize ),
+			pucHostImage, ( size_t ) lSize, hostIO_MANAGER_CACHE_SIZE );
+		if( pxDisk != NULL )
+		{
+			FF_RAMDiskShowPartition( pxDisk );
+		}
+	}
+	else
+	{
+		printf( "Could not load %s\n", pcHostDiskImage );
+	}
+
+	if( pxFile != NULL )
+	{
+		fclose( pxFile );
+	}
+
+	return pxDisk;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,202 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * Entry point of the host build ('make host'): runs the application on the
+ * Posix port of FreeRTOS, as a Linux process that can be profiled with perf
+ * or checked with valgrind.
+ *
+ * Usage: image.host [-b bytes] [-d] [-l] [-m] [-q] [-s seconds] [disk image]
+ *
+ *   disk image  The file that holds the disk, "host.img" by default.  An
+ *               empty or missing file is created, partitioned and formatted.
+ *   -b bytes    The size of the sectors of the disk: 512 (the default), 1024,
+ *               2048 or 4096.  The image that the Makefile makes has sectors
+ *               of 512 bytes, give the name of a new image for other sizes.
+ *   -d          Like -l, and the tasks also wait until the simulated card
+ *               would have finished their reads and writes.
+ *   -l          Model the latency of an SD card, see drivers/ff_latencydisk.c.
+ *               The simulated device time is shown when the disk is closed.
+ *   -m          Load the image into memory and use the RAM disk driver
+ *               instead of the file disk driver.  Changes are not saved.
+ *   -q          Pass the requests of the file disk through the block queue,
+ *               see FreeRTOS-Plus-FAT/ff_blkqueue.c.  Its counters are shown
+ *               when the disk is closed.
+ *   -s seconds  End the simulation after this many seconds, after the disk
+ *               has been flushed and closed.  By default it runs until the
+ *               process is killed, like the target does.
+ */
+
+#include <stddef.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "app_config.h"
+
+/*
+** Startup task, see app/cfs_init.c
+*/
+void startupTask(void* pvParameters);
+
+/*
+** The disk of the host build, see hostdisk.c
+*/
+extern const char *pcHostDiskImage;
+extern BaseType_t xHostDiskInMemory;
+extern BaseType_t xHostDiskLatency;
+extern BaseType_t xHostDiskDelay;
+extern BaseType_t xHostDiskQueue;
+extern uint32_t ulHostDiskSectorSize;
+extern void CloseHostDisk( void );
+
+/* The number of seconds after which the simulation ends, 0 for never. */
+static unsigned long ulRunSeconds = 0;
+
+/*
+ * A convenience function that is called when a FreeRTOS API call fails
+ * and a program cannot continue. It prints a message (if provided) and
+ * ends the process.
+ */
+void FreeRTOS_Error(const portCHAR* msg)
+{
+    if ( NULL != msg )
+    {
+        fprintf(stderr, "%s", msg);
+    }
+    exit(EXIT_FAILURE);
+}
+
+void vAssertCalled( const char *pcFile, uint32_t ulLine )
+{
+    fprintf(stderr, "vAssertCalled: %s, %lu\n", pcFile, (unsigned long) ulLine);
+
+    /* Leave a core dump, or a backtrace in the debugger. */
+    abort();
+}
+
+void vApplicationMallocFailedHook( void )
+{
+    vAssertCalled( __FILE__, __LINE__ );
+}
+
+/*
+** Ends the simulation after ulRunSeconds
+*/
+static void stopTask(void* pvParameters)
+{
+    (void) pvParameters;
+
+    vTaskDelay( pdMS_TO_TICKS( ulRunSeconds * 1000UL ) );
+
+    printf("--- %lu seconds passed, closing the disk ---\n", ulRunSeconds);
+    CloseHostDisk();
+    vTaskEndScheduler();
+
+    /* Not reached. */
+    vTaskDelete(NULL);
+}
+
+static void usage(const char *pcProgram)
+{
+    fprintf(stderr, "Usage: %s [-b bytes] [-d] [-l] [-m] [-q] [-s seconds] [disk image]\n", pcProgram);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    int iOption;
+
+    while ( -1 != ( iOption = getopt(argc, argv, "b:dlmqs:") ) )
+    {
+        switch ( iOption )
+        {
+            case 'b':
+                ulHostDiskSectorSize = strtoul(optarg, NULL, 10);
+                if ( ( ulHostDiskSectorSize != 512 ) && ( ulHostDiskSectorSize != 1024 ) &&
+                     ( ulHostDiskSectorSize != 2048 ) && ( ulHostDiskSectorSize != 4096 ) )
+                {
+                    usage(argv[0]);
+                }
+                break;
+
+            case 'd':
+                xHostDiskDelay = pdTRUE;
+                xHostDiskLatency = pdTRUE;
+                break;
+
+            case 'l':
+                xHostDiskLatency = pdTRUE;
+                break;
+
+            case 'm':
+                xHostDiskInMemory = pdTRUE;
+                break;
+
+            case 'q':
+                xHostDiskQueue = pdTRUE;
+                break;
+
+            case 's':
+                ulRunSeconds = strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                usage(argv[0]);
+                break;
+        }
+    }
+
+    if ( optind < argc )
+    {
+        pcHostDiskImage = argv[optind++];
+    }
+
+    if ( optind < argc )
+    {
+        usage(argv[0]);
+    }
+
+    /* Show the output of the tasks as it comes, also when it is piped. */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    printf("= = = M A I N  S T A R T E D = = =\n\n");
+
+    /*
+    ** Create the Startup Task - This is where all the rest of the Application tasks are created
+    */
+    if ( pdPASS != xTaskCreate(startupTask, "start", configMINIMAL_STACK_SIZE * 2, NULL, PRIOR_START_TASK, NULL) )
+    {
+        FreeRTOS_Error("Could not create Startup task\n");
+    }
+
+    if ( ( 0 != ulRunSeconds ) &&
+         ( pdPASS != xTaskCreate(stopTask, "stop", configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL) ) )
+    {
+        FreeRTOS_Error("Could not create the stop task\n");
+    }
+
+    /*
+    ** Start the FreeRTOS scheduler, it returns after vTaskEndScheduler()
+    */
+    vTaskStartScheduler();
+
+    return EXIT_SUCCESS;
+}
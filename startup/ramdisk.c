@@ -83,13 +83,27 @@
 #include "ff_stdio.h"
 #include "ff_ramdisk.h"
 
+#include "app_config.h"
+
 /* 
 ** The number and size of sectors that will make up the RAM disk.
+** FAT16 needs at least 4085 clusters, so with sectors of 4 KB the disk
+** must be made at least 16 MB large.
 */ 
-#define mainRAM_DISK_SECTOR_SIZE	512UL /* Currently fixed! */
+#define mainRAM_DISK_SECTOR_SIZE	( ( uint32_t ) ffconfigRAMDISK_SECTOR_SIZE )
 #define mainRAM_DISK_SECTORS		( ( 5UL * 1024UL * 1024UL ) / mainRAM_DISK_SECTOR_SIZE ) /* 5M bytes. */
 #define mainIO_MANAGER_CACHE_SIZE	( 15UL * mainRAM_DISK_SECTOR_SIZE )
 
+#if( RAMDISK_FROM_IMAGE != 0 )
+	/* The FAT image generated by tools/mkfatimage, linked in by the Makefile.
+	It must have been built for mainRAM_DISK_SECTORS sectors. */
+	#if( ffconfigRAMDISK_SECTOR_SIZE != 512 )
+		#error mkfatimage writes images with sectors of 512 bytes
+	#endif
+	extern uint8_t _binary_fatimage_start[];
+	extern uint8_t _binary_fatimage_end[];
+#endif
+
 /* Where the RAM disk is mounted. */
 #define mainRAM_DISK_NAME		"/ram"
 
@@ -149,10 +163,18 @@ void CreateRamDisk( void )
 	FF_Disk_t     *pxDisk;
 
 	/* Create the RAM disk. */
+#if( RAMDISK_FROM_IMAGE != 0 )
+        printf("Calling FF_RAMDiskInitFromImage\n");
+	pxDisk = FF_RAMDiskInitFromImage( mainRAM_DISK_NAME, ucRAMDisk, mainRAM_DISK_SECTORS,
+		_binary_fatimage_start, ( size_t ) ( _binary_fatimage_end - _binary_fatimage_start ), mainIO_MANAGER_CACHE_SIZE );
+	configASSERT( pxDisk );
+        printf("Back from FF_RAMDiskInitFromImage\n");
+#else
         printf("Calling FF_RAMDiskInit\n");
 	pxDisk = FF_RAMDiskInit( mainRAM_DISK_NAME, ucRAMDisk, mainRAM_DISK_SECTORS, mainIO_MANAGER_CACHE_SIZE );
 	configASSERT( pxDisk );
         printf("Back from FF_RAMDiskInit\n");
+#endif
 
         printf("Calling FF_RAMDiskShowPartition\n");
 	/* Print out information on the disk. */
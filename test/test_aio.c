@@ -0,0 +1,208 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The asynchronous I/O of ffconfigAIO_SUPPORT: appends to two files are
+ * submitted with mixed priorities.  The requests of each file must complete
+ * in the order of submission, so each file holds its parts in order.  The
+ * files are read back with requests at explicit offsets.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_aio.h"
+
+#include "tests.h"
+
+#define testAIO_FILES			2
+#define testAIO_REQUESTS		16
+
+/* Not a divisor of the sector size. */
+#define testAIO_PART			300UL
+#define testAIO_SIZE			( testAIO_REQUESTS * testAIO_PART )
+
+static const char * const pcAIONames[ testAIO_FILES ] =
+{
+	testDISK_NAME "/aio0.bin",
+	testDISK_NAME "/aio1.bin",
+};
+
+static uint8_t ucData[ testAIO_FILES ][ testAIO_SIZE ];
+static uint8_t ucRead[ testAIO_FILES ][ testAIO_SIZE ];
+static FF_AIORequest_t xRequests[ testAIO_FILES ][ testAIO_REQUESTS ];
+
+/* The number of completed requests of each file, and the order in which they
+were completed. */
+static volatile uint32_t ulCompleted[ testAIO_FILES ];
+static volatile uint32_t ulOrder[ testAIO_FILES ][ testAIO_REQUESTS ];
+
+/*
+ * Called by a worker when a request is complete, the context tells the file
+ * and the number of the request.
+ */
+static void prvAIOCallback( FF_AIORequest_t *pxRequest );
+
+/*
+ * Submits the request for part 'xPart' of file 'xFile', with a priority that
+ * differs from the previous request of the same file.
+ */
+static void prvSubmit( FF_FILE *pxFile, BaseType_t xFile, BaseType_t xPart, BaseType_t xWrite );
+
+/*
+ * Waits until all requests are done, and checks their results.  The requests
+ * of each file were submitted from the first part to the last, or reversed.
+ */
+static void prvWaitAll( BaseType_t xReversed );
+
+/*-----------------------------------------------------------*/
+
+void vTestAIO( FF_Disk_t *pxDisk )
+{
+FF_FILE *pxFiles[ testAIO_FILES ];
+BaseType_t xFile, xPart;
+size_t x;
+
+	( void ) pxDisk;
+
+	for( xFile = 0; xFile < testAIO_FILES; xFile++ )
+	{
+		for( x = 0; x < testAIO_SIZE; x++ )
+		{
+			ucData[ xFile ][ x ] = ( uint8_t ) ( ( x * ( 3 + xFile ) ) + ( x >> 8 ) );
+		}
+
+		pxFiles[ xFile ] = ff_fopen( pcAIONames[ xFile ], "w+" );
+		testCHECK( pxFiles[ xFile ] != NULL );
+		if( pxFiles[ xFile ] == NULL )
+		{
+			return;
+		}
+	}
+
+	/* Appends at the current position, the files take turns. */
+	for( xPart = 0; xPart < testAIO_REQUESTS; xPart++ )
+	{
+		for( xFile = 0; xFile < testAIO_FILES; xFile++ )
+		{
+			prvSubmit( pxFiles[ xFile ], xFile, xPart, pdTRUE );
+		}
+	}
+	prvWaitAll( pdFALSE );
+
+	/* Read back from the last part to the first. */
+	memset( ucRead, '\0', sizeof( ucRead ) );
+	for( xPart = testAIO_REQUESTS - 1; xPart >= 0; xPart-- )
+	{
+		for( xFile = 0; xFile < testAIO_FILES; xFile++ )
+		{
+			prvSubmit( pxFiles[ xFile ], xFile, xPart, pdFALSE );
+		}
+	}
+	prvWaitAll( pdTRUE );
+
+	for( xFile = 0; xFile < testAIO_FILES; xFile++ )
+	{
+		testCHECK( memcmp( ucRead[ xFile ], ucData[ xFile ], testAIO_SIZE ) == 0 );
+		testCHECK( ff_fclose( pxFiles[ xFile ] ) == 0 );
+		testCHECK( ff_remove( pcAIONames[ xFile ] ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvAIOCallback( FF_AIORequest_t *pxRequest )
+{
+uint32_t ulContext = ( uint32_t ) ( ( uintptr_t ) pxRequest->pvCallbackContext );
+uint32_t ulFile = ulContext / testAIO_REQUESTS;
+
+	taskENTER_CRITICAL();
+	{
+		ulOrder[ ulFile ][ ulCompleted[ ulFile ] ] = ulContext % testAIO_REQUESTS;
+		ulCompleted[ ulFile ]++;
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvSubmit( FF_FILE *pxFile, BaseType_t xFile, BaseType_t xPart, BaseType_t xWrite )
+{
+FF_AIORequest_t *pxRequest = &( xRequests[ xFile ][ xPart ] );
+
+	memset( pxRequest, '\0', sizeof( *pxRequest ) );
+	pxRequest->pxFile = pxFile;
+	pxRequest->ulLength = testAIO_PART;
+	pxRequest->uxPriority = ( UBaseType_t ) ( ( xPart * 7 ) % 4 );
+	pxRequest->fnCallback = prvAIOCallback;
+	pxRequest->pvCallbackContext = ( void * ) ( uintptr_t ) ( ( xFile * testAIO_REQUESTS ) + xPart );
+
+	if( xWrite != pdFALSE )
+	{
+		pxRequest->pvBuffer = ucData[ xFile ] + ( xPart * testAIO_PART );
+		pxRequest->lOffset = -1;
+		testCHECK( ff_aio_write( pxRequest ) == 0 );
+	}
+	else
+	{
+		pxRequest->pvBuffer = ucRead[ xFile ] + ( xPart * testAIO_PART );
+		pxRequest->lOffset = ( int32_t ) ( xPart * testAIO_PART );
+		testCHECK( ff_aio_read( pxRequest ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvWaitAll( BaseType_t xReversed )
+{
+BaseType_t xFile, xPart, xDone;
+uint32_t ulExpected;
+
+	do
+	{
+		vTaskDelay( 1 );
+		xDone = pdTRUE;
+		for( xFile = 0; xFile < testAIO_FILES; xFile++ )
+		{
+			for( xPart = 0; xPart < testAIO_REQUESTS; xPart++ )
+			{
+				if( ff_aio_done( &( xRequests[ xFile ][ xPart ] ) ) == pdFALSE )
+				{
+					xDone = pdFALSE;
+				}
+			}
+		}
+	} while( xDone == pdFALSE );
+
+	for( xFile = 0; xFile < testAIO_FILES; xFile++ )
+	{
+		testCHECK( ulCompleted[ xFile ] == testAIO_REQUESTS );
+
+		/* The requests completed in the order in which they were submitted,
+		whatever their priorities. */
+		for( xPart = 0; xPart < testAIO_REQUESTS; xPart++ )
+		{
+			ulExpected = ( xReversed != pdFALSE ) ? ( uint32_t ) ( testAIO_REQUESTS - 1 - xPart ) : ( uint32_t ) xPart;
+			testCHECK( xRequests[ xFile ][ xPart ].lResult == ( int32_t ) testAIO_PART );
+			testCHECK( xRequests[ xFile ][ xPart ].iErrno == 0 );
+			testCHECK( ulOrder[ xFile ][ xPart ] == ulExpected );
+		}
+
+		ulCompleted[ xFile ] = 0;
+	}
+}
+/*-----------------------------------------------------------*/
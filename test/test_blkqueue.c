@@ -0,0 +1,362 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The block queue (ff_blkqueue.c) under the RAM disk, with a driver that
+ * takes two ticks per call and handles one call at a time, like a device
+ * with a high cost per command.  Four tasks read the interleaved sectors of
+ * a file: with the driver called directly every sector costs a call, with
+ * the queue the sectors that the tasks ask for at the same time are merged.
+ * The same is done with a driver that finishes its transfers in a task of
+ * its own, through 'fnStartBlocks' and FF_BlockQueueComplete().
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#if( ffconfigBLOCK_QUEUE != 0 )
+
+/* The file that the tasks read: sector i holds the value i, and i * 3 in its
+last byte. */
+#define testFILE_SECTORS		256
+#define testSECTOR_SIZE			ffconfigRAMDISK_SECTOR_SIZE
+#define testREADERS				4
+
+/* The time that the device needs for every call. */
+#define testTICKS_PER_CALL		( ( TickType_t ) 2 )
+
+typedef enum
+{
+	eDirect,		/* The driver is called by the I/O manager. */
+	eQueued,		/* The driver is called by the block queue. */
+	eStarted,		/* The queue starts transfers that complete later. */
+	eModeCount
+} TestMode_t;
+
+static const char * const pcModeNames[ eModeCount ] = { "direct", "queued", "started" };
+
+/* A transfer that prvStartBlocks() hands to prvDeviceTask(). */
+typedef struct xTEST_JOB
+{
+	FF_Disk_t *pxDisk;
+	uint8_t *pucBuffer;
+	uint32_t ulSectorNumber;
+	uint32_t ulSectorCount;
+	BaseType_t xIsWrite;
+} TestJob_t;
+
+/* The functions of the RAM disk. */
+static FF_ReadBlocks_t fnRAMRead;
+static FF_WriteBlocks_t fnRAMWrite;
+
+/* The device serves one call at a time. */
+static SemaphoreHandle_t xDeviceMutex;
+static QueueHandle_t xDeviceJobs;
+static volatile uint32_t ulDriverCalls;
+
+static volatile uint32_t ulReadersDone;
+
+static uint8_t ucContents[ testFILE_SECTORS * testSECTOR_SIZE ];
+static uint8_t ucReadBack[ testFILE_SECTORS * testSECTOR_SIZE ];
+
+/*
+ * The slow driver, on top of the functions of the RAM disk.
+ */
+static int32_t prvSlowRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+static int32_t prvSlowWrite( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*
+ * The same driver, but the transfer is done by prvDeviceTask() while the
+ * queue goes on.
+ */
+static int32_t prvStartBlocks( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, BaseType_t xIsWrite );
+static void prvDeviceTask( void *pvParameters );
+
+/*
+ * Reads every testREADERS'th sector of the file, starting at the sector
+ * given as the parameter.
+ */
+static void prvReaderTask( void *pvParameters );
+
+/*
+ * Writes the file again and reads it back in one go, which passes larger
+ * requests through the driver.
+ */
+static void prvWriteAndCompare( FF_IOManager_t *pxIOManager );
+
+/*-----------------------------------------------------------*/
+
+void vTestBlockQueue( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_BlockQueueStats_t xStats;
+FF_FILE *pxFile;
+TaskHandle_t xDeviceTask = NULL;
+TickType_t xStart, xTicks;
+uint32_t ulDirectCalls = 0;
+BaseType_t xMode, xReader, xCreated;
+size_t x;
+
+	for( x = 0; x < testFILE_SECTORS; x++ )
+	{
+		memset( ucContents + ( x * testSECTOR_SIZE ), ( int ) x, testSECTOR_SIZE - 1 );
+		ucContents[ ( x * testSECTOR_SIZE ) + testSECTOR_SIZE - 1 ] = ( uint8_t ) ( x * 3 );
+	}
+
+	pxFile = ff_fopen( testDISK_NAME "/queue.bin", "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+	testCHECK( ff_fwrite( ucContents, 1, sizeof( ucContents ), pxFile ) == sizeof( ucContents ) );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+
+	xDeviceMutex = xSemaphoreCreateMutex();
+	xDeviceJobs = xQueueCreate( 1, sizeof( TestJob_t ) );
+	configASSERT( ( xDeviceMutex != NULL ) && ( xDeviceJobs != NULL ) );
+	xCreated = xTaskCreate( prvDeviceTask, "device", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &xDeviceTask );
+	configASSERT( xCreated == pdPASS );
+
+	fnRAMRead = pxIOManager->xBlkDevice.fnpReadBlocks;
+	fnRAMWrite = pxIOManager->xBlkDevice.fnpWriteBlocks;
+	pxIOManager->xBlkDevice.fnpReadBlocks = prvSlowRead;
+	pxIOManager->xBlkDevice.fnpWriteBlocks = prvSlowWrite;
+
+	for( xMode = eDirect; xMode < eModeCount; xMode++ )
+	{
+		if( xMode == eDirect )
+		{
+			FF_BlockQueueDelete( pxIOManager );
+		}
+		else if( xMode == eQueued )
+		{
+			testCHECK( FF_BlockQueueCreate( pxIOManager ) == FF_ERR_NONE );
+		}
+		else
+		{
+			pxDisk->fnStartBlocks = prvStartBlocks;
+		}
+
+		/* All sectors must come from the driver. */
+		testCHECK( FF_FlushCache( pxIOManager ) == FF_ERR_NONE );
+		FF_IOMAN_InitBufferDescriptors( pxIOManager );
+		ulReadersDone = 0;
+		ulDriverCalls = 0;
+		xStart = xTaskGetTickCount();
+
+		for( xReader = 0; xReader < testREADERS; xReader++ )
+		{
+			xCreated = xTaskCreate( prvReaderTask, "reader", configMINIMAL_STACK_SIZE, ( void * ) xReader, tskIDLE_PRIORITY + 2, NULL );
+			configASSERT( xCreated == pdPASS );
+		}
+
+		while( ulReadersDone < testREADERS )
+		{
+			vTaskDelay( 1 );
+		}
+
+		xTicks = xTaskGetTickCount() - xStart;
+		printf( "  %-7s %4lu ticks, %3lu driver calls\n", pcModeNames[ xMode ], ( unsigned long ) xTicks, ( unsigned long ) ulDriverCalls );
+
+		if( xMode == eDirect )
+		{
+			ulDirectCalls = ulDriverCalls;
+			testCHECK( ulDirectCalls >= testFILE_SECTORS );
+		}
+		else
+		{
+			FF_BlockQueueGetStats( pxIOManager, &xStats );
+			testCHECK( xStats.ulMerged > 0 );
+			testCHECK( ulDriverCalls < ulDirectCalls );
+		}
+
+		prvWriteAndCompare( pxIOManager );
+	}
+
+	/* Leave the RAM disk as it was. */
+	testCHECK( FF_FlushCache( pxIOManager ) == FF_ERR_NONE );
+	FF_BlockQueueDelete( pxIOManager );
+	pxDisk->fnStartBlocks = NULL;
+	pxIOManager->xBlkDevice.fnpReadBlocks = fnRAMRead;
+	pxIOManager->xBlkDevice.fnpWriteBlocks = fnRAMWrite;
+
+	vTaskDelete( xDeviceTask );
+	vQueueDelete( xDeviceJobs );
+	vSemaphoreDelete( xDeviceMutex );
+
+	testCHECK( ff_remove( testDISK_NAME "/queue.bin" ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReaderTask( void *pvParameters )
+{
+uint8_t ucSector[ testSECTOR_SIZE ];
+FF_FILE *pxFile;
+long lSector;
+
+	pxFile = ff_fopen( testDISK_NAME "/queue.bin", "r" );
+	testCHECK( pxFile != NULL );
+
+	if( pxFile != NULL )
+	{
+		for( lSector = ( long ) pvParameters; lSector < testFILE_SECTORS; lSector += testREADERS )
+		{
+			testCHECK( ff_fseek( pxFile, lSector * ( long ) testSECTOR_SIZE, FF_SEEK_SET ) == 0 );
+			testCHECK( ff_fread( ucSector, 1, sizeof( ucSector ), pxFile ) == sizeof( ucSector ) );
+			testCHECK( ( ucSector[ 0 ] == ( uint8_t ) lSector ) && ( ucSector[ testSECTOR_SIZE - 1 ] == ( uint8_t ) ( lSector * 3 ) ) );
+		}
+
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	taskENTER_CRITICAL();
+	{
+		ulReadersDone++;
+	}
+	taskEXIT_CRITICAL();
+
+	/* The working directory that ff_fopen() gave this task. */
+	ff_free_CWD_space();
+	vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteAndCompare( FF_IOManager_t *pxIOManager )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( testDISK_NAME "/copy.bin", "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( ucContents, 1, sizeof( ucContents ), pxFile ) == sizeof( ucContents ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	testCHECK( FF_FlushCache( pxIOManager ) == FF_ERR_NONE );
+	FF_IOMAN_InitBufferDescriptors( pxIOManager );
+
+	memset( ucReadBack, '\0', sizeof( ucReadBack ) );
+	pxFile = ff_fopen( testDISK_NAME "/copy.bin", "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fread( ucReadBack, 1, sizeof( ucReadBack ), pxFile ) == sizeof( ucReadBack ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	testCHECK( memcmp( ucContents, ucReadBack, sizeof( ucContents ) ) == 0 );
+	testCHECK( ff_remove( testDISK_NAME "/copy.bin" ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvSlowRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+
+	xSemaphoreTake( xDeviceMutex, portMAX_DELAY );
+	{
+		ulDriverCalls++;
+		vTaskDelay( testTICKS_PER_CALL );
+		lReturn = fnRAMRead( pucDestination, ulSectorNumber, ulSectorCount, pxDisk );
+	}
+	xSemaphoreGive( xDeviceMutex );
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvSlowWrite( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+
+	xSemaphoreTake( xDeviceMutex, portMAX_DELAY );
+	{
+		ulDriverCalls++;
+		vTaskDelay( testTICKS_PER_CALL );
+		lReturn = fnRAMWrite( pucSource, ulSectorNumber, ulSectorCount, pxDisk );
+	}
+	xSemaphoreGive( xDeviceMutex );
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvStartBlocks( FF_Disk_t *pxDisk, uint8_t *pucBuffer, uint32_t ulSectorNumber, uint32_t ulSectorCount, BaseType_t xIsWrite )
+{
+TestJob_t xJob;
+
+	xJob.pxDisk = pxDisk;
+	xJob.pucBuffer = pucBuffer;
+	xJob.ulSectorNumber = ulSectorNumber;
+	xJob.ulSectorCount = ulSectorCount;
+	xJob.xIsWrite = xIsWrite;
+
+	ulDriverCalls++;
+	xQueueSend( xDeviceJobs, &xJob, portMAX_DELAY );
+
+	return FF_ERR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeviceTask( void *pvParameters )
+{
+TestJob_t xJob;
+int32_t lResult;
+
+	( void ) pvParameters;
+
+	for( ;; )
+	{
+		if( xQueueReceive( xDeviceJobs, &xJob, portMAX_DELAY ) == pdPASS )
+		{
+			vTaskDelay( testTICKS_PER_CALL );
+
+			if( xJob.xIsWrite != pdFALSE )
+			{
+				lResult = fnRAMWrite( xJob.pucBuffer, xJob.ulSectorNumber, xJob.ulSectorCount, xJob.pxDisk );
+			}
+			else
+			{
+				lResult = fnRAMRead( xJob.pucBuffer, xJob.ulSectorNumber, xJob.ulSectorCount, xJob.pxDisk );
+			}
+
+			FF_BlockQueueComplete( xJob.pxDisk, lResult );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+#else /* ffconfigBLOCK_QUEUE */
+
+void vTestBlockQueue( FF_Disk_t *pxDisk )
+{
+	( void ) pxDisk;
+	printf( "  ffconfigBLOCK_QUEUE is not set\n" );
+}
+/*-----------------------------------------------------------*/
+
+#endif /* ffconfigBLOCK_QUEUE */
@@ -0,0 +1,176 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The zero-copy reads of ffconfigZERO_COPY_READ: ff_fread_zc() lends out
+ * the file data in parts that end at a sector boundary.  When every handle
+ * borrows a different sector, the loans stop with ENOBUFS before the cache
+ * runs out, and the FAT and the directories can still be accessed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testBORROW_FILE			testDISK_NAME "/borrow.bin"
+#define testBORROW_DIR			testDISK_NAME "/borrowdir"
+#define testBORROW_DIR_FILE		testBORROW_DIR "/file.bin"
+
+/* One handle more than there are sectors in the cache, each one borrows a
+different sector of the file. */
+#define testBORROW_HANDLES		17
+#define testBORROW_SIZE			( testBORROW_HANDLES * ffconfigRAMDISK_SECTOR_SIZE )
+
+/* Not a divisor of the sector size. */
+#define testBORROW_PART			100
+
+static uint8_t ucData[ testBORROW_SIZE ];
+
+/*
+ * Writes ucData to pcName.
+ */
+static void prvWriteData( const char *pcName );
+
+/*-----------------------------------------------------------*/
+
+void vTestBorrow( FF_Disk_t *pxDisk )
+{
+static uint8_t ucRead[ testBORROW_SIZE ];
+FF_FILE *pxFiles[ testBORROW_HANDLES ];
+const void *pvData;
+size_t xLength, xOffset, x;
+uint32_t ulBorrowed = 0;
+
+	for( x = 0; x < sizeof( ucData ); x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 7 ) + ( x >> 9 ) );
+	}
+
+	prvWriteData( testBORROW_FILE );
+
+	/* Small parts, none of them crosses a sector boundary. */
+	pxFiles[ 0 ] = ff_fopen( testBORROW_FILE, "r" );
+	testCHECK( pxFiles[ 0 ] != NULL );
+	if( pxFiles[ 0 ] == NULL )
+	{
+		return;
+	}
+
+	xOffset = 0;
+	for( ;; )
+	{
+		xLength = ff_fread_zc( &pvData, testBORROW_PART, pxFiles[ 0 ] );
+		if( xLength == 0 )
+		{
+			break;
+		}
+
+		testCHECK( xLength <= testBORROW_PART );
+		testCHECK( ( xOffset / ffconfigRAMDISK_SECTOR_SIZE ) == ( ( xOffset + xLength - 1 ) / ffconfigRAMDISK_SECTOR_SIZE ) );
+		testCHECK( xOffset + xLength <= sizeof( ucRead ) );
+		if( xOffset + xLength > sizeof( ucRead ) )
+		{
+			break;
+		}
+
+		memcpy( ucRead + xOffset, pvData, xLength );
+		xOffset += xLength;
+	}
+
+	testCHECK( stdioGET_ERRNO() == 0 );
+	testCHECK( xOffset == sizeof( ucData ) );
+	testCHECK( memcmp( ucRead, ucData, sizeof( ucData ) ) == 0 );
+	testCHECK( ff_fread_release( pxFiles[ 0 ] ) == 0 );
+	testCHECK( ff_fread_release( pxFiles[ 0 ] ) == 0 );
+	testCHECK( ff_fclose( pxFiles[ 0 ] ) == 0 );
+
+	/* More loans than the cache can give. */
+	for( x = 0; x < testBORROW_HANDLES; x++ )
+	{
+		pxFiles[ x ] = ff_fopen( testBORROW_FILE, "r" );
+		testCHECK( pxFiles[ x ] != NULL );
+		if( pxFiles[ x ] == NULL )
+		{
+			continue;
+		}
+
+		testCHECK( ff_fseek( pxFiles[ x ], ( long ) ( x * ffconfigRAMDISK_SECTOR_SIZE ), FF_SEEK_SET ) == 0 );
+		xLength = ff_fread_zc( &pvData, ffconfigRAMDISK_SECTOR_SIZE, pxFiles[ x ] );
+		if( xLength != 0 )
+		{
+			testCHECK( xLength == ffconfigRAMDISK_SECTOR_SIZE );
+			testCHECK( memcmp( pvData, ucData + ( x * ffconfigRAMDISK_SECTOR_SIZE ), xLength ) == 0 );
+			ulBorrowed++;
+		}
+		else
+		{
+			testCHECK( stdioGET_ERRNO() == pdFREERTOS_ERRNO_ENOBUFS );
+		}
+	}
+
+	testCHECK( ulBorrowed > 0 );
+	testCHECK( ulBorrowed + ffconfigBUF_STORE_COUNT < pxDisk->pxIOManager->usCacheSize );
+
+	/* The buffers that are kept back are enough to make a directory and a
+	file. */
+	testCHECK( ff_mkdir( testBORROW_DIR ) == 0 );
+	prvWriteData( testBORROW_DIR_FILE );
+	testCHECK( ulTestCountEntries( testBORROW_DIR ) == 1 );
+	testCHECK( ff_remove( testBORROW_DIR_FILE ) == 0 );
+	testCHECK( ff_rmdir( testBORROW_DIR ) == 0 );
+
+	/* A loan that is given back can be taken by another handle. */
+	testCHECK( ff_fread_release( pxFiles[ 0 ] ) == 0 );
+	if( pxFiles[ testBORROW_HANDLES - 1 ] != NULL )
+	{
+		xLength = ff_fread_zc( &pvData, ffconfigRAMDISK_SECTOR_SIZE, pxFiles[ testBORROW_HANDLES - 1 ] );
+		testCHECK( xLength == ffconfigRAMDISK_SECTOR_SIZE );
+		testCHECK( memcmp( pvData, ucData + ( ( testBORROW_HANDLES - 1 ) * ffconfigRAMDISK_SECTOR_SIZE ), xLength ) == 0 );
+	}
+
+	/* Closing a handle ends its loan. */
+	for( x = 0; x < testBORROW_HANDLES; x++ )
+	{
+		if( pxFiles[ x ] != NULL )
+		{
+			testCHECK( ff_fclose( pxFiles[ x ] ) == 0 );
+		}
+	}
+
+	testCHECK( pxDisk->pxIOManager->usBorrowedBuffers == 0 );
+	testCHECK( ff_remove( testBORROW_FILE ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteData( const char *pcName )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( ucData, 1, sizeof( ucData ), pxFile ) == sizeof( ucData ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
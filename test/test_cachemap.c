@@ -0,0 +1,275 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The mapped cache buffers of ffconfigCACHE_MAP_BLOCKS: a directory workload
+ * is run with the buffers mapped into the RAM disk, with a hook that only
+ * maps every other sector, and without mapping.  The driver counts the
+ * sectors it copies: mapping must save most of them.  A mapped buffer must
+ * be the sector itself and any other buffer must have its own slot in the
+ * cache memory.  What was written through a mapped buffer must be on the
+ * disk after a remount without mapping, although it is never written back.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testMAP_DIR				testDISK_NAME "/cachemap"
+#define testMAP_NAME			testMAP_DIR "/a file with a long name %03d.txt"
+#define testMAP_KEEP			testDISK_NAME "/cachemap.txt"
+
+#define testMAP_FILES			120
+#define testMAP_FILE_SIZE		100UL
+
+/* The functions of the RAM disk. */
+static FF_ReadBlocks_t fnRAMRead;
+static FF_WriteBlocks_t fnRAMWrite;
+static FF_MapBlocksHook fnRAMMap;
+
+/* The sectors that passed through the driver. */
+static uint32_t ulSectorsRead;
+static uint32_t ulSectorsWritten;
+
+/*
+ * Creates testMAP_FILES files in testMAP_DIR, reads them back and removes
+ * them again.
+ */
+static void prvWorkload( void );
+
+/*
+ * Checks that every valid buffer of the cache is mapped to its own sector,
+ * or uses its own slot of the cache memory.
+ */
+static void prvCheckBuffers( FF_Disk_t *pxDisk );
+
+/*
+ * Writes or checks testMAP_KEEP.
+ */
+static void prvWriteKeep( void );
+static void prvCheckKeep( void );
+
+/*
+ * The driver functions of the RAM disk, counting the sectors.
+ */
+static int32_t prvCountingRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+static int32_t prvCountingWrite( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*
+ * Maps the even sectors only.
+ */
+static uint8_t *prvMapEven( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount );
+
+/*-----------------------------------------------------------*/
+
+void vTestCacheMap( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+uint32_t ulMappedRead, ulMappedWritten;
+
+	fnRAMRead = pxIOManager->xBlkDevice.fnpReadBlocks;
+	fnRAMWrite = pxIOManager->xBlkDevice.fnpWriteBlocks;
+	fnRAMMap = pxDisk->fnMapBlocks;
+	pxIOManager->xBlkDevice.fnpReadBlocks = prvCountingRead;
+	pxIOManager->xBlkDevice.fnpWriteBlocks = prvCountingWrite;
+
+	/* All buffers are mapped.  A file is kept: its directory entry and its
+	clusters in the FAT are only changed in mapped buffers, which are never
+	written back. */
+	vTestRemount( pxDisk );
+	ulSectorsRead = 0;
+	ulSectorsWritten = 0;
+	prvWorkload();
+	prvWriteKeep();
+	prvCheckBuffers( pxDisk );
+	testCHECK( FF_FlushCache( pxIOManager ) == FF_ERR_NONE );
+	ulMappedRead = ulSectorsRead;
+	ulMappedWritten = ulSectorsWritten;
+
+	pxDisk->fnMapBlocks = NULL;
+	vTestRemount( pxDisk );
+	prvCheckKeep();
+	testCHECK( ff_remove( testMAP_KEEP ) == 0 );
+
+	/* Half of the buffers are mapped, the others are copied. */
+	pxDisk->fnMapBlocks = prvMapEven;
+	vTestRemount( pxDisk );
+	prvWorkload();
+	prvWriteKeep();
+	prvCheckBuffers( pxDisk );
+
+	pxDisk->fnMapBlocks = NULL;
+	vTestRemount( pxDisk );
+	prvCheckKeep();
+	testCHECK( ff_remove( testMAP_KEEP ) == 0 );
+
+	/* No buffer is mapped. */
+	vTestRemount( pxDisk );
+	ulSectorsRead = 0;
+	ulSectorsWritten = 0;
+	prvWorkload();
+	prvCheckBuffers( pxDisk );
+	testCHECK( FF_FlushCache( pxIOManager ) == FF_ERR_NONE );
+
+	printf( "  sectors read %lu, written %lu, against %lu and %lu without mapping\n",
+		( unsigned long ) ulMappedRead, ( unsigned long ) ulMappedWritten,
+		( unsigned long ) ulSectorsRead, ( unsigned long ) ulSectorsWritten );
+	testCHECK( ( ulMappedRead * 4 ) < ulSectorsRead );
+	testCHECK( ( ulMappedWritten * 4 ) < ulSectorsWritten );
+
+	pxIOManager->xBlkDevice.fnpReadBlocks = fnRAMRead;
+	pxIOManager->xBlkDevice.fnpWriteBlocks = fnRAMWrite;
+	pxDisk->fnMapBlocks = fnRAMMap;
+	vTestRemount( pxDisk );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWorkload( void )
+{
+uint8_t ucData[ testMAP_FILE_SIZE ];
+FF_FILE *pxFile;
+char pcName[ 64 ];
+BaseType_t x;
+
+	testCHECK( ff_mkdir( testMAP_DIR ) == 0 );
+
+	for( x = 0; x < testMAP_FILES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testMAP_NAME, ( int ) x );
+		memset( ucData, 'a' + ( int ) x, sizeof( ucData ) );
+		pxFile = ff_fopen( pcName, "w" );
+		testCHECK( pxFile != NULL );
+		if( pxFile != NULL )
+		{
+			testCHECK( ff_fwrite( ucData, 1, sizeof( ucData ), pxFile ) == sizeof( ucData ) );
+			testCHECK( ff_fclose( pxFile ) == 0 );
+		}
+	}
+
+	testCHECK( ulTestCountEntries( testMAP_DIR ) == testMAP_FILES );
+
+	for( x = 0; x < testMAP_FILES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testMAP_NAME, ( int ) x );
+		pxFile = ff_fopen( pcName, "r" );
+		testCHECK( pxFile != NULL );
+		if( pxFile != NULL )
+		{
+			testCHECK( ff_fread( ucData, 1, sizeof( ucData ), pxFile ) == sizeof( ucData ) );
+			testCHECK( ( ucData[ 0 ] == ( uint8_t ) ( 'a' + x ) ) && ( ucData[ testMAP_FILE_SIZE - 1 ] == ( uint8_t ) ( 'a' + x ) ) );
+			testCHECK( ff_fclose( pxFile ) == 0 );
+		}
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+
+	testCHECK( ff_rmdir( testMAP_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckBuffers( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_Buffer_t *pxBuffer;
+uint8_t *pucSlot;
+UBaseType_t uxIndex;
+
+	for( uxIndex = 0; uxIndex < pxIOManager->usCacheSize; uxIndex++ )
+	{
+		pxBuffer = &( pxIOManager->pxBuffers[ uxIndex ] );
+		pucSlot = pxIOManager->pucCacheMem + ( uxIndex * pxIOManager->usSectorSize );
+
+		if( pxBuffer->bValid == pdFALSE )
+		{
+			continue;
+		}
+
+		if( pxBuffer->bMapped != pdFALSE )
+		{
+			testCHECK( pxDisk->fnMapBlocks != NULL );
+			testCHECK( pxBuffer->pucBuffer == ( uint8_t * ) pxDisk->pvTag + ( pxBuffer->ulSector * pxIOManager->usSectorSize ) );
+		}
+		else
+		{
+			testCHECK( ( pxDisk->fnMapBlocks != prvMapEven ) || ( ( pxBuffer->ulSector % 2 ) != 0 ) );
+			testCHECK( pxBuffer->pucBuffer == pucSlot );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteKeep( void )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( testMAP_KEEP, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( testMAP_KEEP, 1, sizeof( testMAP_KEEP ), pxFile ) == sizeof( testMAP_KEEP ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckKeep( void )
+{
+char pcText[ sizeof( testMAP_KEEP ) ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( testMAP_KEEP, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == sizeof( testMAP_KEEP ) );
+		testCHECK( ff_fread( pcText, 1, sizeof( pcText ), pxFile ) == sizeof( pcText ) );
+		testCHECK( memcmp( pcText, testMAP_KEEP, sizeof( pcText ) ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvCountingRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+	ulSectorsRead += ulSectorCount;
+	return fnRAMRead( pucDestination, ulSectorNumber, ulSectorCount, pxDisk );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvCountingWrite( uint8_t *pucSource, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+	ulSectorsWritten += ulSectorCount;
+	return fnRAMWrite( pucSource, ulSectorNumber, ulSectorCount, pxDisk );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t *prvMapEven( FF_Disk_t *pxDisk, uint32_t ulSectorNumber, uint32_t ulSectorCount )
+{
+uint8_t *pucReturn = NULL;
+
+	if( ( ulSectorCount == 1 ) && ( ( ulSectorNumber % 2 ) == 0 ) )
+	{
+		pucReturn = fnRAMMap( pxDisk, ulSectorNumber, ulSectorCount );
+	}
+
+	return pucReturn;
+}
+/*-----------------------------------------------------------*/
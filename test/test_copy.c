@@ -0,0 +1,176 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * ff_copyfile() of ffconfigCOPYFILE_SUPPORT: an existing destination is only
+ * replaced with FF_COPY_OVERWRITE, and only once the copy is complete.  When
+ * it can not be replaced, or when there is no room for the copy, it is left
+ * as it was, and no temporary file or cluster is left behind.  A rename in
+ * one directory refuses a name that is taken, even when the caller did not
+ * look first.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testCOPY_DIR			testDISK_NAME "/copy"
+#define testCOPY_SOURCE			testCOPY_DIR "/source.bin"
+#define testCOPY_DEST			testCOPY_DIR "/dest.bin"
+#define testCOPY_NEW			testCOPY_DIR "/new.bin"
+#define testCOPY_LARGE			testCOPY_DIR "/large.bin"
+
+/* More than a cluster, and not a whole number of sectors. */
+#define testCOPY_SIZE			5000UL
+#define testCOPY_OLD_TEXT		"the old destination"
+
+static uint8_t ucData[ testCOPY_SIZE ];
+
+/*
+ * Writes 'ulLength' bytes to a new file.
+ */
+static void prvWriteFile( const char *pcName, const void *pvData, uint32_t ulLength );
+
+/*
+ * Checks that a file holds exactly 'ulLength' bytes of pvData.
+ */
+static void prvCheckFile( const char *pcName, const void *pvData, uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+void vTestCopyFile( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_FILE *pxFile;
+FF_Error_t xError;
+uint32_t ulFreeClusters, ulLargeSize, x;
+char pcName[ 16 ];
+
+	for( x = 0; x < testCOPY_SIZE; x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 3 ) + ( x >> 9 ) );
+	}
+
+	testCHECK( ff_mkdir( testCOPY_DIR ) == 0 );
+	prvWriteFile( testCOPY_SOURCE, ucData, testCOPY_SIZE );
+	prvWriteFile( testCOPY_DEST, testCOPY_OLD_TEXT, sizeof( testCOPY_OLD_TEXT ) );
+
+	/* Without the flag, the destination stays. */
+	testCHECK( ff_copyfile( testCOPY_SOURCE, testCOPY_DEST, 0 ) == -1 );
+	testCHECK( stdioGET_ERRNO() == pdFREERTOS_ERRNO_EEXIST );
+	prvCheckFile( testCOPY_DEST, testCOPY_OLD_TEXT, sizeof( testCOPY_OLD_TEXT ) );
+
+	/* A destination that is open can not be replaced: it stays as it was and
+	the copy is gone again. */
+	ulFreeClusters = FF_CountFreeClusters( pxIOManager, &xError );
+	pxFile = ff_fopen( testCOPY_DEST, "r" );
+	testCHECK( pxFile != NULL );
+	testCHECK( ff_copyfile( testCOPY_SOURCE, testCOPY_DEST, FF_COPY_OVERWRITE ) == -1 );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+	prvCheckFile( testCOPY_DEST, testCOPY_OLD_TEXT, sizeof( testCOPY_OLD_TEXT ) );
+	testCHECK( ulTestCountEntries( testCOPY_DIR ) == 2 );
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) == ulFreeClusters );
+
+	/* A file that takes more than half of the free space can not be copied:
+	the destination must survive that too. */
+	ulLargeSize = ( ( ulFreeClusters / 5 ) * 3 ) * pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize;
+	pxFile = ff_fopen( testCOPY_LARGE, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		for( x = 0; x < ulLargeSize; x += testCOPY_SIZE )
+		{
+			testCHECK( ff_fwrite( ucData, 1, testCOPY_SIZE, pxFile ) == testCOPY_SIZE );
+		}
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+	ulFreeClusters = FF_CountFreeClusters( pxIOManager, &xError );
+	testCHECK( ff_copyfile( testCOPY_LARGE, testCOPY_DEST, FF_COPY_OVERWRITE ) == -1 );
+	testCHECK( stdioGET_ERRNO() == pdFREERTOS_ERRNO_ENOSPC );
+	prvCheckFile( testCOPY_DEST, testCOPY_OLD_TEXT, sizeof( testCOPY_OLD_TEXT ) );
+	testCHECK( ulTestCountEntries( testCOPY_DIR ) == 3 );
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) == ulFreeClusters );
+	testCHECK( ff_remove( testCOPY_LARGE ) == 0 );
+
+	/* With the flag, the copy takes its place. */
+	testCHECK( ff_copyfile( testCOPY_SOURCE, testCOPY_DEST, FF_COPY_OVERWRITE ) == 0 );
+	testCHECK( ff_copyfile( testCOPY_SOURCE, testCOPY_NEW, 0 ) == 0 );
+	testCHECK( ulTestCountEntries( testCOPY_DIR ) == 3 );
+	testCHECK( ulTestCountEntries( testCOPY_DIR "/~cp*" ) == 0 );
+
+	vTestRemount( pxDisk );
+	prvCheckFile( testCOPY_SOURCE, ucData, testCOPY_SIZE );
+	prvCheckFile( testCOPY_DEST, ucData, testCOPY_SIZE );
+	prvCheckFile( testCOPY_NEW, ucData, testCOPY_SIZE );
+
+	/* The name is checked again by the rename itself. */
+	pxFile = FF_Open( pxIOManager, "/copy/new.bin", FF_MODE_READ, &xError );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		strcpy( pcName, "dest.bin" );
+		xError = FF_RenameDirent( pxIOManager, pxFile->ulDirCluster, pxFile->usDirEntry, pcName, NULL );
+		testCHECK( FF_GETERROR( xError ) == FF_ERR_DIR_OBJECT_EXISTS );
+		testCHECK( FF_Close( pxFile ) == FF_ERR_NONE );
+	}
+	prvCheckFile( testCOPY_NEW, ucData, testCOPY_SIZE );
+
+	testCHECK( ff_remove( testCOPY_SOURCE ) == 0 );
+	testCHECK( ff_remove( testCOPY_DEST ) == 0 );
+	testCHECK( ff_remove( testCOPY_NEW ) == 0 );
+	testCHECK( ff_rmdir( testCOPY_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteFile( const char *pcName, const void *pvData, uint32_t ulLength )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( pvData, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckFile( const char *pcName, const void *pvData, uint32_t ulLength )
+{
+static uint8_t ucRead[ testCOPY_SIZE ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == ulLength );
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, pvData, ulLength ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,141 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The deferred directory entries of ffconfigDEFERRED_DIRENT_UPDATE: the size
+ * of a file that is written is not in its entry right away, but it is after
+ * ff_fflush() and after ff_fclose(), also once the disk has been mounted
+ * again.  A file that is truncated shows its new size.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testDEFERRED_FILE		testDISK_NAME "/deferred.bin"
+
+/* Longer than a cluster, and not a whole number of sectors. */
+#define testFIRST_PART			3000UL
+#define testSECOND_PART			1500UL
+#define testTRUNCATED			700UL
+
+static uint8_t ucData[ testFIRST_PART + testSECOND_PART ];
+
+/*
+ * Returns the size of a file according to its directory entry, or -1.
+ */
+static long prvEntrySize( const char *pcName );
+
+/*
+ * Checks that the file holds the first 'ulLength' bytes of ucData.
+ */
+static void prvCheckContents( uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+void vTestDeferredDirent( FF_Disk_t *pxDisk )
+{
+FF_FILE *pxFile;
+size_t x;
+
+	for( x = 0; x < sizeof( ucData ); x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 13 ) + ( x >> 8 ) );
+	}
+
+	pxFile = ff_fopen( testDEFERRED_FILE, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+
+	/* The entry waits until the handle is flushed. */
+	testCHECK( ff_fwrite( ucData, 1, testFIRST_PART, pxFile ) == testFIRST_PART );
+	testCHECK( prvEntrySize( testDEFERRED_FILE ) == 0 );
+	testCHECK( ff_fflush( pxFile ) == 0 );
+	testCHECK( prvEntrySize( testDEFERRED_FILE ) == ( long ) testFIRST_PART );
+
+	testCHECK( ff_fwrite( ucData + testFIRST_PART, 1, testSECOND_PART, pxFile ) == testSECOND_PART );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+	testCHECK( prvEntrySize( testDEFERRED_FILE ) == ( long ) sizeof( ucData ) );
+	prvCheckContents( sizeof( ucData ) );
+
+	/* The entry was written to the disk, not only to the cache. */
+	vTestRemount( pxDisk );
+	testCHECK( prvEntrySize( testDEFERRED_FILE ) == ( long ) sizeof( ucData ) );
+	prvCheckContents( sizeof( ucData ) );
+
+	/* A truncated file, and one that has become empty. */
+	pxFile = ff_truncate( testDEFERRED_FILE, testTRUNCATED );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+	testCHECK( prvEntrySize( testDEFERRED_FILE ) == ( long ) testTRUNCATED );
+	prvCheckContents( testTRUNCATED );
+
+	pxFile = ff_fopen( testDEFERRED_FILE, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	vTestRemount( pxDisk );
+	testCHECK( prvEntrySize( testDEFERRED_FILE ) == 0 );
+
+	testCHECK( ff_remove( testDEFERRED_FILE ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static long prvEntrySize( const char *pcName )
+{
+FF_Stat_t xStat;
+long lSize = -1;
+
+	if( ff_stat( pcName, &xStat ) == 0 )
+	{
+		lSize = ( long ) xStat.st_size;
+	}
+
+	return lSize;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckContents( uint32_t ulLength )
+{
+static uint8_t ucRead[ sizeof( ucData ) ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( testDEFERRED_FILE, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == ulLength );
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, ucData, ulLength ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
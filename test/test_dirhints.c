@@ -0,0 +1,128 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The free-entry hints of ffconfigDIRENT_HINT_CACHE: entries that are
+ * deleted must be found again by the next creations, so a directory with
+ * holes does not grow, and a directory that is removed must not leave hints
+ * behind for a new directory in the same cluster.  The files are moved in
+ * from another directory, which relies on the hints; ff_fopen() and
+ * ff_mkdir() find a hole themselves while they look for an existing entry.
+ */
+
+#include <stdio.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testHINT_DIR			testDISK_NAME "/hints"
+#define testHINT_OTHER_DIR		testDISK_NAME "/other"
+
+/* The names need two LFN entries and a short entry each, more files than fit
+in one cluster. */
+#define testHINT_FILES			48
+#define testHINT_OLD_NAME		testHINT_DIR "/long file name %02d.old"
+#define testHINT_NEW_NAME		testHINT_DIR "/long file name %02d.new"
+#define testHINT_OTHER_NAME		testHINT_OTHER_DIR "/file"
+
+/*
+ * Creates an empty file in testHINT_OTHER_DIR and moves it to pcName.
+ */
+static void prvMoveIn( const char *pcName );
+
+/*-----------------------------------------------------------*/
+
+void vTestDirentHints( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_Error_t xError;
+FF_Stat_t xStat;
+uint32_t ulFreeClusters, ulCluster;
+char pcName[ 64 ];
+BaseType_t x;
+
+	testCHECK( ff_mkdir( testHINT_DIR ) == 0 );
+	testCHECK( ff_mkdir( testHINT_OTHER_DIR ) == 0 );
+
+	for( x = 0; x < testHINT_FILES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testHINT_OLD_NAME, ( int ) x );
+		prvMoveIn( pcName );
+	}
+
+	ulFreeClusters = FF_CountFreeClusters( pxIOManager, &xError );
+	testCHECK( FF_isERR( xError ) == pdFALSE );
+
+	/* Every other file goes, and names of the same length fill the holes. */
+	for( x = 0; x < testHINT_FILES; x += 2 )
+	{
+		snprintf( pcName, sizeof( pcName ), testHINT_OLD_NAME, ( int ) x );
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+
+	for( x = 0; x < testHINT_FILES; x += 2 )
+	{
+		snprintf( pcName, sizeof( pcName ), testHINT_NEW_NAME, ( int ) x );
+		prvMoveIn( pcName );
+	}
+
+	/* The directory has not been extended. */
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) == ulFreeClusters );
+	testCHECK( ulTestCountEntries( testHINT_DIR ) == testHINT_FILES );
+
+	for( x = 0; x < testHINT_FILES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), ( ( x % 2 ) == 0 ) ? testHINT_NEW_NAME : testHINT_OLD_NAME, ( int ) x );
+		testCHECK( ff_stat( pcName, &xStat ) == 0 );
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+
+	/* A new directory in the same cluster starts without hints: its entry must
+	be seen.  The allocator is made to start at the cluster that is freed. */
+	testCHECK( ff_stat( testHINT_DIR, &xStat ) == 0 );
+	ulCluster = xStat.st_ino;
+	testCHECK( ff_rmdir( testHINT_DIR ) == 0 );
+	pxIOManager->xPartition.ulLastFreeCluster = ulCluster;
+	testCHECK( ff_mkdir( testHINT_DIR ) == 0 );
+	testCHECK( ( ff_stat( testHINT_DIR, &xStat ) == 0 ) && ( xStat.st_ino == ulCluster ) );
+	snprintf( pcName, sizeof( pcName ), testHINT_NEW_NAME, 0 );
+	prvMoveIn( pcName );
+	testCHECK( ulTestCountEntries( testHINT_DIR ) == 1 );
+
+	testCHECK( ff_remove( pcName ) == 0 );
+	testCHECK( ff_rmdir( testHINT_DIR ) == 0 );
+	testCHECK( ff_rmdir( testHINT_OTHER_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMoveIn( const char *pcName )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( testHINT_OTHER_NAME, "w" );
+	testCHECK( pxFile != NULL );
+
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fclose( pxFile ) == 0 );
+		testCHECK( ff_rename( testHINT_OTHER_NAME, pcName, pdFALSE ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
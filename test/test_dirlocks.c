@@ -0,0 +1,158 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The directory locks of ffconfigDIRECTORY_LOCKS: tasks that make and remove
+ * sibling directories at the same time, each with a subdirectory and a file
+ * in it.  They need more directory locks than there are slots.  Afterwards
+ * the parent must be empty but for a file that was there all along, and all
+ * clusters must be free again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testSIBLING_DIR			testDISK_NAME "/siblings"
+#define testKEEP_FILE			testSIBLING_DIR "/keep.txt"
+#define testKEEP_TEXT			"kept while the siblings come and go"
+
+/* One task more than there are lock slots. */
+#define testDIR_TASKS			( ffconfigDIRECTORY_LOCK_DEPTH + 1 )
+#define testDIR_ROUNDS			40
+
+static volatile uint32_t ulTasksDone;
+
+/*
+ * Makes and removes testSIBLING_DIR/dirN, with a subdirectory and a file.
+ */
+static void prvSiblingTask( void *pvParameters );
+
+/*-----------------------------------------------------------*/
+
+void vTestDirectoryLocks( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_FindData_t xFindData;
+FF_FILE *pxFile;
+FF_Error_t xError;
+uint32_t ulFreeClusters;
+char pcText[ sizeof( testKEEP_TEXT ) ];
+BaseType_t xTask, xCreated;
+int iResult;
+
+	testCHECK( ff_mkdir( testSIBLING_DIR ) == 0 );
+
+	pxFile = ff_fopen( testKEEP_FILE, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( testKEEP_TEXT, 1, sizeof( testKEEP_TEXT ), pxFile ) == sizeof( testKEEP_TEXT ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	ulFreeClusters = FF_CountFreeClusters( pxIOManager, &xError );
+	ulTasksDone = 0;
+
+	for( xTask = 0; xTask < testDIR_TASKS; xTask++ )
+	{
+		xCreated = xTaskCreate( prvSiblingTask, "sibling", configMINIMAL_STACK_SIZE, ( void * ) xTask, tskIDLE_PRIORITY + 2, NULL );
+		configASSERT( xCreated == pdPASS );
+	}
+
+	while( ulTasksDone < testDIR_TASKS )
+	{
+		vTaskDelay( 1 );
+	}
+
+	/* Only the file that was kept is left. */
+	memset( &xFindData, '\0', sizeof( xFindData ) );
+	for( iResult = ff_findfirst( testSIBLING_DIR, &xFindData ); iResult == 0; iResult = ff_findnext( &xFindData ) )
+	{
+		testCHECK( ( strcmp( xFindData.pcFileName, "." ) == 0 ) || ( strcmp( xFindData.pcFileName, ".." ) == 0 ) ||
+			( strcmp( xFindData.pcFileName, "keep.txt" ) == 0 ) );
+	}
+
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) == ulFreeClusters );
+
+	pxFile = ff_fopen( testKEEP_FILE, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fread( pcText, 1, sizeof( pcText ), pxFile ) == sizeof( pcText ) );
+		testCHECK( memcmp( pcText, testKEEP_TEXT, sizeof( pcText ) ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	testCHECK( ff_remove( testKEEP_FILE ) == 0 );
+	testCHECK( ff_rmdir( testSIBLING_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSiblingTask( void *pvParameters )
+{
+char pcDir[ 48 ], pcSubDir[ 48 ], pcFile[ 48 ];
+FF_FILE *pxFile;
+BaseType_t xRound;
+
+	snprintf( pcDir, sizeof( pcDir ), testSIBLING_DIR "/dir%d", ( int ) ( BaseType_t ) pvParameters );
+	snprintf( pcSubDir, sizeof( pcSubDir ), "%s/sub", pcDir );
+	snprintf( pcFile, sizeof( pcFile ), "%s/file.txt", pcSubDir );
+
+	for( xRound = 0; xRound < testDIR_ROUNDS; xRound++ )
+	{
+		/* The tasks take turns between the steps. */
+		testCHECK( ff_mkdir( pcDir ) == 0 );
+		taskYIELD();
+		testCHECK( ff_mkdir( pcSubDir ) == 0 );
+		taskYIELD();
+
+		pxFile = ff_fopen( pcFile, "w" );
+		testCHECK( pxFile != NULL );
+		if( pxFile != NULL )
+		{
+			testCHECK( ff_fwrite( pcFile, 1, sizeof( pcFile ), pxFile ) == sizeof( pcFile ) );
+			testCHECK( ff_fclose( pxFile ) == 0 );
+		}
+		taskYIELD();
+
+		/* A directory that is not empty stays. */
+		testCHECK( ff_rmdir( pcSubDir ) == -1 );
+		testCHECK( ff_remove( pcFile ) == 0 );
+		taskYIELD();
+		testCHECK( ff_rmdir( pcSubDir ) == 0 );
+		taskYIELD();
+		testCHECK( ff_rmdir( pcDir ) == 0 );
+		taskYIELD();
+	}
+
+	taskENTER_CRITICAL();
+	{
+		ulTasksDone++;
+	}
+	taskEXIT_CRITICAL();
+
+	/* The working directory that ff_mkdir() gave this task. */
+	ff_free_CWD_space();
+	vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
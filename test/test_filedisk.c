@@ -0,0 +1,141 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The file disk (drivers/ff_filedisk.c) with sectors of 4 KB: a new image is
+ * partitioned and formatted with that size, and a file written to it can be
+ * read back after the image has been closed and mounted again.  The image
+ * takes the place of the RAM disk meanwhile, the configuration only has
+ * room for one disk.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_filedisk.h"
+
+#include "tests.h"
+
+#define testFILE_DISK_IMAGE		"test4k.img"
+
+/* Large enough for FAT16 with one sector per cluster. */
+#define testFILE_SECTOR_SIZE	4096UL
+#define testFILE_SECTORS		8192UL
+#define testFILE_CACHE_SIZE		( 8UL * testFILE_SECTOR_SIZE )
+
+/* Spans a few sectors, and does not end on a sector boundary. */
+#define testFILE_LENGTH			( ( 3UL * testFILE_SECTOR_SIZE ) + 100UL )
+
+static uint8_t ucWritten[ testFILE_LENGTH ];
+static uint8_t ucRead[ testFILE_LENGTH ];
+
+/*
+ * Opens the image and mounts it at testDISK_NAME.
+ */
+static FF_Disk_t *prvOpenImage( void );
+
+/*
+ * Unmounts the image and closes it, and gives testDISK_NAME back to the RAM
+ * disk.
+ */
+static void prvCloseImage( FF_Disk_t *pxDisk, FF_Disk_t *pxRAMDisk );
+
+/*-----------------------------------------------------------*/
+
+void vTestFileDisk( FF_Disk_t *pxDisk )
+{
+FF_Disk_t *pxFileDisk;
+FF_FILE *pxFile;
+size_t x;
+
+	for( x = 0; x < sizeof( ucWritten ); x++ )
+	{
+		ucWritten[ x ] = ( uint8_t ) ( ( x * 7 ) + ( x / testFILE_SECTOR_SIZE ) );
+	}
+
+	/* A new image is made, and formatted. */
+	unlink( testFILE_DISK_IMAGE );
+	pxFileDisk = prvOpenImage();
+	if( pxFileDisk == NULL )
+	{
+		return;
+	}
+
+	testCHECK( pxFileDisk->pxIOManager->usSectorSize == testFILE_SECTOR_SIZE );
+	testCHECK( ff_mkdir( testDISK_NAME "/dir" ) == 0 );
+
+	pxFile = ff_fopen( testDISK_NAME "/dir/data.bin", "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( ucWritten, 1, sizeof( ucWritten ), pxFile ) == sizeof( ucWritten ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	prvCloseImage( pxFileDisk, pxDisk );
+
+	/* The image is mounted as it is the second time. */
+	pxFileDisk = prvOpenImage();
+	if( pxFileDisk == NULL )
+	{
+		return;
+	}
+
+	pxFile = ff_fopen( testDISK_NAME "/dir/data.bin", "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == sizeof( ucWritten ) );
+		testCHECK( ff_fread( ucRead, 1, sizeof( ucRead ), pxFile ) == sizeof( ucRead ) );
+		testCHECK( memcmp( ucWritten, ucRead, sizeof( ucWritten ) ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	prvCloseImage( pxFileDisk, pxDisk );
+	unlink( testFILE_DISK_IMAGE );
+}
+/*-----------------------------------------------------------*/
+
+static FF_Disk_t *prvOpenImage( void )
+{
+FF_Disk_t *pxDisk;
+
+	pxDisk = FF_FileDiskInit( testDISK_NAME, testFILE_DISK_IMAGE, testFILE_SECTORS, testFILE_SECTOR_SIZE,
+		testFILE_CACHE_SIZE, pdFALSE );
+	testCHECK( pxDisk != NULL );
+
+	if( pxDisk != NULL )
+	{
+		testCHECK( pxDisk->xStatus.bIsMounted != pdFALSE );
+		testCHECK( pxDisk->ulNumberOfSectors == testFILE_SECTORS );
+	}
+
+	return pxDisk;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCloseImage( FF_Disk_t *pxDisk, FF_Disk_t *pxRAMDisk )
+{
+	testCHECK( FF_FS_Add( testDISK_NAME, pxRAMDisk ) == pdTRUE );
+	testCHECK( FF_Unmount( pxDisk ) == FF_ERR_NONE );
+	testCHECK( FF_FileDiskDelete( pxDisk ) == pdPASS );
+}
+/*-----------------------------------------------------------*/
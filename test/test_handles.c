@@ -0,0 +1,200 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * A handle that has been closed must be refused by every function, also
+ * when it came from the heap and its memory has been freed.  Nothing may be
+ * opened between the two closes, or the handle could be reused.  A log
+ * handle, which writes past the stdio buffer, is refused as well.  With
+ * more handles open than the address index has lists, the open ones are
+ * still found and the closed ones are not.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+/* Enough handles to empty the pool of the I/O manager. */
+#define testPOOL_HANDLES		ffconfigFILE_HANDLE_POOL_SIZE
+
+/* More handles than the lists of the address index of FF_CheckValid(). */
+#define testINDEX_HANDLES		( ( 2 * ffconfigHANDLE_INDEX_BUCKETS ) + 3 )
+
+/*
+ * Closes pxFile with FF_Close() or ff_fclose(), then checks that it is
+ * refused afterwards.
+ */
+static void prvCloseTwice( FF_FILE *pxFile, BaseType_t xUseStdio );
+
+/*-----------------------------------------------------------*/
+
+void vTestHandles( FF_Disk_t *pxDisk )
+{
+#if( testPOOL_HANDLES != 0 )
+	FF_FILE *pxPoolFiles[ testPOOL_HANDLES ];
+#endif
+FF_FILE *pxFile;
+char pcName[ 32 ];
+BaseType_t x;
+
+FF_FILE *pxIndexFiles[ testINDEX_HANDLES ];
+
+	( void ) pxDisk;
+
+	/* Handles from the pool, or from the heap when there is no pool. */
+	pxFile = ff_fopen( testDISK_NAME "/twice.txt", "w" );
+	testCHECK( pxFile != NULL );
+	prvCloseTwice( pxFile, pdFALSE );
+
+	pxFile = ff_fopen( testDISK_NAME "/twice.txt", "a" );
+	testCHECK( pxFile != NULL );
+	testCHECK( ff_setvbuf( pxFile, NULL, FF_IOFBF, 64 ) == 0 );
+	testCHECK( ff_fputc( 'a', pxFile ) == 'a' );
+	prvCloseTwice( pxFile, pdTRUE );
+
+	#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	{
+		pxFile = ff_fopen( testDISK_NAME "/twice.log", "l" );
+		testCHECK( pxFile != NULL );
+		testCHECK( ff_fputc( 'l', pxFile ) == 'l' );
+		prvCloseTwice( pxFile, pdTRUE );
+	}
+	#endif
+
+	#if( testPOOL_HANDLES != 0 )
+	{
+		/* Empty the pool, the next handles come from the heap. */
+		for( x = 0; x < testPOOL_HANDLES; x++ )
+		{
+			snprintf( pcName, sizeof( pcName ), testDISK_NAME "/pool%d.txt", ( int ) x );
+			pxPoolFiles[ x ] = ff_fopen( pcName, "w" );
+			testCHECK( pxPoolFiles[ x ] != NULL );
+		}
+
+		pxFile = ff_fopen( testDISK_NAME "/twice.txt", "r" );
+		testCHECK( pxFile != NULL );
+		prvCloseTwice( pxFile, pdFALSE );
+
+		pxFile = ff_fopen( testDISK_NAME "/twice.txt", "a" );
+		testCHECK( pxFile != NULL );
+		testCHECK( ff_setvbuf( pxFile, NULL, FF_IOFBF, 64 ) == 0 );
+		testCHECK( ff_fputc( 'b', pxFile ) == 'b' );
+		prvCloseTwice( pxFile, pdTRUE );
+
+		#if( ffconfigLOG_FILE_SUPPORT != 0 )
+		{
+			pxFile = ff_fopen( testDISK_NAME "/twice.log", "l" );
+			testCHECK( pxFile != NULL );
+			testCHECK( ff_fputc( 'm', pxFile ) == 'm' );
+			prvCloseTwice( pxFile, pdFALSE );
+		}
+		#endif
+
+		for( x = 0; x < testPOOL_HANDLES; x++ )
+		{
+			testCHECK( ff_fclose( pxPoolFiles[ x ] ) == 0 );
+			snprintf( pcName, sizeof( pcName ), testDISK_NAME "/pool%d.txt", ( int ) x );
+			testCHECK( ff_remove( pcName ) == 0 );
+		}
+	}
+	#endif
+
+	/* Both characters were written out by the first close. */
+	pxFile = ff_fopen( testDISK_NAME "/twice.txt", "r" );
+	testCHECK( pxFile != NULL );
+	testCHECK( ff_filelength( pxFile ) == ( ( testPOOL_HANDLES != 0 ) ? 2u : 1u ) );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+	testCHECK( ff_remove( testDISK_NAME "/twice.txt" ) == 0 );
+
+	#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	{
+		pxFile = ff_fopen( testDISK_NAME "/twice.log", "r" );
+		testCHECK( pxFile != NULL );
+		testCHECK( ff_filelength( pxFile ) == ( ( testPOOL_HANDLES != 0 ) ? 2u : 1u ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+		testCHECK( ff_remove( testDISK_NAME "/twice.log" ) == 0 );
+	}
+	#endif
+
+	/* Several handles share each list of the index. */
+	for( x = 0; x < testINDEX_HANDLES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testDISK_NAME "/index%d.txt", ( int ) x );
+		pxIndexFiles[ x ] = ff_fopen( pcName, "w" );
+		testCHECK( pxIndexFiles[ x ] != NULL );
+	}
+	for( x = 0; x < testINDEX_HANDLES; x += 2 )
+	{
+		testCHECK( FF_Close( pxIndexFiles[ x ] ) == FF_ERR_NONE );
+	}
+	for( x = 0; x < testINDEX_HANDLES; x++ )
+	{
+		testCHECK( FF_isERR( FF_CheckValid( pxIndexFiles[ x ] ) ) == ( ( ( x % 2 ) == 0 ) ? pdTRUE : pdFALSE ) );
+	}
+	for( x = 0; x < testINDEX_HANDLES; x++ )
+	{
+		if( ( x % 2 ) != 0 )
+		{
+			testCHECK( FF_Close( pxIndexFiles[ x ] ) == FF_ERR_NONE );
+		}
+		snprintf( pcName, sizeof( pcName ), testDISK_NAME "/index%d.txt", ( int ) x );
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+
+	testCHECK( FF_GETERROR( FF_CheckValid( NULL ) ) == FF_ERR_NULL_POINTER );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCloseTwice( FF_FILE *pxFile, BaseType_t xUseStdio )
+{
+uint8_t ucByte;
+
+	if( pxFile == NULL )
+	{
+		return;
+	}
+
+	if( xUseStdio != pdFALSE )
+	{
+		testCHECK( ff_fclose( pxFile ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == -1 );
+	}
+	else
+	{
+		testCHECK( FF_Close( pxFile ) == FF_ERR_NONE );
+	}
+
+	testCHECK( FF_GETERROR( FF_Close( pxFile ) ) == FF_ERR_FILE_BAD_HANDLE );
+	testCHECK( FF_GETERROR( FF_CheckValid( pxFile ) ) == FF_ERR_FILE_BAD_HANDLE );
+
+	testCHECK( FF_GETERROR( FF_Read( pxFile, 1, 1, &ucByte ) ) == FF_ERR_FILE_BAD_HANDLE );
+	testCHECK( FF_GETERROR( FF_GetC( pxFile ) ) == FF_ERR_FILE_BAD_HANDLE );
+	testCHECK( FF_GETERROR( FF_Write( pxFile, 1, 1, &ucByte ) ) == FF_ERR_FILE_BAD_HANDLE );
+	testCHECK( FF_GETERROR( FF_PutC( pxFile, 'x' ) ) == FF_ERR_FILE_BAD_HANDLE );
+	testCHECK( ff_fgetc( pxFile ) == FF_EOF );
+	testCHECK( ff_fputc( 'x', pxFile ) == FF_EOF );
+	testCHECK( ff_fwrite( &ucByte, 1, 1, pxFile ) == 0 );
+	testCHECK( ff_ftell( pxFile ) == -1 );
+	testCHECK( ff_fseek( pxFile, 0, FF_SEEK_SET ) == -1 );
+	testCHECK( ff_fflush( pxFile ) == -1 );
+}
+/*-----------------------------------------------------------*/
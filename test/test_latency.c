@@ -0,0 +1,204 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The latency model (drivers/ff_latencydisk.c) under the RAM disk, called by
+ * several tasks at the same time, as a reentrant driver or the block queue
+ * would call it.  No transfer may be lost from the statistics, and
+ * FF_LatencyDiskDetach() must wait for the transfers that are still in the
+ * driver.  With 'xDelayCaller' the tasks must together take the time of the
+ * device, also when every command takes less than a tick.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_latencydisk.h"
+
+#include "tests.h"
+
+#define testTASKS				4
+#define testREADS_PER_TASK		200
+#define testSECTOR_SIZE			ffconfigRAMDISK_SECTOR_SIZE
+
+/* A simple timing, without erases, so the device time is easy to check.  A
+read takes less than a tick. */
+#define testCOMMAND_US			100UL
+#define testREAD_SECTOR_US		10UL
+#define testDEVICE_US			( ( uint64_t ) ( testTASKS * testREADS_PER_TASK ) * ( testCOMMAND_US + testREAD_SECTOR_US ) )
+
+/* How long the slow driver keeps a read. */
+#define testSLOW_TICKS			( ( TickType_t ) 20 )
+
+/* The read function of the RAM disk. */
+static FF_ReadBlocks_t fnRAMRead;
+
+static volatile uint32_t ulReadersDone;
+
+/* Set by prvSlowRead() when it has started, and when it is about to return. */
+static volatile BaseType_t xSlowReadStarted;
+static volatile BaseType_t xSlowReadFinished;
+
+/*
+ * Runs testTASKS readers, and checks the statistics when they are done.
+ * Returns the number of ticks they took.
+ */
+static TickType_t prvReadConcurrently( FF_Disk_t *pxDisk );
+
+/*
+ * Reads single sectors through the driver of the I/O manager.
+ */
+static void prvReaderTask( void *pvParameters );
+
+/*
+ * A driver that takes testSLOW_TICKS for every read.
+ */
+static int32_t prvSlowRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*-----------------------------------------------------------*/
+
+void vTestLatency( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_LatencyDiskParameters_t xParameters;
+TickType_t xTicks, xDeviceTicks;
+BaseType_t xCreated;
+
+	memset( &xParameters, '\0', sizeof( xParameters ) );
+	xParameters.ulCommandUs = testCOMMAND_US;
+	xParameters.ulReadSectorUs = testREAD_SECTOR_US;
+
+	/* Concurrent transfers are all accounted. */
+	testCHECK( FF_LatencyDiskAttach( pxDisk, &xParameters ) == pdPASS );
+	testCHECK( FF_LatencyDiskAttach( pxDisk, &xParameters ) == pdFAIL );
+	( void ) prvReadConcurrently( pxDisk );
+	testCHECK( FF_LatencyDiskDetach( pxDisk ) == pdPASS );
+	testCHECK( FF_LatencyDiskDetach( pxDisk ) == pdFAIL );
+
+	/* The tasks share the device, the parts of ticks add up. */
+	xParameters.xDelayCaller = pdTRUE;
+	testCHECK( FF_LatencyDiskAttach( pxDisk, &xParameters ) == pdPASS );
+	xTicks = prvReadConcurrently( pxDisk );
+	testCHECK( FF_LatencyDiskDetach( pxDisk ) == pdPASS );
+	xDeviceTicks = ( TickType_t ) ( testDEVICE_US / ( 1000000UL / configTICK_RATE_HZ ) );
+	printf( "  %lu ticks for %lu ticks of device time\n", ( unsigned long ) xTicks, ( unsigned long ) xDeviceTicks );
+	testCHECK( xTicks >= xDeviceTicks );
+	xParameters.xDelayCaller = pdFALSE;
+
+	/* Detaching waits for a read that is in the driver. */
+	fnRAMRead = pxIOManager->xBlkDevice.fnpReadBlocks;
+	pxIOManager->xBlkDevice.fnpReadBlocks = prvSlowRead;
+	testCHECK( FF_LatencyDiskAttach( pxDisk, &xParameters ) == pdPASS );
+
+	xSlowReadStarted = pdFALSE;
+	xSlowReadFinished = pdFALSE;
+	ulReadersDone = 0;
+	xCreated = xTaskCreate( prvReaderTask, "slow", configMINIMAL_STACK_SIZE, pxDisk, tskIDLE_PRIORITY + 2, NULL );
+	configASSERT( xCreated == pdPASS );
+
+	while( xSlowReadStarted == pdFALSE )
+	{
+		vTaskDelay( 1 );
+	}
+
+	testCHECK( FF_LatencyDiskDetach( pxDisk ) == pdPASS );
+	testCHECK( xSlowReadFinished != pdFALSE );
+	testCHECK( pxIOManager->xBlkDevice.fnpReadBlocks == prvSlowRead );
+
+	/* The task goes on with the driver that has been put back. */
+	while( ulReadersDone < 1 )
+	{
+		vTaskDelay( 1 );
+	}
+
+	pxIOManager->xBlkDevice.fnpReadBlocks = fnRAMRead;
+}
+/*-----------------------------------------------------------*/
+
+static TickType_t prvReadConcurrently( FF_Disk_t *pxDisk )
+{
+FF_LatencyDiskStats_t xStats;
+TickType_t xStart;
+BaseType_t xTask, xCreated;
+
+	testCHECK( FF_LatencyDiskResetStats( pxDisk ) == pdPASS );
+	ulReadersDone = 0;
+	xStart = xTaskGetTickCount();
+
+	for( xTask = 0; xTask < testTASKS; xTask++ )
+	{
+		xCreated = xTaskCreate( prvReaderTask, "reader", configMINIMAL_STACK_SIZE, pxDisk, tskIDLE_PRIORITY + 2, NULL );
+		configASSERT( xCreated == pdPASS );
+	}
+
+	while( ulReadersDone < testTASKS )
+	{
+		/* The statistics may be read while the transfers go on. */
+		testCHECK( FF_LatencyDiskGetStats( pxDisk, &xStats ) == pdPASS );
+		vTaskDelay( 1 );
+	}
+
+	testCHECK( FF_LatencyDiskGetStats( pxDisk, &xStats ) == pdPASS );
+	testCHECK( xStats.ulReadCommands == ( testTASKS * testREADS_PER_TASK ) );
+	testCHECK( xStats.ulSectorsRead == ( testTASKS * testREADS_PER_TASK ) );
+	testCHECK( xStats.ullDeviceUs == testDEVICE_US );
+
+	return xTaskGetTickCount() - xStart;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReaderTask( void *pvParameters )
+{
+FF_Disk_t *pxDisk = ( FF_Disk_t * ) pvParameters;
+uint8_t ucSector[ testSECTOR_SIZE ];
+uint32_t ulRead;
+
+	for( ulRead = 0; ulRead < testREADS_PER_TASK; ulRead++ )
+	{
+		testCHECK( pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks( ucSector, ulRead, 1, pxDisk ) == 0 );
+
+		if( pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks == prvSlowRead )
+		{
+			/* One slow read is enough. */
+			break;
+		}
+	}
+
+	taskENTER_CRITICAL();
+	{
+		ulReadersDone++;
+	}
+	taskEXIT_CRITICAL();
+
+	vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvSlowRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+
+	xSlowReadStarted = pdTRUE;
+	vTaskDelay( testSLOW_TICKS );
+	lReturn = fnRAMRead( pucDestination, ulSectorNumber, ulSectorCount, pxDisk );
+	xSlowReadFinished = pdTRUE;
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,179 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The lazy clearing of ffconfigRAMDISK_LAZY_ZERO: a second RAM disk is made
+ * on a buffer full of garbage, which it does not clear.  Sectors that were
+ * never written must read as zeros through the driver and through a mapping,
+ * while the garbage stays in memory until a region is written.  A write of
+ * zeros to such a region is skipped, a write of data clears the rest of the
+ * region.  A directory made on the disk must be empty.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_ramdisk.h"
+
+#include "tests.h"
+
+#define testLAZY_DIR			testDISK_NAME "/lazy"
+#define testLAZY_GARBAGE		0xa5
+
+/* Regions of 4 KB near the end of the disk, which the file system does not
+use.  The driver is called directly for them. */
+#define testLAZY_REGION			( 4096UL / ffconfigRAMDISK_SECTOR_SIZE )
+#define testLAZY_ZEROS			( testDISK_SECTORS - ( 4 * testLAZY_REGION ) )
+#define testLAZY_WRITTEN		( testDISK_SECTORS - ( 3 * testLAZY_REGION ) )
+#define testLAZY_MAPPED			( testDISK_SECTORS - ( 2 * testLAZY_REGION ) )
+
+#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+
+static uint8_t ucLazyDisk[ testDISK_SECTORS * ffconfigRAMDISK_SECTOR_SIZE ];
+
+/*
+ * Returns pdTRUE when 'xLength' bytes at pucData all hold ucValue.
+ */
+static BaseType_t prvAllAre( const uint8_t *pucData, size_t xLength, uint8_t ucValue );
+
+/*
+ * Returns pdTRUE when sector ulSector reads as zeros through the driver.
+ */
+static BaseType_t prvReadsZeros( FF_Disk_t *pxDisk, uint32_t ulSector );
+
+#endif /* ffconfigRAMDISK_LAZY_ZERO */
+
+/*-----------------------------------------------------------*/
+
+#if( ffconfigRAMDISK_LAZY_ZERO != 0 )
+
+void vTestLazyZero( FF_Disk_t *pxDisk )
+{
+static char pcDiskName[] = testDISK_NAME;
+uint8_t ucSector[ ffconfigRAMDISK_SECTOR_SIZE ];
+FF_Disk_t *pxLazyDisk;
+FF_IOManager_t *pxIOManager;
+FF_FILE *pxFile;
+uint8_t *pucSector;
+uint32_t x;
+
+	memset( ucLazyDisk, testLAZY_GARBAGE, sizeof( ucLazyDisk ) );
+	pxLazyDisk = FF_RAMDiskInit( pcDiskName, ucLazyDisk, testDISK_SECTORS, testCACHE_SIZE );
+	testCHECK( pxLazyDisk != NULL );
+	if( pxLazyDisk == NULL )
+	{
+		return;
+	}
+	pxIOManager = pxLazyDisk->pxIOManager;
+
+	/* Never written: zeros are read, the garbage is still in memory. */
+	for( x = 0; x < testLAZY_REGION; x++ )
+	{
+		testCHECK( prvReadsZeros( pxLazyDisk, testLAZY_ZEROS + x ) != pdFALSE );
+	}
+	testCHECK( prvAllAre( ucLazyDisk + ( testLAZY_ZEROS * ffconfigRAMDISK_SECTOR_SIZE ), testLAZY_REGION * ffconfigRAMDISK_SECTOR_SIZE, testLAZY_GARBAGE ) != pdFALSE );
+
+	/* Writing zeros changes nothing. */
+	memset( ucSector, '\0', sizeof( ucSector ) );
+	testCHECK( pxIOManager->xBlkDevice.fnpWriteBlocks( ucSector, testLAZY_ZEROS + 1, 1, pxLazyDisk ) == 0 );
+	testCHECK( prvReadsZeros( pxLazyDisk, testLAZY_ZEROS + 1 ) != pdFALSE );
+	testCHECK( prvAllAre( ucLazyDisk + ( testLAZY_ZEROS * ffconfigRAMDISK_SECTOR_SIZE ), testLAZY_REGION * ffconfigRAMDISK_SECTOR_SIZE, testLAZY_GARBAGE ) != pdFALSE );
+
+	/* Writing data clears the rest of the region, but not the next one. */
+	memset( ucSector, 'd', sizeof( ucSector ) );
+	testCHECK( pxIOManager->xBlkDevice.fnpWriteBlocks( ucSector, testLAZY_WRITTEN + 2, 1, pxLazyDisk ) == 0 );
+	testCHECK( pxIOManager->xBlkDevice.fnpReadBlocks( ucSector, testLAZY_WRITTEN + 2, 1, pxLazyDisk ) == 0 );
+	testCHECK( prvAllAre( ucSector, sizeof( ucSector ), 'd' ) != pdFALSE );
+	for( x = 0; x < testLAZY_REGION; x++ )
+	{
+		if( x != 2 )
+		{
+			testCHECK( prvReadsZeros( pxLazyDisk, testLAZY_WRITTEN + x ) != pdFALSE );
+			testCHECK( prvAllAre( ucLazyDisk + ( ( testLAZY_WRITTEN + x ) * ffconfigRAMDISK_SECTOR_SIZE ), ffconfigRAMDISK_SECTOR_SIZE, 0 ) != pdFALSE );
+		}
+	}
+	testCHECK( prvAllAre( ucLazyDisk + ( ( testLAZY_WRITTEN + testLAZY_REGION ) * ffconfigRAMDISK_SECTOR_SIZE ), ffconfigRAMDISK_SECTOR_SIZE, testLAZY_GARBAGE ) != pdFALSE );
+
+	/* A mapped sector is used directly, so it must hold the zeros. */
+	pucSector = pxLazyDisk->fnMapBlocks( pxLazyDisk, testLAZY_MAPPED + 1, 2 );
+	testCHECK( pucSector == ucLazyDisk + ( ( testLAZY_MAPPED + 1 ) * ffconfigRAMDISK_SECTOR_SIZE ) );
+	if( pucSector != NULL )
+	{
+		testCHECK( prvAllAre( pucSector, 2 * ffconfigRAMDISK_SECTOR_SIZE, 0 ) != pdFALSE );
+	}
+
+	/* The clusters of a new directory were cleared with writes of zeros. */
+	testCHECK( ff_mkdir( testLAZY_DIR ) == 0 );
+	testCHECK( ulTestCountEntries( testLAZY_DIR ) == 0 );
+	pxFile = ff_fopen( testLAZY_DIR "/file.txt", "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( testLAZY_DIR, 1, sizeof( testLAZY_DIR ), pxFile ) == sizeof( testLAZY_DIR ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+	vTestRemount( pxLazyDisk );
+	testCHECK( ulTestCountEntries( testLAZY_DIR ) == 1 );
+
+	/* Give testDISK_NAME back to the RAM disk of the tests. */
+	testCHECK( FF_FS_Add( testDISK_NAME, pxDisk ) == pdTRUE );
+	testCHECK( FF_Unmount( pxLazyDisk ) == FF_ERR_NONE );
+	testCHECK( FF_RAMDiskDelete( pxLazyDisk ) == pdPASS );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvAllAre( const uint8_t *pucData, size_t xLength, uint8_t ucValue )
+{
+size_t x;
+BaseType_t xReturn = pdTRUE;
+
+	for( x = 0; x < xLength; x++ )
+	{
+		if( pucData[ x ] != ucValue )
+		{
+			xReturn = pdFALSE;
+			break;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReadsZeros( FF_Disk_t *pxDisk, uint32_t ulSector )
+{
+uint8_t ucSector[ ffconfigRAMDISK_SECTOR_SIZE ];
+
+	memset( ucSector, testLAZY_GARBAGE, sizeof( ucSector ) );
+
+	return ( ( pxDisk->pxIOManager->xBlkDevice.fnpReadBlocks( ucSector, ulSector, 1, pxDisk ) == 0 ) &&
+		( prvAllAre( ucSector, sizeof( ucSector ), 0 ) != pdFALSE ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+#else /* ffconfigRAMDISK_LAZY_ZERO */
+
+void vTestLazyZero( FF_Disk_t *pxDisk )
+{
+	( void ) pxDisk;
+}
+/*-----------------------------------------------------------*/
+
+#endif /* ffconfigRAMDISK_LAZY_ZERO */
@@ -0,0 +1,216 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * Log files of ffconfigLOG_FILE_SUPPORT: small records are appended through
+ * a handle opened with "l".  After ff_fflush() the disk itself must hold the
+ * records and the size, while the handle stays open: a snapshot of the disk
+ * taken right then is mounted in place of the RAM disk and read.  After
+ * ff_fclose() the clusters that were reserved ahead are free again, and the
+ * file is complete once the disk has been mounted again, also after it was
+ * reopened in the middle of a sector.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_ramdisk.h"
+
+#include "tests.h"
+
+#define testLOG_FILE			testDISK_NAME "/events.log"
+
+/* The part that is flushed, the part that is only closed, and the part that
+is appended after reopening.  None is a whole number of sectors. */
+#define testLOG_FLUSHED			3000UL
+#define testLOG_CLOSED			1500UL
+#define testLOG_REOPENED		700UL
+#define testLOG_SIZE			( testLOG_FLUSHED + testLOG_CLOSED + testLOG_REOPENED )
+
+/* The records are at most this long, one is longer than a sector. */
+#define testLOG_RECORD			37UL
+#define testLOG_LONG_RECORD		1100UL
+
+/* Slots for the sectors that are written while the snapshot is kept. */
+#define testLOG_SAVE_SLOTS		128UL
+#define testLOG_SAVE_WORDS		( ( ( testDISK_SECTORS + 31UL ) / 32UL ) + \
+								( ( testLOG_SAVE_SLOTS * ( ffconfigRAMDISK_SECTOR_SIZE + 4UL ) ) / 4UL ) )
+
+static uint8_t ucData[ testLOG_SIZE ];
+static uint8_t ucImage[ testDISK_SECTORS * ffconfigRAMDISK_SECTOR_SIZE ];
+static uint32_t ulSaveArea[ testLOG_SAVE_WORDS ];
+
+/*
+ * Appends ucData[ ulFrom ] up to ucData[ ulTo ] in records of varying length.
+ */
+static void prvAppend( FF_FILE *pxFile, uint32_t ulFrom, uint32_t ulTo );
+
+/*
+ * Checks that a file holds exactly the first 'ulLength' bytes of ucData.
+ */
+static void prvCheckFile( const char *pcName, uint32_t ulLength );
+
+/*
+ * Mounts the snapshot that was read into ucImage at testDISK_NAME, checks the
+ * log in it, and gives testDISK_NAME back to the RAM disk.
+ */
+static void prvCheckImage( FF_Disk_t *pxRAMDisk, uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+void vTestLogFile( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+uint32_t ulClusterSize = pxIOManager->xPartition.ulSectorsPerCluster * pxIOManager->usSectorSize;
+uint32_t ulFreeClusters, ulSectors;
+FF_FILE *pxFile;
+FF_Error_t xError;
+FF_Stat_t xStat;
+int32_t lCount;
+size_t x;
+
+	for( x = 0; x < testLOG_SIZE; x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 11 ) + ( x >> 9 ) );
+	}
+
+	ulFreeClusters = FF_CountFreeClusters( pxIOManager, &xError );
+
+	pxFile = ff_fopen( testLOG_FILE, "l" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+
+	/* A log handle can not be read. */
+	testCHECK( ff_fgetc( pxFile ) == FF_EOF );
+
+	prvAppend( pxFile, 0, testLOG_FLUSHED );
+	testCHECK( ff_ftell( pxFile ) == ( long ) testLOG_FLUSHED );
+
+	/* Clusters were reserved ahead of the data. */
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) < ulFreeClusters - ( ( testLOG_FLUSHED + ulClusterSize - 1 ) / ulClusterSize ) );
+
+	/* The records and the size are on the disk, the handle stays open. */
+	testCHECK( ff_fflush( pxFile ) == 0 );
+	testCHECK( ( ff_stat( testLOG_FILE, &xStat ) == 0 ) && ( xStat.st_size == testLOG_FLUSHED ) );
+	testCHECK( FF_RAMDiskSnapshotStart( pxDisk, ( uint8_t * ) ulSaveArea, sizeof( ulSaveArea ) ) == pdPASS );
+
+	prvAppend( pxFile, testLOG_FLUSHED, testLOG_FLUSHED + testLOG_CLOSED );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+
+	/* The clusters that were reserved ahead are free again. */
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) ==
+		ulFreeClusters - ( ( testLOG_FLUSHED + testLOG_CLOSED + ulClusterSize - 1 ) / ulClusterSize ) );
+	prvCheckFile( testLOG_FILE, testLOG_FLUSHED + testLOG_CLOSED );
+
+	/* The disk as it was right after ff_fflush(). */
+	for( ulSectors = 0; ulSectors < testDISK_SECTORS; ulSectors += ( uint32_t ) lCount )
+	{
+		lCount = FF_RAMDiskSnapshotRead( pxDisk, ucImage + ( ulSectors * ffconfigRAMDISK_SECTOR_SIZE ), testDISK_SECTORS - ulSectors );
+		testCHECK( lCount > 0 );
+		if( lCount <= 0 )
+		{
+			break;
+		}
+	}
+	testCHECK( FF_RAMDiskSnapshotStop( pxDisk ) == pdPASS );
+	if( ulSectors == testDISK_SECTORS )
+	{
+		prvCheckImage( pxDisk, testLOG_FLUSHED );
+	}
+
+	vTestRemount( pxDisk );
+	prvCheckFile( testLOG_FILE, testLOG_FLUSHED + testLOG_CLOSED );
+
+	/* Reopened, the log goes on in the middle of its last sector. */
+	pxFile = ff_fopen( testLOG_FILE, "l" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		prvAppend( pxFile, testLOG_FLUSHED + testLOG_CLOSED, testLOG_SIZE );
+		testCHECK( ff_ftell( pxFile ) == ( long ) testLOG_SIZE );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	vTestRemount( pxDisk );
+	prvCheckFile( testLOG_FILE, testLOG_SIZE );
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) == ulFreeClusters - ( ( testLOG_SIZE + ulClusterSize - 1 ) / ulClusterSize ) );
+
+	testCHECK( ff_remove( testLOG_FILE ) == 0 );
+	testCHECK( FF_CountFreeClusters( pxIOManager, &xError ) == ulFreeClusters );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAppend( FF_FILE *pxFile, uint32_t ulFrom, uint32_t ulTo )
+{
+uint32_t ulLength, ulPart = 1;
+
+	while( ulFrom < ulTo )
+	{
+		ulLength = ( ulPart == testLOG_RECORD ) ? testLOG_LONG_RECORD : ulPart;
+		if( ulLength > ulTo - ulFrom )
+		{
+			ulLength = ulTo - ulFrom;
+		}
+
+		testCHECK( ff_fwrite( ucData + ulFrom, 1, ulLength, pxFile ) == ulLength );
+		ulFrom += ulLength;
+
+		ulPart = ( ulPart % testLOG_RECORD ) + 1;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckFile( const char *pcName, uint32_t ulLength )
+{
+static uint8_t ucRead[ testLOG_SIZE ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == ulLength );
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, ucData, ulLength ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckImage( FF_Disk_t *pxRAMDisk, uint32_t ulLength )
+{
+static char pcDiskName[] = testDISK_NAME;
+FF_Disk_t *pxImageDisk;
+
+	pxImageDisk = FF_RAMDiskInitFromImage( pcDiskName, ucImage, testDISK_SECTORS, ucImage, sizeof( ucImage ), testCACHE_SIZE );
+	testCHECK( pxImageDisk != NULL );
+	if( pxImageDisk != NULL )
+	{
+		prvCheckFile( testLOG_FILE, ulLength );
+
+		testCHECK( FF_FS_Add( testDISK_NAME, pxRAMDisk ) == pdTRUE );
+		testCHECK( FF_Unmount( pxImageDisk ) == FF_ERR_NONE );
+		testCHECK( FF_RAMDiskDelete( pxImageDisk ) == pdPASS );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,158 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * Entry point of the tests of the host build ('make test').  They run on
+ * the Posix port of FreeRTOS, with the configuration of startup/posix/, on a
+ * RAM disk.  The process exits with 0 when all tests passed.
+ *
+ * Build with e.g. HOST_BUILD_CFLAGS="-O1 -g -fsanitize=address,undefined"
+ * to have memory errors reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_ramdisk.h"
+
+#include "tests.h"
+
+typedef struct xTEST
+{
+	const char *pcName;
+	void ( *pvTest )( FF_Disk_t *pxDisk );
+} Test_t;
+
+static const Test_t xTests[] =
+{
+	{ "handles", vTestHandles },
+	{ "block queue", vTestBlockQueue },
+	{ "file disk", vTestFileDisk },
+	{ "latency", vTestLatency },
+	{ "dirent hints", vTestDirentHints },
+	{ "directory locks", vTestDirectoryLocks },
+	{ "deferred dirent", vTestDeferredDirent },
+	{ "rename", vTestRename },
+	{ "wild-cards", vTestWildCards },
+	{ "borrow", vTestBorrow },
+	{ "map file", vTestMapFile },
+	{ "vector I/O", vTestVectorIO },
+	{ "asynchronous I/O", vTestAIO },
+	{ "stream buffers", vTestStdioBuffers },
+	{ "copy file", vTestCopyFile },
+	{ "log file", vTestLogFile },
+	{ "parallel reads", vTestParallelReads },
+	{ "handle pool", vTestHandlePool },
+	{ "cache map", vTestCacheMap },
+	{ "lazy zero", vTestLazyZero },
+	{ "reentrant disk", vTestReentrantDisk },
+	{ "compressed disk", vTestZRAMDisk },
+	{ "snapshot", vTestSnapshot },
+};
+
+volatile uint32_t ulTestFailures = 0;
+
+static uint8_t ucDisk[ testDISK_SECTORS * ffconfigRAMDISK_SECTOR_SIZE ];
+
+void vAssertCalled( const char *pcFile, uint32_t ulLine )
+{
+	fprintf( stderr, "vAssertCalled: %s, %lu\n", pcFile, ( unsigned long ) ulLine );
+	abort();
+}
+
+void vApplicationMallocFailedHook( void )
+{
+	vAssertCalled( __FILE__, __LINE__ );
+}
+
+void vTestRemount( FF_Disk_t *pxDisk )
+{
+	testCHECK( FF_Unmount( pxDisk ) == FF_ERR_NONE );
+
+	/* Nothing may come from the cache afterwards. */
+	FF_IOMAN_InitBufferDescriptors( pxDisk->pxIOManager );
+	testCHECK( FF_Mount( pxDisk, 0 ) == FF_ERR_NONE );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulTestCountEntries( const char *pcDirectory )
+{
+FF_FindData_t xFindData;
+uint32_t ulCount = 0;
+int iResult;
+
+	memset( &xFindData, '\0', sizeof( xFindData ) );
+
+	for( iResult = ff_findfirst( pcDirectory, &xFindData ); iResult == 0; iResult = ff_findnext( &xFindData ) )
+	{
+		if( ( strcmp( xFindData.pcFileName, "." ) != 0 ) && ( strcmp( xFindData.pcFileName, ".." ) != 0 ) )
+		{
+			ulCount++;
+		}
+	}
+
+	return ulCount;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestTask( void *pvParameters )
+{
+FF_Disk_t *pxDisk;
+size_t x;
+uint32_t ulBefore;
+
+	( void ) pvParameters;
+
+	pxDisk = FF_RAMDiskInit( testDISK_NAME, ucDisk, testDISK_SECTORS, testCACHE_SIZE );
+	if( pxDisk == NULL )
+	{
+		printf( "Could not create the RAM disk\n" );
+		exit( EXIT_FAILURE );
+	}
+
+	for( x = 0; x < sizeof( xTests ) / sizeof( xTests[ 0 ] ); x++ )
+	{
+		printf( "%s\n", xTests[ x ].pcName );
+		ulBefore = ulTestFailures;
+		xTests[ x ].pvTest( pxDisk );
+		printf( "  %s\n", ( ulTestFailures == ulBefore ) ? "ok" : "FAILED" );
+	}
+
+	printf( "%lu failure(s)\n", ( unsigned long ) ulTestFailures );
+	exit( ( ulTestFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+	setvbuf( stdout, NULL, _IOLBF, 0 );
+
+	if( xTaskCreate( prvTestTask, "test", configMINIMAL_STACK_SIZE * 4, NULL, tskIDLE_PRIORITY + 2, NULL ) != pdPASS )
+	{
+		printf( "Could not create the test task\n" );
+		return EXIT_FAILURE;
+	}
+
+	vTaskStartScheduler();
+
+	return EXIT_FAILURE;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,143 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The read-only mappings of ffconfigMMAP_SUPPORT: the extents of a mapped
+ * file hold its contents in order, also when the file is fragmented.  An
+ * empty file has no extents, and a handle that can write can not be mapped.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testMMAP_FILE			testDISK_NAME "/mapped.bin"
+#define testMMAP_OTHER_FILE		testDISK_NAME "/between.bin"
+
+/* The file is written in two parts, another file is written in between, so
+that the file has at least two extents. */
+#define testMMAP_FIRST_PART		1500UL
+#define testMMAP_SECOND_PART	2500UL
+#define testMMAP_OTHER_SIZE		600UL
+
+static uint8_t ucData[ testMMAP_FIRST_PART + testMMAP_SECOND_PART ];
+
+/*
+ * Writes 'ulLength' bytes from pucData to pcName, in mode pcMode.
+ */
+static void prvWrite( const char *pcName, const char *pcMode, const uint8_t *pucData, uint32_t ulLength );
+
+/*
+ * Maps pcName and checks that it holds the first 'ulLength' bytes of ucData.
+ * Returns the number of extents.
+ */
+static uint32_t prvCheckMapping( const char *pcName, uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+void vTestMapFile( FF_Disk_t *pxDisk )
+{
+FF_FILE *pxFile;
+FF_Error_t xError;
+size_t x;
+
+	( void ) pxDisk;
+
+	for( x = 0; x < sizeof( ucData ); x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 11 ) + ( x >> 8 ) );
+	}
+
+	prvWrite( testMMAP_FILE, "w", ucData, testMMAP_FIRST_PART );
+	prvWrite( testMMAP_OTHER_FILE, "w", ucData, testMMAP_OTHER_SIZE );
+	prvWrite( testMMAP_FILE, "a", ucData + testMMAP_FIRST_PART, testMMAP_SECOND_PART );
+
+	testCHECK( prvCheckMapping( testMMAP_FILE, sizeof( ucData ) ) >= 2 );
+	testCHECK( prvCheckMapping( testMMAP_OTHER_FILE, testMMAP_OTHER_SIZE ) == 1 );
+
+	/* A handle that can change the file. */
+	pxFile = ff_fopen( testMMAP_OTHER_FILE, "r+" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( FF_MapFile( pxFile, &xError ) == NULL );
+		testCHECK( FF_GETERROR( xError ) == FF_ERR_FILE_NOT_OPENED_IN_READ_MODE );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	/* An empty file. */
+	prvWrite( testMMAP_OTHER_FILE, "w", ucData, 0 );
+	testCHECK( prvCheckMapping( testMMAP_OTHER_FILE, 0 ) == 0 );
+
+	testCHECK( ff_mmap_ro( testDISK_NAME "/missing.bin" ) == NULL );
+
+	testCHECK( ff_remove( testMMAP_FILE ) == 0 );
+	testCHECK( ff_remove( testMMAP_OTHER_FILE ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWrite( const char *pcName, const char *pcMode, const uint8_t *pucData, uint32_t ulLength )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, pcMode );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( pucData, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCheckMapping( const char *pcName, uint32_t ulLength )
+{
+FF_Mapping_t *pxMapping;
+uint32_t ulExtent, ulOffset = 0, ulExtentCount = 0;
+
+	pxMapping = ff_mmap_ro( pcName );
+	testCHECK( pxMapping != NULL );
+	if( pxMapping != NULL )
+	{
+		testCHECK( pxMapping->ulLength == ulLength );
+		ulExtentCount = pxMapping->ulExtentCount;
+
+		for( ulExtent = 0; ulExtent < pxMapping->ulExtentCount; ulExtent++ )
+		{
+			testCHECK( pxMapping->pxExtents[ ulExtent ].ulLength != 0 );
+			testCHECK( ulOffset + pxMapping->pxExtents[ ulExtent ].ulLength <= ulLength );
+			if( ulOffset + pxMapping->pxExtents[ ulExtent ].ulLength > ulLength )
+			{
+				break;
+			}
+
+			testCHECK( memcmp( pxMapping->pxExtents[ ulExtent ].pucData, ucData + ulOffset, pxMapping->pxExtents[ ulExtent ].ulLength ) == 0 );
+			ulOffset += pxMapping->pxExtents[ ulExtent ].ulLength;
+		}
+
+		testCHECK( ulOffset == ulLength );
+		testCHECK( ff_munmap( pxMapping ) == 0 );
+	}
+
+	return ulExtentCount;
+}
+/*-----------------------------------------------------------*/
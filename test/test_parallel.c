@@ -0,0 +1,299 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The parallel reads of ffconfigCONCURRENT_READS: tasks read their own
+ * fragmented file in small parts, with an empty cache, while another task
+ * appends to a file.  The driver keeps every read for a tick and counts the
+ * reads that are in it at the same time.  With a reentrant driver, more than
+ * one read must have been in it at once, and every task must have read its
+ * own data.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testPARALLEL_DIR		testDISK_NAME "/parallel"
+#define testPARALLEL_NAME		testPARALLEL_DIR "/file%d.bin"
+#define testPARALLEL_APPENDED	testPARALLEL_DIR "/appended.bin"
+
+#define testREADERS				4
+#define testFILE_SIZE			( 20UL * 1024UL )
+
+/* The files are written in turns of this many bytes, so their clusters
+alternate.  The readers read in parts of testREAD_PART bytes. */
+#define testWRITE_TURN			700UL
+#define testREAD_PART			100UL
+
+/* What the writer appends while the files are read. */
+#define testAPPEND_PART			512UL
+#define testAPPEND_PARTS		8UL
+
+/* The read function of the RAM disk. */
+static FF_ReadBlocks_t fnRAMRead;
+
+/* The reads that are in prvCountingRead(), and the most there were. */
+static volatile UBaseType_t uxReadsInDriver;
+static volatile UBaseType_t uxMostReadsInDriver;
+
+static volatile uint32_t ulTasksDone;
+
+/*
+ * Returns byte 'ulOffset' of file 'xFile'.
+ */
+static uint8_t prvByte( BaseType_t xFile, uint32_t ulOffset );
+
+/*
+ * Reads its file in parts of testREAD_PART bytes and compares them.
+ */
+static void prvReaderTask( void *pvParameters );
+
+/*
+ * Appends testAPPEND_PARTS parts to testPARALLEL_APPENDED.
+ */
+static void prvWriterTask( void *pvParameters );
+
+/*
+ * A driver that keeps every read for a tick, and counts the reads it holds.
+ */
+static int32_t prvCountingRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk );
+
+/*-----------------------------------------------------------*/
+
+void vTestParallelReads( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_FILE *pxFiles[ testREADERS ];
+FF_MapBlocksHook fnMapBlocks;
+uint8_t ucBuffer[ testWRITE_TURN ];
+uint32_t ulOffset, ulLength, x;
+char pcName[ 48 ];
+BaseType_t xFile, xCreated;
+
+	testCHECK( ff_mkdir( testPARALLEL_DIR ) == 0 );
+
+	for( xFile = 0; xFile < testREADERS; xFile++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testPARALLEL_NAME, ( int ) xFile );
+		pxFiles[ xFile ] = ff_fopen( pcName, "w" );
+		testCHECK( pxFiles[ xFile ] != NULL );
+		if( pxFiles[ xFile ] == NULL )
+		{
+			return;
+		}
+	}
+
+	for( ulOffset = 0; ulOffset < testFILE_SIZE; ulOffset += ulLength )
+	{
+		ulLength = testFILE_SIZE - ulOffset;
+		if( ulLength > testWRITE_TURN )
+		{
+			ulLength = testWRITE_TURN;
+		}
+
+		for( xFile = 0; xFile < testREADERS; xFile++ )
+		{
+			for( x = 0; x < ulLength; x++ )
+			{
+				ucBuffer[ x ] = prvByte( xFile, ulOffset + x );
+			}
+			testCHECK( ff_fwrite( ucBuffer, 1, ulLength, pxFiles[ xFile ] ) == ulLength );
+		}
+	}
+
+	for( xFile = 0; xFile < testREADERS; xFile++ )
+	{
+		testCHECK( ff_fclose( pxFiles[ xFile ] ) == 0 );
+	}
+
+	/* Every sector comes from the driver, none is mapped. */
+	vTestRemount( pxDisk );
+	fnMapBlocks = pxDisk->fnMapBlocks;
+	pxDisk->fnMapBlocks = NULL;
+	fnRAMRead = pxIOManager->xBlkDevice.fnpReadBlocks;
+	pxIOManager->xBlkDevice.fnpReadBlocks = prvCountingRead;
+	uxReadsInDriver = 0;
+	uxMostReadsInDriver = 0;
+	ulTasksDone = 0;
+
+	for( xFile = 0; xFile < testREADERS; xFile++ )
+	{
+		xCreated = xTaskCreate( prvReaderTask, "reader", configMINIMAL_STACK_SIZE, ( void * ) xFile, tskIDLE_PRIORITY + 2, NULL );
+		configASSERT( xCreated == pdPASS );
+	}
+	xCreated = xTaskCreate( prvWriterTask, "writer", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, NULL );
+	configASSERT( xCreated == pdPASS );
+
+	while( ulTasksDone < ( testREADERS + 1 ) )
+	{
+		vTaskDelay( 1 );
+	}
+
+	pxIOManager->xBlkDevice.fnpReadBlocks = fnRAMRead;
+	pxDisk->fnMapBlocks = fnMapBlocks;
+
+	#if( ffconfigCONCURRENT_READS != 0 )
+	{
+		if( ( pxIOManager->ucFlags & FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT ) != 0 )
+		{
+			testCHECK( uxMostReadsInDriver > 1 );
+		}
+	}
+	#endif
+	testCHECK( uxReadsInDriver == 0 );
+
+	vTestRemount( pxDisk );
+	testCHECK( ulTestCountEntries( testPARALLEL_DIR ) == testREADERS + 1 );
+	pxFiles[ 0 ] = ff_fopen( testPARALLEL_APPENDED, "r" );
+	testCHECK( pxFiles[ 0 ] != NULL );
+	if( pxFiles[ 0 ] != NULL )
+	{
+		testCHECK( ff_filelength( pxFiles[ 0 ] ) == testAPPEND_PART * testAPPEND_PARTS );
+		testCHECK( ff_fclose( pxFiles[ 0 ] ) == 0 );
+	}
+
+	for( xFile = 0; xFile < testREADERS; xFile++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testPARALLEL_NAME, ( int ) xFile );
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+	testCHECK( ff_remove( testPARALLEL_APPENDED ) == 0 );
+	testCHECK( ff_rmdir( testPARALLEL_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t prvByte( BaseType_t xFile, uint32_t ulOffset )
+{
+	return ( uint8_t ) ( ( ulOffset * ( uint32_t ) ( xFile + 3 ) ) + ( ulOffset >> 8 ) + ( uint32_t ) xFile );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReaderTask( void *pvParameters )
+{
+BaseType_t xFile = ( BaseType_t ) pvParameters;
+uint8_t ucPart[ testREAD_PART ];
+FF_FILE *pxFile;
+uint32_t ulOffset, ulLength, x;
+char pcName[ 48 ];
+
+	snprintf( pcName, sizeof( pcName ), testPARALLEL_NAME, ( int ) xFile );
+	pxFile = ff_fopen( pcName, "r" );
+	testCHECK( pxFile != NULL );
+
+	if( pxFile != NULL )
+	{
+		for( ulOffset = 0; ulOffset < testFILE_SIZE; ulOffset += ulLength )
+		{
+			ulLength = testFILE_SIZE - ulOffset;
+			if( ulLength > testREAD_PART )
+			{
+				ulLength = testREAD_PART;
+			}
+
+			testCHECK( ff_fread( ucPart, 1, ulLength, pxFile ) == ulLength );
+			for( x = 0; x < ulLength; x++ )
+			{
+				if( ucPart[ x ] != prvByte( xFile, ulOffset + x ) )
+				{
+					testCHECK( ucPart[ x ] == prvByte( xFile, ulOffset + x ) );
+					break;
+				}
+			}
+		}
+
+		testCHECK( ff_fgetc( pxFile ) == FF_EOF );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+
+	taskENTER_CRITICAL();
+	{
+		ulTasksDone++;
+	}
+	taskEXIT_CRITICAL();
+
+	/* The working directory that ff_fopen() gave this task. */
+	ff_free_CWD_space();
+	vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriterTask( void *pvParameters )
+{
+static uint8_t ucPart[ testAPPEND_PART ];
+FF_FILE *pxFile;
+uint32_t ulPart;
+
+	( void ) pvParameters;
+
+	memset( ucPart, 'w', sizeof( ucPart ) );
+
+	for( ulPart = 0; ulPart < testAPPEND_PARTS; ulPart++ )
+	{
+		/* The FAT is changed while the readers follow their chains. */
+		pxFile = ff_fopen( testPARALLEL_APPENDED, "a" );
+		testCHECK( pxFile != NULL );
+		if( pxFile != NULL )
+		{
+			testCHECK( ff_fwrite( ucPart, 1, sizeof( ucPart ), pxFile ) == sizeof( ucPart ) );
+			testCHECK( ff_fclose( pxFile ) == 0 );
+		}
+		taskYIELD();
+	}
+
+	taskENTER_CRITICAL();
+	{
+		ulTasksDone++;
+	}
+	taskEXIT_CRITICAL();
+
+	ff_free_CWD_space();
+	vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvCountingRead( uint8_t *pucDestination, uint32_t ulSectorNumber, uint32_t ulSectorCount, FF_Disk_t *pxDisk )
+{
+int32_t lReturn;
+
+	taskENTER_CRITICAL();
+	{
+		uxReadsInDriver++;
+		if( uxMostReadsInDriver < uxReadsInDriver )
+		{
+			uxMostReadsInDriver = uxReadsInDriver;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	vTaskDelay( 1 );
+	lReturn = fnRAMRead( pucDestination, ulSectorNumber, ulSectorCount, pxDisk );
+
+	taskENTER_CRITICAL();
+	{
+		uxReadsInDriver--;
+	}
+	taskEXIT_CRITICAL();
+
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,270 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The handle pool of ffconfigFILE_HANDLE_POOL_SIZE: as many files as the
+ * pool holds are open at once, with handles and sector buffers of the pool
+ * that do not overlap.  They are written in turns, in parts that are not
+ * aligned on sectors, so each sector buffer is used.  One more file gets its
+ * handle from the heap.  Every handle goes back to the pool when it is
+ * closed, also when the open fails, and is handed out again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testPOOL_DIR			testDISK_NAME "/pool"
+#define testPOOL_NAME			testPOOL_DIR "/file%d.bin"
+#define testPOOL_EXTRA			testPOOL_DIR "/extra.bin"
+
+/* Not a whole number of sectors, nor are the parts. */
+#define testPOOL_FILE_SIZE		2000UL
+#define testPOOL_PART			77UL
+
+#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+
+/*
+ * Returns pdTRUE when pxFile is one of the handles of the pool.
+ */
+static BaseType_t prvInPool( FF_IOManager_t *pxIOManager, FF_FILE *pxFile );
+
+/*
+ * Returns the number of handles on the free list of the pool.
+ */
+static UBaseType_t prvFreeHandles( FF_IOManager_t *pxIOManager );
+
+/*
+ * Returns byte 'ulOffset' of file 'xFile'.
+ */
+static uint8_t prvByte( BaseType_t xFile, uint32_t ulOffset );
+
+#endif /* ffconfigFILE_HANDLE_POOL_SIZE */
+
+/*-----------------------------------------------------------*/
+
+#if( ffconfigFILE_HANDLE_POOL_SIZE != 0 )
+
+void vTestHandlePool( FF_Disk_t *pxDisk )
+{
+FF_IOManager_t *pxIOManager = pxDisk->pxIOManager;
+FF_FILE *pxFiles[ ffconfigFILE_HANDLE_POOL_SIZE ];
+FF_FILE *pxFile, *pxExtra;
+uint8_t ucPart[ testPOOL_PART ];
+uint32_t ulOffset, ulLength, x;
+char pcName[ 32 ];
+BaseType_t xFile, xOther;
+
+	testCHECK( prvFreeHandles( pxIOManager ) == ffconfigFILE_HANDLE_POOL_SIZE );
+	testCHECK( ff_mkdir( testPOOL_DIR ) == 0 );
+
+	/* A file that can not be opened gives its handle back. */
+	testCHECK( ff_fopen( testPOOL_DIR "/missing.bin", "r" ) == NULL );
+	testCHECK( prvFreeHandles( pxIOManager ) == ffconfigFILE_HANDLE_POOL_SIZE );
+
+	for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testPOOL_NAME, ( int ) xFile );
+		pxFiles[ xFile ] = ff_fopen( pcName, "w+" );
+		testCHECK( pxFiles[ xFile ] != NULL );
+		if( pxFiles[ xFile ] == NULL )
+		{
+			return;
+		}
+		testCHECK( prvInPool( pxIOManager, pxFiles[ xFile ] ) != pdFALSE );
+	}
+	testCHECK( prvFreeHandles( pxIOManager ) == 0 );
+
+	#if( ffconfigOPTIMISE_UNALIGNED_ACCESS != 0 )
+	{
+		/* Each handle has its own sector buffer. */
+		for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+		{
+			for( xOther = xFile + 1; xOther < ffconfigFILE_HANDLE_POOL_SIZE; xOther++ )
+			{
+				testCHECK( ( pxFiles[ xFile ]->pucBuffer + pxIOManager->usSectorSize <= pxFiles[ xOther ]->pucBuffer ) ||
+					( pxFiles[ xOther ]->pucBuffer + pxIOManager->usSectorSize <= pxFiles[ xFile ]->pucBuffer ) );
+			}
+		}
+	}
+	#else
+	{
+		( void ) xOther;
+	}
+	#endif
+
+	/* The pool is empty, the next handle comes from the heap. */
+	pxExtra = ff_fopen( testPOOL_EXTRA, "w" );
+	testCHECK( pxExtra != NULL );
+	testCHECK( prvInPool( pxIOManager, pxExtra ) == pdFALSE );
+
+	for( ulOffset = 0; ulOffset < testPOOL_FILE_SIZE; ulOffset += ulLength )
+	{
+		ulLength = testPOOL_FILE_SIZE - ulOffset;
+		if( ulLength > testPOOL_PART )
+		{
+			ulLength = testPOOL_PART;
+		}
+
+		for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+		{
+			for( x = 0; x < ulLength; x++ )
+			{
+				ucPart[ x ] = prvByte( xFile, ulOffset + x );
+			}
+			testCHECK( ff_fwrite( ucPart, 1, ulLength, pxFiles[ xFile ] ) == ulLength );
+		}
+		if( pxExtra != NULL )
+		{
+			testCHECK( ff_fwrite( ucPart, 1, ulLength, pxExtra ) == ulLength );
+		}
+	}
+
+	/* Read back in turns, through the same handles. */
+	for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+	{
+		testCHECK( ff_fseek( pxFiles[ xFile ], 0, FF_SEEK_SET ) == 0 );
+	}
+	for( ulOffset = 0; ulOffset < testPOOL_FILE_SIZE; ulOffset += ulLength )
+	{
+		ulLength = testPOOL_FILE_SIZE - ulOffset;
+		if( ulLength > testPOOL_PART )
+		{
+			ulLength = testPOOL_PART;
+		}
+
+		for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+		{
+			testCHECK( ff_fread( ucPart, 1, ulLength, pxFiles[ xFile ] ) == ulLength );
+			for( x = 0; x < ulLength; x++ )
+			{
+				if( ucPart[ x ] != prvByte( xFile, ulOffset + x ) )
+				{
+					testCHECK( ucPart[ x ] == prvByte( xFile, ulOffset + x ) );
+					break;
+				}
+			}
+		}
+	}
+
+	/* A closed handle goes back to the pool and is the next one out. */
+	pxFile = pxFiles[ 3 ];
+	testCHECK( ff_fclose( pxFile ) == 0 );
+	testCHECK( prvFreeHandles( pxIOManager ) == 1 );
+	snprintf( pcName, sizeof( pcName ), testPOOL_NAME, 3 );
+	pxFiles[ 3 ] = ff_fopen( pcName, "r" );
+	testCHECK( pxFiles[ 3 ] == pxFile );
+	testCHECK( prvFreeHandles( pxIOManager ) == 0 );
+
+	if( pxExtra != NULL )
+	{
+		testCHECK( ff_fclose( pxExtra ) == 0 );
+		testCHECK( prvFreeHandles( pxIOManager ) == 0 );
+	}
+
+	for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+	{
+		if( pxFiles[ xFile ] != NULL )
+		{
+			testCHECK( ff_fclose( pxFiles[ xFile ] ) == 0 );
+		}
+	}
+	testCHECK( prvFreeHandles( pxIOManager ) == ffconfigFILE_HANDLE_POOL_SIZE );
+
+	/* A log handle takes more than the pool holds, and gives it all back. */
+	#if( ffconfigLOG_FILE_SUPPORT != 0 )
+	{
+		pxFile = ff_fopen( testPOOL_EXTRA, "l" );
+		testCHECK( ( pxFile != NULL ) && ( prvInPool( pxIOManager, pxFile ) != pdFALSE ) );
+		if( pxFile != NULL )
+		{
+			testCHECK( ff_fclose( pxFile ) == 0 );
+		}
+		testCHECK( prvFreeHandles( pxIOManager ) == ffconfigFILE_HANDLE_POOL_SIZE );
+	}
+	#endif
+
+	for( xFile = 0; xFile < ffconfigFILE_HANDLE_POOL_SIZE; xFile++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testPOOL_NAME, ( int ) xFile );
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+	testCHECK( ff_remove( testPOOL_EXTRA ) == 0 );
+	testCHECK( ff_rmdir( testPOOL_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvInPool( FF_IOManager_t *pxIOManager, FF_FILE *pxFile )
+{
+FF_FILE *pxPool = ( FF_FILE * ) pxIOManager->pvFileHandlePool;
+BaseType_t xReturn = pdFALSE;
+
+	if( ( pxFile >= pxPool ) && ( pxFile < &( pxPool[ ffconfigFILE_HANDLE_POOL_SIZE ] ) ) )
+	{
+		/* Only whole handles are handed out. */
+		testCHECK( ( ( ( uint8_t * ) pxFile - ( uint8_t * ) pxPool ) % sizeof( FF_FILE ) ) == 0 );
+		xReturn = pdTRUE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFreeHandles( FF_IOManager_t *pxIOManager )
+{
+FF_FILE *pxFile;
+UBaseType_t uxCount = 0;
+
+	FF_PendSemaphore( pxIOManager->pvSemaphore );
+	{
+		for( pxFile = ( FF_FILE * ) pxIOManager->pvFreeFileHandles; pxFile != NULL; pxFile = pxFile->pxNext )
+		{
+			testCHECK( prvInPool( pxIOManager, pxFile ) != pdFALSE );
+			uxCount++;
+			if( uxCount > ffconfigFILE_HANDLE_POOL_SIZE )
+			{
+				/* The list has a loop. */
+				break;
+			}
+		}
+	}
+	FF_ReleaseSemaphore( pxIOManager->pvSemaphore );
+
+	return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t prvByte( BaseType_t xFile, uint32_t ulOffset )
+{
+	return ( uint8_t ) ( ( ulOffset * 5 ) + ( ulOffset >> 7 ) + ( uint32_t ) ( xFile * 29 ) );
+}
+/*-----------------------------------------------------------*/
+
+#else /* ffconfigFILE_HANDLE_POOL_SIZE */
+
+void vTestHandlePool( FF_Disk_t *pxDisk )
+{
+	( void ) pxDisk;
+}
+/*-----------------------------------------------------------*/
+
+#endif /* ffconfigFILE_HANDLE_POOL_SIZE */
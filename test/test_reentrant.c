@@ -0,0 +1,165 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The RAM disk as a reentrant block device: tasks call its driver directly,
+ * without the semaphore of the I/O manager, on a new disk.  Each task owns
+ * every fourth sector of a range, so the tasks share each region of 4 KB and
+ * fill the same unwritten regions at the same time.  They write their sectors
+ * in rounds and yield after each sector.  No task may lose what another one
+ * wrote, and the sectors outside the range must still read as zeros.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_ramdisk.h"
+
+#include "tests.h"
+
+#define testREENTRANT_TASKS		4
+#define testREENTRANT_ROUNDS	8
+
+/* The last regions of 4 KB of the disk, which the file system does not use. */
+#define testREENTRANT_SECTORS	( 16UL * ( 4096UL / ffconfigRAMDISK_SECTOR_SIZE ) )
+#define testREENTRANT_FIRST		( testDISK_SECTORS - testREENTRANT_SECTORS )
+
+static uint8_t ucReentrantDisk[ testDISK_SECTORS * ffconfigRAMDISK_SECTOR_SIZE ];
+static FF_Disk_t *pxReentrantDisk;
+
+static volatile uint32_t ulTasksDone;
+
+/*
+ * Returns the byte that fills sector ulSector after round 'xRound'.  It is
+ * never zero, as writes of zeros to an unwritten region are skipped.
+ */
+static uint8_t prvByte( uint32_t ulSector, BaseType_t xRound );
+
+/*
+ * Returns pdTRUE when sector ulSector reads as ucValue through the driver.
+ */
+static BaseType_t prvSectorIs( uint32_t ulSector, uint8_t ucValue );
+
+/*
+ * Writes and checks its own sectors, one at a time.
+ */
+static void prvSectorTask( void *pvParameters );
+
+/*-----------------------------------------------------------*/
+
+void vTestReentrantDisk( FF_Disk_t *pxDisk )
+{
+static char pcDiskName[] = testDISK_NAME;
+uint32_t ulSector;
+BaseType_t xTask, xCreated;
+
+	/* The file system does not take the semaphore for this driver. */
+	testCHECK( ( pxDisk->pxIOManager->ucFlags & FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT ) != 0 );
+
+	memset( ucReentrantDisk, 0xa5, sizeof( ucReentrantDisk ) );
+	pxReentrantDisk = FF_RAMDiskInit( pcDiskName, ucReentrantDisk, testDISK_SECTORS, testCACHE_SIZE );
+	testCHECK( pxReentrantDisk != NULL );
+	if( pxReentrantDisk == NULL )
+	{
+		return;
+	}
+	testCHECK( ( pxReentrantDisk->pxIOManager->ucFlags & FF_IOMAN_BLOCK_DEVICE_IS_REENTRANT ) != 0 );
+
+	ulTasksDone = 0;
+	for( xTask = 0; xTask < testREENTRANT_TASKS; xTask++ )
+	{
+		xCreated = xTaskCreate( prvSectorTask, "sectors", configMINIMAL_STACK_SIZE, ( void * ) xTask, tskIDLE_PRIORITY + 2, NULL );
+		configASSERT( xCreated == pdPASS );
+	}
+
+	while( ulTasksDone < testREENTRANT_TASKS )
+	{
+		vTaskDelay( 1 );
+	}
+
+	for( ulSector = 0; ulSector < testREENTRANT_SECTORS; ulSector++ )
+	{
+		testCHECK( prvSectorIs( testREENTRANT_FIRST + ulSector, prvByte( ulSector, testREENTRANT_ROUNDS - 1 ) ) != pdFALSE );
+	}
+	testCHECK( prvSectorIs( testREENTRANT_FIRST - 1, 0 ) != pdFALSE );
+
+	/* Give testDISK_NAME back to the RAM disk of the tests. */
+	testCHECK( FF_FS_Add( testDISK_NAME, pxDisk ) == pdTRUE );
+	testCHECK( FF_Unmount( pxReentrantDisk ) == FF_ERR_NONE );
+	testCHECK( FF_RAMDiskDelete( pxReentrantDisk ) == pdPASS );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t prvByte( uint32_t ulSector, BaseType_t xRound )
+{
+	return ( uint8_t ) ( ( ( ulSector * 7 ) + ( ( uint32_t ) xRound * 31 ) ) % 255 ) + 1;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSectorIs( uint32_t ulSector, uint8_t ucValue )
+{
+uint8_t ucSector[ ffconfigRAMDISK_SECTOR_SIZE ];
+BaseType_t xReturn = pdFALSE;
+size_t x;
+
+	if( pxReentrantDisk->pxIOManager->xBlkDevice.fnpReadBlocks( ucSector, ulSector, 1, pxReentrantDisk ) == 0 )
+	{
+		for( x = 0; ( x < sizeof( ucSector ) ) && ( ucSector[ x ] == ucValue ); x++ )
+		{
+		}
+		xReturn = ( x == sizeof( ucSector ) ) ? pdTRUE : pdFALSE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSectorTask( void *pvParameters )
+{
+uint32_t ulFirst = ( uint32_t ) ( BaseType_t ) pvParameters;
+uint8_t ucSector[ ffconfigRAMDISK_SECTOR_SIZE ];
+uint32_t ulSector;
+BaseType_t xRound;
+
+	for( xRound = 0; xRound < testREENTRANT_ROUNDS; xRound++ )
+	{
+		for( ulSector = ulFirst; ulSector < testREENTRANT_SECTORS; ulSector += testREENTRANT_TASKS )
+		{
+			memset( ucSector, prvByte( ulSector, xRound ), sizeof( ucSector ) );
+			testCHECK( pxReentrantDisk->pxIOManager->xBlkDevice.fnpWriteBlocks( ucSector, testREENTRANT_FIRST + ulSector, 1, pxReentrantDisk ) == 0 );
+			taskYIELD();
+		}
+
+		/* Another task that filled a region did not clear these. */
+		for( ulSector = ulFirst; ulSector < testREENTRANT_SECTORS; ulSector += testREENTRANT_TASKS )
+		{
+			testCHECK( prvSectorIs( testREENTRANT_FIRST + ulSector, prvByte( ulSector, xRound ) ) != pdFALSE );
+		}
+	}
+
+	taskENTER_CRITICAL();
+	{
+		ulTasksDone++;
+	}
+	taskEXIT_CRITICAL();
+
+	vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,158 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * Renames within a directory (FF_RenameDirent()): to a name with fewer LFN
+ * entries, which is done in place, to a short name, and to a name that needs
+ * a new run of entries.  Only the new name may be listed afterwards, and the
+ * object keeps its contents, first cluster and times.  A directory that is
+ * renamed keeps its files, and an existing name is only replaced when asked.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+/* FF_SetTime() is called with the path on the volume, without testDISK_NAME. */
+#define testRENAME_VOLUME_DIR	"/rename"
+#define testRENAME_DIR			testDISK_NAME testRENAME_VOLUME_DIR
+
+/* Three LFN entries, two, none, and five. */
+#define testNAME_LONG			"a rather long name for a file.txt"
+#define testNAME_SHORTER		"shorter name.txt"
+#define testNAME_8_3			"SHORT.TXT"
+#define testNAME_LONGER			"a name that is much longer than the ones before it.txt"
+
+#define testRENAME_TEXT			"the contents stay"
+
+/*
+ * Renames testRENAME_DIR/pcFrom to testRENAME_DIR/pcTo and checks that only
+ * the new name is there, with the same first cluster, time and contents.
+ */
+static void prvRename( const char *pcFrom, const char *pcTo );
+
+/*
+ * Writes a file with testRENAME_TEXT.
+ */
+static void prvWrite( const char *pcPath );
+
+/*
+ * Checks that a file holds testRENAME_TEXT.
+ */
+static void prvCheck( const char *pcPath );
+
+/*-----------------------------------------------------------*/
+
+void vTestRename( FF_Disk_t *pxDisk )
+{
+FF_SystemTime_t xTime = { 2001, 2, 3, 4, 5, 6 };
+FF_Stat_t xStat;
+
+	testCHECK( ff_mkdir( testRENAME_DIR ) == 0 );
+	prvWrite( testRENAME_DIR "/" testNAME_LONG );
+	testCHECK( FF_SetTime( pxDisk->pxIOManager, testRENAME_VOLUME_DIR "/" testNAME_LONG, &xTime, ETimeCreate | ETimeMod ) == FF_ERR_NONE );
+
+	prvRename( testNAME_LONG, testNAME_SHORTER );
+	prvRename( testNAME_SHORTER, testNAME_8_3 );
+	prvRename( testNAME_8_3, testNAME_LONGER );
+	prvRename( testNAME_LONGER, testNAME_LONG );
+
+	/* The entries were written to the disk. */
+	vTestRemount( pxDisk );
+	testCHECK( ulTestCountEntries( testRENAME_DIR ) == 1 );
+	prvCheck( testRENAME_DIR "/" testNAME_LONG );
+
+	/* A directory keeps its contents. */
+	testCHECK( ff_mkdir( testRENAME_DIR "/directory with a long name" ) == 0 );
+	prvWrite( testRENAME_DIR "/directory with a long name/inner.txt" );
+	testCHECK( ff_rename( testRENAME_DIR "/directory with a long name", testRENAME_DIR "/dir", pdFALSE ) == 0 );
+	testCHECK( ff_stat( testRENAME_DIR "/directory with a long name", &xStat ) != 0 );
+	prvCheck( testRENAME_DIR "/dir/inner.txt" );
+	testCHECK( ulTestCountEntries( testRENAME_DIR ) == 2 );
+
+	/* An existing name is only replaced when that is asked for. */
+	prvWrite( testRENAME_DIR "/" testNAME_SHORTER );
+	testCHECK( ff_rename( testRENAME_DIR "/" testNAME_SHORTER, testRENAME_DIR "/" testNAME_LONG, pdFALSE ) != 0 );
+	testCHECK( ulTestCountEntries( testRENAME_DIR ) == 3 );
+	testCHECK( ff_rename( testRENAME_DIR "/" testNAME_SHORTER, testRENAME_DIR "/" testNAME_LONG, pdTRUE ) == 0 );
+	testCHECK( ulTestCountEntries( testRENAME_DIR ) == 2 );
+	prvCheck( testRENAME_DIR "/" testNAME_LONG );
+
+	testCHECK( ff_remove( testRENAME_DIR "/dir/inner.txt" ) == 0 );
+	testCHECK( ff_rmdir( testRENAME_DIR "/dir" ) == 0 );
+	testCHECK( ff_remove( testRENAME_DIR "/" testNAME_LONG ) == 0 );
+	testCHECK( ff_rmdir( testRENAME_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRename( const char *pcFrom, const char *pcTo )
+{
+char pcOld[ 96 ], pcNew[ 96 ];
+FF_Stat_t xBefore, xAfter;
+
+	snprintf( pcOld, sizeof( pcOld ), testRENAME_DIR "/%s", pcFrom );
+	snprintf( pcNew, sizeof( pcNew ), testRENAME_DIR "/%s", pcTo );
+
+	testCHECK( ff_stat( pcOld, &xBefore ) == 0 );
+	testCHECK( ff_rename( pcOld, pcNew, pdFALSE ) == 0 );
+
+	testCHECK( ff_stat( pcOld, &xAfter ) != 0 );
+	testCHECK( ff_stat( pcNew, &xAfter ) == 0 );
+	testCHECK( ulTestCountEntries( testRENAME_DIR ) == 1 );
+
+	testCHECK( xAfter.st_ino == xBefore.st_ino );
+	testCHECK( xAfter.st_size == xBefore.st_size );
+	testCHECK( xAfter.st_mtime == xBefore.st_mtime );
+	testCHECK( xAfter.st_ctime == xBefore.st_ctime );
+	prvCheck( pcNew );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWrite( const char *pcPath )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcPath, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( testRENAME_TEXT, 1, sizeof( testRENAME_TEXT ), pxFile ) == sizeof( testRENAME_TEXT ) );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheck( const char *pcPath )
+{
+char pcText[ sizeof( testRENAME_TEXT ) ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcPath, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fread( pcText, 1, sizeof( pcText ), pxFile ) == sizeof( pcText ) );
+		testCHECK( memcmp( pcText, testRENAME_TEXT, sizeof( pcText ) ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,239 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The snapshots of ffconfigRAMDISK_SNAPSHOT: after the snapshot is taken, a
+ * file is overwritten in place, a file is removed and another one is created,
+ * some of it after the first part of the snapshot was read out.  The disk
+ * itself must show the changes, the snapshot, mounted in place of the RAM
+ * disk, must show the files as they were.  When the save area runs full the
+ * file system's writes must still succeed, and reading the snapshot must
+ * report that it was lost.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_ramdisk.h"
+
+#include "tests.h"
+
+#define testSNAP_FILE			testDISK_NAME "/snapshot.bin"
+#define testSNAP_REMOVED		testDISK_NAME "/removed.txt"
+#define testSNAP_ADDED			testDISK_NAME "/added.bin"
+
+/* Not a whole number of sectors. */
+#define testSNAP_FILE_SIZE		3000UL
+#define testSNAP_ADDED_SIZE		5000UL
+
+/* The snapshot is read out in two parts, the boot sector and the FATs are
+in the first. */
+#define testSNAP_FIRST_PART		80UL
+
+/* The bitmap of preserved sectors, followed by slots of a sector and its
+number. */
+#define testSNAP_MAP_WORDS		( ( testDISK_SECTORS + 31UL ) / 32UL )
+#define testSNAP_SLOT_WORDS		( ( ffconfigRAMDISK_SECTOR_SIZE + 4UL ) / 4UL )
+#define testSNAP_SLOTS			128UL
+#define testSNAP_FEW_SLOTS		2UL
+
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+
+static uint8_t ucOld[ testSNAP_ADDED_SIZE ];
+static uint8_t ucNew[ testSNAP_ADDED_SIZE ];
+static uint8_t ucImage[ testDISK_SECTORS * ffconfigRAMDISK_SECTOR_SIZE ];
+static uint32_t ulSaveArea[ testSNAP_MAP_WORDS + ( testSNAP_SLOTS * testSNAP_SLOT_WORDS ) ];
+
+/*
+ * Writes the first 'ulLength' bytes of pucData to a file, opened with
+ * pcMode.
+ */
+static void prvWriteFile( const char *pcName, const char *pcMode, const uint8_t *pucData, uint32_t ulLength );
+
+/*
+ * Checks that a file holds exactly the first 'ulLength' bytes of pucData.
+ */
+static void prvCheckFile( const char *pcName, const uint8_t *pucData, uint32_t ulLength );
+
+/*
+ * Reads up to ulSectorCount sectors of the snapshot into ucImage, from
+ * sector ulFirst on.  Returns the sector after the last one read.
+ */
+static uint32_t prvReadSnapshot( FF_Disk_t *pxDisk, uint32_t ulFirst, uint32_t ulSectorCount );
+
+/*
+ * Mounts the snapshot in ucImage at testDISK_NAME, checks the files in it,
+ * and gives testDISK_NAME back to the RAM disk.
+ */
+static void prvCheckImage( FF_Disk_t *pxRAMDisk );
+
+#endif /* ffconfigRAMDISK_SNAPSHOT */
+
+/*-----------------------------------------------------------*/
+
+#if( ffconfigRAMDISK_SNAPSHOT != 0 )
+
+void vTestSnapshot( FF_Disk_t *pxDisk )
+{
+FF_Stat_t xStat;
+uint32_t ulSector, x;
+int32_t lCount;
+
+	for( x = 0; x < testSNAP_ADDED_SIZE; x++ )
+	{
+		ucOld[ x ] = ( uint8_t ) ( ( x * 13 ) + ( x >> 8 ) );
+		ucNew[ x ] = ( uint8_t ) ~ucOld[ x ];
+	}
+
+	prvWriteFile( testSNAP_FILE, "w", ucOld, testSNAP_FILE_SIZE );
+	prvWriteFile( testSNAP_REMOVED, "w", ( const uint8_t * ) testSNAP_REMOVED, sizeof( testSNAP_REMOVED ) );
+	testCHECK( FF_RAMDiskSnapshotStart( pxDisk, ( uint8_t * ) ulSaveArea, sizeof( ulSaveArea ) ) == pdPASS );
+
+	/* Overwritten in place: the same clusters get the new data. */
+	prvWriteFile( testSNAP_FILE, "r+", ucNew, testSNAP_FILE_SIZE );
+	testCHECK( ff_remove( testSNAP_REMOVED ) == 0 );
+	testCHECK( FF_FlushCache( pxDisk->pxIOManager ) == FF_ERR_NONE );
+
+	/* Sectors that were read out are no longer preserved, the others still
+	are. */
+	ulSector = prvReadSnapshot( pxDisk, 0, testSNAP_FIRST_PART );
+	testCHECK( ulSector == testSNAP_FIRST_PART );
+	prvWriteFile( testSNAP_ADDED, "w", ucNew, testSNAP_ADDED_SIZE );
+	testCHECK( FF_FlushCache( pxDisk->pxIOManager ) == FF_ERR_NONE );
+	ulSector = prvReadSnapshot( pxDisk, ulSector, testDISK_SECTORS );
+	testCHECK( ulSector == testDISK_SECTORS );
+	testCHECK( FF_RAMDiskSnapshotRead( pxDisk, ucImage, 1 ) == 0 );
+	testCHECK( FF_RAMDiskSnapshotStop( pxDisk ) == pdPASS );
+
+	/* The disk has the changes. */
+	prvCheckFile( testSNAP_FILE, ucNew, testSNAP_FILE_SIZE );
+	prvCheckFile( testSNAP_ADDED, ucNew, testSNAP_ADDED_SIZE );
+	testCHECK( ff_stat( testSNAP_REMOVED, &xStat ) != 0 );
+
+	if( ulSector == testDISK_SECTORS )
+	{
+		prvCheckImage( pxDisk );
+	}
+
+	/* A save area that runs full loses the snapshot, not the data. */
+	testCHECK( FF_RAMDiskSnapshotStart( pxDisk, ( uint8_t * ) ulSaveArea,
+		( testSNAP_MAP_WORDS + ( testSNAP_FEW_SLOTS * testSNAP_SLOT_WORDS ) ) * sizeof( uint32_t ) ) == pdPASS );
+	prvWriteFile( testSNAP_FILE, "w", ucOld, testSNAP_ADDED_SIZE );
+	testCHECK( FF_FlushCache( pxDisk->pxIOManager ) == FF_ERR_NONE );
+	lCount = FF_RAMDiskSnapshotRead( pxDisk, ucImage, testDISK_SECTORS );
+	testCHECK( FF_isERR( lCount ) != pdFALSE );
+	testCHECK( FF_GETERROR( lCount ) == FF_ERR_IOMAN_NOT_ENOUGH_FREE_SPACE );
+	testCHECK( FF_RAMDiskSnapshotStop( pxDisk ) == pdPASS );
+
+	vTestRemount( pxDisk );
+	prvCheckFile( testSNAP_FILE, ucOld, testSNAP_ADDED_SIZE );
+	prvCheckFile( testSNAP_ADDED, ucNew, testSNAP_ADDED_SIZE );
+
+	testCHECK( ff_remove( testSNAP_FILE ) == 0 );
+	testCHECK( ff_remove( testSNAP_ADDED ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteFile( const char *pcName, const char *pcMode, const uint8_t *pucData, uint32_t ulLength )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, pcMode );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( pucData, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckFile( const char *pcName, const uint8_t *pucData, uint32_t ulLength )
+{
+static uint8_t ucRead[ testSNAP_ADDED_SIZE ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == ulLength );
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, pucData, ulLength ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadSnapshot( FF_Disk_t *pxDisk, uint32_t ulFirst, uint32_t ulSectorCount )
+{
+uint32_t ulSector = ulFirst;
+int32_t lCount;
+
+	if( ulSectorCount > testDISK_SECTORS - ulFirst )
+	{
+		ulSectorCount = testDISK_SECTORS - ulFirst;
+	}
+
+	while( ulSector < ulFirst + ulSectorCount )
+	{
+		lCount = FF_RAMDiskSnapshotRead( pxDisk, ucImage + ( ulSector * ffconfigRAMDISK_SECTOR_SIZE ), ( ulFirst + ulSectorCount ) - ulSector );
+		testCHECK( lCount > 0 );
+		if( lCount <= 0 )
+		{
+			break;
+		}
+		ulSector += ( uint32_t ) lCount;
+	}
+
+	return ulSector;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckImage( FF_Disk_t *pxRAMDisk )
+{
+static char pcDiskName[] = testDISK_NAME;
+FF_Disk_t *pxImageDisk;
+FF_Stat_t xStat;
+
+	pxImageDisk = FF_RAMDiskInitFromImage( pcDiskName, ucImage, testDISK_SECTORS, ucImage, sizeof( ucImage ), testCACHE_SIZE );
+	testCHECK( pxImageDisk != NULL );
+	if( pxImageDisk != NULL )
+	{
+		prvCheckFile( testSNAP_FILE, ucOld, testSNAP_FILE_SIZE );
+		prvCheckFile( testSNAP_REMOVED, ( const uint8_t * ) testSNAP_REMOVED, sizeof( testSNAP_REMOVED ) );
+		testCHECK( ff_stat( testSNAP_ADDED, &xStat ) != 0 );
+
+		testCHECK( FF_FS_Add( testDISK_NAME, pxRAMDisk ) == pdTRUE );
+		testCHECK( FF_Unmount( pxImageDisk ) == FF_ERR_NONE );
+		testCHECK( FF_RAMDiskDelete( pxImageDisk ) == pdPASS );
+	}
+}
+/*-----------------------------------------------------------*/
+
+#else /* ffconfigRAMDISK_SNAPSHOT */
+
+void vTestSnapshot( FF_Disk_t *pxDisk )
+{
+	( void ) pxDisk;
+}
+/*-----------------------------------------------------------*/
+
+#endif /* ffconfigRAMDISK_SNAPSHOT */
@@ -0,0 +1,176 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The stream buffers of ffconfigSTDIO_BUFFERS: a file is written with
+ * ff_fputc() and ff_fwrite() in turn, and read back with ff_fgetc() and
+ * ff_fread() in turn, after ff_setvbuf().  The position must be right all the
+ * way, also after a seek and with two buffered streams used in turn.  A
+ * stream that was closed must not be served from its old buffer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testSTDIO_FILE			testDISK_NAME "/stdio.bin"
+
+/* Not a whole number of buffers or sectors. */
+#define testSTDIO_SIZE			3000UL
+#define testSTDIO_BUFFER		100
+#define testSTDIO_SEEK			1000UL
+#define testSTDIO_TURNS			500UL
+
+static uint8_t ucData[ testSTDIO_SIZE ];
+
+/*
+ * Reads the whole file from pxFile, with ff_fgetc() and ff_fread() in turn.
+ */
+static void prvReadMixed( FF_FILE *pxFile );
+
+/*-----------------------------------------------------------*/
+
+void vTestStdioBuffers( FF_Disk_t *pxDisk )
+{
+static char pcBuffer[ testSTDIO_BUFFER ];
+uint8_t ucRead[ 200 ];
+FF_FILE *pxFile, *pxOther;
+uint32_t ulPosition, ulLength, ulPart, x;
+
+	( void ) pxDisk;
+
+	for( x = 0; x < testSTDIO_SIZE; x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 7 ) + ( x >> 8 ) );
+	}
+
+	/* Written through a buffer of the caller. */
+	pxFile = ff_fopen( testSTDIO_FILE, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+	testCHECK( ff_setvbuf( pxFile, pcBuffer, FF_IOFBF, sizeof( pcBuffer ) ) == 0 );
+
+	ulPosition = 0;
+	ulPart = 1;
+	while( ulPosition < testSTDIO_SIZE )
+	{
+		for( x = 0; ( x < ulPart ) && ( ulPosition < testSTDIO_SIZE ); x++ )
+		{
+			testCHECK( ff_fputc( ucData[ ulPosition ], pxFile ) == ( int ) ucData[ ulPosition ] );
+			ulPosition++;
+		}
+
+		ulLength = ulPart * 11;
+		if( ulLength > testSTDIO_SIZE - ulPosition )
+		{
+			ulLength = testSTDIO_SIZE - ulPosition;
+		}
+		testCHECK( ff_fwrite( ucData + ulPosition, 1, ulLength, pxFile ) == ulLength );
+		ulPosition += ulLength;
+		testCHECK( ff_ftell( pxFile ) == ( long ) ulPosition );
+
+		ulPart = ( ulPart % 37 ) + 5;
+	}
+	testCHECK( ff_fclose( pxFile ) == 0 );
+
+	/* Read back through a buffer of ff_setvbuf(). */
+	pxFile = ff_fopen( testSTDIO_FILE, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+	testCHECK( ff_filelength( pxFile ) == testSTDIO_SIZE );
+	testCHECK( ff_setvbuf( pxFile, NULL, FF_IOFBF, 64 ) == 0 );
+	prvReadMixed( pxFile );
+
+	/* A seek drops what was read ahead. */
+	testCHECK( ff_fseek( pxFile, testSTDIO_SEEK, FF_SEEK_SET ) == 0 );
+	testCHECK( ff_fgetc( pxFile ) == ( int ) ucData[ testSTDIO_SEEK ] );
+	testCHECK( ff_fread( ucRead, 1, sizeof( ucRead ), pxFile ) == sizeof( ucRead ) );
+	testCHECK( memcmp( ucRead, ucData + testSTDIO_SEEK + 1, sizeof( ucRead ) ) == 0 );
+	ulPosition = testSTDIO_SEEK + 1 + sizeof( ucRead );
+	testCHECK( ff_ftell( pxFile ) == ( long ) ulPosition );
+
+	/* Two buffered streams used in turn: each time, the other one was the
+	handle that was checked last. */
+	pxOther = ff_fopen( testSTDIO_FILE, "r" );
+	testCHECK( pxOther != NULL );
+	if( pxOther != NULL )
+	{
+		testCHECK( ff_setvbuf( pxOther, NULL, FF_IOFBF, 64 ) == 0 );
+		for( x = 0; x < testSTDIO_TURNS; x++ )
+		{
+			testCHECK( ff_fgetc( pxFile ) == ( int ) ucData[ ulPosition + x ] );
+			testCHECK( ff_fgetc( pxOther ) == ( int ) ucData[ x ] );
+		}
+		testCHECK( ff_fclose( pxOther ) == 0 );
+	}
+	ulPosition += testSTDIO_TURNS;
+
+	/* The handle is served from its buffer right before it is closed, and
+	refused right after. */
+	testCHECK( ff_fgetc( pxFile ) == ( int ) ucData[ ulPosition ] );
+	testCHECK( pxFFLastValidFile == pxFile );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+	testCHECK( pxFFLastValidFile != pxFile );
+	testCHECK( ff_fgetc( pxFile ) == FF_EOF );
+	testCHECK( stdioGET_ERRNO() != 0 );
+
+	testCHECK( ff_remove( testSTDIO_FILE ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReadMixed( FF_FILE *pxFile )
+{
+static uint8_t ucRead[ testSTDIO_SIZE ];
+uint32_t ulPosition = 0, ulLength, ulPart = 3, x;
+
+	while( ulPosition < testSTDIO_SIZE )
+	{
+		for( x = 0; ( x < ulPart ) && ( ulPosition < testSTDIO_SIZE ); x++ )
+		{
+			testCHECK( ff_fgetc( pxFile ) == ( int ) ucData[ ulPosition ] );
+			ulPosition++;
+		}
+
+		/* Parts that are shorter and longer than the stream buffer. */
+		ulLength = ulPart * 13;
+		if( ulLength > testSTDIO_SIZE - ulPosition )
+		{
+			ulLength = testSTDIO_SIZE - ulPosition;
+		}
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, ucData + ulPosition, ulLength ) == 0 );
+		ulPosition += ulLength;
+		testCHECK( ff_ftell( pxFile ) == ( long ) ulPosition );
+
+		ulPart = ( ulPart % 29 ) + 4;
+	}
+
+	testCHECK( ff_fgetc( pxFile ) == FF_EOF );
+	testCHECK( ff_fread( ucRead, 1, 1, pxFile ) == 0 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,180 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The vectored reads and writes of ff_readv() and ff_writev(): buffers of
+ * all sizes, that start and end anywhere in a sector, are written and read
+ * in order.  Also in the middle of a file, and through a log handle.  A
+ * vector that is too long for the file is refused without writing.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testVECTOR_FILE			testDISK_NAME "/vector.bin"
+#define testVECTOR_LOG_FILE		testDISK_NAME "/vector.log"
+
+#define testVECTOR_SIZE			4000UL
+#define testVECTOR_OFFSET		300UL
+
+static uint8_t ucData[ testVECTOR_SIZE ];
+static uint8_t ucRead[ testVECTOR_SIZE + 100 ];
+
+/* The buffers cross sector boundaries, contain whole sectors, or are empty. */
+static const uint32_t ulWriteParts[] = { 100, 1000, 3, 0, 1500, 1, 1396 };
+static const uint32_t ulReadParts[] = { 511, 2, 1024, 7, 0, 2500 };
+
+/* Overwrites a part in the middle of the file. */
+static const uint32_t ulUpdateParts[] = { 212, 600, 512 };
+
+/*
+ * Fills a vector with the parts, which are taken from pucBuffer one after
+ * the other.  Returns their total length.
+ */
+static uint32_t prvMakeVector( FF_IOVec_t *pxVector, const uint32_t *pulParts, BaseType_t xCount, uint8_t *pucBuffer );
+
+/*
+ * Checks that pcName holds the first 'ulLength' bytes of ucData.
+ */
+static void prvCheckContents( const char *pcName, uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+void vTestVectorIO( FF_Disk_t *pxDisk )
+{
+FF_IOVec_t xVector[ 8 ];
+FF_FILE *pxFile;
+uint32_t ulTotal;
+size_t x;
+
+	( void ) pxDisk;
+
+	for( x = 0; x < sizeof( ucData ); x++ )
+	{
+		ucData[ x ] = ( uint8_t ) ( ( x * 29 ) + ( x >> 9 ) );
+	}
+
+	/* Write the file in uneven parts. */
+	pxFile = ff_fopen( testVECTOR_FILE, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+
+	ulTotal = prvMakeVector( xVector, ulWriteParts, sizeof( ulWriteParts ) / sizeof( ulWriteParts[ 0 ] ), ucData );
+	testCHECK( ulTotal == testVECTOR_SIZE );
+	testCHECK( ff_writev( pxFile, xVector, sizeof( ulWriteParts ) / sizeof( ulWriteParts[ 0 ] ) ) == ( int32_t ) ulTotal );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+	prvCheckContents( testVECTOR_FILE, testVECTOR_SIZE );
+
+	/* Read it back in other parts, the last one goes beyond the end. */
+	pxFile = ff_fopen( testVECTOR_FILE, "r+" );
+	testCHECK( pxFile != NULL );
+	if( pxFile == NULL )
+	{
+		return;
+	}
+
+	memset( ucRead, '\0', sizeof( ucRead ) );
+	ulTotal = prvMakeVector( xVector, ulReadParts, sizeof( ulReadParts ) / sizeof( ulReadParts[ 0 ] ), ucRead );
+	testCHECK( ulTotal > testVECTOR_SIZE );
+	testCHECK( ff_readv( pxFile, xVector, sizeof( ulReadParts ) / sizeof( ulReadParts[ 0 ] ) ) == ( int32_t ) testVECTOR_SIZE );
+	testCHECK( memcmp( ucRead, ucData, testVECTOR_SIZE ) == 0 );
+	testCHECK( ff_readv( pxFile, xVector, 1 ) == 0 );
+
+	/* Overwrite a part in the middle, with new data. */
+	for( x = testVECTOR_OFFSET; x < sizeof( ucData ); x++ )
+	{
+		ucData[ x ] ^= 0x5a;
+	}
+
+	testCHECK( ff_fseek( pxFile, ( long ) testVECTOR_OFFSET, FF_SEEK_SET ) == 0 );
+	ulTotal = prvMakeVector( xVector, ulUpdateParts, sizeof( ulUpdateParts ) / sizeof( ulUpdateParts[ 0 ] ), ucData + testVECTOR_OFFSET );
+	testCHECK( ff_writev( pxFile, xVector, sizeof( ulUpdateParts ) / sizeof( ulUpdateParts[ 0 ] ) ) == ( int32_t ) ulTotal );
+	testCHECK( ff_ftell( pxFile ) == ( long ) ( testVECTOR_OFFSET + ulTotal ) );
+
+	/* A vector of more than 2 GB is refused, nothing is written.  The sum of
+	these lengths would wrap around to 1. */
+	xVector[ 0 ].ulLength = 0xFFFFFFFFul;
+	xVector[ 1 ].ulLength = 2ul;
+	testCHECK( ff_writev( pxFile, xVector, 2 ) == -1 );
+	testCHECK( stdioGET_ERRNO() == pdFREERTOS_ERRNO_ENOSPC );
+	testCHECK( ff_ftell( pxFile ) == ( long ) ( testVECTOR_OFFSET + ulTotal ) );
+	testCHECK( ff_fclose( pxFile ) == 0 );
+
+	/* Put the old data back for the rest of the file. */
+	for( x = testVECTOR_OFFSET + ulTotal; x < sizeof( ucData ); x++ )
+	{
+		ucData[ x ] ^= 0x5a;
+	}
+	prvCheckContents( testVECTOR_FILE, testVECTOR_SIZE );
+
+	/* A log handle appends the same parts. */
+	pxFile = ff_fopen( testVECTOR_LOG_FILE, "l" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		ulTotal = prvMakeVector( xVector, ulWriteParts, sizeof( ulWriteParts ) / sizeof( ulWriteParts[ 0 ] ), ucData );
+		testCHECK( ff_writev( pxFile, xVector, sizeof( ulWriteParts ) / sizeof( ulWriteParts[ 0 ] ) ) == ( int32_t ) ulTotal );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+	prvCheckContents( testVECTOR_LOG_FILE, testVECTOR_SIZE );
+
+	testCHECK( ff_remove( testVECTOR_FILE ) == 0 );
+	testCHECK( ff_remove( testVECTOR_LOG_FILE ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMakeVector( FF_IOVec_t *pxVector, const uint32_t *pulParts, BaseType_t xCount, uint8_t *pucBuffer )
+{
+uint32_t ulTotal = 0;
+BaseType_t x;
+
+	for( x = 0; x < xCount; x++ )
+	{
+		pxVector[ x ].pvBuffer = pucBuffer + ulTotal;
+		pxVector[ x ].ulLength = pulParts[ x ];
+		ulTotal += pulParts[ x ];
+	}
+
+	return ulTotal;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckContents( const char *pcName, uint32_t ulLength )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		memset( ucRead, '\0', sizeof( ucRead ) );
+		testCHECK( ff_filelength( pxFile ) == ulLength );
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, ucData, ulLength ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,115 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The wild-cards of ffconfigFINDAPI_ALLOW_WILDCARDS: ff_findfirst() with a
+ * pattern lists the matching entries of a directory, both long names and
+ * plain 8.3 names.  A pattern that ends in ':' lists the other entries, and
+ * a path without a wild-card still lists the whole directory.
+ */
+
+#include <stdio.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+
+#include "tests.h"
+
+#define testWILD_DIR			testDISK_NAME "/wild"
+
+static const char * const pcWildNames[] =
+{
+	"readme.txt",
+	"notes.TXT",
+	"LOG0001.TXT",
+	"log-file-0002.txt",
+	"abc.bin",
+	"aXc long name.bin",
+	"data.tar.gz",
+	"a.b",
+};
+
+#define testWILD_FILES			( sizeof( pcWildNames ) / sizeof( pcWildNames[ 0 ] ) )
+
+/*-----------------------------------------------------------*/
+
+void vTestWildCards( FF_Disk_t *pxDisk )
+{
+FF_FILE *pxFile;
+char pcName[ 64 ];
+size_t x;
+
+	( void ) pxDisk;
+
+	testCHECK( ff_mkdir( testWILD_DIR ) == 0 );
+
+	for( x = 0; x < testWILD_FILES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testWILD_DIR "/%s", pcWildNames[ x ] );
+		pxFile = ff_fopen( pcName, "w" );
+		testCHECK( pxFile != NULL );
+		if( pxFile != NULL )
+		{
+			testCHECK( ff_fclose( pxFile ) == 0 );
+		}
+	}
+
+	/* Without a wild-card the path is the directory to list. */
+	testCHECK( ulTestCountEntries( testWILD_DIR ) == testWILD_FILES );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*" ) == testWILD_FILES );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/**" ) == testWILD_FILES );
+
+	/* A literal suffix, in either case when the case is ignored. */
+	#if( ffconfigWILDCARD_CASE_INSENSITIVE != 0 )
+	{
+		testCHECK( ulTestCountEntries( testWILD_DIR "/*.txt" ) == 4 );
+		testCHECK( ulTestCountEntries( testWILD_DIR "/*.TXT" ) == 4 );
+		testCHECK( ulTestCountEntries( testWILD_DIR "/LOG*" ) == 2 );
+	}
+	#else
+	{
+		testCHECK( ulTestCountEntries( testWILD_DIR "/*.txt" ) == 2 );
+		testCHECK( ulTestCountEntries( testWILD_DIR "/*.TXT" ) == 2 );
+		testCHECK( ulTestCountEntries( testWILD_DIR "/LOG*" ) == 1 );
+	}
+	#endif
+
+	/* '?' takes exactly one character, the segments between stars are found
+	in order. */
+	testCHECK( ulTestCountEntries( testWILD_DIR "/a?c*" ) == 2 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/?.?" ) == 1 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*.*.*" ) == 1 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*f*0*2*" ) == 1 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*long*name*" ) == 1 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*name*long*" ) == 0 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/readme.tx?" ) == 1 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/readme.txt?" ) == 0 );
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*.doc" ) == 0 );
+
+	/* The inverted pattern. */
+	testCHECK( ulTestCountEntries( testWILD_DIR "/*.bin:" ) == testWILD_FILES - 2 );
+
+	for( x = 0; x < testWILD_FILES; x++ )
+	{
+		snprintf( pcName, sizeof( pcName ), testWILD_DIR "/%s", pcWildNames[ x ] );
+		testCHECK( ff_remove( pcName ) == 0 );
+	}
+
+	testCHECK( ff_rmdir( testWILD_DIR ) == 0 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,171 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * The compressed RAM disk of ff_zramdisk.c: a text file that is twice as big
+ * as the arena and a file that does not compress are written, and read back
+ * after the page cache was flushed and the disk was mounted again, so every
+ * page is decompressed.  Then a file that does not compress is written until
+ * the arena is full: the write must fail with ENOSPC, and the files that were
+ * already on the disk must still read back after another remount.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "ff_headers.h"
+#include "ff_stdio.h"
+#include "ff_zramdisk.h"
+
+#include "tests.h"
+
+#define testZRAM_TEXT			testDISK_NAME "/text.txt"
+#define testZRAM_RANDOM			testDISK_NAME "/random.bin"
+#define testZRAM_FULL			testDISK_NAME "/full.bin"
+
+/* The arena that holds the disk, which is as big as the RAM disk. */
+#define testZRAM_ARENA			( 96UL * 1024UL )
+
+/* The text only fits when it is compressed. */
+#define testZRAM_TEXT_SIZE		( 2UL * testZRAM_ARENA )
+#define testZRAM_RANDOM_SIZE	( 10UL * 1024UL )
+
+/* The full file is written in parts, up to more than the arena holds. */
+#define testZRAM_PART			4096UL
+#define testZRAM_FULL_SIZE		( 2UL * testZRAM_ARENA )
+
+static uint8_t ucArena[ testZRAM_ARENA ];
+static uint8_t ucText[ testZRAM_TEXT_SIZE ];
+static uint8_t ucRandom[ testZRAM_FULL_SIZE ];
+
+/*
+ * Checks that a file holds exactly the first 'ulLength' bytes of pucData.
+ */
+static void prvCheckFile( const char *pcName, const uint8_t *pucData, uint32_t ulLength );
+
+/*
+ * Writes the first 'ulLength' bytes of pucData to a new file.
+ */
+static void prvWriteFile( const char *pcName, const uint8_t *pucData, uint32_t ulLength );
+
+/*-----------------------------------------------------------*/
+
+void vTestZRAMDisk( FF_Disk_t *pxDisk )
+{
+static char pcDiskName[] = testDISK_NAME;
+FF_Disk_t *pxZRAMDisk;
+FF_FILE *pxFile;
+uint32_t ulLength, ulRandom = 0x12345678UL;
+size_t xWritten;
+char pcLine[ 64 ];
+
+	/* Lines that differ in a few characters, and bytes that do not compress. */
+	for( ulLength = 0; ulLength < testZRAM_TEXT_SIZE; ulLength += ( uint32_t ) strlen( pcLine ) )
+	{
+		snprintf( pcLine, sizeof( pcLine ), "record %05lu: voltage %s, mode %lu\n", ( unsigned long ) ( ulLength / 37 ),
+			( ( ulLength % 3 ) == 0 ) ? "low" : "nominal", ( unsigned long ) ( ulLength % 5 ) );
+		memcpy( ucText + ulLength, pcLine, ( strlen( pcLine ) < testZRAM_TEXT_SIZE - ulLength ) ? strlen( pcLine ) : testZRAM_TEXT_SIZE - ulLength );
+	}
+	for( ulLength = 0; ulLength < testZRAM_FULL_SIZE; ulLength++ )
+	{
+		ulRandom = ( ulRandom * 1103515245UL ) + 12345UL;
+		ucRandom[ ulLength ] = ( uint8_t ) ( ulRandom >> 16 );
+	}
+
+	pxZRAMDisk = FF_ZRAMDiskInit( pcDiskName, ucArena, sizeof( ucArena ), testDISK_SECTORS, testCACHE_SIZE );
+	testCHECK( ( pxZRAMDisk != NULL ) && ( pxZRAMDisk->xStatus.bIsMounted != pdFALSE ) );
+	if( ( pxZRAMDisk == NULL ) || ( pxZRAMDisk->xStatus.bIsMounted == pdFALSE ) )
+	{
+		if( pxZRAMDisk != NULL )
+		{
+			FF_ZRAMDiskDelete( pxZRAMDisk );
+		}
+		return;
+	}
+
+	prvWriteFile( testZRAM_TEXT, ucText, testZRAM_TEXT_SIZE );
+	prvWriteFile( testZRAM_RANDOM, ucRandom, testZRAM_RANDOM_SIZE );
+
+	/* Every page is read back from the arena. */
+	testCHECK( FF_ZRAMDiskFlush( pxZRAMDisk ) == pdPASS );
+	vTestRemount( pxZRAMDisk );
+	prvCheckFile( testZRAM_TEXT, ucText, testZRAM_TEXT_SIZE );
+	prvCheckFile( testZRAM_RANDOM, ucRandom, testZRAM_RANDOM_SIZE );
+	testCHECK( FF_ZRAMDiskShowStats( pxZRAMDisk ) == pdPASS );
+
+	/* Fill the arena. */
+	pxFile = ff_fopen( testZRAM_FULL, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		for( ulLength = 0; ulLength < testZRAM_FULL_SIZE; ulLength += testZRAM_PART )
+		{
+			xWritten = ff_fwrite( ucRandom + ulLength, 1, testZRAM_PART, pxFile );
+			if( xWritten != testZRAM_PART )
+			{
+				break;
+			}
+		}
+		testCHECK( ulLength < testZRAM_FULL_SIZE );
+		testCHECK( stdioGET_ERRNO() == pdFREERTOS_ERRNO_ENOSPC );
+		( void ) ff_fclose( pxFile );
+	}
+
+	/* What was on the disk is still there. */
+	testCHECK( FF_ZRAMDiskFlush( pxZRAMDisk ) == pdPASS );
+	vTestRemount( pxZRAMDisk );
+	prvCheckFile( testZRAM_TEXT, ucText, testZRAM_TEXT_SIZE );
+	prvCheckFile( testZRAM_RANDOM, ucRandom, testZRAM_RANDOM_SIZE );
+
+	/* Give testDISK_NAME back to the RAM disk of the tests. */
+	testCHECK( FF_FS_Add( testDISK_NAME, pxDisk ) == pdTRUE );
+	testCHECK( FF_Unmount( pxZRAMDisk ) == FF_ERR_NONE );
+	testCHECK( FF_ZRAMDiskDelete( pxZRAMDisk ) == pdPASS );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteFile( const char *pcName, const uint8_t *pucData, uint32_t ulLength )
+{
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "w" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_fwrite( pucData, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckFile( const char *pcName, const uint8_t *pucData, uint32_t ulLength )
+{
+static uint8_t ucRead[ testZRAM_TEXT_SIZE ];
+FF_FILE *pxFile;
+
+	pxFile = ff_fopen( pcName, "r" );
+	testCHECK( pxFile != NULL );
+	if( pxFile != NULL )
+	{
+		testCHECK( ff_filelength( pxFile ) == ulLength );
+		testCHECK( ff_fread( ucRead, 1, ulLength, pxFile ) == ulLength );
+		testCHECK( memcmp( ucRead, pucData, ulLength ) == 0 );
+		testCHECK( ff_fclose( pxFile ) == 0 );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,81 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ * Declarations shared by the tests of the host build ('make test').
+ */
+
+#ifndef _TESTS_H_
+#define _TESTS_H_
+
+#include <stdio.h>
+
+#include <FreeRTOS.h>
+
+#include "ff_headers.h"
+
+/* Where test_main.c mounts the RAM disk that the tests use. */
+#define testDISK_NAME		"/ram"
+
+/* The RAM disk of the tests: 4 MB with 512-byte sectors. */
+#define testDISK_SECTORS	( ( 4UL * 1024UL * 1024UL ) / ffconfigRAMDISK_SECTOR_SIZE )
+#define testCACHE_SIZE		( 16UL * ffconfigRAMDISK_SECTOR_SIZE )
+
+/* Counts a failure and tells where it happened, the test goes on. */
+#define testCHECK( x )																	\
+	do																					\
+	{																					\
+		if( !( x ) )																	\
+		{																				\
+			printf( "  FAILED %s:%d: %s\n", __FILE__, __LINE__, #x );					\
+			ulTestFailures++;															\
+		}																				\
+	} while( 0 )
+
+extern volatile uint32_t ulTestFailures;
+
+/* Unmounts the disk and mounts it again, with an empty cache.  No file may be
+open. */
+void vTestRemount( FF_Disk_t *pxDisk );
+
+/* Returns the number of entries in a directory, without "." and "..". */
+uint32_t ulTestCountEntries( const char *pcDirectory );
+
+/* The tests, called one at a time from a task, with the RAM disk mounted. */
+void vTestHandles( FF_Disk_t *pxDisk );
+void vTestBlockQueue( FF_Disk_t *pxDisk );
+void vTestFileDisk( FF_Disk_t *pxDisk );
+void vTestLatency( FF_Disk_t *pxDisk );
+void vTestDirentHints( FF_Disk_t *pxDisk );
+void vTestDirectoryLocks( FF_Disk_t *pxDisk );
+void vTestDeferredDirent( FF_Disk_t *pxDisk );
+void vTestRename( FF_Disk_t *pxDisk );
+void vTestWildCards( FF_Disk_t *pxDisk );
+void vTestBorrow( FF_Disk_t *pxDisk );
+void vTestMapFile( FF_Disk_t *pxDisk );
+void vTestVectorIO( FF_Disk_t *pxDisk );
+void vTestAIO( FF_Disk_t *pxDisk );
+void vTestStdioBuffers( FF_Disk_t *pxDisk );
+void vTestCopyFile( FF_Disk_t *pxDisk );
+void vTestLogFile( FF_Disk_t *pxDisk );
+void vTestParallelReads( FF_Disk_t *pxDisk );
+void vTestHandlePool( FF_Disk_t *pxDisk );
+void vTestCacheMap( FF_Disk_t *pxDisk );
+void vTestLazyZero( FF_Disk_t *pxDisk );
+void vTestReentrantDisk( FF_Disk_t *pxDisk );
+void vTestZRAMDisk( FF_Disk_t *pxDisk );
+void vTestSnapshot( FF_Disk_t *pxDisk );
+
+#endif /* _TESTS_H_ */
@@ -0,0 +1,674 @@
+/*
+Copyright 2013, Jernej Kovacic
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * mkfatimage - host side tool that builds a ready-to-mount FAT16 disk image.
+ *
+ * The image has the same shape as the one FF_RAMDiskInit() creates at run
+ * time: an MBR with a single primary partition that starts after a few hidden
+ * sectors.  Every path given on the command line is added to the root
+ * directory under its own base name (just like 'tar cf'), directories are
+ * added recursively.  Clusters are handed out in a single forward sweep, so
+ * each directory and each file occupies one contiguous run of clusters.
+ *
+ * Only the used part of the disk is written: the image stops after the last
+ * allocated cluster.  The free clusters at the end of the disk never have to
+ * be read by FreeRTOS+FAT before they are written, so FF_RAMDiskInitFromImage()
+ * does not have to clear them either.
+ *
+ * Usage: mkfatimage [-n sectors] [-h hidden] -o image path...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define mkfatSECTOR_SIZE			512u
+#define mkfatDEFAULT_SECTORS		10240u	/* 5 MB, as in startup/ramdisk.c */
+#define mkfatDEFAULT_HIDDEN			8u		/* ramHIDDEN_SECTOR_COUNT */
+#define mkfatRESERVED_SECTORS		1u
+#define mkfatNUMBER_OF_FATS			2u
+#define mkfatROOT_ENTRIES			512u
+#define mkfatENTRY_SIZE				32u
+#define mkfatLFN_CHARS				13u
+#define mkfatMAX_NAME				255u
+
+#define mkfatMIN_FAT16_CLUSTERS		4085u
+#define mkfatMAX_FAT16_CLUSTERS		65524u
+
+#define mkfatATTR_DIR				0x10u
+#define mkfatATTR_ARCHIVE			0x20u
+#define mkfatATTR_LFN				0x0Fu
+#define mkfatCASE_LOWER_BASE		0x08u
+#define mkfatCASE_LOWER_EXT			0x10u
+
+typedef struct
+{
+	uint32_t ulPartitionSectors;
+	uint32_t ulHiddenSectors;
+	uint32_t ulSectorsPerCluster;
+	uint32_t ulSectorsPerFAT;
+	uint32_t ulRootSectors;
+	uint32_t ulFirstDataSector;	/* Relative to the start of the partition. */
+	uint32_t ulClusterCount;
+	uint32_t ulNextFreeCluster;
+	uint8_t *pucDisk;			/* The whole disk, including the hidden sectors. */
+	uint8_t *pucPartition;
+} Volume_t;
+
+/* A directory that is being filled: where its entries go, and the short
+names already used in it. */
+typedef struct
+{
+	uint8_t *pucEntries;
+	uint32_t ulEntryCount;
+	uint32_t ulUsed;
+} DirWriter_t;
+
+static void prvFatal( const char *pcMessage, const char *pcArgument )
+{
+	fprintf( stderr, "mkfatimage: %s%s%s\n", pcMessage, pcArgument ? ": " : "", pcArgument ? pcArgument : "" );
+	exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutShort( uint8_t *pucBuffer, uint32_t ulOffset, uint32_t ulValue )
+{
+	pucBuffer[ ulOffset + 0 ] = ( uint8_t ) ( ulValue );
+	pucBuffer[ ulOffset + 1 ] = ( uint8_t ) ( ulValue >> 8 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutLong( uint8_t *pucBuffer, uint32_t ulOffset, uint32_t ulValue )
+{
+	prvPutShort( pucBuffer, ulOffset, ulValue & 0xFFFFu );
+	prvPutShort( pucBuffer, ulOffset + 2, ulValue >> 16 );
+}
+/*-----------------------------------------------------------*/
+
+/* Pick the smallest cluster size that keeps the volume a valid FAT16, and size
+the FATs to match. */
+static void prvComputeGeometry( Volume_t *pxVolume )
+{
+uint32_t ulSectorsPerCluster, ulSectorsPerFAT, ulClusters, ulAvailable;
+
+	pxVolume->ulRootSectors = ( mkfatROOT_ENTRIES * mkfatENTRY_SIZE ) / mkfatSECTOR_SIZE;
+
+	for( ulSectorsPerCluster = 1; ulSectorsPerCluster <= 128; ulSectorsPerCluster <<= 1 )
+	{
+		ulSectorsPerFAT = 1;
+		for( ;; )
+		{
+			ulAvailable = pxVolume->ulPartitionSectors - mkfatRESERVED_SECTORS - pxVolume->ulRootSectors - ( mkfatNUMBER_OF_FATS * ulSectorsPerFAT );
+			ulClusters = ulAvailable / ulSectorsPerCluster;
+			if( ( ( ulClusters + 2 ) * 2 ) <= ( ulSectorsPerFAT * mkfatSECTOR_SIZE ) )
+			{
+				break;
+			}
+			ulSectorsPerFAT++;
+		}
+
+		if( ulClusters <= mkfatMAX_FAT16_CLUSTERS )
+		{
+			break;
+		}
+	}
+
+	if( ( ulClusters < mkfatMIN_FAT16_CLUSTERS ) || ( ulClusters > mkfatMAX_FAT16_CLUSTERS ) )
+	{
+		prvFatal( "disk size does not make a FAT16 volume", NULL );
+	}
+
+	pxVolume->ulSectorsPerCluster = ulSectorsPerCluster;
+	pxVolume->ulSectorsPerFAT = ulSectorsPerFAT;
+	pxVolume->ulClusterCount = ulClusters;
+	pxVolume->ulFirstDataSector = mkfatRESERVED_SECTORS + ( mkfatNUMBER_OF_FATS * ulSectorsPerFAT ) + pxVolume->ulRootSectors;
+	pxVolume->ulNextFreeCluster = 2;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteMBRAndBootSector( Volume_t *pxVolume )
+{
+uint8_t *pucMBR = pxVolume->pucDisk;
+uint8_t *pucBoot = pxVolume->pucPartition;
+uint8_t *pucFAT = pucBoot + ( mkfatRESERVED_SECTORS * mkfatSECTOR_SIZE );
+uint32_t ulTotal = pxVolume->ulHiddenSectors + pxVolume->ulPartitionSectors;
+
+	/* A single primary partition, addressed by LBA only. */
+	pucMBR[ 0x1BE + 0 ] = 0x00;
+	pucMBR[ 0x1BE + 1 ] = 0xFE;
+	pucMBR[ 0x1BE + 2 ] = 0xFF;
+	pucMBR[ 0x1BE + 3 ] = 0xFF;
+	pucMBR[ 0x1BE + 4 ] = ( pxVolume->ulPartitionSectors < 65536u ) ? 0x04 : 0x06;
+	pucMBR[ 0x1BE + 5 ] = 0xFE;
+	pucMBR[ 0x1BE + 6 ] = 0xFF;
+	pucMBR[ 0x1BE + 7 ] = 0xFF;
+	prvPutLong( pucMBR, 0x1BE + 8, pxVolume->ulHiddenSectors );
+	prvPutLong( pucMBR, 0x1BE + 12, pxVolume->ulPartitionSectors );
+	pucMBR[ 510 ] = 0x55;
+	pucMBR[ 511 ] = 0xAA;
+
+	pucBoot[ 0 ] = 0xEB;
+	pucBoot[ 1 ] = 0x3C;
+	pucBoot[ 2 ] = 0x90;
+	memcpy( pucBoot + 3, "MKFATIMG", 8 );
+	prvPutShort( pucBoot, 11, mkfatSECTOR_SIZE );
+	pucBoot[ 13 ] = ( uint8_t ) pxVolume->ulSectorsPerCluster;
+	prvPutShort( pucBoot, 14, mkfatRESERVED_SECTORS );
+	pucBoot[ 16 ] = mkfatNUMBER_OF_FATS;
+	prvPutShort( pucBoot, 17, mkfatROOT_ENTRIES );
+	if( pxVolume->ulPartitionSectors < 65536u )
+	{
+		prvPutShort( pucBoot, 19, pxVolume->ulPartitionSectors );
+	}
+	else
+	{
+		prvPutLong( pucBoot, 32, pxVolume->ulPartitionSectors );
+	}
+	pucBoot[ 21 ] = 0xF8;
+	prvPutShort( pucBoot, 22, pxVolume->ulSectorsPerFAT );
+	prvPutShort( pucBoot, 24, 63 );
+	prvPutShort( pucBoot, 26, 255 );
+	prvPutLong( pucBoot, 28, pxVolume->ulHiddenSectors );
+	pucBoot[ 36 ] = 0x80;
+	pucBoot[ 38 ] = 0x29;
+	prvPutLong( pucBoot, 39, ulTotal * 0x9E3779B1u );
+	memcpy( pucBoot + 43, "RAMDISK    ", 11 );
+	memcpy( pucBoot + 54, "FAT16   ", 8 );
+	pucBoot[ 510 ] = 0x55;
+	pucBoot[ 511 ] = 0xAA;
+
+	/* Media byte and end-of-chain marker in the two reserved FAT entries. */
+	prvPutShort( pucFAT, 0, 0xFFF8 );
+	prvPutShort( pucFAT, 2, 0xFFFF );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t *prvClusterAddress( Volume_t *pxVolume, uint32_t ulCluster )
+{
+	return pxVolume->pucPartition + ( ( pxVolume->ulFirstDataSector + ( ( ulCluster - 2 ) * pxVolume->ulSectorsPerCluster ) ) * mkfatSECTOR_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+/* Claim a contiguous run of clusters large enough for ulBytes and chain them
+in the first FAT.  Returns 0 for an empty file. */
+static uint32_t prvAllocateRun( Volume_t *pxVolume, uint64_t ullBytes )
+{
+uint32_t ulClusterSize = pxVolume->ulSectorsPerCluster * mkfatSECTOR_SIZE;
+uint32_t ulCount, ulFirst, ulIndex;
+uint8_t *pucFAT = pxVolume->pucPartition + ( mkfatRESERVED_SECTORS * mkfatSECTOR_SIZE );
+
+	ulCount = ( uint32_t ) ( ( ullBytes + ulClusterSize - 1 ) / ulClusterSize );
+	if( ulCount == 0 )
+	{
+		return 0;
+	}
+
+	ulFirst = pxVolume->ulNextFreeCluster;
+	if( ( ulFirst - 2 ) + ulCount > pxVolume->ulClusterCount )
+	{
+		prvFatal( "disk full", NULL );
+	}
+
+	for( ulIndex = 0; ulIndex < ulCount; ulIndex++ )
+	{
+		prvPutShort( pucFAT, ( ulFirst + ulIndex ) * 2, ( ulIndex + 1 < ulCount ) ? ( ulFirst + ulIndex + 1 ) : 0xFFFF );
+	}
+	pxVolume->ulNextFreeCluster += ulCount;
+
+	return ulFirst;
+}
+/*-----------------------------------------------------------*/
+
+static int prvIsShortNameChar( int c )
+{
+	return ( isalnum( c ) != 0 ) || ( ( c > 127 ) ) || ( strchr( "$%'-_@~`!(){}^#&", c ) != NULL );
+}
+/*-----------------------------------------------------------*/
+
+/* Returns non-zero if pcName fits in an 8.3 entry as it is, apart from its
+case.  The case flags are returned for names that are all lower case in
+either part; mixed case names always get a long name. */
+static int prvFitsShortName( const char *pcName, uint8_t pucShort[ 11 ], uint8_t *pucCase )
+{
+const char *pcDot = strchr( pcName, '.' );
+size_t xBaseLength = pcDot ? ( size_t ) ( pcDot - pcName ) : strlen( pcName );
+size_t xExtLength = pcDot ? strlen( pcDot + 1 ) : 0;
+int iUpper[ 2 ] = { 0, 0 }, iLower[ 2 ] = { 0, 0 };
+size_t x;
+
+	if( ( xBaseLength == 0 ) || ( xBaseLength > 8 ) || ( xExtLength > 3 ) ||
+		( ( pcDot != NULL ) && ( ( xExtLength == 0 ) || ( strchr( pcDot + 1, '.' ) != NULL ) ) ) )
+	{
+		return 0;
+	}
+
+	memset( pucShort, ' ', 11 );
+	for( x = 0; x < xBaseLength + ( pcDot ? xExtLength + 1 : 0 ); x++ )
+	{
+		int c = ( unsigned char ) pcName[ x ];
+		int iPart = ( x > xBaseLength );
+
+		if( x == xBaseLength )
+		{
+			continue;
+		}
+		if( prvIsShortNameChar( c ) == 0 )
+		{
+			return 0;
+		}
+		iUpper[ iPart ] |= ( isupper( c ) != 0 );
+		iLower[ iPart ] |= ( islower( c ) != 0 );
+		pucShort[ iPart ? ( 8 + x - xBaseLength - 1 ) : x ] = ( uint8_t ) toupper( c );
+	}
+
+	if( ( iUpper[ 0 ] && iLower[ 0 ] ) || ( iUpper[ 1 ] && iLower[ 1 ] ) )
+	{
+		return 0;
+	}
+
+	*pucCase = ( uint8_t ) ( ( iLower[ 0 ] ? mkfatCASE_LOWER_BASE : 0 ) | ( iLower[ 1 ] ? mkfatCASE_LOWER_EXT : 0 ) );
+	return 1;
+}
+/*-----------------------------------------------------------*/
+
+static int prvShortNameUsed( const DirWriter_t *pxDir, const uint8_t pucShort[ 11 ] )
+{
+uint32_t ulIndex;
+
+	for( ulIndex = 0; ulIndex < pxDir->ulUsed; ulIndex++ )
+	{
+		const uint8_t *pucEntry = pxDir->pucEntries + ( ulIndex * mkfatENTRY_SIZE );
+
+		if( ( pucEntry[ 11 ] != mkfatATTR_LFN ) && ( memcmp( pucEntry, pucShort, 11 ) == 0 ) )
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+/* Make a 'BASE~N.EXT' alias for a name that needs a long name entry. */
+static void prvMakeAlias( const DirWriter_t *pxDir, const char *pcName, uint8_t pucShort[ 11 ] )
+{
+const char *pcDot = strrchr( pcName, '.' );
+char pcBase[ 9 ], pcTail[ 9 ];
+size_t xBaseLength = 0, xExt = 0;
+const char *pc;
+unsigned uNumber;
+
+	if( pcDot == pcName )
+	{
+		pcDot = NULL;
+	}
+
+	memset( pucShort, ' ', 11 );
+	for( pc = pcName; ( *pc != '\0' ) && ( pc != pcDot ) && ( xBaseLength < 6 ); pc++ )
+	{
+		if( prvIsShortNameChar( ( unsigned char ) *pc ) != 0 )
+		{
+			pcBase[ xBaseLength++ ] = ( char ) toupper( ( unsigned char ) *pc );
+		}
+	}
+	if( xBaseLength == 0 )
+	{
+		pcBase[ xBaseLength++ ] = '_';
+	}
+	pcBase[ xBaseLength ] = '\0';
+
+	for( pc = pcDot ? pcDot + 1 : "" ; ( *pc != '\0' ) && ( xExt < 3 ); pc++ )
+	{
+		if( prvIsShortNameChar( ( unsigned char ) *pc ) != 0 )
+		{
+			pucShort[ 8 + xExt++ ] = ( uint8_t ) toupper( ( unsigned char ) *pc );
+		}
+	}
+
+	for( uNumber = 1; uNumber < 1000000u; uNumber++ )
+	{
+		size_t xTail = ( size_t ) snprintf( pcTail, sizeof( pcTail ), "~%u", uNumber );
+		size_t xKeep = ( xBaseLength + xTail > 8 ) ? ( 8 - xTail ) : xBaseLength;
+
+		memset( pucShort, ' ', 8 );
+		memcpy( pucShort, pcBase, xKeep );
+		memcpy( pucShort + xKeep, pcTail, xTail );
+		if( prvShortNameUsed( pxDir, pucShort ) == 0 )
+		{
+			return;
+		}
+	}
+
+	prvFatal( "no free short name for", pcName );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t prvShortNameChecksum( const uint8_t pucShort[ 11 ] )
+{
+uint8_t ucSum = 0;
+int i;
+
+	for( i = 0; i < 11; i++ )
+	{
+		ucSum = ( uint8_t ) ( ( ( ucSum & 1 ) << 7 ) + ( ucSum >> 1 ) + pucShort[ i ] );
+	}
+
+	return ucSum;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvLongNameEntries( const char *pcName )
+{
+uint8_t pucShort[ 11 ], ucCase;
+int iPlainUpper = ( prvFitsShortName( pcName, pucShort, &ucCase ) != 0 ) && ( ucCase == 0 );
+
+	/* Anything but a plain upper case 8.3 name also gets a long name, so that
+	the name reads back exactly as it was given, whatever the setting of
+	ffconfigSHORTNAME_CASE. */
+	return iPlainUpper ? 0 : ( uint32_t ) ( ( strlen( pcName ) + mkfatLFN_CHARS - 1 ) / mkfatLFN_CHARS );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t *prvNextEntry( DirWriter_t *pxDir )
+{
+	if( pxDir->ulUsed >= pxDir->ulEntryCount )
+	{
+		prvFatal( "directory full", NULL );
+	}
+
+	return pxDir->pucEntries + ( pxDir->ulUsed++ * mkfatENTRY_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddEntry( DirWriter_t *pxDir, const char *pcName, const uint8_t pucFixedShort[ 11 ],
+	uint8_t ucAttributes, uint32_t ulCluster, uint32_t ulSize, time_t xTime )
+{
+uint8_t pucShort[ 11 ], ucCase = 0, ucSum;
+uint32_t ulLongEntries = 0, ulOrdinal, ulChar;
+size_t xNameLength;
+uint8_t *pucEntry;
+struct tm *pxTime = gmtime( &xTime );
+uint32_t ulDate = 0x0021, ulTime = 0;	/* 1980-01-01 00:00 */
+static const uint8_t ucCharOffsets[ mkfatLFN_CHARS ] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+
+	if( pucFixedShort != NULL )
+	{
+		/* The "." and ".." entries. */
+		memcpy( pucShort, pucFixedShort, 11 );
+	}
+	else
+	{
+		ulLongEntries = prvLongNameEntries( pcName );
+		if( prvFitsShortName( pcName, pucShort, &ucCase ) == 0 )
+		{
+			prvMakeAlias( pxDir, pcName, pucShort );
+		}
+		else if( prvShortNameUsed( pxDir, pucShort ) != 0 )
+		{
+			prvFatal( "duplicate name", pcName );
+		}
+	}
+
+	xNameLength = strlen( pcName );
+	ucSum = prvShortNameChecksum( pucShort );
+	for( ulOrdinal = ulLongEntries; ulOrdinal > 0; ulOrdinal-- )
+	{
+		pucEntry = prvNextEntry( pxDir );
+		pucEntry[ 0 ] = ( uint8_t ) ( ulOrdinal | ( ( ulOrdinal == ulLongEntries ) ? 0x40u : 0u ) );
+		pucEntry[ 11 ] = mkfatATTR_LFN;
+		pucEntry[ 13 ] = ucSum;
+		for( ulChar = 0; ulChar < mkfatLFN_CHARS; ulChar++ )
+		{
+			size_t xIndex = ( ( ulOrdinal - 1 ) * mkfatLFN_CHARS ) + ulChar;
+
+			if( xIndex < xNameLength )
+			{
+				prvPutShort( pucEntry, ucCharOffsets[ ulChar ], ( unsigned char ) pcName[ xIndex ] );
+			}
+			else if( xIndex == xNameLength )
+			{
+				prvPutShort( pucEntry, ucCharOffsets[ ulChar ], 0x0000 );
+			}
+			else
+			{
+				prvPutShort( pucEntry, ucCharOffsets[ ulChar ], 0xFFFF );
+			}
+		}
+	}
+
+	if( ( pxTime != NULL ) && ( pxTime->tm_year >= 80 ) )
+	{
+		ulDate = ( ( uint32_t ) ( pxTime->tm_year - 80 ) << 9 ) | ( ( uint32_t ) ( pxTime->tm_mon + 1 ) << 5 ) | ( uint32_t ) pxTime->tm_mday;
+		ulTime = ( ( uint32_t ) pxTime->tm_hour << 11 ) | ( ( uint32_t ) pxTime->tm_min << 5 ) | ( ( uint32_t ) pxTime->tm_sec / 2 );
+	}
+
+	pucEntry = prvNextEntry( pxDir );
+	memcpy( pucEntry, pucShort, 11 );
+	pucEntry[ 11 ] = ucAttributes;
+	pucEntry[ 12 ] = ucCase;
+	prvPutShort( pucEntry, 14, ulTime );
+	prvPutShort( pucEntry, 16, ulDate );
+	prvPutShort( pucEntry, 18, ulDate );
+	prvPutShort( pucEntry, 22, ulTime );
+	prvPutShort( pucEntry, 24, ulDate );
+	prvPutShort( pucEntry, 26, ulCluster );
+	prvPutLong( pucEntry, 28, ulSize );
+}
+/*-----------------------------------------------------------*/
+
+static const char *prvBaseName( const char *pcPath )
+{
+const char *pcSlash = strrchr( pcPath, '/' );
+
+	return ( pcSlash != NULL ) ? pcSlash + 1 : pcPath;
+}
+/*-----------------------------------------------------------*/
+
+static int prvSkipEntry( const struct dirent *pxEntry )
+{
+	return ( strcmp( pxEntry->d_name, "." ) != 0 ) && ( strcmp( pxEntry->d_name, ".." ) != 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddPath( Volume_t *pxVolume, DirWriter_t *pxParent, uint32_t ulParentCluster, const char *pcPath, const char *pcName );
+
+/* Add a directory: its own entries first, so that the directory is followed
+directly by the files in it. */
+static void prvAddDirectory( Volume_t *pxVolume, DirWriter_t *pxParent, uint32_t ulParentCluster, const char *pcPath, const char *pcName, time_t xTime )
+{
+struct dirent **ppxList;
+int iCount, i;
+uint32_t ulEntries = 2, ulCluster;
+DirWriter_t xDir;
+static const uint8_t ucDot[ 11 ] = { '.', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ' };
+static const uint8_t ucDotDot[ 11 ] = { '.', '.', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ' };
+char pcChild[ 4096 ];
+
+	iCount = scandir( pcPath, &ppxList, prvSkipEntry, alphasort );
+	if( iCount < 0 )
+	{
+		prvFatal( "cannot read directory", pcPath );
+	}
+
+	for( i = 0; i < iCount; i++ )
+	{
+		ulEntries += prvLongNameEntries( ppxList[ i ]->d_name ) + 1;
+	}
+
+	/* Always leave room for one more entry, so a directory never starts out
+	completely full. */
+	ulCluster = prvAllocateRun( pxVolume, ( uint64_t ) ( ulEntries + 1 ) * mkfatENTRY_SIZE );
+	prvAddEntry( pxParent, pcName, NULL, mkfatATTR_DIR, ulCluster, 0, xTime );
+
+	xDir.pucEntries = prvClusterAddress( pxVolume, ulCluster );
+	xDir.ulEntryCount = ( pxVolume->ulNextFreeCluster - ulCluster ) * pxVolume->ulSectorsPerCluster * ( mkfatSECTOR_SIZE / mkfatENTRY_SIZE );
+	xDir.ulUsed = 0;
+	prvAddEntry( &xDir, ".", ucDot, mkfatATTR_DIR, ulCluster, 0, xTime );
+	prvAddEntry( &xDir, "..", ucDotDot, mkfatATTR_DIR, ulParentCluster, 0, xTime );
+
+	for( i = 0; i < iCount; i++ )
+	{
+		snprintf( pcChild, sizeof( pcChild ), "%s/%s", pcPath, ppxList[ i ]->d_name );
+		prvAddPath( pxVolume, &xDir, ulCluster, pcChild, ppxList[ i ]->d_name );
+		free( ppxList[ i ] );
+	}
+	free( ppxList );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddPath( Volume_t *pxVolume, DirWriter_t *pxParent, uint32_t ulParentCluster, const char *pcPath, const char *pcName )
+{
+struct stat xStat;
+uint32_t ulCluster;
+FILE *pxFile;
+
+	if( ( strlen( pcName ) == 0 ) || ( strlen( pcName ) > mkfatMAX_NAME ) )
+	{
+		prvFatal( "invalid name", pcPath );
+	}
+
+	if( stat( pcPath, &xStat ) != 0 )
+	{
+		prvFatal( "cannot stat", pcPath );
+	}
+
+	if( S_ISDIR( xStat.st_mode ) )
+	{
+		prvAddDirectory( pxVolume, pxParent, ulParentCluster, pcPath, pcName, xStat.st_mtime );
+	}
+	else if( S_ISREG( xStat.st_mode ) )
+	{
+		if( ( uint64_t ) xStat.st_size > 0xFFFFFFFFull )
+		{
+			prvFatal( "file too large", pcPath );
+		}
+
+		ulCluster = prvAllocateRun( pxVolume, ( uint64_t ) xStat.st_size );
+		if( ulCluster != 0 )
+		{
+			pxFile = fopen( pcPath, "rb" );
+			if( ( pxFile == NULL ) ||
+				( fread( prvClusterAddress( pxVolume, ulCluster ), 1, ( size_t ) xStat.st_size, pxFile ) != ( size_t ) xStat.st_size ) )
+			{
+				prvFatal( "cannot read", pcPath );
+			}
+			fclose( pxFile );
+		}
+		prvAddEntry( pxParent, pcName, NULL, mkfatATTR_ARCHIVE, ulCluster, ( uint32_t ) xStat.st_size, xStat.st_mtime );
+	}
+	else
+	{
+		fprintf( stderr, "mkfatimage: skipping special file %s\n", pcPath );
+	}
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char **argv )
+{
+Volume_t xVolume;
+DirWriter_t xRoot;
+uint32_t ulDiskSectors = mkfatDEFAULT_SECTORS, ulUsedSectors;
+const char *pcOutput = NULL;
+char pcPath[ 4096 ];
+size_t xLength;
+FILE *pxOut;
+int iOption;
+
+	memset( &xVolume, '\0', sizeof( xVolume ) );
+	xVolume.ulHiddenSectors = mkfatDEFAULT_HIDDEN;
+
+	while( ( iOption = getopt( argc, argv, "n:h:o:" ) ) != -1 )
+	{
+		switch( iOption )
+		{
+		case 'n':
+			ulDiskSectors = ( uint32_t ) strtoul( optarg, NULL, 0 );
+			break;
+		case 'h':
+			xVolume.ulHiddenSectors = ( uint32_t ) strtoul( optarg, NULL, 0 );
+			break;
+		case 'o':
+			pcOutput = optarg;
+			break;
+		default:
+			pcOutput = NULL;
+			optind = argc;
+			break;
+		}
+	}
+
+	if( ( pcOutput == NULL ) || ( ulDiskSectors <= xVolume.ulHiddenSectors ) || ( xVolume.ulHiddenSectors == 0 ) )
+	{
+		fprintf( stderr, "Usage: mkfatimage [-n sectors] [-h hidden] -o image path...\n" );
+		return EXIT_FAILURE;
+	}
+
+	xVolume.ulPartitionSectors = ulDiskSectors - xVolume.ulHiddenSectors;
+	prvComputeGeometry( &xVolume );
+
+	xVolume.pucDisk = calloc( ulDiskSectors, mkfatSECTOR_SIZE );
+	if( xVolume.pucDisk == NULL )
+	{
+		prvFatal( "out of memory", NULL );
+	}
+	xVolume.pucPartition = xVolume.pucDisk + ( xVolume.ulHiddenSectors * mkfatSECTOR_SIZE );
+	prvWriteMBRAndBootSector( &xVolume );
+
+	xRoot.pucEntries = xVolume.pucPartition + ( ( mkfatRESERVED_SECTORS + ( mkfatNUMBER_OF_FATS * xVolume.ulSectorsPerFAT ) ) * mkfatSECTOR_SIZE );
+	xRoot.ulEntryCount = mkfatROOT_ENTRIES;
+	xRoot.ulUsed = 0;
+
+	for( ; optind < argc; optind++ )
+	{
+		/* Strip trailing slashes, 'tar' stores "rootfs/" as "rootfs". */
+		snprintf( pcPath, sizeof( pcPath ), "%s", argv[ optind ] );
+		for( xLength = strlen( pcPath ); ( xLength > 1 ) && ( pcPath[ xLength - 1 ] == '/' ); xLength-- )
+		{
+			pcPath[ xLength - 1 ] = '\0';
+		}
+		prvAddPath( &xVolume, &xRoot, 0, pcPath, prvBaseName( pcPath ) );
+	}
+
+	/* The second FAT is a copy of the first one. */
+	memcpy( xVolume.pucPartition + ( ( mkfatRESERVED_SECTORS + xVolume.ulSectorsPerFAT ) * mkfatSECTOR_SIZE ),
+		xVolume.pucPartition + ( mkfatRESERVED_SECTORS * mkfatSECTOR_SIZE ),
+		xVolume.ulSectorsPerFAT * mkfatSECTOR_SIZE );
+
+	ulUsedSectors = xVolume.ulHiddenSectors + xVolume.ulFirstDataSector + ( ( xVolume.ulNextFreeCluster - 2 ) * xVolume.ulSectorsPerCluster );
+
+	pxOut = fopen( pcOutput, "wb" );
+	if( ( pxOut == NULL ) ||
+		( fwrite( xVolume.pucDisk, mkfatSECTOR_SIZE, ulUsedSectors, pxOut ) != ulUsedSectors ) ||
+		( fclose( pxOut ) != 0 ) )
+	{
+		prvFatal( "cannot write", pcOutput );
+	}
+
+	printf( "mkfatimage: %s: %lu of %lu sectors used, %lu clusters of %lu bytes\n", pcOutput,
+		( unsigned long ) ulUsedSectors, ( unsigned long ) ulDiskSectors,
+		( unsigned long ) xVolume.ulClusterCount, ( unsigned long ) ( xVolume.ulSectorsPerCluster * mkfatSECTOR_SIZE ) );
+	free( xVolume.pucDisk );
+
+	return EXIT_SUCCESS;
+}
+/*-----------------------------------------------------------*/